@@ -17,10 +17,13 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "tensorflow/core/common_runtime/collective_executor_mgr.h"
@@ -63,6 +66,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/core/threadpool_options.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/numbers.h"
@@ -89,6 +93,11 @@ auto* direct_session_runs = monitoring::Counter<0>::New(
     "/tensorflow/core/direct_session_runs",
     "The number of times DirectSession::Run() has been called.");
 
+// Maximum number of released call frames kept per set of feeds and fetches.
+// Calls beyond this many concurrent ones build a frame that is freed when they
+// return.
+constexpr size_t kMaxPooledCallFrames = 16;
+
 absl::Status NewThreadPoolFromThreadPoolOptions(
     const SessionOptions& options,
     const ThreadPoolOptionProto& thread_pool_options, int pool_number,
@@ -840,6 +849,101 @@ absl::Status DirectSession::RunInternal(
   return absl::OkStatus();
 }
 
+// The call frame of a `DirectSession::Run()` step. Unlike `FunctionCallFrame`,
+// it can be reset after the step and reused by later steps with the same
+// feeds and fetches.
+class DirectSession::RunCallFrame : public CallFrameInterface {
+ public:
+  explicit RunCallFrame(const ExecutorsAndKeys* executors_and_keys)
+      : executors_and_keys_(executors_and_keys),
+        args_(executors_and_keys->input_types.size()),
+        rets_(executors_and_keys->output_types.size()) {}
+
+  size_t num_args() const override { return args_.size(); }
+  size_t num_retvals() const override { return rets_.size(); }
+
+  // Sets the argument at `index`, which must match the type of the feed.
+  absl::Status SetArg(int index, Tensor val) {
+    const DataType expected = executors_and_keys_->input_types[index];
+    if (TF_PREDICT_FALSE(val.dtype() != expected)) {
+      return errors::InvalidArgument("Expects arg[", index, "] to be ",
+                                     DataTypeString(expected), " but ",
+                                     DataTypeString(val.dtype()),
+                                     " is provided");
+    }
+    args_[index] = std::move(val);
+    return absl::OkStatus();
+  }
+
+  absl::Status GetArg(int index, const Tensor** val) override {
+    if (TF_PREDICT_FALSE(index < 0 ||
+                         static_cast<size_t>(index) >= args_.size())) {
+      return errors::Internal("Args index out of bounds: ", index);
+    }
+    *val = &args_[index];
+    return absl::OkStatus();
+  }
+
+  absl::Status SetRetval(int index, const Tensor& val) override {
+    if (TF_PREDICT_FALSE(index < 0 ||
+                         static_cast<size_t>(index) >= rets_.size())) {
+      return errors::Internal("RetVal index out of bounds: ", index);
+    }
+    const DataType expected = executors_and_keys_->output_types[index];
+    if (TF_PREDICT_FALSE(val.dtype() != expected)) {
+      return errors::InvalidArgument("Expects ret[", index, "] to be ",
+                                     DataTypeString(expected), ", but ",
+                                     DataTypeString(val.dtype()),
+                                     " is provided.");
+    }
+    Retval* item = &rets_[index];
+    if (TF_PREDICT_FALSE(item->has_val)) {
+      return errors::Internal("Retval[", index, "] has already been set.");
+    }
+    item->has_val = true;
+    item->val = val;
+    return absl::OkStatus();
+  }
+
+  // Returns an error if the step did not set every return value.
+  absl::Status CheckRetvals() const {
+    for (size_t i = 0; i < rets_.size(); ++i) {
+      if (TF_PREDICT_FALSE(!rets_[i].has_val)) {
+        return errors::InvalidArgument("Retval[", i, "] does not have value");
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Moves out the return value at `index`.
+  Tensor TakeRetval(int index) {
+    rets_[index].has_val = false;
+    return std::move(rets_[index].val);
+  }
+
+  // Drops the arguments and any return values that were not taken, so that
+  // the tensors are not kept alive while the frame waits in the pool.
+  void Reset() {
+    for (Tensor& arg : args_) {
+      arg = Tensor();
+    }
+    for (Retval& ret : rets_) {
+      ret.has_val = false;
+      ret.val = Tensor();
+    }
+  }
+
+ private:
+  struct Retval {
+    bool has_val = false;
+    Tensor val;
+  };
+
+  const ExecutorsAndKeys* const executors_and_keys_;  // Not owned.
+  absl::InlinedVector<Tensor, 4UL> args_;
+  absl::InlinedVector<Retval, 4UL> rets_;
+};
+
 absl::Status DirectSession::Run(const RunOptions& run_options,
                                 const NamedTensorList& inputs,
                                 const std::vector<string>& output_names,
@@ -885,27 +989,46 @@ absl::Status DirectSession::Run(
   }
 
   // Configure a call frame for the step, which we use to feed and
-  // fetch values to and from the executors.
-  FunctionCallFrame call_frame(executors_and_keys->input_types,
-                               executors_and_keys->output_types);
-  absl::InlinedVector<Tensor, 4UL> feed_args(inputs.size());
+  // fetch values to and from the executors. Steps with the same feeds and
+  // fetches share a pool of frames, so that steady-state calls do not build
+  // a new one.
+  std::unique_ptr<RunCallFrame> call_frame;
+  {
+    mutex_lock l(executors_and_keys->call_frames_mu);
+    if (!executors_and_keys->call_frames.empty()) {
+      call_frame = std::move(executors_and_keys->call_frames.back());
+      executors_and_keys->call_frames.pop_back();
+    }
+  }
+  if (call_frame == nullptr) {
+    call_frame = std::make_unique<RunCallFrame>(executors_and_keys);
+  }
+  auto release_call_frame =
+      gtl::MakeCleanup([executors_and_keys, &call_frame]() {
+        call_frame->Reset();
+        mutex_lock l(executors_and_keys->call_frames_mu);
+        if (executors_and_keys->call_frames.size() < kMaxPooledCallFrames) {
+          executors_and_keys->call_frames.push_back(std::move(call_frame));
+        }
+      });
+
+  if (inputs.size() != executors_and_keys->input_types.size()) {
+    return errors::InvalidArgument(
+        "Expects ", executors_and_keys->input_types.size(), " arguments, but ",
+        inputs.size(), " is provided");
+  }
   for (const auto& it : inputs) {
+    const int index = executors_and_keys->input_name_to_index[it.first];
     if (it.second.dtype() == DT_RESOURCE) {
       Tensor tensor_from_handle;
       TF_RETURN_IF_ERROR(
           ResourceHandleToInputTensor(it.second, &tensor_from_handle));
-      feed_args[executors_and_keys->input_name_to_index[it.first]] =
-          tensor_from_handle;
+      TF_RETURN_IF_ERROR(
+          call_frame->SetArg(index, std::move(tensor_from_handle)));
     } else {
-      feed_args[executors_and_keys->input_name_to_index[it.first]] = it.second;
+      TF_RETURN_IF_ERROR(call_frame->SetArg(index, it.second));
     }
   }
-  const absl::Status s = call_frame.SetArgs(feed_args);
-  if (errors::IsInternal(s)) {
-    return errors::InvalidArgument(s.message());
-  } else if (!s.ok()) {
-    return s;
-  }
 
   const int64_t step_id = step_id_counter_.fetch_add(1);
 
@@ -913,20 +1036,13 @@ absl::Status DirectSession::Run(
     LogMemory::RecordStep(step_id, run_state_args.handle);
   }
 
-  TF_RETURN_IF_ERROR(RunInternal(step_id, run_options, &call_frame,
+  TF_RETURN_IF_ERROR(RunInternal(step_id, run_options, call_frame.get(),
                                  executors_and_keys, run_metadata,
                                  threadpool_options));
 
   // Receive outputs.
   if (outputs) {
-    std::vector<Tensor> sorted_outputs;
-    const absl::Status s = call_frame.ConsumeRetvals(
-        &sorted_outputs, /* allow_dead_tensors = */ false);
-    if (errors::IsInternal(s)) {
-      return errors::InvalidArgument(s.message());
-    } else if (!s.ok()) {
-      return s;
-    }
+    TF_RETURN_IF_ERROR(call_frame->CheckRetvals());
     const bool unique_outputs =
         output_names.size() == executors_and_keys->output_name_to_index.size();
     // first_indices[i] = j implies that j is the smallest value for which
@@ -942,13 +1058,12 @@ absl::Status DirectSession::Run(
     }
     outputs->clear();
     size_t output_size = 0;
-    outputs->reserve(sorted_outputs.size());
+    outputs->reserve(output_names.size());
     for (int i = 0; i < output_names.size(); ++i) {
       const string& output_name = output_names[i];
       if (first_indices.empty() || first_indices[i] == i) {
-        outputs->emplace_back(
-            std::move(sorted_outputs[executors_and_keys
-                                         ->output_name_to_index[output_name]]));
+        outputs->emplace_back(call_frame->TakeRetval(
+            executors_and_keys->output_name_to_index[output_name]));
       } else {
         outputs->push_back((*outputs)[first_indices[i]]);
       }
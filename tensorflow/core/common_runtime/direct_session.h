@@ -149,6 +149,8 @@ class DirectSession : public Session {
     std::unique_ptr<Executor> executor;
   };
 
+  class RunCallFrame;
+
   // An ExecutorsAndKeys is created for a given set of feeds/fetches.
   // 'step_count' is the number of times this graph is executed.
   // 'graph' is the entire graph being executed. 'name_to_node'
@@ -175,6 +177,13 @@ class DirectSession : public Session {
     CallableOptions callable_options;
 
     int64_t collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+
+    // Call frames released by finished `Run()` calls with these feeds and
+    // fetches. Later calls reuse them instead of building a new frame. Holds
+    // at most `kMaxPooledCallFrames` frames.
+    mutex call_frames_mu;
+    std::vector<std::unique_ptr<RunCallFrame>> call_frames
+        TF_GUARDED_BY(call_frames_mu);
   };
 
   // A FunctionInfo object is created for every unique set of feeds/fetches.
@@ -549,6 +549,36 @@ TEST_F(DirectSessionMinusAXTest, TestFeed_Callable) {
   EXPECT_FLOAT_EQ(39.0, mat(1, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, TestFeedRepeatedly) {
+  Initialize({1, 2, 3, 4});
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // Steps with the same feeds and fetches reuse the call frame of earlier
+  // steps, so check that no feed or fetch leaks from one step to the next,
+  // including after a step that fails.
+  std::vector<string> output_names = {y_ + ":0"};
+  for (int i = 0; i < 10; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({2, 1}));
+    t.matrix<float>()(0, 0) = i;
+    t.matrix<float>()(1, 0) = 1;
+    std::vector<std::pair<string, Tensor>> inputs = {{x_, t}};
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run(inputs, output_names, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    auto mat = outputs[0].matrix<float>();
+    EXPECT_FLOAT_EQ(i + 2, mat(0, 0));
+    EXPECT_FLOAT_EQ(3 * i + 4, mat(1, 0));
+
+    // Feeding the wrong type fails without affecting the next step.
+    Tensor bad(DT_INT32, TensorShape({2, 1}));
+    inputs = {{x_, bad}};
+    absl::Status s = session->Run(inputs, output_names, {}, &outputs);
+    EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  }
+}
+
 TEST_F(DirectSessionMinusAXTest, TestConcurrency) {
   Initialize({1, 2, 3, 4});
   auto session = CreateSession();
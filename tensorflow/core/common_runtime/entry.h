@@ -107,6 +107,7 @@ struct Entry {
       val.Destroy();
     }
     state = State::NO_VALUE;
+    alloc_attr = AllocatorAttributes();
   }
 
   union {
@@ -17,7 +17,11 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <functional>
+#include <map>
 #include <memory>
+#include <queue>
 #include <utility>
 #include <vector>
 
@@ -62,6 +66,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -141,17 +146,97 @@ struct KernelTimer {
   }
 };
 
+// The step (an `ExecutorState`) and slot of the work-stealing worker running on
+// the current thread, if any.
+thread_local std::pair<const void*, int> current_work_stealing_worker = {
+    nullptr, -1};
+
+// Runs the stall checks of all work-stealing steps on one thread, so that
+// scheduling a check doesn't start a thread. The thread is started by the
+// first check.
+class StallCheckTimer {
+ public:
+  static StallCheckTimer* Global() {
+    static StallCheckTimer* timer = new StallCheckTimer;
+    return timer;
+  }
+
+  // Runs `check` on the timer thread in `delay_micros`. `check` must not
+  // block.
+  void Schedule(int64_t delay_micros, std::function<void()> check) {
+    const uint64 deadline = Env::Default()->NowMicros() + delay_micros;
+    mutex_lock l(mu_);
+    if (thread_ == nullptr) {
+      thread_.reset(Env::Default()->StartThread(
+          ThreadOptions(), "tf_executor_stall_check", [this]() { Run(); }));
+    }
+    const bool earliest = checks_.empty() || deadline < checks_.begin()->first;
+    checks_.emplace(deadline, std::move(check));
+    if (earliest) cv_.notify_one();
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::vector<std::function<void()>> due;
+      {
+        mutex_lock l(mu_);
+        while (due.empty()) {
+          const uint64 now = Env::Default()->NowMicros();
+          while (!checks_.empty() && checks_.begin()->first <= now) {
+            due.push_back(std::move(checks_.begin()->second));
+            checks_.erase(checks_.begin());
+          }
+          if (!due.empty()) break;
+          if (checks_.empty()) {
+            cv_.wait(l);
+          } else {
+            cv_.wait_for(
+                l, std::chrono::microseconds(checks_.begin()->first - now));
+          }
+        }
+      }
+      for (const std::function<void()>& check : due) check();
+    }
+  }
+
+  mutex mu_;
+  condition_variable cv_;
+  // Pending checks by deadline, in microseconds.
+  std::multimap<uint64, std::function<void()>> checks_ TF_GUARDED_BY(mu_);
+  // Never joined, as the timer is never deleted.
+  std::unique_ptr<Thread> thread_ TF_GUARDED_BY(mu_);
+};
+
 // TODO(b/152925936): Re-evaluate these constants with current usage patterns.
 typedef absl::InlinedVector<TensorValue, 4UL> TensorValueVec;
 typedef absl::InlinedVector<AllocatorAttributes, 4UL> AllocatorAttributeVec;
 
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  // How ready nodes that are not run inline get dispatched to the runner.
+  enum class Scheduling {
+    // One closure per node, in the order in which nodes become ready.
+    kDefault,
+    // One closure per node, but the closures process the ready nodes with the
+    // longest estimated remaining critical path first.
+    kCriticalPath,
+    // Nodes are pushed to the queue of the thread that made them ready, and
+    // idle threads steal from the queues of busy ones. A closure is only
+    // scheduled to wake up another thread.
+    kWorkStealing,
+  };
+
+  explicit ExecutorImpl(const LocalExecutorParams& p,
+                        Scheduling scheduling = Scheduling::kDefault)
+      : immutable_state_(p), scheduling_(scheduling) {}
 
   absl::Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
     kernel_stats_.Initialize(immutable_state_.graph_view());
+    if (scheduling_ == Scheduling::kCriticalPath) {
+      kernel_stats_.InitializeCriticalPath(immutable_state_.graph_view());
+    }
     return absl::OkStatus();
   }
 
@@ -210,6 +295,79 @@ class ExecutorImpl : public Executor {
       cost_estimate.store(new_estimate, std::memory_order_relaxed);
     }
 
+    // Computes a topological order of the graph, ignoring the back edges out
+    // of NextIteration nodes, and the initial critical path costs.
+    void InitializeCriticalPath(const GraphView& gview) {
+      const int32_t num_nodes = gview.num_nodes();
+      std::vector<int32_t> pending(num_nodes, 0);
+      for (int32_t i = 0; i < num_nodes; ++i) {
+        const NodeItem* item = gview.node(i);
+        if (item == nullptr || item->is_next_iteration) continue;
+        for (const EdgeInfo& e : item->output_edges()) ++pending[e.dst_id];
+        for (const ControlEdgeInfo& e : item->output_control_edges()) {
+          ++pending[e.dst_id];
+        }
+      }
+      topological_order_.reserve(num_nodes);
+      for (int32_t i = 0; i < num_nodes; ++i) {
+        if (gview.node(i) && pending[i] == 0) topological_order_.push_back(i);
+      }
+      for (size_t i = 0; i < topological_order_.size(); ++i) {
+        const NodeItem* item = gview.node(topological_order_[i]);
+        if (item->is_next_iteration) continue;
+        for (const EdgeInfo& e : item->output_edges()) {
+          if (--pending[e.dst_id] == 0) topological_order_.push_back(e.dst_id);
+        }
+        for (const ControlEdgeInfo& e : item->output_control_edges()) {
+          if (--pending[e.dst_id] == 0) topological_order_.push_back(e.dst_id);
+        }
+      }
+      critical_path_costs_ =
+          std::make_unique<std::atomic_uint_fast64_t[]>(num_nodes);
+      for (int32_t i = 0; i < num_nodes; ++i) critical_path_costs_[i] = 0;
+      UpdateCriticalPath(gview);
+    }
+
+    // Returns true iff `InitializeCriticalPath()` has been called.
+    bool HasCriticalPath() const { return critical_path_costs_ != nullptr; }
+
+    // Returns the estimated cost, in CPU cycles, of the most expensive path
+    // from the given node (inclusive) to any sink of the graph. Nodes with a
+    // higher cost are on a longer remaining path and should run first.
+    uint64 CriticalPathCost(const NodeItem& node) const {
+      return critical_path_costs_[node.node_id].load(std::memory_order_relaxed);
+    }
+
+    // Recomputes the critical path costs from the current cost estimates.
+    // Kernels without the expensive marker are never timed and count as
+    // `kInexpensiveCostEstimateCycles`. Like `UpdateCostEstimate()`,
+    // concurrent updates are benign.
+    void UpdateCriticalPath(const GraphView& gview) {
+      for (auto it = topological_order_.rbegin();
+           it != topological_order_.rend(); ++it) {
+        const NodeItem* item = gview.node(*it);
+        uint64 downstream_cost = 0;
+        if (!item->is_next_iteration) {
+          for (const EdgeInfo& e : item->output_edges()) {
+            downstream_cost = std::max<uint64>(
+                downstream_cost, critical_path_costs_[e.dst_id].load(
+                                     std::memory_order_relaxed));
+          }
+          for (const ControlEdgeInfo& e : item->output_control_edges()) {
+            downstream_cost = std::max<uint64>(
+                downstream_cost, critical_path_costs_[e.dst_id].load(
+                                     std::memory_order_relaxed));
+          }
+        }
+        const uint64 cost =
+            is_expensive_[*it]
+                ? cost_estimates_[*it].load(std::memory_order_relaxed)
+                : kInexpensiveCostEstimateCycles;
+        critical_path_costs_[*it].store(cost + downstream_cost,
+                                        std::memory_order_relaxed);
+      }
+    }
+
    private:
     // Initial time (in CPU cycles) we expect an operation to take.  Used to
     // determine whether an operation should be place in a threadpool.
@@ -217,14 +375,27 @@ class ExecutorImpl : public Executor {
     static constexpr uint64 kInitialCostEstimateCycles = 100 * 1000 * 1000;
     static constexpr uint64 kOpIsExpensiveThresholdCycles = 8000;
     static constexpr uint64 kCostDecay = 10;
+    // Cost (in CPU cycles) assumed for kernels that are not marked expensive
+    // when computing critical path costs.
+    static constexpr uint64 kInexpensiveCostEstimateCycles = 1000;
 
     std::vector<bool> is_expensive_;
     // std::unique_ptr<std::atomic<bool>[]> is_expensive_;
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
+
+    // Only set if the executor prioritizes the critical path.
+    std::vector<int32_t> topological_order_;
+    std::unique_ptr<std::atomic_uint_fast64_t[]> critical_path_costs_;
   };
 
+  // Number of steps between recomputations of the critical path costs from
+  // the measured kernel costs.
+  static constexpr int64_t kCriticalPathUpdateInterval = 100;
+
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  const Scheduling scheduling_;
+  std::atomic<int64_t> num_steps_{0};
 
   ExecutorImpl(const ExecutorImpl&) = delete;
   void operator=(const ExecutorImpl&) = delete;
@@ -284,7 +455,8 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                ExecutorImpl::Scheduling scheduling);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -297,6 +469,7 @@ class ExecutorState {
   typedef typename PropagatorStateType::TaggedNodeSeq TaggedNodeSeq;
 
   struct AsyncState;
+  struct QueuedNode;
 
   // Process a ready node in current thread.
   void Process(const TaggedNode& node, int64_t scheduled_nsec);
@@ -341,6 +514,58 @@ class ExecutorState {
   // REQUIRES: `!ready->empty()`.
   void ScheduleReady(TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready);
 
+  // Like the default branch of `ScheduleReady()`, but nodes that are not
+  // inlined go through `ready_queue_`, so that the thread pool always picks up
+  // the ready node with the highest critical path cost.
+  void ScheduleReadyByCriticalPath(TaggedNodeSeq* ready,
+                                   TaggedNodeReadyQueue* inline_ready,
+                                   int64_t scheduled_nsec);
+
+  // Processes the node with the highest critical path cost in `ready_queue_`.
+  //
+  // REQUIRES: `ready_queue_` has an entry for this call.
+  void ProcessHighestPriority();
+
+  // Like the default branch of `ScheduleReady()`, but nodes that are not
+  // inlined go to the queue of the current worker, if the current thread is a
+  // work-stealing worker of this step, and idle workers are woken up to steal
+  // them.
+  void ScheduleReadyByWorkStealing(TaggedNodeSeq* ready,
+                                   TaggedNodeReadyQueue* inline_ready,
+                                   int64_t scheduled_nsec);
+
+  // Claims up to `max_workers` idle worker slots and stores them in
+  // `*workers`. Each claimed worker counts as a deferred op until it exits,
+  // so the step cannot finish before its workers.
+  void ClaimIdleWorkers(int max_workers, std::vector<int>* workers);
+
+  // Runs the work-stealing worker in slot `worker`: processes `first` (if
+  // not null), and then the nodes in its own queue or stolen from the queues
+  // of other workers, until no queued nodes are left.
+  //
+  // REQUIRES: `worker` was claimed by `ClaimIdleWorkers()`.
+  void WorkerLoop(int worker, const TaggedNode* first, int64_t scheduled_nsec);
+
+  // Returns the slot of the work-stealing worker of this step running on the
+  // current thread, or -1.
+  int CurrentWorker() const;
+
+  // Schedules a stall check on the `StallCheckTimer` in
+  // `kWorkStealingStallMicros`, unless one is already scheduled. Called when
+  // nodes are left in a worker queue while no idle worker can be woken up to
+  // steal them.
+  void MaybeScheduleStallCheck();
+
+  // Called by the stall check. If nodes have waited in the worker queues while
+  // no worker started a node since the check was scheduled, every worker is
+  // assumed to be blocked inside a kernel (e.g. one waiting for a queue that a
+  // queued node would fill), and the queued nodes are moved to
+  // `*stalled_nodes` so that they get one closure each. Otherwise schedules
+  // another check while nodes are queued.
+  //
+  // REQUIRES: the step has not been deleted.
+  void TakeStalledNodes(std::vector<QueuedNode>* stalled_nodes);
+
   // A wrapper for runner_ to keep track of the pending queue length. Op
   // execution should dispatch work using this function instead of using runner_
   // directly.
@@ -415,12 +640,74 @@ class ExecutorState {
 
   mutex mu_;
   absl::Status status_ TF_GUARDED_BY(mu_);
+
+  // A ready node waiting for a thread, ordered by critical path cost and then
+  // by the order in which nodes became ready.
+  struct PrioritizedNode {
+    uint64 priority;
+    uint64 sequence;
+    TaggedNode tagged_node;
+    int64_t scheduled_nsec;
+
+    bool operator<(const PrioritizedNode& other) const {
+      if (priority != other.priority) return priority < other.priority;
+      return sequence > other.sequence;
+    }
+  };
+
+  // How ready nodes are dispatched. Falls back to `kDefault` if kernels run
+  // inline or a deterministic op order is required.
+  const ExecutorImpl::Scheduling scheduling_;
+
+  // Used if `scheduling_` is `kCriticalPath`.
+  mutex ready_queue_mu_;
+  std::priority_queue<PrioritizedNode> ready_queue_
+      TF_GUARDED_BY(ready_queue_mu_);
+  uint64 next_ready_sequence_ TF_GUARDED_BY(ready_queue_mu_) = 0;
+
+  // Used if `scheduling_` is `kWorkStealing`.
+  struct QueuedNode {
+    TaggedNode tagged_node;
+    int64_t scheduled_nsec;
+  };
+  // The ready nodes of one worker. The owner pushes and pops at the back, and
+  // thieves take the oldest node at `head`.
+  struct WorkerQueue {
+    mutex mu;
+    std::vector<QueuedNode> nodes TF_GUARDED_BY(mu);
+    size_t head TF_GUARDED_BY(mu) = 0;
+  };
+  // Maximum number of workers per step, to bound the cost of stealing.
+  static constexpr int kMaxWorkStealingWorkers = 64;
+  // How long queued nodes may wait while no worker starts a node before they
+  // are dispatched as one closure per node.
+  static constexpr int64_t kWorkStealingStallMicros = 10 * 1000;
+  int num_workers_ = 0;
+  std::unique_ptr<WorkerQueue[]> worker_queues_;
+  // Never less than the number of nodes in `worker_queues_`.
+  std::atomic<int64_t> num_queued_nodes_{0};
+  // The number of nodes started by workers.
+  std::atomic<int64_t> num_worker_nodes_started_{0};
+  mutex workers_mu_;
+  std::vector<int> idle_workers_ TF_GUARDED_BY(workers_mu_);
+  // Set when the step finishes; no stall check is scheduled afterwards.
+  bool workers_closed_ TF_GUARDED_BY(workers_mu_) = false;
+  bool stall_check_scheduled_ TF_GUARDED_BY(workers_mu_) = false;
+  int64_t stall_check_nodes_started_ TF_GUARDED_BY(workers_mu_) = 0;
+  // Shared with scheduled stall checks, which may run after the step is
+  // deleted. `state` is cleared by the destructor.
+  struct StallCheckHandle {
+    mutex mu;
+    ExecutorState* state TF_GUARDED_BY(mu) = nullptr;
+  };
+  std::shared_ptr<StallCheckHandle> stall_check_handle_;
 };
 
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats,
+    ExecutorImpl::Scheduling scheduling)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -450,16 +737,33 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       sync_on_finish_(args.sync_on_finish),
       run_all_kernels_inline_(args.run_all_kernels_inline),
       propagator_(immutable_state, step_id_, vlog_),
-      num_outstanding_ops_(0) {
+      num_outstanding_ops_(0),
+      scheduling_(run_all_kernels_inline_ || OpOrderDeterminismRequired()
+                      ? ExecutorImpl::Scheduling::kDefault
+                      : scheduling) {
   if (args.user_intra_op_threadpool != nullptr) {
     Device* device = immutable_state_.params().device;
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (scheduling_ == ExecutorImpl::Scheduling::kWorkStealing) {
+    num_workers_ = std::min(port::MaxParallelism(), kMaxWorkStealingWorkers);
+    worker_queues_ = std::make_unique<WorkerQueue[]>(num_workers_);
+    idle_workers_.reserve(num_workers_);
+    for (int i = num_workers_ - 1; i >= 0; --i) idle_workers_.push_back(i);
+    stall_check_handle_ = std::make_shared<StallCheckHandle>();
+    mutex_lock l(stall_check_handle_->mu);
+    stall_check_handle_->state = this;
+  }
 }
 
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::~ExecutorState() {
+  if (stall_check_handle_ != nullptr) {
+    // Waits for a stall check that is looking at this step.
+    mutex_lock l(stall_check_handle_->mu);
+    stall_check_handle_->state = nullptr;
+  }
   if (device_context_) {
     device_context_->Unref();
   }
@@ -1299,6 +1603,10 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         inline_ready->push_back(tagged_node);
       }
     }
+  } else if (scheduling_ == ExecutorImpl::Scheduling::kCriticalPath) {
+    ScheduleReadyByCriticalPath(ready, inline_ready, scheduled_nsec);
+  } else if (scheduling_ == ExecutorImpl::Scheduling::kWorkStealing) {
+    ScheduleReadyByWorkStealing(ready, inline_ready, scheduled_nsec);
   } else {
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
@@ -1376,6 +1684,294 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ScheduleReadyByCriticalPath(
+    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready,
+    int64_t scheduled_nsec) {
+  int num_dispatched = 0;
+  {
+    mutex_lock l(ready_queue_mu_);
+    for (auto& tagged_node : *ready) {
+      const NodeItem& item = *tagged_node.node_item;
+      if (inline_ready != nullptr &&
+          (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item))) {
+        // Inline this inexpensive node.
+        inline_ready->push_back(tagged_node);
+        continue;
+      }
+      ready_queue_.push({kernel_stats_->CriticalPathCost(item),
+                         next_ready_sequence_++, tagged_node, scheduled_nsec});
+      ++num_dispatched;
+    }
+    if (inline_ready != nullptr && inline_ready->empty() &&
+        num_dispatched > 0) {
+      // Keep the most critical ready node of the step on this thread.
+      inline_ready->push_back(ready_queue_.top().tagged_node);
+      ready_queue_.pop();
+      --num_dispatched;
+    }
+  }
+  // Each task processes whichever node is the most critical when it starts,
+  // not necessarily one of the nodes pushed above.
+  const int threshold = kInlineScheduleReadyThreshold;
+  if (num_dispatched < threshold) {
+    for (int i = 0; i < num_dispatched; ++i) {
+      RunTask([this]() { ProcessHighestPriority(); },
+              /*sample_rate=*/num_dispatched);
+    }
+    return;
+  }
+  // There are too many ready expensive nodes. Schedule them in child threads.
+  for (int begin = 0; begin < num_dispatched; begin += threshold) {
+    const int chunk_size = std::min(threshold, num_dispatched - begin);
+    RunTask([this, chunk_size]() {
+      for (int i = 0; i < chunk_size; ++i) {
+        RunTask([this]() { ProcessHighestPriority(); },
+                /*sample_rate=*/chunk_size);
+      }
+    });
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ProcessHighestPriority() {
+  const PrioritizedNode node = [this]() {
+    mutex_lock l(ready_queue_mu_);
+    DCHECK(!ready_queue_.empty());
+    PrioritizedNode top = ready_queue_.top();
+    ready_queue_.pop();
+    return top;
+  }();
+  Process(node.tagged_node, node.scheduled_nsec);
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ScheduleReadyByWorkStealing(
+    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready,
+    int64_t scheduled_nsec) {
+  TaggedNodeSeq expensive_nodes;
+  for (auto& tagged_node : *ready) {
+    const NodeItem& item = *tagged_node.node_item;
+    if (inline_ready != nullptr &&
+        (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item))) {
+      // Inline this inexpensive node.
+      inline_ready->push_back(tagged_node);
+    } else {
+      expensive_nodes.push_back(tagged_node);
+    }
+  }
+  if (inline_ready != nullptr && inline_ready->empty() &&
+      !expensive_nodes.empty()) {
+    inline_ready->push_back(expensive_nodes.back());
+    expensive_nodes.pop_back();
+  }
+  if (expensive_nodes.empty()) return;
+
+  const int num_nodes = expensive_nodes.size();
+  const int worker = CurrentWorker();
+  std::vector<int> workers;
+  if (worker >= 0) {
+    // Keep the nodes for this worker, and wake up idle workers to steal the
+    // ones it will not get to right away.
+    num_queued_nodes_.fetch_add(num_nodes, std::memory_order_relaxed);
+    {
+      WorkerQueue& queue = worker_queues_[worker];
+      mutex_lock l(queue.mu);
+      for (auto& tagged_node : expensive_nodes) {
+        queue.nodes.push_back({tagged_node, scheduled_nsec});
+      }
+    }
+    ClaimIdleWorkers(num_nodes, &workers);
+    if (static_cast<int>(workers.size()) < num_nodes) {
+      // Some nodes wait until a busy worker gets to them, which never happens
+      // if all workers block.
+      MaybeScheduleStallCheck();
+    }
+    for (int idle_worker : workers) {
+      RunTask(
+          [this, idle_worker, scheduled_nsec]() {
+            WorkerLoop(idle_worker, /*first=*/nullptr, scheduled_nsec);
+          },
+          /*sample_rate=*/num_nodes);
+    }
+    return;
+  }
+
+  // The current thread is not a worker of this step, so it has no queue.
+  // Start a worker for each node while there are idle ones, and schedule a
+  // closure per node for the rest.
+  ClaimIdleWorkers(num_nodes, &workers);
+  const int num_workers = workers.size();
+  for (int i = 0; i < num_nodes; ++i) {
+    const TaggedNode tagged_node = expensive_nodes[i];
+    if (i < num_workers) {
+      RunTask(
+          [this, idle_worker = workers[i], tagged_node, scheduled_nsec]() {
+            WorkerLoop(idle_worker, &tagged_node, scheduled_nsec);
+          },
+          /*sample_rate=*/num_nodes);
+    } else {
+      RunTask([=]() { Process(tagged_node, scheduled_nsec); },
+              /*sample_rate=*/num_nodes);
+    }
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ClaimIdleWorkers(
+    int max_workers, std::vector<int>* workers) {
+  {
+    mutex_lock l(workers_mu_);
+    while (static_cast<int>(workers->size()) < max_workers &&
+           !idle_workers_.empty()) {
+      workers->push_back(idle_workers_.back());
+      idle_workers_.pop_back();
+    }
+  }
+  if (!workers->empty()) {
+    mutex_lock lock(num_deferred_ops_mu_);
+    num_deferred_ops_ += workers->size();
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::MaybeScheduleStallCheck() {
+  {
+    mutex_lock l(workers_mu_);
+    if (stall_check_scheduled_ || workers_closed_) return;
+    stall_check_scheduled_ = true;
+    stall_check_nodes_started_ =
+        num_worker_nodes_started_.load(std::memory_order_relaxed);
+  }
+  StallCheckTimer::Global()->Schedule(
+      kWorkStealingStallMicros, [handle = stall_check_handle_]() {
+        std::vector<QueuedNode> stalled_nodes;
+        ExecutorState* state;
+        {
+          mutex_lock l(handle->mu);
+          state = handle->state;
+          if (state == nullptr) return;
+          state->TakeStalledNodes(&stalled_nodes);
+        }
+        // The step cannot finish before the stalled nodes are processed, so
+        // `state` stays valid until the last closure is scheduled.
+        const int num_nodes = stalled_nodes.size();
+        for (const QueuedNode& node : stalled_nodes) {
+          state->RunTask(
+              [state, node]() {
+                state->Process(node.tagged_node, node.scheduled_nsec);
+              },
+              /*sample_rate=*/num_nodes);
+        }
+      });
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::TakeStalledNodes(
+    std::vector<QueuedNode>* stalled_nodes) {
+  bool reschedule = false;
+  {
+    mutex_lock l(workers_mu_);
+    stall_check_scheduled_ = false;
+    if (workers_closed_ ||
+        num_queued_nodes_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    if (num_worker_nodes_started_.load(std::memory_order_relaxed) !=
+        stall_check_nodes_started_) {
+      reschedule = true;
+    } else {
+      for (int i = 0; i < num_workers_; ++i) {
+        WorkerQueue& queue = worker_queues_[i];
+        mutex_lock queue_lock(queue.mu);
+        for (size_t j = queue.head; j < queue.nodes.size(); ++j) {
+          stalled_nodes->push_back(std::move(queue.nodes[j]));
+        }
+        queue.nodes.clear();
+        queue.head = 0;
+      }
+      num_queued_nodes_.fetch_sub(stalled_nodes->size(),
+                                  std::memory_order_relaxed);
+      metrics::RecordWorkStealingStalledNodes(stalled_nodes->size());
+      VLOG(1) << "No work-stealing worker of step " << step_id_
+              << " started a node in " << kWorkStealingStallMicros
+              << "us; dispatching " << stalled_nodes->size()
+              << " queued nodes as closures.";
+    }
+  }
+  if (reschedule) MaybeScheduleStallCheck();
+}
+
+template <class PropagatorStateType>
+int ExecutorState<PropagatorStateType>::CurrentWorker() const {
+  const auto& [state, worker] = current_work_stealing_worker;
+  return state == this ? worker : -1;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::WorkerLoop(int worker,
+                                                    const TaggedNode* first,
+                                                    int64_t scheduled_nsec) {
+  // Restored on exit, in case this thread runs a worker of a nested step.
+  const auto saved_worker = current_work_stealing_worker;
+  current_work_stealing_worker = {this, worker};
+  if (first != nullptr) {
+    num_worker_nodes_started_.fetch_add(1, std::memory_order_relaxed);
+    Process(*first, scheduled_nsec);
+  }
+
+  WorkerQueue& own_queue = worker_queues_[worker];
+  while (true) {
+    absl::optional<QueuedNode> node;
+    {
+      mutex_lock l(own_queue.mu);
+      if (own_queue.nodes.size() > own_queue.head) {
+        node = std::move(own_queue.nodes.back());
+        own_queue.nodes.pop_back();
+        if (own_queue.nodes.size() == own_queue.head) {
+          own_queue.nodes.clear();
+          own_queue.head = 0;
+        }
+      }
+    }
+    for (int i = 1; !node && i < num_workers_ &&
+                    num_queued_nodes_.load(std::memory_order_relaxed) > 0;
+         ++i) {
+      WorkerQueue& victim = worker_queues_[(worker + i) % num_workers_];
+      mutex_lock l(victim.mu);
+      if (victim.nodes.size() > victim.head) {
+        node = std::move(victim.nodes[victim.head++]);
+        if (victim.nodes.size() == victim.head) {
+          victim.nodes.clear();
+          victim.head = 0;
+        }
+      }
+    }
+    if (!node) break;
+    num_queued_nodes_.fetch_sub(1, std::memory_order_relaxed);
+    num_worker_nodes_started_.fetch_add(1, std::memory_order_relaxed);
+    Process(node->tagged_node, node->scheduled_nsec);
+  }
+
+  // Only this worker pushes to its queue, so no node can be left behind in it
+  // once the worker has found it empty.
+  current_work_stealing_worker = saved_worker;
+  {
+    mutex_lock l(workers_mu_);
+    idle_workers_.push_back(worker);
+  }
+  bool finish_when_deferred_ops_done = false;
+  {
+    mutex_lock lock(num_deferred_ops_mu_);
+    num_deferred_ops_--;
+    if (num_deferred_ops_ == 0) {
+      finish_when_deferred_ops_done = finish_when_deferred_ops_done_;
+    }
+  }
+  // This may delete `this`.
+  if (finish_when_deferred_ops_done) Finish();
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Checks condition to decide if needs to invoke Finish(). If there are
@@ -1383,6 +1979,10 @@ void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Finish(). Otherwise, invoke Finish() directly.
   // Note that it is critical that the ScheduleFinish / Finish codepath does not
   // block, otherwise we might deadlock.  See b/124523000 for details.
+  if (scheduling_ == ExecutorImpl::Scheduling::kWorkStealing) {
+    mutex_lock l(workers_mu_);
+    workers_closed_ = true;
+  }
   {
     mutex_lock lock(num_deferred_ops_mu_);
     if (num_deferred_ops_ > 0) {
@@ -1514,16 +2114,23 @@ void ExecutorState<PropagatorStateType>::Finish() {
 }
 
 void ExecutorImpl::RunAsyncInternal(const Args& args, DoneCallback done) {
+  if (scheduling_ == Scheduling::kCriticalPath &&
+      num_steps_.fetch_add(1, std::memory_order_relaxed) %
+              kCriticalPathUpdateInterval ==
+          kCriticalPathUpdateInterval - 1) {
+    kernel_stats_.UpdateCriticalPath(immutable_state_.graph_view());
+  }
   if (OpOrderDeterminismRequired()) {
     (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+                                               &kernel_stats_, scheduling_))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_,
+                                        scheduling_))
         ->RunAsync(std::move(done));
   } else {
     (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+                                              &kernel_stats_, scheduling_))
         ->RunAsync(std::move(done));
   }
 }
@@ -1563,6 +2170,12 @@ class DefaultExecutorRegistrar {
     Factory* factory = new Factory;
     ExecutorFactory::Register("", factory);
     ExecutorFactory::Register("DEFAULT", factory);
+    ExecutorFactory::Register(
+        "CRITICAL_PATH",
+        new SchedulingFactory<ExecutorImpl::Scheduling::kCriticalPath>);
+    ExecutorFactory::Register(
+        "WORK_STEALING",
+        new SchedulingFactory<ExecutorImpl::Scheduling::kWorkStealing>);
   }
 
  private:
@@ -1576,6 +2189,19 @@ class DefaultExecutorRegistrar {
       return absl::OkStatus();
     }
   };
+
+  // Creates executors that dispatch ready nodes with the given scheduling.
+  template <ExecutorImpl::Scheduling scheduling>
+  class SchedulingFactory : public ExecutorFactory {
+    absl::Status NewExecutor(const LocalExecutorParams& params,
+                             const Graph& graph,
+                             std::unique_ptr<Executor>* out_executor) override {
+      auto impl = std::make_unique<ExecutorImpl>(params, scheduling);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return absl::OkStatus();
+    }
+  };
 };
 static DefaultExecutorRegistrar registrar;
 
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
@@ -33,19 +34,24 @@ limitations under the License.
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/local_rendezvous.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -77,7 +83,8 @@ class ExecutorTest : public ::testing::Test {
   }
 
   // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
+  void Create(std::unique_ptr<const Graph> graph,
+              const string& executor_type = "") {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
@@ -92,7 +99,9 @@ class ExecutorTest : public ::testing::Test {
     };
     rendez_ = NewLocalRendezvous();
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    std::unique_ptr<Executor> exec;
+    TF_CHECK_OK(NewExecutor(executor_type, params, *graph, &exec));
+    exec_ = exec.release();
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
@@ -265,6 +274,130 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, CriticalPathRandomTree) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "CRITICAL_PATH");
+  // Enough steps for the critical path to be recomputed from measured costs.
+  for (int iters = 0; iters < 128; ++iters) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, WorkStealingRandomTree) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "WORK_STEALING");
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+// Blocks until "n" instances of the op run at the same time, like kernels
+// that wait for each other through queues.
+REGISTER_OP("ExecutorTestBarrier")
+    .Input("x: float")
+    .Output("y: float")
+    .Attr("n: int");
+
+class ExecutorTestBarrierOp : public OpKernel {
+ public:
+  explicit ExecutorTestBarrierOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("n", &n_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    static mutex* mu = new mutex;
+    static condition_variable* cv = new condition_variable;
+    static int64_t num_arrived = 0;
+    {
+      mutex_lock l(*mu);
+      const int64_t generation = num_arrived++ / n_;
+      if (num_arrived % n_ == 0) {
+        cv->notify_all();
+      } else {
+        while (num_arrived / n_ == generation) cv->wait(l);
+      }
+    }
+    context->set_output(0, context->input(0));
+  }
+
+ private:
+  int64_t n_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("ExecutorTestBarrier").Device(DEVICE_CPU),
+                        ExecutorTestBarrierOp);
+
+// Passes its input through. Unlike Identity, it is expensive, so it runs on a
+// work-stealing worker rather than inline.
+REGISTER_OP("ExecutorTestPassThrough").Input("x: float").Output("y: float");
+
+class ExecutorTestPassThroughOp : public OpKernel {
+ public:
+  using OpKernel::OpKernel;
+
+  void Compute(OpKernelContext* context) override {
+    context->set_output(0, context->input(0));
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("ExecutorTestPassThrough").Device(DEVICE_CPU),
+                        ExecutorTestPassThroughOp);
+
+TEST_F(ExecutorTest, WorkStealingBlockedWorkers) {
+  // Two expensive producers each feed more barriers than a step has workers.
+  // At least one producer runs on a worker, which queues the barriers it makes
+  // ready. Every worker blocks in a barrier, so the barriers left in the queue
+  // only run once the stall check dispatches them.
+  constexpr int kNumProducers = 2;
+  constexpr int kBarriersPerProducer = 65;
+  constexpr int kNumBarriers = kNumProducers * kBarriersPerProducer;
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* x = test::graph::Constant(g.get(), V(1.0));
+  for (int p = 0; p < kNumProducers; ++p) {
+    Node* producer;
+    TF_ASSERT_OK(NodeBuilder(strings::StrCat("producer", p),
+                             "ExecutorTestPassThrough")
+                     .Input(x)
+                     .Finalize(g.get(), &producer));
+    for (int i = 0; i < kBarriersPerProducer; ++i) {
+      TF_ASSERT_OK(NodeBuilder(strings::StrCat("barrier", p, "_", i),
+                               "ExecutorTestBarrier")
+                       .Input(producer)
+                       .Attr("n", kNumBarriers)
+                       .Finalize(g.get(), nullptr));
+    }
+  }
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g), "WORK_STEALING");
+  thread::ThreadPool pool(Env::Default(), "barriers", kNumBarriers + 2);
+  runner_ = [&pool](std::function<void()> fn) { pool.Schedule(std::move(fn)); };
+  monitoring::testing::CellReader<int64_t> stalled_nodes(
+      "/tensorflow/core/work_stealing_stalled_nodes");
+  for (int iters = 0; iters < 4; ++iters) {
+    TF_ASSERT_OK(Run(rendez_));
+  }
+  EXPECT_GT(stalled_nodes.Delta(), 0);
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -442,7 +575,8 @@ TEST_F(ExecutorTest, NoInputTensors) {
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
 // control dependencies.
-static void BM_executor(::testing::benchmark::State& state) {
+static void BM_executor_helper(::testing::benchmark::State& state,
+                               const char* executor_type) {
   const int width = state.range(0);
   const int depth = state.range(1);
 
@@ -476,12 +610,18 @@ static void BM_executor(::testing::benchmark::State& state) {
   }
 
   FixupSourceAndSinkEdges(g);
-  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  test::Benchmark("cpu", g, nullptr, nullptr, nullptr, executor_type,
+                  /*old_benchmark_api=*/false)
+      .Run(state);
 
   state.SetLabel(strings::StrCat("Nodes = ", cur));
   state.SetItemsProcessed(cur * static_cast<int64_t>(state.iterations()));
 }
 
+static void BM_executor(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "");
+}
+
 // Tall skinny graphs
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(16, 1024);
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(32, 8192);
@@ -493,6 +633,65 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+// The same graphs with WORK_STEALING. Their no-op nodes all run inline, so
+// this measures the scheduling overhead of the executor, while
+// BM_WideAndDeep measures the dispatch of expensive nodes.
+static void BM_executor_work_stealing(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "WORK_STEALING");
+}
+
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(16, 1024);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(32, 8192);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(1024, 16);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(8192, 32);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(1024, 1024);
+
+// Create a graph with a chain of 'depth' matmuls next to 'width' independent
+// matmuls of the same size. The chain is the critical path of the step, so
+// dispatching its nodes ahead of the independent ones shortens the step. The
+// third argument selects the executor: 0 for the default FIFO dispatch, 1 for
+// CRITICAL_PATH, and 2 for WORK_STEALING.
+static void BM_WideAndDeep(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  static constexpr const char* kExecutorTypes[] = {"", "CRITICAL_PATH",
+                                                   "WORK_STEALING"};
+  static constexpr const char* kLabels[] = {"fifo", "critical_path",
+                                            "work_stealing"};
+  const int executor = state.range(2);
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor matrix(DT_FLOAT, TensorShape({64, 64}));
+  matrix.flat<float>().setConstant(1.0f / 64);
+  Node* m = test::graph::Constant(g, matrix);
+  Node* deep = m;
+  for (int i = 0; i < depth; ++i) {
+    deep = test::graph::Matmul(g, deep, m, false, false);
+  }
+  for (int i = 0; i < width; ++i) {
+    test::graph::Matmul(g, m, m, false, false);
+  }
+
+  SessionOptions options;
+  options.config.set_inter_op_parallelism_threads(4);
+  FixupSourceAndSinkEdges(g);
+  test::Benchmark("cpu", g, &options, nullptr, nullptr,
+                  kExecutorTypes[executor], /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetLabel(kLabels[executor]);
+  state.SetItemsProcessed((width + depth) *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_WideAndDeep)
+    ->UseRealTime()
+    ->Args({256, 64, 0})
+    ->Args({256, 64, 1})
+    ->Args({256, 64, 2})
+    ->Args({1024, 16, 0})
+    ->Args({1024, 16, 1})
+    ->Args({1024, 16, 2});
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
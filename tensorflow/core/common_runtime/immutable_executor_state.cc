@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 
+#include <memory>
+#include <utility>
+
 #include "absl/memory/memory.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -28,6 +31,11 @@ limitations under the License.
 namespace tensorflow {
 
 namespace {
+// Maximum number of released `PropagatorBuffers` kept for reuse. Steps beyond
+// this many concurrent ones allocate storage of their own, which is freed when
+// they finish, so a burst of concurrent steps does not pin memory forever.
+constexpr size_t kMaxPooledPropagatorBuffers = 16;
+
 bool IsInitializationOp(const Node* node) {
   return node->op_def().allows_uninitialized_input();
 }
@@ -42,6 +50,36 @@ ImmutableExecutorState::~ImmutableExecutorState() {
   }
 }
 
+std::unique_ptr<ImmutableExecutorState::PropagatorBuffers>
+ImmutableExecutorState::AcquirePropagatorBuffers() const {
+  std::unique_ptr<PropagatorBuffers> buffers;
+  {
+    mutex_lock l(propagator_buffers_mu_);
+    if (!propagator_buffers_.empty()) {
+      buffers = std::move(propagator_buffers_.back());
+      propagator_buffers_.pop_back();
+    }
+  }
+  if (buffers == nullptr) {
+    buffers = std::make_unique<PropagatorBuffers>();
+    buffers->input_tensors.resize(root_frame_info_->total_inputs);
+    buffers->pending.reset(new std::atomic<int32>[gview_.num_nodes()]);
+  }
+  copy_pending_counts(buffers->pending.get());
+  return buffers;
+}
+
+void ImmutableExecutorState::ReleasePropagatorBuffers(
+    std::unique_ptr<PropagatorBuffers> buffers) const {
+  for (Entry& entry : buffers->input_tensors) {
+    entry.ClearVal();
+  }
+  mutex_lock l(propagator_buffers_mu_);
+  if (propagator_buffers_.size() < kMaxPooledPropagatorBuffers) {
+    propagator_buffers_.push_back(std::move(buffers));
+  }
+}
+
 namespace {
 void GetMaxPendingCounts(const Node* n, size_t* max_pending,
                          size_t* max_dead_count) {
@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/entry.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/local_executor_params.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
@@ -29,6 +30,8 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/lib/gtl/flatset.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
@@ -116,6 +119,27 @@ class ImmutableExecutorState {
     std::atomic_thread_fence(std::memory_order_release);
   }
 
+  // The per-step storage of a `SimplePropagatorState`.
+  struct PropagatorBuffers {
+    // Indexed like `get_root_frame_info().total_inputs`.
+    std::vector<Entry> input_tensors;
+    // Indexed by node ID.
+    std::unique_ptr<std::atomic<int32>[]> pending;
+  };
+
+  // Returns storage for a `SimplePropagatorState` of this graph, reusing the
+  // storage of an earlier step if one has released it. All entries of
+  // `input_tensors` are empty, and `pending` holds the initial pending counts.
+  //
+  // REQUIRES: `!requires_control_flow_support()`.
+  std::unique_ptr<PropagatorBuffers> AcquirePropagatorBuffers() const;
+
+  // Returns `buffers` to the pool for use by a later step, or frees them if
+  // the pool is full. Clears any input tensors that an aborted step did not
+  // consume.
+  void ReleasePropagatorBuffers(
+      std::unique_ptr<PropagatorBuffers> buffers) const;
+
  private:
   struct ControlFlowInfo {
     gtl::FlatSet<string> unique_frame_names;
@@ -155,6 +179,12 @@ class ImmutableExecutorState {
   // Shallow copies of the constant tensors used in the graph.
   std::vector<Tensor> const_tensors_;
 
+  // Storage released by finished steps. Holds at most one entry per step that
+  // has run concurrently with others, up to a small fixed limit.
+  mutable mutex propagator_buffers_mu_;
+  mutable std::vector<std::unique_ptr<PropagatorBuffers>> propagator_buffers_
+      TF_GUARDED_BY(propagator_buffers_mu_);
+
   ImmutableExecutorState(const ImmutableExecutorState&) = delete;
   void operator=(const ImmutableExecutorState&) = delete;
 };
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/process_state.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <vector>
@@ -101,8 +102,17 @@ Allocator* ProcessState::GetCPUAllocator(int numa_node) {
       int64_t cpu_mem_limit = cpu_mem_limit_in_mb * (1LL << 20);
       DCHECK(sub_allocator);
 
+      int64_t thread_cache_capacity = 0;
+      status = ReadInt64FromEnvVar("TF_CPU_BFC_THREAD_CACHE_SIZE",
+                                   /*default_val=*/0, &thread_cache_capacity);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.message();
+      }
+
       BFCAllocator::Options allocator_opts;
       allocator_opts.allow_growth = true;
+      allocator_opts.thread_cache_capacity = static_cast<int>(
+          std::clamp<int64_t>(thread_cache_capacity, 0, 1 << 16));
       allocator = new BFCAllocator(
           absl::WrapUnique(sub_allocator), cpu_mem_limit,
           /*name=*/"bfc_cpu_allocator_for_gpu", allocator_opts);
@@ -164,10 +174,12 @@ void ProcessState::TestOnlyReset() {
     if (a != default_cpu_allocator) delete a;
   }
   cpu_allocators_.clear();
+  cpu_allocators_cached_.store(0, std::memory_order_release);
   for (Allocator* a : cpu_al_) {
     delete a;
   }
   cpu_al_.clear();
+  numa_enabled_ = false;
 }
 
 }  // namespace tensorflow
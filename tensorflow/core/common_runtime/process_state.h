@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_PROCESS_STATE_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_PROCESS_STATE_H_
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <unordered_map>
@@ -81,18 +82,15 @@ class ProcessState : public ProcessStateInterface {
   virtual ~ProcessState() {}
   friend class GPUProcessState;
   friend class PluggableDeviceProcessState;
+  friend class ProcessStateTestPeer;
 
   // If these flags need to be runtime configurable consider adding
   // them to ConfigProto.
   static constexpr bool FLAGS_brain_mem_reg_gpu_dma = true;
   static constexpr bool FLAGS_brain_gpu_record_mem_types = false;
 
-  // Helper method for unit tests to reset the ProcessState singleton by
-  // cleaning up everything. Never use in production.
-  void TestOnlyReset();
-
   static ProcessState* instance_;
-  bool numa_enabled_;
+  std::atomic<bool> numa_enabled_;
 
   mutex mu_;
 
@@ -113,6 +111,11 @@ class ProcessState : public ProcessStateInterface {
   // Allocators for runtime attribute use analysis.
   MDMap mem_desc_map_;
   std::vector<Allocator*> cpu_al_ TF_GUARDED_BY(mu_);
+
+ private:
+  // Helper method for unit tests to reset the ProcessState singleton by
+  // cleaning up everything, including EnableNUMA(). Never use in production.
+  void TestOnlyReset();
 };
 
 namespace internal {
@@ -15,6 +15,8 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
 
 #include <atomic>
+#include <memory>
+#include <utility>
 
 #include "tensorflow/core/common_runtime/propagator_debug_utils.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -33,17 +35,19 @@ SimplePropagatorState::SimplePropagatorState(
     : immutable_state_(immutable_state),
       step_id_(step_id),
       vlog_(vlog || VLOG_IS_ON(1)),
-      input_tensors_(finfo.total_inputs),
-      pending_(
-          new std::atomic<int32>[immutable_state.graph_view().num_nodes()]),
+      buffers_(immutable_state.AcquirePropagatorBuffers()),
+      input_tensors_(buffers_->input_tensors),
+      pending_(buffers_->pending.get()),
       active_(vlog_ ? new std::vector<bool>(
                           immutable_state.graph_view().num_nodes())
                     : nullptr),
       nodes_(finfo.nodes.get()) {
-  immutable_state_.copy_pending_counts(pending_.get());
+  DCHECK_EQ(input_tensors_.size(), finfo.total_inputs);
 }
 
-SimplePropagatorState::~SimplePropagatorState() {}
+SimplePropagatorState::~SimplePropagatorState() {
+  immutable_state_.ReleasePropagatorBuffers(std::move(buffers_));
+}
 
 void SimplePropagatorState::ActivateRoots(
     gtl::ArraySlice<const NodeItem*> roots, TaggedNodeSeq* ready) {
@@ -173,9 +173,13 @@ class SimplePropagatorState {
   // source node of an edge and is cleared by the destination of the same
   // edge. The destination node always runs after the source node, so there
   // is never concurrent access to the same entry.
-  std::vector<Entry> input_tensors_;
+  //
+  // `input_tensors_` and `pending_` point into `buffers_`, which is recycled
+  // through `immutable_state_` across steps.
+  std::unique_ptr<ImmutableExecutorState::PropagatorBuffers> buffers_;
+  std::vector<Entry>& input_tensors_;
 
-  std::unique_ptr<std::atomic<int32>[]> pending_;
+  std::atomic<int32>* const pending_;
 
   // If `vlog_` is true, this stores a bit vector of active nodes, indexed by
   // node ID.
@@ -38,8 +38,18 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
   absl::Status CreateDevices(
       const SessionOptions& options, const string& name_prefix,
       std::vector<std::unique_ptr<Device>>* devices) override {
+    const bool use_numa_affinity =
+        options.config.experimental().use_numa_affinity();
     int num_numa_nodes = port::NUMANumNodes();
-    int n = 1;
+    if (use_numa_affinity && num_numa_nodes > 1) {
+      // Backs each node's devices with an allocator drawing from node-local
+      // memory; without this all nodes share the node 0 allocator.
+      ProcessState::singleton()->EnableNUMA();
+    }
+    // Unless the device count is set explicitly, create one device per NUMA
+    // node, each with its own node-pinned intra-op thread pool (see
+    // LocalDevice).
+    int n = use_numa_affinity ? num_numa_nodes : 1;
     auto iter = options.config.device_count().find("CPU");
     if (iter != options.config.device_count().end()) {
       n = iter->second;
@@ -47,7 +57,7 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/device:CPU:", i);
       std::unique_ptr<ThreadPoolDevice> tpd;
-      if (options.config.experimental().use_numa_affinity()) {
+      if (use_numa_affinity) {
         int numa_node = i % num_numa_nodes;
         if (numa_node != i) {
           LOG(INFO) << "Only " << num_numa_nodes
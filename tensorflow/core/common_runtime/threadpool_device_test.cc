@@ -15,11 +15,23 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/process_state.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
+
+class ProcessStateTestPeer {
+ public:
+  static void Reset() { ProcessState::singleton()->TestOnlyReset(); }
+};
+
 namespace {
 
 const int kDimSize = 2;
@@ -68,5 +80,24 @@ TEST(ThreadPoolDeviceTest, CopyTensor) {
   device_context->Unref();
 }
 
+// Enabling NUMA is process-wide, so it is undone after each test.
+class ThreadPoolDeviceNumaTest : public ::testing::Test {
+ protected:
+  void TearDown() override { ProcessStateTestPeer::Reset(); }
+};
+
+TEST_F(ThreadPoolDeviceNumaTest, OneDevicePerNumaNode) {
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_numa_affinity(true);
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::GetFactory(DEVICE_CPU)
+                   ->CreateDevices(options, "/job:a/replica:0/task:0",
+                                   &devices));
+  ASSERT_EQ(devices.size(), static_cast<size_t>(port::NUMANumNodes()));
+  for (int i = 0; i < static_cast<int>(devices.size()); ++i) {
+    EXPECT_EQ(devices[i]->attributes().locality().numa_node(), i);
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
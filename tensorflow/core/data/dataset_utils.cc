@@ -59,6 +59,7 @@ limitations under the License.
 #include "tensorflow/core/platform/regexp.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/tstring.h"
+#include "tensorflow/core/util/batch_util.h"
 #include "tensorflow/core/util/determinism.h"
 #include "tensorflow/core/util/work_sharder.h"
 
@@ -883,6 +884,191 @@ absl::Status CopyBatch(AnyContext ctx,
   return absl::OkStatus();
 }
 
+BatchBuilder::BatchBuilder(AnyContext ctx, int64_t batch_size,
+                           CopyMode copy_mode)
+    : ctx_(ctx),
+      batch_size_(batch_size),
+      copy_mode_(copy_mode),
+      state_(std::make_shared<State>()) {}
+
+BatchBuilder::~BatchBuilder() {
+  if (finished_) return;
+  mutex_lock l(state_->mu);
+  while (state_->num_pending_copies > 0) {
+    state_->cond_var.wait(l);
+  }
+}
+
+void BatchBuilder::Add(std::vector<Tensor>&& element) {
+  DCHECK(!finished_);
+  const int64_t index = num_elements_++;
+  if (status_.ok()) {
+    status_ = AddElement(index, std::move(element));
+  }
+}
+
+absl::Status BatchBuilder::AddElement(int64_t index,
+                                      std::vector<Tensor>&& element) {
+  if (index == 0) {
+    state_->batch.reserve(element.size());
+    for (size_t component_index = 0; component_index < element.size();
+         ++component_index) {
+      const Tensor& component = element[component_index];
+      TensorShape batch_component_shape({batch_size_});
+      batch_component_shape.AppendShape(component.shape());
+      state_->batch.emplace_back(ctx_.allocator, component.dtype(),
+                                 batch_component_shape);
+      if (!state_->batch.back().IsInitialized()) {
+        return errors::ResourceExhausted(
+            "Failed to allocate memory for the batch of component ",
+            component_index);
+      }
+      element_shapes_.push_back(component.shape());
+    }
+  }
+  if (element.size() != element_shapes_.size()) {
+    return errors::InvalidArgument(
+        "Cannot batch elements with different numbers of components. First "
+        "element had ",
+        element_shapes_.size(), " components and element ", index, " had ",
+        element.size(), ".");
+  }
+  int64_t element_bytes = 0;
+  for (size_t component_index = 0; component_index < element.size();
+       ++component_index) {
+    if (element[component_index].shape() != element_shapes_[component_index]) {
+      return errors::InvalidArgument(
+          "Cannot batch tensors with different shapes in component ",
+          component_index, ". First element had shape ",
+          element_shapes_[component_index].DebugString(), " and element ",
+          index, " had shape ",
+          element[component_index].shape().DebugString(), ".");
+    }
+    element_bytes += element[component_index].TotalBytes();
+  }
+
+  if (copy_mode_ == CopyMode::kSynchronous) {
+    std::vector<std::vector<Tensor>> elements;
+    elements.push_back(std::move(element));
+    return CopyElements(*state_, index, std::move(elements));
+  }
+  if (pending_elements_.empty()) {
+    pending_index_ = index;
+  }
+  pending_elements_.push_back(std::move(element));
+  pending_bytes_ += element_bytes;
+  // Grouping the elements amortizes the cost of scheduling the copies.
+  constexpr int64_t kMinParallelCopyBytes = 1 << 20;
+  if (pending_bytes_ >= kMinParallelCopyBytes) {
+    SchedulePendingCopies();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status BatchBuilder::Finish(std::vector<Tensor>* out_tensors) {
+  DCHECK(!finished_);
+  DCHECK_GT(num_elements_, 0);
+  finished_ = true;
+  absl::Status status = status_;
+  if (status.ok() && !pending_elements_.empty()) {
+    status = CopyElements(*state_, pending_index_,
+                          std::move(pending_elements_));
+    pending_elements_.clear();
+  }
+  {
+    mutex_lock l(state_->mu);
+    while (state_->num_pending_copies > 0) {
+      state_->cond_var.wait(l);
+    }
+    status.Update(state_->status);
+    state_->num_elements = num_elements_;
+  }
+  TF_RETURN_IF_ERROR(status);
+  *out_tensors = Result(*state_, num_elements_);
+  return absl::OkStatus();
+}
+
+void BatchBuilder::FinishAsync(
+    std::function<void(absl::Status, std::vector<Tensor>)> done) {
+  DCHECK(!finished_);
+  DCHECK_GT(num_elements_, 0);
+  finished_ = true;
+  absl::Status status = status_;
+  if (status.ok()) {
+    SchedulePendingCopies();
+  }
+  {
+    mutex_lock l(state_->mu);
+    state_->status.Update(status);
+    state_->num_elements = num_elements_;
+    if (state_->num_pending_copies > 0) {
+      state_->done = std::move(done);
+      return;
+    }
+    status = state_->status;
+  }
+  done(status, status.ok() ? Result(*state_, num_elements_)
+                           : std::vector<Tensor>());
+}
+
+absl::Status BatchBuilder::CopyElements(
+    State& state, int64_t index, std::vector<std::vector<Tensor>>&& elements) {
+  for (auto& element : elements) {
+    for (size_t component_index = 0; component_index < element.size();
+         ++component_index) {
+      TF_RETURN_IF_ERROR(batch_util::CopyElementToSlice(
+          std::move(element[component_index]), &state.batch[component_index],
+          index));
+    }
+    ++index;
+  }
+  return absl::OkStatus();
+}
+
+void BatchBuilder::SchedulePendingCopies() {
+  if (pending_elements_.empty()) return;
+  {
+    mutex_lock l(state_->mu);
+    ++state_->num_pending_copies;
+  }
+  (*ctx_.runner)([state = state_, index = pending_index_,
+                  elements = std::move(pending_elements_)]() mutable {
+    absl::Status status = CopyElements(*state, index, std::move(elements));
+    // Releases the elements before the batch is handed out.
+    elements.clear();
+    std::function<void(absl::Status, std::vector<Tensor>)> done;
+    int64_t num_elements;
+    {
+      mutex_lock l(state->mu);
+      state->status.Update(status);
+      if (--state->num_pending_copies > 0) return;
+      state->cond_var.notify_all();
+      done = std::move(state->done);
+      status = state->status;
+      num_elements = state->num_elements;
+    }
+    if (done) {
+      done(status, status.ok() ? Result(*state, num_elements)
+                               : std::vector<Tensor>());
+    }
+  });
+  pending_elements_.clear();
+  pending_bytes_ = 0;
+}
+
+std::vector<Tensor> BatchBuilder::Result(State& state, int64_t num_elements) {
+  std::vector<Tensor> result;
+  result.reserve(state.batch.size());
+  for (const Tensor& batch_component : state.batch) {
+    // A partial batch shares the buffer of the full batch, which avoids
+    // copying it again.
+    result.push_back(batch_component.dim_size(0) == num_elements
+                         ? batch_component
+                         : batch_component.Slice(0, num_elements));
+  }
+  return result;
+}
+
 absl::flat_hash_set<tstring> CreateGraphRewriteConfigs(const Options& options) {
   absl::flat_hash_set<tstring> configs;
   const auto& autotune_options = options.autotune_options();
@@ -1009,6 +1195,8 @@ REGISTER_DATASET_EXPERIMENT("allow_small_function_optimizations",
                             RandomJobSamplePercentage<0>, AllTasks);
 REGISTER_DATASET_EXPERIMENT("autotune_buffer_optimization",
                             RandomJobSamplePercentage<0>, IndependentHostTasks);
+REGISTER_DATASET_EXPERIMENT("autotune_global_budget",
+                            RandomJobSamplePercentage<0>, AllTasks);
 REGISTER_DATASET_EXPERIMENT(kFilterParallelizationOpt,
                             RandomJobSamplePercentage<0>, AllTasks);
 REGISTER_DATASET_EXPERIMENT("min_outer_interleave_parallelism",
@@ -35,6 +35,9 @@ limitations under the License.
 #include "tensorflow/core/framework/resource_handle.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 namespace data {
@@ -302,6 +305,87 @@ absl::Status CopyBatch(AnyContext ctx,
                        std::vector<std::vector<Tensor>>&& batch_elements,
                        bool parallel_copy, std::vector<Tensor>* out_tensors);
 
+// Builds a batch by copying each element into its slice of the batch as soon
+// as it is added, rather than collecting all the elements first.
+//
+// The batch tensors are allocated when the first element is added, with room
+// for `batch_size` elements of its shapes. Elements can then be released as
+// they are copied, so at most a few of them need to be alive at the same time
+// instead of the whole batch. If fewer than `batch_size` elements are added,
+// the resulting tensors are slices of the batch tensors.
+class BatchBuilder {
+ public:
+  enum class CopyMode {
+    // Elements are copied by the thread that adds them.
+    kSynchronous,
+    // Elements are copied using `ctx.runner`, in groups of at least 1MB, while
+    // the next elements are being added.
+    kParallel,
+  };
+
+  BatchBuilder(AnyContext ctx, int64_t batch_size, CopyMode copy_mode);
+
+  // Waits for the outstanding copies, if `Finish()` or `FinishAsync()` haven't
+  // been called.
+  ~BatchBuilder();
+
+  // Adds the next element of the batch. Errors, e.g. elements with different
+  // shapes, are returned by `Finish()`.
+  void Add(std::vector<Tensor>&& element);
+
+  // Returns the number of elements added so far.
+  int64_t num_elements() const { return num_elements_; }
+
+  // Waits for all elements to be copied and stores the batch, one tensor per
+  // component, in `out_tensors`. Must be called at most once, after at least
+  // one element has been added.
+  absl::Status Finish(std::vector<Tensor>* out_tensors);
+
+  // Like `Finish()`, but instead of blocking, calls `done` from the thread
+  // that completes the last copy.
+  void FinishAsync(
+      std::function<void(absl::Status, std::vector<Tensor>)> done);
+
+ private:
+  // State shared with the copies scheduled using `ctx.runner`.
+  struct State {
+    mutex mu;
+    condition_variable cond_var;
+    int64_t num_pending_copies TF_GUARDED_BY(mu) = 0;
+    absl::Status status TF_GUARDED_BY(mu);
+    std::function<void(absl::Status, std::vector<Tensor>)> done
+        TF_GUARDED_BY(mu);
+    int64_t num_elements TF_GUARDED_BY(mu) = 0;
+    std::vector<Tensor> batch;
+  };
+
+  absl::Status AddElement(int64_t index, std::vector<Tensor>&& element);
+
+  // Copies `elements`, the first of which is the element at `index` in the
+  // batch, into the batch.
+  static absl::Status CopyElements(State& state, int64_t index,
+                                   std::vector<std::vector<Tensor>>&& elements);
+
+  // Copies the pending elements using `ctx_.runner`.
+  void SchedulePendingCopies();
+
+  // Returns the batch of `num_elements` elements.
+  static std::vector<Tensor> Result(State& state, int64_t num_elements);
+
+  const AnyContext ctx_;
+  const int64_t batch_size_;
+  const CopyMode copy_mode_;
+  const std::shared_ptr<State> state_;
+  int64_t num_elements_ = 0;
+  bool finished_ = false;
+  absl::Status status_;
+  // Elements that haven't been copied yet and the position of the first one.
+  std::vector<std::vector<Tensor>> pending_elements_;
+  int64_t pending_index_ = 0;
+  int64_t pending_bytes_ = 0;
+  std::vector<TensorShape> element_shapes_;
+};
+
 // Computes the set of experiments to apply based on the job name, task id,
 // rollout percentage of registered experiments, and the
 // TF_DATA_EXPERIMENT_OPT_IN and TF_DATA_EXPERIMENT_OPT_OUT environment
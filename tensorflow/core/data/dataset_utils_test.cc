@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/data/dataset_utils.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -24,6 +25,7 @@ limitations under the License.
 #include <gmock/gmock.h>
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "xla/tsl/protobuf/error_codes.pb.h"
 #include "xla/tsl/util/determinism_test_util.h"
@@ -31,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/data/test_utils.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/dataset.pb.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
@@ -38,11 +41,15 @@ limitations under the License.
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/str_util.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/util/work_sharder.h"
 #include "tsl/platform/status_matchers.h"
@@ -754,6 +761,160 @@ TEST(DatasetUtilsTest, CountBytes) {
   EXPECT_EQ(GetTotalBytes(compressed), compressed_element.ByteSizeLong());
 }
 
+class BatchBuilderTest
+    : public ::testing::TestWithParam<BatchBuilder::CopyMode> {
+ protected:
+  BatchBuilderTest()
+      : thread_pool_(Env::Default(), "batch_builder_test", /*num_threads=*/4) {
+    IteratorContext::Params params;
+    params.allocator_getter = [](AllocatorAttributes) {
+      return cpu_allocator();
+    };
+    params.runner = [this](std::function<void()> fn) {
+      thread_pool_.Schedule(std::move(fn));
+    };
+    params.runner_threadpool_size = 4;
+    ctx_ = std::make_unique<IteratorContext>(std::move(params));
+  }
+
+  // Returns a batch element whose components are `value` and a vector of
+  // `size` copies of `value`.
+  std::vector<Tensor> Element(int64_t value, int64_t size) {
+    Tensor vector(DT_FLOAT, TensorShape({size}));
+    vector.flat<float>().setConstant(value);
+    return {CreateTensor<int64_t>(TensorShape({}), {value}), vector};
+  }
+
+  thread::ThreadPool thread_pool_;
+  std::unique_ptr<IteratorContext> ctx_;
+};
+
+TEST_P(BatchBuilderTest, FullBatch) {
+  // Large enough for `kParallel` to copy some of the elements while the
+  // others are being added.
+  constexpr int64_t kSize = 1 << 18;
+  BatchBuilder batch_builder(AnyContext(ctx_.get()), /*batch_size=*/4,
+                             GetParam());
+  for (int64_t i = 0; i < 4; ++i) {
+    batch_builder.Add(Element(i, kSize));
+  }
+  EXPECT_EQ(batch_builder.num_elements(), 4);
+  std::vector<Tensor> batch;
+  TF_ASSERT_OK(batch_builder.Finish(&batch));
+  ASSERT_EQ(batch.size(), 2);
+  test::ExpectEqual(batch[0], test::AsTensor<int64_t>({0, 1, 2, 3}));
+  ASSERT_EQ(batch[1].shape(), TensorShape({4, kSize}));
+  for (int64_t i = 0; i < 4; ++i) {
+    test::ExpectEqual(batch[1].SubSlice(i), Element(i, kSize)[1]);
+  }
+}
+
+TEST_P(BatchBuilderTest, PartialBatch) {
+  BatchBuilder batch_builder(AnyContext(ctx_.get()), /*batch_size=*/4,
+                             GetParam());
+  for (int64_t i = 0; i < 3; ++i) {
+    batch_builder.Add(Element(i, /*size=*/2));
+  }
+  std::vector<Tensor> batch;
+  TF_ASSERT_OK(batch_builder.Finish(&batch));
+  ASSERT_EQ(batch.size(), 2);
+  test::ExpectEqual(batch[0], test::AsTensor<int64_t>({0, 1, 2}));
+  test::ExpectEqual(batch[1], test::AsTensor<float>({0, 0, 1, 1, 2, 2},
+                                                    TensorShape({3, 2})));
+}
+
+TEST_P(BatchBuilderTest, DifferentShapes) {
+  BatchBuilder batch_builder(AnyContext(ctx_.get()), /*batch_size=*/2,
+                             GetParam());
+  batch_builder.Add(Element(0, /*size=*/2));
+  batch_builder.Add(Element(1, /*size=*/3));
+  std::vector<Tensor> batch;
+  EXPECT_THAT(batch_builder.Finish(&batch),
+              StatusIs(error::INVALID_ARGUMENT,
+                       HasSubstr("Cannot batch tensors with different shapes "
+                                 "in component 1")));
+}
+
+TEST_P(BatchBuilderTest, FinishAsync) {
+  constexpr int64_t kSize = 1 << 18;
+  BatchBuilder batch_builder(AnyContext(ctx_.get()), /*batch_size=*/4,
+                             GetParam());
+  for (int64_t i = 0; i < 4; ++i) {
+    batch_builder.Add(Element(i, kSize));
+  }
+  absl::Status status;
+  std::vector<Tensor> batch;
+  Notification done;
+  batch_builder.FinishAsync(
+      [&](absl::Status s, std::vector<Tensor> output) {
+        status = s;
+        batch = std::move(output);
+        done.Notify();
+      });
+  done.WaitForNotification();
+  TF_ASSERT_OK(status);
+  ASSERT_EQ(batch.size(), 2);
+  test::ExpectEqual(batch[0], test::AsTensor<int64_t>({0, 1, 2, 3}));
+  for (int64_t i = 0; i < 4; ++i) {
+    test::ExpectEqual(batch[1].SubSlice(i), Element(i, kSize)[1]);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    CopyModes, BatchBuilderTest,
+    ::testing::Values(BatchBuilder::CopyMode::kSynchronous,
+                      BatchBuilder::CopyMode::kParallel));
+
+// Batches 64 elements of 1MB that are produced one at a time, with `CopyBatch`
+// (argument 0) or with a synchronous `BatchBuilder` (argument 1), and reports
+// the peak memory allocated while doing so. `CopyBatch` needs every element
+// and the batch at once, `BatchBuilder` only the batch and one element.
+void BM_BatchPeakMemory(::testing::benchmark::State& state) {
+  const bool use_batch_builder = state.range(0);
+  constexpr int64_t kBatchSize = 64;
+  constexpr int64_t kElementSize = (1 << 20) / sizeof(float);
+  EnableCPUAllocatorStats();
+  Allocator* allocator = cpu_allocator();
+  IteratorContext::Params params;
+  params.allocator_getter = [allocator](AllocatorAttributes) {
+    return allocator;
+  };
+  params.runner = [](std::function<void()> fn) { fn(); };
+  IteratorContext ctx(std::move(params));
+  auto make_element = [allocator]() -> std::vector<Tensor> {
+    Tensor element(allocator, DT_FLOAT, TensorShape({kElementSize}));
+    element.flat<float>().setZero();
+    return {element};
+  };
+
+  int64_t peak_bytes = 0;
+  for (auto s : state) {
+    CHECK(allocator->ClearStats());
+    const int64_t start_bytes = allocator->GetStats()->bytes_in_use;
+    std::vector<Tensor> batch;
+    if (use_batch_builder) {
+      BatchBuilder batch_builder(AnyContext(&ctx), kBatchSize,
+                                 BatchBuilder::CopyMode::kSynchronous);
+      for (int64_t i = 0; i < kBatchSize; ++i) {
+        batch_builder.Add(make_element());
+      }
+      TF_CHECK_OK(batch_builder.Finish(&batch));
+    } else {
+      std::vector<std::vector<Tensor>> batch_elements;
+      for (int64_t i = 0; i < kBatchSize; ++i) {
+        batch_elements.push_back(make_element());
+      }
+      TF_CHECK_OK(CopyBatch(AnyContext(&ctx), std::move(batch_elements),
+                            /*parallel_copy=*/false, &batch));
+    }
+    peak_bytes = std::max(
+        peak_bytes, allocator->GetStats()->peak_bytes_in_use - start_bytes);
+  }
+  state.SetLabel(absl::StrCat("peak MB = ", peak_bytes >> 20));
+}
+
+BENCHMARK(BM_BatchPeakMemory)->Arg(0)->Arg(1);
+
 TEST_F(DatasetOpsTestBase, TestVariantEqualityChecking) {
   Tensor scalar_0{DT_VARIANT, TensorShape({})};
   scalar_0.scalar<Variant>()() = TestVariant({CreateTensor<int64_t>({}, {0})});
@@ -0,0 +1,560 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/queued_read_file.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/platform.h"
+
+#if !defined(PLATFORM_WINDOWS)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#endif  // !defined(PLATFORM_WINDOWS)
+
+// io_uring is used through its system calls directly, so that no liburing
+// dependency is needed.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(IORING_FEAT_SINGLE_MMAP)
+#define TF_DATA_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace tensorflow {
+namespace data {
+
+#if !defined(PLATFORM_WINDOWS)
+namespace {
+
+// A block of the file that is read ahead of the reader.
+struct Block {
+  explicit Block(int64_t capacity) : data(new char[capacity]) {}
+
+  int64_t offset = 0;
+  // Number of bytes to read. Only the last block of a file is shorter than
+  // the block size.
+  size_t length = 0;
+  std::unique_ptr<char[]> data;
+  struct iovec iov;
+  // Set once the read has completed. `result` is the number of bytes read, or
+  // a negated errno value if the read failed.
+  bool done = false;
+  int64_t result = 0;
+};
+
+// Issues block reads. Not thread-safe. Once a call has failed, the queue can't
+// be used anymore, and blocks that were passed to it must never be freed.
+class ReadQueue {
+ public:
+  virtual ~ReadQueue() = default;
+
+  // Starts reading `block`. `block` must stay alive until it has been passed
+  // to `Wait` or `Release`.
+  virtual absl::Status Submit(Block* block) = 0;
+
+  // Waits until `block` has been read.
+  virtual absl::Status Wait(Block* block) = 0;
+
+  // Waits until the queue no longer uses `block`, without requiring its data.
+  virtual absl::Status Release(Block* block) = 0;
+};
+
+// Reads each block with a blocking pread call once it is waited for.
+class PreadQueue : public ReadQueue {
+ public:
+  explicit PreadQueue(int fd) : fd_(fd) {}
+
+  absl::Status Submit(Block* block) override { return absl::OkStatus(); }
+
+  absl::Status Wait(Block* block) override {
+    if (block->done) {
+      return absl::OkStatus();
+    }
+    ssize_t r;
+    do {
+      r = pread(fd_, block->data.get(), block->length, block->offset);
+    } while (r < 0 && errno == EINTR);
+    block->result = r < 0 ? -errno : r;
+    block->done = true;
+    return absl::OkStatus();
+  }
+
+  absl::Status Release(Block* block) override { return absl::OkStatus(); }
+
+ private:
+  const int fd_;
+};
+
+#if defined(TF_DATA_HAS_IO_URING)
+int IoUringSetup(unsigned entries, struct io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+
+// Keeps block reads in flight in an io_uring submission queue.
+class IoUringQueue : public ReadQueue {
+ public:
+  // Returns a queue with room for at least `entries` reads of `fd`, or nullptr
+  // if io_uring is not available.
+  static std::unique_ptr<IoUringQueue> Create(int fd, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ring_fd = IoUringSetup(entries, &params);
+    if (ring_fd < 0) {
+      VLOG(1) << "io_uring is not available: " << strerror(errno);
+      return nullptr;
+    }
+    auto queue = absl::WrapUnique(new IoUringQueue(fd, ring_fd));
+    if (!queue->MapRings(params)) {
+      VLOG(1) << "Failed to map io_uring rings: " << strerror(errno);
+      return nullptr;
+    }
+    return queue;
+  }
+
+  ~IoUringQueue() override {
+    if (sqes_ != nullptr) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, ring_size_);
+    }
+    close(ring_fd_);
+  }
+
+  absl::Status Submit(Block* block) override {
+    TF_RETURN_IF_ERROR(CheckNotBroken());
+    const unsigned tail = *sq_tail_;
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= num_sq_entries_) {
+      return errors::Internal("The io_uring submission queue is full.");
+    }
+    const unsigned index = tail & *sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    block->iov.iov_base = block->data.get();
+    block->iov.iov_len = block->length;
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd_;
+    sqe->off = block->offset;
+    sqe->addr = reinterpret_cast<uint64_t>(&block->iov);
+    sqe->len = 1;
+    sqe->user_data = reinterpret_cast<uint64_t>(block);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    int r;
+    do {
+      r = IoUringEnter(ring_fd_, 1, 0, 0);
+    } while (r < 0 && (errno == EINTR || errno == EAGAIN));
+    if (r < 0) {
+      // The read is in the submission queue, and the kernel may still pick it
+      // up.
+      broken_ = true;
+      return errors::IOError("Failed to submit an io_uring read", errno);
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Wait(Block* block) override {
+    TF_RETURN_IF_ERROR(CheckNotBroken());
+    while (!block->done) {
+      const unsigned head = *cq_head_;
+      if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+            errno != EINTR) {
+          broken_ = true;
+          return errors::IOError("Failed to wait for io_uring reads", errno);
+        }
+        continue;
+      }
+      const struct io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+      Block* completed = reinterpret_cast<Block*>(cqe.user_data);
+      completed->result = cqe.res;
+      completed->done = true;
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    }
+    return absl::OkStatus();
+  }
+
+  // The kernel writes into the block until the read completes, so a block can
+  // only be reused once it has been reaped.
+  absl::Status Release(Block* block) override { return Wait(block); }
+
+ private:
+  IoUringQueue(int fd, int ring_fd) : fd_(fd), ring_fd_(ring_fd) {}
+
+  // Once a call to io_uring_enter has failed, it is unknown which reads are
+  // still in flight, so the queue can't be used anymore.
+  absl::Status CheckNotBroken() const {
+    if (broken_) {
+      return errors::FailedPrecondition(
+          "The io_uring queue failed earlier and can't be used anymore.");
+    }
+    return absl::OkStatus();
+  }
+
+  bool MapRings(const struct io_uring_params& params) {
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+      errno = ENOTSUP;
+      return false;
+    }
+    ring_size_ =
+        std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                 params.cq_off.cqes +
+                     params.cq_entries * sizeof(struct io_uring_cqe));
+    sq_ring_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* ring = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(ring + params.cq_off.cqes);
+    num_sq_entries_ = params.sq_entries;
+    return true;
+  }
+
+  const int fd_;
+  const int ring_fd_;
+  // The submission and completion rings share one mapping.
+  void* sq_ring_ = MAP_FAILED;
+  size_t ring_size_ = 0;
+  struct io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned num_sq_entries_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  struct io_uring_cqe* cqes_ = nullptr;
+  bool broken_ = false;
+};
+#endif  // defined(TF_DATA_HAS_IO_URING)
+
+class QueuedReadFile : public RandomAccessFile {
+ public:
+  QueuedReadFile(std::string filename, int fd, int64_t file_size,
+                 int64_t queue_depth, int64_t block_size,
+                 std::unique_ptr<ReadQueue> queue)
+      : filename_(std::move(filename)),
+        fd_(fd),
+        file_size_(file_size),
+        block_size_(block_size),
+        queue_(std::move(queue)),
+        queue_depth_(queue_depth) {}
+
+  ~QueuedReadFile() override {
+    {
+      mutex_lock l(mu_);
+      ReleaseWindowLocked();
+    }
+    queue_.reset();
+    close(fd_);
+  }
+
+  absl::Status Name(absl::string_view* result) const override {
+    *result = filename_;
+    return absl::OkStatus();
+  }
+
+  absl::Status Read(uint64 offset, size_t n, absl::string_view* result,
+                    char* scratch) const override {
+    mutex_lock l(mu_);
+    absl::Status status;
+    size_t copied = 0;
+    while (copied < n && offset + copied < static_cast<uint64>(file_size_)) {
+      const int64_t position = offset + copied;
+      FillWindowLocked(position);
+      Block* block = window_.front().get();
+      absl::Status wait_status = queue_->Wait(block);
+      if (!wait_status.ok()) {
+        // Read the same position again with blocking reads.
+        FallBackToPreadLocked(wait_status);
+        continue;
+      }
+      status = FinishReadLocked(block);
+      if (!status.ok()) {
+        break;
+      }
+      const int64_t available = block->offset + block->result - position;
+      if (available <= 0) {
+        // The file is shorter than it was when it was opened.
+        break;
+      }
+      const size_t to_copy =
+          std::min(static_cast<size_t>(available), n - copied);
+      memcpy(scratch + copied, block->data.get() + (position - block->offset),
+             to_copy);
+      copied += to_copy;
+    }
+    *result = absl::string_view(scratch, copied);
+    TF_RETURN_IF_ERROR(status);
+    if (copied < n) {
+      return errors::OutOfRange("Read less bytes than requested");
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  // Makes the block containing `position` the front of the read-ahead window
+  // and keeps up to `queue_depth_` blocks in flight from there.
+  void FillWindowLocked(int64_t position) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const int64_t block_offset = position - position % block_size_;
+    while (!window_.empty() && window_.front()->offset < block_offset) {
+      absl::Status s = queue_->Release(window_.front().get());
+      if (!s.ok()) {
+        FallBackToPreadLocked(s);
+        break;
+      }
+      free_blocks_.push_back(std::move(window_.front()));
+      window_.pop_front();
+    }
+    if (!window_.empty() && window_.front()->offset != block_offset) {
+      // The reader moved backwards, so the read-ahead starts over.
+      ReleaseWindowLocked();
+    }
+    while (static_cast<int64_t>(window_.size()) < queue_depth_) {
+      const int64_t next_offset = window_.empty()
+                                      ? block_offset
+                                      : window_.back()->offset + block_size_;
+      if (next_offset >= file_size_) {
+        break;
+      }
+      std::unique_ptr<Block> block;
+      if (free_blocks_.empty()) {
+        block = std::make_unique<Block>(block_size_);
+      } else {
+        block = std::move(free_blocks_.back());
+        free_blocks_.pop_back();
+      }
+      block->offset = next_offset;
+      block->length = std::min(block_size_, file_size_ - next_offset);
+      block->done = false;
+      block->result = 0;
+      absl::Status s = queue_->Submit(block.get());
+      // A read whose submission failed may still be started, so the block is
+      // handled like the others in flight.
+      window_.push_back(std::move(block));
+      if (!s.ok()) {
+        FallBackToPreadLocked(s);
+      }
+    }
+  }
+
+  // Completes short reads of `block`, which the queue has read, with blocking
+  // reads.
+  absl::Status FinishReadLocked(Block* block) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (block->result < 0) {
+      return errors::IOError(
+          absl::StrCat(filename_, " at offset ", block->offset),
+          -block->result);
+    }
+    while (block->result < static_cast<int64_t>(block->length)) {
+      const ssize_t r =
+          pread(fd_, block->data.get() + block->result,
+                block->length - block->result, block->offset + block->result);
+      if (r < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return errors::IOError(
+            absl::StrCat(filename_, " at offset ", block->offset), errno);
+      }
+      if (r == 0) {
+        break;
+      }
+      block->result += r;
+    }
+    return absl::OkStatus();
+  }
+
+  void ReleaseWindowLocked() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    while (!window_.empty()) {
+      absl::Status s = queue_->Release(window_.front().get());
+      if (!s.ok()) {
+        FallBackToPreadLocked(s);
+        return;
+      }
+      free_blocks_.push_back(std::move(window_.front()));
+      window_.pop_front();
+    }
+  }
+
+  // Switches to blocking reads after the queue failed with `status`. The
+  // kernel may still write into the blocks of the window, so they are never
+  // freed.
+  void FallBackToPreadLocked(const absl::Status& status) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    LOG(WARNING) << "Reading " << filename_
+                 << " with blocking reads after the read queue failed: "
+                 << status;
+    for (std::unique_ptr<Block>& block : window_) {
+      static_cast<void>(block.release());
+    }
+    window_.clear();
+    queue_ = std::make_unique<PreadQueue>(fd_);
+    queue_depth_ = 1;
+  }
+
+  const std::string filename_;
+  const int fd_;
+  const int64_t file_size_;
+  const int64_t block_size_;
+
+  mutable mutex mu_;
+  // Replaced by a `PreadQueue` with a depth of 1 if the queue fails.
+  mutable std::unique_ptr<ReadQueue> queue_ TF_GUARDED_BY(mu_);
+  mutable int64_t queue_depth_ TF_GUARDED_BY(mu_);
+  // Blocks that have been submitted, in file order.
+  mutable std::deque<std::unique_ptr<Block>> window_ TF_GUARDED_BY(mu_);
+  mutable std::vector<std::unique_ptr<Block>> free_blocks_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace
+#endif  // !defined(PLATFORM_WINDOWS)
+
+bool IoUringAvailable() {
+#if defined(TF_DATA_HAS_IO_URING)
+  static const bool available = [] {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ring_fd = IoUringSetup(1, &params);
+    if (ring_fd < 0) {
+      return false;
+    }
+    close(ring_fd);
+    return (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  }();
+  return available;
+#else
+  return false;
+#endif  // defined(TF_DATA_HAS_IO_URING)
+}
+
+absl::Status NewQueuedReadFile(const std::string& filename,
+                               const QueuedReadFileOptions& options,
+                               std::unique_ptr<RandomAccessFile>* result) {
+  if (options.queue_depth <= 0 || options.queue_depth > kMaxReadQueueDepth) {
+    return errors::InvalidArgument("Queue depth must be in [1, ",
+                                   kMaxReadQueueDepth, "], got ",
+                                   options.queue_depth);
+  }
+  if (options.block_size <= 0) {
+    return errors::InvalidArgument("Block size must be positive, got ",
+                                   options.block_size);
+  }
+#if defined(PLATFORM_WINDOWS)
+  return errors::Unimplemented(
+      "Queued reads are not supported on this platform.");
+#else
+  absl::string_view scheme, host, path;
+  io::ParseURI(filename, &scheme, &host, &path);
+  if (!scheme.empty() && scheme != "file") {
+    return errors::Unimplemented(
+        "Queued reads are only supported for local files, got ", filename);
+  }
+  const std::string local_path(path);
+  int fd;
+  do {
+    fd = open(local_path.c_str(), O_RDONLY | O_CLOEXEC);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    return errors::IOError(filename, errno);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int error = errno;
+    close(fd);
+    return errors::IOError(filename, error);
+  }
+
+  std::unique_ptr<ReadQueue> queue;
+  // Without io_uring, blocks are only read when they are needed, so there is
+  // no point in holding more than one.
+  int64_t queue_depth = 1;
+#if defined(TF_DATA_HAS_IO_URING)
+  if (options.use_io_uring) {
+    queue = IoUringQueue::Create(fd, options.queue_depth);
+    if (queue) {
+      queue_depth = options.queue_depth;
+    }
+  }
+#endif  // defined(TF_DATA_HAS_IO_URING)
+  if (!queue) {
+    VLOG(2) << "Reading " << filename << " with blocking reads.";
+    queue = std::make_unique<PreadQueue>(fd);
+  }
+  *result = std::make_unique<QueuedReadFile>(filename, fd, st.st_size,
+                                             queue_depth, options.block_size,
+                                             std::move(queue));
+  return absl::OkStatus();
+#endif  // defined(PLATFORM_WINDOWS)
+}
+
+}  // namespace data
+}  // namespace tensorflow
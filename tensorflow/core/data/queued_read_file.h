@@ -0,0 +1,61 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_QUEUED_READ_FILE_H_
+#define TENSORFLOW_CORE_DATA_QUEUED_READ_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/platform/file_system.h"
+
+namespace tensorflow {
+namespace data {
+
+// Largest `QueuedReadFileOptions::queue_depth` accepted by `NewQueuedReadFile`.
+inline constexpr int64_t kMaxReadQueueDepth = 4096;
+
+struct QueuedReadFileOptions {
+  // Maximum number of block reads kept in flight ahead of the reader.
+  int64_t queue_depth = 16;
+  // Size in bytes of each block read.
+  int64_t block_size = 256 << 10;
+  // Whether to submit reads through io_uring. If false, or if io_uring is not
+  // available, blocks are read with blocking pread calls.
+  bool use_io_uring = true;
+};
+
+// Returns whether the kernel supports the io_uring features used by
+// `NewQueuedReadFile`.
+bool IoUringAvailable();
+
+// Opens the local file `filename` for mostly sequential reading. The returned
+// file reads ahead of the last read position in blocks of
+// `options.block_size` bytes and keeps up to `options.queue_depth` of them in
+// flight, so that fast local storage is kept busy while the caller processes
+// data. Reads that do not follow the previous one restart the read-ahead at
+// the new position. If io_uring fails, the file continues with blocking reads.
+//
+// Returns `Unimplemented` if `filename` does not refer to a local file, in
+// which case callers should fall back to `Env::NewRandomAccessFile`.
+absl::Status NewQueuedReadFile(const std::string& filename,
+                               const QueuedReadFileOptions& options,
+                               std::unique_ptr<RandomAccessFile>* result);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_QUEUED_READ_FILE_H_
@@ -0,0 +1,228 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/queued_read_file.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Writes `size` random bytes to a new local file and returns its name.
+std::string WriteRandomFile(int64_t size, std::string* contents) {
+  random::PhiloxRandom philox(42);
+  random::SimplePhilox rng(&philox);
+  contents->resize(size);
+  for (char& c : *contents) {
+    c = static_cast<char>(rng.Uniform(256));
+  }
+  std::string filename;
+  EXPECT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  TF_EXPECT_OK(WriteStringToFile(Env::Default(), filename, *contents));
+  return filename;
+}
+
+class QueuedReadFileTest
+    : public ::testing::TestWithParam<std::tuple<bool, int64_t>> {
+ protected:
+  QueuedReadFileOptions Options() const {
+    QueuedReadFileOptions options;
+    options.use_io_uring = std::get<0>(GetParam());
+    options.queue_depth = std::get<1>(GetParam());
+    options.block_size = 4096 + 7;
+    return options;
+  }
+};
+
+TEST_P(QueuedReadFileTest, SequentialReads) {
+  std::string contents;
+  const std::string filename = WriteRandomFile(100 * 1000 + 13, &contents);
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(NewQueuedReadFile(filename, Options(), &file));
+
+  std::vector<char> scratch(10000);
+  uint64_t offset = 0;
+  for (size_t n = 1; offset < contents.size(); n = n * 3 % scratch.size()) {
+    absl::string_view result;
+    absl::Status s = file->Read(offset, n, &result, scratch.data());
+    EXPECT_EQ(result, absl::string_view(contents).substr(offset, n));
+    offset += result.size();
+    if (offset == contents.size()) {
+      EXPECT_TRUE(s.ok() || absl::IsOutOfRange(s)) << s;
+    } else {
+      TF_ASSERT_OK(s);
+    }
+  }
+}
+
+TEST_P(QueuedReadFileTest, RandomReads) {
+  std::string contents;
+  const std::string filename = WriteRandomFile(50 * 1000, &contents);
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(NewQueuedReadFile(filename, Options(), &file));
+
+  random::PhiloxRandom philox(7);
+  random::SimplePhilox rng(&philox);
+  std::vector<char> scratch(20000);
+  for (int i = 0; i < 100; ++i) {
+    const uint64_t offset = rng.Uniform(contents.size());
+    const size_t n = rng.Uniform(scratch.size());
+    absl::string_view result;
+    absl::Status s = file->Read(offset, n, &result, scratch.data());
+    EXPECT_EQ(result, absl::string_view(contents).substr(offset, n));
+    if (offset + n <= contents.size()) {
+      TF_EXPECT_OK(s);
+    } else {
+      EXPECT_TRUE(absl::IsOutOfRange(s)) << s;
+    }
+  }
+}
+
+TEST_P(QueuedReadFileTest, ReadPastEnd) {
+  std::string contents;
+  const std::string filename = WriteRandomFile(100, &contents);
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(NewQueuedReadFile(filename, Options(), &file));
+
+  char scratch[10];
+  absl::string_view result;
+  EXPECT_TRUE(absl::IsOutOfRange(file->Read(200, 10, &result, scratch)));
+  EXPECT_TRUE(result.empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(QueuedReadFile, QueuedReadFileTest,
+                         ::testing::Combine(::testing::Bool(),
+                                            ::testing::Values(1, 4, 32)));
+
+TEST(QueuedReadFileTest, Name) {
+  std::string contents;
+  const std::string filename = WriteRandomFile(10, &contents);
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(NewQueuedReadFile(filename, QueuedReadFileOptions(), &file));
+  absl::string_view name;
+  TF_ASSERT_OK(file->Name(&name));
+  EXPECT_EQ(name, filename);
+}
+
+TEST(QueuedReadFileTest, NonLocalFile) {
+  std::unique_ptr<RandomAccessFile> file;
+  EXPECT_TRUE(absl::IsUnimplemented(NewQueuedReadFile(
+      "gs://bucket/file", QueuedReadFileOptions(), &file)));
+}
+
+TEST(QueuedReadFileTest, InvalidOptions) {
+  std::unique_ptr<RandomAccessFile> file;
+  QueuedReadFileOptions options;
+  options.queue_depth = 0;
+  EXPECT_TRUE(absl::IsInvalidArgument(
+      NewQueuedReadFile("/tmp/file", options, &file)));
+  options = QueuedReadFileOptions();
+  options.block_size = 0;
+  EXPECT_TRUE(absl::IsInvalidArgument(
+      NewQueuedReadFile("/tmp/file", options, &file)));
+}
+
+TEST(QueuedReadFileTest, MissingFile) {
+  std::unique_ptr<RandomAccessFile> file;
+  EXPECT_FALSE(NewQueuedReadFile(io::JoinPath(testing::TmpDir(), "missing"),
+                                 QueuedReadFileOptions(), &file)
+                   .ok());
+}
+
+// Evicts `filename` from the page cache, so that it is read from the device.
+// Only supported on Linux, and has no effect if the file is on a memory file
+// system such as tmpfs.
+void DropFromPageCache(const std::string& filename) {
+#if defined(__linux__)
+  const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  CHECK_GE(fd, 0) << filename;
+  // Dirty pages are not evicted, so they are written back first.
+  CHECK_EQ(fdatasync(fd), 0);
+  CHECK_EQ(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED), 0);
+  close(fd);
+#endif  // defined(__linux__)
+}
+
+// Reads a 256MB local file sequentially from the device. The first argument
+// is the queue depth, 0 reading through `Env::NewRandomAccessFile` instead.
+void BM_QueuedReadFile(::testing::benchmark::State& state) {
+  const int64_t queue_depth = state.range(0);
+  constexpr int64_t kFileSize = 256 << 20;
+  constexpr int64_t kReadSize = 256 << 10;
+  static const std::string* filename = [] {
+    std::string filename;
+    CHECK(Env::Default()->LocalTempFilename(&filename));
+    TF_CHECK_OK(WriteStringToFile(Env::Default(), filename,
+                                  std::string(kFileSize, 'x')));
+    return new std::string(filename);
+  }();
+
+  std::vector<char> scratch(kReadSize);
+  for (auto s : state) {
+    state.PauseTiming();
+    DropFromPageCache(*filename);
+    state.ResumeTiming();
+    std::unique_ptr<RandomAccessFile> file;
+    if (queue_depth == 0) {
+      TF_CHECK_OK(Env::Default()->NewRandomAccessFile(*filename, &file));
+    } else {
+      QueuedReadFileOptions options;
+      options.queue_depth = queue_depth;
+      options.block_size = kReadSize;
+      TF_CHECK_OK(NewQueuedReadFile(*filename, options, &file));
+    }
+    for (int64_t offset = 0; offset < kFileSize; offset += kReadSize) {
+      absl::string_view result;
+      TF_CHECK_OK(file->Read(offset, kReadSize, &result, scratch.data()));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kFileSize);
+  state.SetLabel(IoUringAvailable() ? "io_uring" : "pread");
+}
+
+BENCHMARK(BM_QueuedReadFile)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
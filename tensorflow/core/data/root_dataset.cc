@@ -94,6 +94,16 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
   }
   params->autotune_ram_budget_from_options =
       options.autotune_options().ram_budget();
+  if (options.autotune_options().optional_measurement_interval_ms_case() ==
+      AutotuneOptions::kMeasurementIntervalMs) {
+    params->measurement_options.interval_ms =
+        options.autotune_options().measurement_interval_ms();
+  }
+  if (options.autotune_options().optional_min_throughput_improvement_case() ==
+      AutotuneOptions::kMinThroughputImprovement) {
+    params->measurement_options.min_improvement =
+        options.autotune_options().min_throughput_improvement();
+  }
   double ram_budget_share;
   if (experiments.contains("autotune_buffer_optimization")) {
     // When running this experiment, increase the ram_budget since it already
@@ -216,6 +226,10 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       if (experiments.contains("autotune_buffer_optimization")) {
         model_->AddExperiment("autotune_buffer_optimization");
       }
+      if (experiments.contains("autotune_global_budget")) {
+        model_->AddExperiment("autotune_global_budget");
+      }
+      model_->SetMeasurementOptions(dataset()->params_.measurement_options);
     }
     IteratorContext iter_ctx(CreateParams(ctx));
     if (model_) {
@@ -38,6 +38,7 @@ class RootDataset : public DatasetBase {
     std::function<int64_t()> autotune_cpu_budget_func;
     double ram_budget_share;
     int64_t autotune_ram_budget_from_options;
+    model::Model::MeasurementOptions measurement_options;
     int64_t max_intra_op_parallelism = 1;
     int64_t private_threadpool_size = 0;
 
@@ -0,0 +1,929 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/raw_coding.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tsl/platform/host_info.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Component buffers in the ring get the same alignment as buffers from the
+// default CPU allocator.
+constexpr uint64_t kRingAlignment = Allocator::kAllocatorAlignment;
+// Offset of the first data byte of the ring, after the `RingHeader`.
+constexpr uint64_t kRingDataOffset = kRingAlignment;
+constexpr int kListenBacklog = 64;
+constexpr int kMaxBindAttempts = 16;
+// Upper bound of the backoff after a failed accept.
+constexpr int64_t kMaxAcceptBackoffMs = 1000;
+// Room for the status, flags, shapes, and locations of a response, on top of
+// its inline component bytes.
+constexpr uint64_t kMaxFrameOverheadBytes = 1 << 20;  // 1 MiB
+
+// Where the bytes of a component of a response are stored.
+enum ComponentLocation : uint32_t {
+  // Raw tensor bytes in the shared-memory ring.
+  kRing = 0,
+  // Raw tensor bytes inline in the response.
+  kInline = 1,
+  // A serialized `TensorProto` inline in the response.
+  kProto = 2,
+};
+
+// Header at the start of the shared-memory object. Ring positions increase
+// monotonically and are taken modulo the capacity to index the data. `tail` is
+// written by the client: every position before it has been released and may
+// be overwritten by the server.
+struct RingHeader {
+  std::atomic<uint64_t> tail;
+};
+static_assert(sizeof(RingHeader) <= kRingDataOffset,
+              "RingHeader must fit before the ring data");
+
+uint64_t RoundUp(uint64_t n, uint64_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+// The largest message either end of a connection with a ring of
+// `ring_capacity` bytes accepts: components of up to a ring's worth of bytes
+// sent inline, plus their metadata. Lengths read from the peer are checked
+// against it before anything is allocated.
+uint64_t MaxFrameBytes(uint64_t ring_capacity) {
+  return std::min<uint64_t>(ring_capacity + kMaxFrameOverheadBytes,
+                            std::numeric_limits<uint32_t>::max());
+}
+
+// Fills in the abstract Unix socket address of the server listening on `port`
+// and returns its length. The abstract namespace needs no file in the file
+// system, and names are released when the socket is closed. It has no access
+// control either, so both ends check the credentials of their peer with
+// `PeerIsSameUser`.
+socklen_t SocketAddress(int port, sockaddr_un* address) {
+  std::memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  const std::string name = absl::StrCat("tf_data_service_shm_", port);
+  std::memcpy(address->sun_path + 1, name.data(), name.size());
+  return offsetof(sockaddr_un, sun_path) + 1 + name.size();
+}
+
+// Returns whether the process at the other end of the connected Unix socket
+// `fd` runs as the same user as this process. Elements are only served to,
+// and only accepted from, processes of the same user.
+bool PeerIsSameUser(int fd) {
+  ucred credentials;
+  socklen_t length = sizeof(credentials);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+    LOG(WARNING) << "Failed to get shm data transfer peer credentials: "
+                 << strerror(errno);
+    return false;
+  }
+  return credentials.uid == geteuid();
+}
+
+absl::Status WriteFully(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return errors::IOError("send to shm data transfer peer", errno);
+    }
+    data += n;
+    size -= n;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ReadFully(int fd, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = recv(fd, data, size, 0);
+    if (n == 0) {
+      return errors::Unavailable(
+          "shm data transfer peer closed the connection");
+    }
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return errors::IOError("recv from shm data transfer peer", errno);
+    }
+    data += n;
+    size -= n;
+  }
+  return absl::OkStatus();
+}
+
+// Messages on the socket are prefixed with their length as a fixed32.
+absl::Status WriteFrame(int fd, absl::string_view payload) {
+  if (payload.size() > std::numeric_limits<uint32_t>::max()) {
+    return errors::InvalidArgument("shm data transfer message of ",
+                                   payload.size(), " bytes is too large");
+  }
+  char header[sizeof(uint32_t)];
+  core::EncodeFixed32(header, payload.size());
+  TF_RETURN_IF_ERROR(WriteFully(fd, header, sizeof(header)));
+  return WriteFully(fd, payload.data(), payload.size());
+}
+
+// Fails with `DataLoss` if the peer announces more than `max_size` bytes.
+absl::Status ReadFrame(int fd, uint64_t max_size, std::string* payload) {
+  char header[sizeof(uint32_t)];
+  TF_RETURN_IF_ERROR(ReadFully(fd, header, sizeof(header)));
+  const uint32_t size = core::DecodeFixed32(header);
+  if (size > max_size) {
+    return errors::DataLoss("shm data transfer message of ", size,
+                            " bytes exceeds the limit of ", max_size,
+                            " bytes");
+  }
+  payload->resize(size);
+  return ReadFully(fd, payload->data(), payload->size());
+}
+
+// Sends the ring capacity together with the file descriptor of the ring.
+absl::Status SendRing(int socket_fd, int ring_fd, uint64_t capacity) {
+  char payload[sizeof(uint64_t)];
+  core::EncodeFixed64(payload, capacity);
+  iovec iov = {payload, sizeof(payload)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &ring_fd, sizeof(int));
+  while (sendmsg(socket_fd, &msg, MSG_NOSIGNAL) < 0) {
+    if (errno != EINTR) {
+      return errors::IOError("send shm data transfer ring", errno);
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ReceiveRing(int socket_fd, int* ring_fd, uint64_t* capacity) {
+  char payload[sizeof(uint64_t)];
+  iovec iov = {payload, sizeof(payload)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t n;
+  while ((n = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC)) < 0) {
+    if (errno != EINTR) {
+      return errors::IOError("receive shm data transfer ring", errno);
+    }
+  }
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (n != sizeof(payload) || cmsg == nullptr ||
+      cmsg->cmsg_type != SCM_RIGHTS) {
+    return errors::Unavailable(
+        "Malformed handshake from the shm data transfer server");
+  }
+  std::memcpy(ring_fd, CMSG_DATA(cmsg), sizeof(int));
+  *capacity = core::DecodeFixed64(payload);
+  return absl::OkStatus();
+}
+
+// The worker side of the ring of a client connection.
+class RingWriter {
+ public:
+  // Creates a ring with `capacity` bytes of data. On success, `*fd` is an open
+  // descriptor of the shared-memory object that the caller must close.
+  static absl::Status Create(uint64_t capacity,
+                             std::unique_ptr<RingWriter>* ring, int* fd) {
+    // The object is unlinked right away; the client gets access to it through
+    // the descriptor, so no name outlives the connection.
+    const std::string name =
+        absl::StrCat("/tf_data_service_shm_", getpid(), "_", random::New64());
+    *fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (*fd < 0) {
+      return errors::IOError("shm_open " + name, errno);
+    }
+    shm_unlink(name.c_str());
+    const size_t size = kRingDataOffset + capacity;
+    if (ftruncate(*fd, size) != 0) {
+      absl::Status s = errors::IOError("ftruncate " + name, errno);
+      close(*fd);
+      return s;
+    }
+    void* base =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (base == MAP_FAILED) {
+      absl::Status s = errors::IOError("mmap " + name, errno);
+      close(*fd);
+      return s;
+    }
+    new (base) RingHeader{0};
+    ring->reset(new RingWriter(static_cast<char*>(base), capacity));
+    return absl::OkStatus();
+  }
+
+  ~RingWriter() { munmap(base_, kRingDataOffset + capacity_); }
+
+  uint64_t capacity() const { return capacity_; }
+  uint64_t head() const { return head_; }
+
+  // Reserves `size` contiguous bytes of the ring at `*position`. Returns false
+  // if the client has not released enough of the ring yet.
+  bool Reserve(uint64_t size, uint64_t* position) {
+    uint64_t start = head_;
+    if (start % capacity_ + size > capacity_) {
+      // Skip the end of the ring so the reservation does not wrap around.
+      start = RoundUp(start, capacity_);
+    }
+    if (size > capacity_ ||
+        start + size - header()->tail.load(std::memory_order_acquire) >
+            capacity_) {
+      return false;
+    }
+    head_ = start + size;
+    *position = start;
+    return true;
+  }
+
+  // Undoes the last reservation, which started at `head`.
+  void Unreserve(uint64_t head) { head_ = head; }
+
+  char* data(uint64_t position) {
+    return base_ + kRingDataOffset + position % capacity_;
+  }
+
+ private:
+  RingWriter(char* base, uint64_t capacity)
+      : base_(base), capacity_(capacity) {}
+
+  RingHeader* header() { return reinterpret_cast<RingHeader*>(base_); }
+
+  char* const base_;
+  const uint64_t capacity_;
+  uint64_t head_ = 0;
+};
+
+// The client side of the ring of a connection. Regions of the ring are
+// released when the last tensor pointing into them is destroyed, which may be
+// after the client itself is destroyed.
+class RingReader {
+ public:
+  RingReader(char* base, uint64_t capacity)
+      : base_(base), capacity_(capacity) {}
+
+  ~RingReader() { munmap(base_, kRingDataOffset + capacity_); }
+
+  uint64_t capacity() const { return capacity_; }
+
+  char* data(uint64_t position) {
+    return base_ + kRingDataOffset + position % capacity_;
+  }
+
+  // Starts tracking the region [begin, end). Regions must be tracked in the
+  // order the server reserved them.
+  void Track(uint64_t begin, uint64_t end) TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    regions_.emplace(begin, Region{end, /*released=*/false});
+  }
+
+  // Releases the region starting at `begin`, and hands the ring back to the
+  // server up to the first region that is still in use.
+  void Release(uint64_t begin) TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    regions_[begin].released = true;
+    uint64_t tail = 0;
+    bool advanced = false;
+    while (!regions_.empty() && regions_.begin()->second.released) {
+      tail = regions_.begin()->second.end;
+      advanced = true;
+      regions_.erase(regions_.begin());
+    }
+    if (advanced) {
+      reinterpret_cast<RingHeader*>(base_)->tail.store(
+          tail, std::memory_order_release);
+    }
+  }
+
+ private:
+  struct Region {
+    uint64_t end;
+    bool released;
+  };
+
+  char* const base_;
+  const uint64_t capacity_;
+  mutex mu_;
+  std::map<uint64_t, Region> regions_ TF_GUARDED_BY(mu_);
+};
+
+// The part of the ring that holds the components of one element.
+class RingRegion {
+ public:
+  RingRegion(std::shared_ptr<RingReader> ring, uint64_t begin, uint64_t end)
+      : ring_(std::move(ring)), begin_(begin) {
+    ring_->Track(begin, end);
+  }
+  ~RingRegion() { ring_->Release(begin_); }
+
+  RingRegion(const RingRegion&) = delete;
+  RingRegion& operator=(const RingRegion&) = delete;
+
+ private:
+  const std::shared_ptr<RingReader> ring_;
+  const uint64_t begin_;
+};
+
+// A tensor buffer that points into the ring and keeps its region in use.
+class RingTensorBuffer : public TensorBuffer {
+ public:
+  RingTensorBuffer(void* data, size_t size, std::shared_ptr<RingRegion> region)
+      : TensorBuffer(data), size_(size), region_(std::move(region)) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name(kShmTransferProtocol);
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const size_t size_;
+  const std::shared_ptr<RingRegion> region_;
+};
+
+// Encodes a GetElement response: the status, and for successful requests the
+// element flags, the ring region of the element, and the components. Responses
+// larger than the client accepts are replaced by a `ResourceExhausted` error.
+void EncodeResponse(const absl::Status& status, const GetElementResult& result,
+                    RingWriter& ring, std::string* out) {
+  core::PutVarint32(out, static_cast<uint32_t>(status.code()));
+  if (!status.ok()) {
+    core::PutVarint64(out, status.message().size());
+    out->append(status.message());
+    return;
+  }
+  core::PutVarint32(out, (result.end_of_sequence ? 1 : 0) |
+                             (result.skip ? 2 : 0));
+  core::PutVarint64(out, result.element_index);
+
+  uint64_t ring_bytes = 0;
+  for (const Tensor& component : result.components) {
+    if (DataTypeCanUseMemcpy(component.dtype())) {
+      ring_bytes += RoundUp(component.TotalBytes(), kRingAlignment);
+    }
+  }
+  const uint64_t region_begin = ring.head();
+  uint64_t position = 0;
+  const bool use_ring = ring_bytes > 0 && ring.Reserve(ring_bytes, &position);
+  core::PutVarint64(out, region_begin);
+  core::PutVarint64(out, use_ring ? ring.head() : region_begin);
+
+  core::PutVarint32(out, result.components.size());
+  for (const Tensor& component : result.components) {
+    core::PutVarint32(out, component.dtype());
+    core::PutVarint32(out, component.dims());
+    for (int64_t dim : component.shape().dim_sizes()) {
+      core::PutVarint64(out, dim);
+    }
+    if (!DataTypeCanUseMemcpy(component.dtype())) {
+      TensorProto proto;
+      component.AsProtoTensorContent(&proto);
+      const std::string serialized = proto.SerializeAsString();
+      core::PutVarint32(out, kProto);
+      core::PutVarint64(out, serialized.size());
+      out->append(serialized);
+      continue;
+    }
+    const absl::string_view bytes = component.tensor_data();
+    if (use_ring) {
+      core::PutVarint32(out, kRing);
+      core::PutVarint64(out, position);
+      std::memcpy(ring.data(position), bytes.data(), bytes.size());
+      position += RoundUp(bytes.size(), kRingAlignment);
+    } else {
+      core::PutVarint32(out, kInline);
+      core::PutVarint64(out, bytes.size());
+      out->append(bytes.data(), bytes.size());
+    }
+  }
+
+  const uint64_t max_frame_bytes = MaxFrameBytes(ring.capacity());
+  if (out->size() > max_frame_bytes) {
+    // The client never learns about the region, so it would never release it.
+    if (use_ring) ring.Unreserve(region_begin);
+    const size_t size = out->size();
+    out->clear();
+    EncodeResponse(
+        errors::ResourceExhausted(
+            "shm data transfer response of ", size,
+            " bytes exceeds the limit of ", max_frame_bytes,
+            " bytes. Increase TF_DATA_SERVICE_SHM_RING_BYTES on the worker."),
+        result, ring, out);
+  }
+}
+
+absl::Status Malformed() {
+  return errors::DataLoss("Malformed response from shm data transfer server");
+}
+
+// Decodes a response produced by `EncodeResponse`. Components in the ring are
+// mapped directly unless `allocator` is set, in which case they are copied
+// into buffers from `allocator`.
+absl::Status DecodeResponse(absl::string_view in,
+                            const std::shared_ptr<RingReader>& ring,
+                            Allocator* allocator, GetElementResult& result) {
+  uint32_t code;
+  if (!core::GetVarint32(&in, &code)) return Malformed();
+  if (code != 0) {
+    uint64_t length;
+    if (!core::GetVarint64(&in, &length) || in.size() < length) {
+      return Malformed();
+    }
+    return absl::Status(static_cast<absl::StatusCode>(code),
+                        in.substr(0, length));
+  }
+  uint32_t flags;
+  uint64_t element_index, region_begin, region_end;
+  uint32_t num_components;
+  if (!core::GetVarint32(&in, &flags) ||
+      !core::GetVarint64(&in, &element_index) ||
+      !core::GetVarint64(&in, &region_begin) ||
+      !core::GetVarint64(&in, &region_end) ||
+      !core::GetVarint32(&in, &num_components) || region_end < region_begin ||
+      region_end - region_begin > 2 * ring->capacity()) {
+    return Malformed();
+  }
+  result.end_of_sequence = flags & 1;
+  result.skip = flags & 2;
+  result.element_index = element_index;
+  std::shared_ptr<RingRegion> region;
+  if (region_end > region_begin) {
+    region = std::make_shared<RingRegion>(ring, region_begin, region_end);
+  }
+
+  if (allocator == nullptr) {
+    allocator = cpu_allocator();
+  }
+  result.components.reserve(num_components);
+  for (uint32_t i = 0; i < num_components; ++i) {
+    uint32_t dtype, dims, location;
+    if (!core::GetVarint32(&in, &dtype) || !core::GetVarint32(&in, &dims) ||
+        dims > TensorShape::MaxDimensions()) {
+      return Malformed();
+    }
+    std::vector<int64_t> dim_sizes(dims);
+    for (int64_t& dim : dim_sizes) {
+      uint64_t size;
+      if (!core::GetVarint64(&in, &size)) return Malformed();
+      dim = size;
+    }
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(TensorShape::BuildTensorShape(dim_sizes, &shape));
+    uint64_t value;
+    if (!core::GetVarint32(&in, &location) || !core::GetVarint64(&in, &value)) {
+      return Malformed();
+    }
+    // Tensors in the ring or inline are built from the dtype on the wire, while
+    // `FromProto` checks the dtype of proto components itself.
+    const DataType type = static_cast<DataType>(dtype);
+    if ((location == kRing || location == kInline) &&
+        (!DataType_IsValid(dtype) || type == DT_INVALID || IsRefType(type) ||
+         !DataTypeCanUseMemcpy(type))) {
+      return Malformed();
+    }
+    switch (location) {
+      case kRing: {
+        const uint64_t size = shape.num_elements() * DataTypeSize(type);
+        if (region == nullptr || value < region_begin ||
+            value + size > region_end ||
+            value % ring->capacity() + size > ring->capacity()) {
+          return Malformed();
+        }
+        if (allocator == cpu_allocator()) {
+          result.components.emplace_back(
+              type, shape,
+              core::RefCountPtr<TensorBuffer>(
+                  new RingTensorBuffer(ring->data(value), size, region)));
+        } else {
+          result.components.emplace_back(allocator, type, shape);
+          std::memcpy(result.components.back().data(), ring->data(value),
+                      size);
+        }
+        break;
+      }
+      case kInline: {
+        if (in.size() < value) return Malformed();
+        result.components.emplace_back(allocator, type, shape);
+        Tensor& component = result.components.back();
+        if (component.TotalBytes() != value) return Malformed();
+        std::memcpy(component.data(), in.data(), value);
+        in.remove_prefix(value);
+        break;
+      }
+      case kProto: {
+        TensorProto proto;
+        if (in.size() < value ||
+            !proto.ParseFromArray(in.data(), static_cast<int>(value))) {
+          return Malformed();
+        }
+        in.remove_prefix(value);
+        result.components.emplace_back();
+        if (!result.components.back().FromProto(allocator, proto)) {
+          return errors::Internal("Failed to parse tensor.");
+        }
+        break;
+      }
+      default:
+        return Malformed();
+    }
+  }
+  return absl::OkStatus();
+}
+
+class ShmDataTransferServer : public DataTransferServer {
+ public:
+  explicit ShmDataTransferServer(DataTransferServer::GetElementT get_element)
+      : get_element_(std::move(get_element)) {}
+
+  ~ShmDataTransferServer() override {
+    std::vector<std::unique_ptr<Thread>> connection_threads;
+    {
+      mutex_lock l(mu_);
+      stopped_ = true;
+      accept_backoff_cv_.notify_all();
+      if (listen_fd_ >= 0) {
+        shutdown(listen_fd_, SHUT_RDWR);
+      }
+      for (int fd : connection_fds_) {
+        shutdown(fd, SHUT_RDWR);
+      }
+    }
+    accept_thread_.reset();
+    {
+      mutex_lock l(mu_);
+      for (auto& [id, thread] : connection_threads_) {
+        connection_threads.push_back(std::move(thread));
+      }
+      connection_threads_.clear();
+      for (auto& thread : finished_connection_threads_) {
+        connection_threads.push_back(std::move(thread));
+      }
+      finished_connection_threads_.clear();
+    }
+    connection_threads.clear();
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+  }
+
+  absl::Status Start(const experimental::WorkerConfig& config) override {
+    TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_DATA_SERVICE_SHM_RING_BYTES",
+                                           kDefaultShmRingBytes,
+                                           &ring_bytes_));
+    if (ring_bytes_ <= 0) {
+      return errors::InvalidArgument(
+          "TF_DATA_SERVICE_SHM_RING_BYTES must be positive, got ",
+          ring_bytes_);
+    }
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+      return errors::IOError("create shm data transfer socket", errno);
+    }
+    for (int attempt = 0;; ++attempt) {
+      port_ = 1 + random::New64() % std::numeric_limits<int32_t>::max();
+      sockaddr_un address;
+      socklen_t length = SocketAddress(port_, &address);
+      if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), length) ==
+          0) {
+        break;
+      }
+      if (errno != EADDRINUSE || attempt + 1 == kMaxBindAttempts) {
+        return errors::IOError("bind shm data transfer socket", errno);
+      }
+    }
+    if (listen(listen_fd_, kListenBacklog) != 0) {
+      return errors::IOError("listen on shm data transfer socket", errno);
+    }
+    accept_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf_data_service_shm_accept", [this] { AcceptLoop(); }));
+    return absl::OkStatus();
+  }
+
+  int Port() const override { return port_; }
+
+  absl::StatusOr<std::string> GetCompatibilityInfo() const override {
+    return tsl::port::Hostname();
+  }
+
+ private:
+  void AcceptLoop() {
+    int64_t accept_backoff_ms = 1;
+    while (true) {
+      int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0 && errno == EINTR) continue;
+      if (fd >= 0 && !PeerIsSameUser(fd)) {
+        LOG(WARNING) << "Rejected a shm data transfer connection from a "
+                        "process of another user.";
+        close(fd);
+        continue;
+      }
+      // Threads of closed connections are joined at the end of the iteration,
+      // after `mu_` is released.
+      std::vector<std::unique_ptr<Thread>> finished_threads;
+      mutex_lock l(mu_);
+      finished_threads.swap(finished_connection_threads_);
+      if (stopped_) {
+        if (fd >= 0) close(fd);
+        return;
+      }
+      if (fd < 0) {
+        // Errors such as EMFILE or ECONNABORTED are transient, so accepting
+        // continues after a backoff, until the server is stopped.
+        LOG_EVERY_N_SEC(ERROR, 60)
+            << "Failed to accept shm data transfer connection: "
+            << strerror(errno);
+        accept_backoff_cv_.wait_for(
+            l, std::chrono::milliseconds(accept_backoff_ms));
+        accept_backoff_ms =
+            std::min(2 * accept_backoff_ms, kMaxAcceptBackoffMs);
+        continue;
+      }
+      accept_backoff_ms = 1;
+      connection_fds_.insert(fd);
+      const int64_t id = next_connection_id_++;
+      connection_threads_[id] = absl::WrapUnique(Env::Default()->StartThread(
+          {}, "tf_data_service_shm_connection",
+          [this, id, fd] { ServeConnection(id, fd); }));
+    }
+  }
+
+  void ServeConnection(int64_t id, int fd) {
+    std::unique_ptr<RingWriter> ring;
+    int ring_fd;
+    absl::Status s = RingWriter::Create(ring_bytes_, &ring, &ring_fd);
+    if (s.ok()) {
+      s = SendRing(fd, ring_fd, ring->capacity());
+      close(ring_fd);
+    }
+    while (s.ok()) {
+      std::string request_bytes;
+      s = ReadFrame(fd, MaxFrameBytes(ring->capacity()), &request_bytes);
+      if (!s.ok()) break;
+      GetElementRequest request;
+      GetElementResult result;
+      absl::Status get_element_status;
+      if (request.ParseFromString(request_bytes)) {
+        get_element_status = get_element_(&request, &result);
+      } else {
+        get_element_status =
+            errors::InvalidArgument("Failed to parse GetElementRequest.");
+      }
+      std::string response;
+      EncodeResponse(get_element_status, result, *ring, &response);
+      // Make the ring writes visible before the client learns about them.
+      std::atomic_thread_fence(std::memory_order_release);
+      s = WriteFrame(fd, response);
+    }
+    VLOG(2) << "Closing shm data transfer connection: " << s;
+    mutex_lock l(mu_);
+    connection_fds_.erase(fd);
+    close(fd);
+    // A thread cannot join itself; the accept loop or the destructor joins it.
+    auto it = connection_threads_.find(id);
+    if (it != connection_threads_.end()) {
+      finished_connection_threads_.push_back(std::move(it->second));
+      connection_threads_.erase(it);
+    }
+  }
+
+  const DataTransferServer::GetElementT get_element_;
+  int64_t ring_bytes_ = kDefaultShmRingBytes;
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::unique_ptr<Thread> accept_thread_;
+
+  mutex mu_;
+  bool stopped_ TF_GUARDED_BY(mu_) = false;
+  // Notified when the server is stopped, to end the backoff after a failed
+  // accept.
+  condition_variable accept_backoff_cv_;
+  absl::flat_hash_set<int> connection_fds_ TF_GUARDED_BY(mu_);
+  int64_t next_connection_id_ TF_GUARDED_BY(mu_) = 0;
+  // Threads serving open connections, by connection id.
+  absl::flat_hash_map<int64_t, std::unique_ptr<Thread>> connection_threads_
+      TF_GUARDED_BY(mu_);
+  // Threads whose connection is closed, waiting to be joined.
+  std::vector<std::unique_ptr<Thread>> finished_connection_threads_
+      TF_GUARDED_BY(mu_);
+};
+
+class ShmDataTransferClient : public DataTransferClient {
+ public:
+  static absl::Status Create(const DataTransferClient::Config& config,
+                             std::unique_ptr<DataTransferClient>* out) {
+    const size_t colon = config.address.rfind(':');
+    int port;
+    if (colon == std::string::npos ||
+        !absl::SimpleAtoi(
+            absl::string_view(config.address).substr(colon + 1), &port)) {
+      return errors::InvalidArgument(
+          "Invalid shm data transfer server address: ", config.address);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return errors::IOError("create shm data transfer socket", errno);
+    }
+    sockaddr_un address;
+    socklen_t length = SocketAddress(port, &address);
+    int ring_fd = -1;
+    uint64_t capacity = 0;
+    absl::Status s;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), length) != 0) {
+      s = errors::IOError(
+          absl::StrCat("connect to shm data transfer server at ",
+                       config.address),
+          errno);
+    } else if (!PeerIsSameUser(fd)) {
+      s = errors::PermissionDenied(
+          "The shm data transfer server at ", config.address,
+          " runs as a different user than the client.");
+    } else {
+      s = ReceiveRing(fd, &ring_fd, &capacity);
+    }
+    if (!s.ok()) {
+      close(fd);
+      return s;
+    }
+    void* base = mmap(nullptr, kRingDataOffset + capacity,
+                      PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+    close(ring_fd);
+    if (base == MAP_FAILED) {
+      s = errors::IOError("mmap shm data transfer ring", errno);
+      close(fd);
+      return s;
+    }
+    *out = absl::WrapUnique(new ShmDataTransferClient(
+        config.address, fd,
+        std::make_shared<RingReader>(static_cast<char*>(base), capacity),
+        config.allocator));
+    return absl::OkStatus();
+  }
+
+  ~ShmDataTransferClient() override { close(fd_); }
+
+  absl::Status GetElement(const GetElementRequest& req,
+                          GetElementResult& result) override {
+    VLOG(3) << "GetElement for task " << req.task_id()
+            << " from shm data transfer server.";
+    if (cancelled_.load()) {
+      return errors::Cancelled("Client was cancelled.");
+    }
+    mutex_lock l(mu_);
+    std::string response;
+    int64_t start_time_us = env_->NowMicros();
+    absl::Status s = WriteFrame(fd_, req.SerializeAsString());
+    if (s.ok()) {
+      s = ReadFrame(fd_, MaxFrameBytes(ring_->capacity()), &response);
+    }
+    int64_t end_time_us = env_->NowMicros();
+    if (!s.ok()) {
+      if (cancelled_.load()) {
+        return errors::Cancelled("Client was cancelled.");
+      }
+      return s;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    TF_RETURN_IF_ERROR(DecodeResponse(response, ring_, allocator_, result));
+    metrics::RecordTFDataServiceGetElementDuration(kShmTransferProtocol,
+                                                   end_time_us - start_time_us);
+    return absl::OkStatus();
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel ShmDataTransferClient for worker " << address_ << ".";
+    cancelled_.store(true);
+    // Unblocks any request waiting for a response.
+    shutdown(fd_, SHUT_RDWR);
+  }
+
+  absl::StatusOr<std::string> GetCompatibilityInfo() const override {
+    return tsl::port::Hostname();
+  }
+
+  absl::Status CheckCompatibility(
+      const std::string& server_compatibility_info) const override {
+    const std::string hostname = tsl::port::Hostname();
+    if (server_compatibility_info != hostname) {
+      return errors::FailedPrecondition(
+          "The shm data transfer server runs on host '",
+          server_compatibility_info, "' but the client runs on host '",
+          hostname, "'; shared memory is only used for co-located clients.");
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  ShmDataTransferClient(std::string address, int fd,
+                        std::shared_ptr<RingReader> ring, Allocator* allocator)
+      : address_(std::move(address)),
+        fd_(fd),
+        ring_(std::move(ring)),
+        allocator_(allocator) {}
+
+  const std::string address_;
+  const int fd_;
+  const std::shared_ptr<RingReader> ring_;
+  Allocator* const allocator_;
+  std::atomic<bool> cancelled_ = false;
+  // Serializes requests on the connection.
+  mutex mu_;
+};
+
+class ShmTransferRegistrar {
+ public:
+  ShmTransferRegistrar() {
+    DataTransferServer::Register(
+        kShmTransferProtocol,
+        [](DataTransferServer::GetElementT get_element,
+           std::shared_ptr<DataTransferServer>* server) {
+          *server = std::make_shared<ShmDataTransferServer>(
+              std::move(get_element));
+          return absl::OkStatus();
+        });
+    DataTransferClient::Register(
+        kShmTransferProtocol, [](DataTransferClient::Config config,
+                                 std::unique_ptr<DataTransferClient>* out) {
+          return ShmDataTransferClient::Create(config, out);
+        });
+  }
+};
+static ShmTransferRegistrar shm_transfer_registrar;
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // defined(__linux__)
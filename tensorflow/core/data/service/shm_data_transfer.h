@@ -0,0 +1,49 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+
+#include <cstdint>
+
+namespace tensorflow {
+namespace data {
+
+// Data transfer protocol for tf.data service clients running on the same host
+// as the worker.
+//
+// Each client connection gets a ring buffer in a POSIX shared-memory object.
+// The worker copies the components of each element into the ring once, and
+// the client wraps them in tensors that point directly into its mapping of
+// the ring, without compression or serialization. Requests, responses, and
+// element metadata travel over a Unix domain socket. Components that cannot be
+// copied as raw memory (strings and variants), or that do not fit in the free
+// part of the ring, are sent inline over the socket instead. Messages are
+// limited to the ring size plus 1 MiB, so elements with more inline bytes fail
+// with `ResourceExhausted`.
+//
+// The server reports its host name as compatibility information, so that
+// clients on other hosts fail the compatibility check and fall back to gRPC.
+// Only available on Linux; on other platforms the protocol is not registered.
+constexpr const char kShmTransferProtocol[] = "shm";
+
+// Default size of the ring buffer of each client connection. It can be
+// overridden with the TF_DATA_SERVICE_SHM_RING_BYTES environment variable on
+// the worker.
+constexpr int64_t kDefaultShmRingBytes = int64_t{64} << 20;  // 64 MiB
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
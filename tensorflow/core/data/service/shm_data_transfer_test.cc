@@ -0,0 +1,264 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/test.h"
+#include "tsl/platform/host_info.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+#if defined(__linux__)
+
+using ::testing::HasSubstr;
+
+// Serves an element with a float matrix, a string scalar, and the task id of
+// the request. Negative task ids fail with NotFound.
+absl::Status GetTestElement(const GetElementRequest* req,
+                            GetElementResult* result) {
+  if (req->task_id() < 0) {
+    return errors::NotFound("No task ", req->task_id());
+  }
+  result->components.push_back(
+      test::AsTensor<float>({1.0, 2.0, 3.0, 4.0}, TensorShape({2, 2})));
+  result->components.push_back(test::AsScalar<tstring>("hello"));
+  result->components.push_back(test::AsScalar<int64_t>(req->task_id()));
+  result->element_index = req->task_id();
+  result->end_of_sequence = false;
+  return absl::OkStatus();
+}
+
+std::shared_ptr<DataTransferServer> StartServer(
+    DataTransferServer::GetElementT get_element) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_CHECK_OK(DataTransferServer::Build(kShmTransferProtocol,
+                                        std::move(get_element), &server));
+  TF_CHECK_OK(server->Start(/*config=*/{}));
+  return server;
+}
+
+std::unique_ptr<DataTransferClient> CreateClient(
+    const DataTransferServer& server) {
+  std::unique_ptr<DataTransferClient> client;
+  DataTransferClient::Config config = {
+      kShmTransferProtocol, absl::StrCat("localhost:", server.Port()),
+      /*accelerator_device_info=*/nullptr, /*allocator=*/nullptr};
+  TF_CHECK_OK(DataTransferClient::Build(kShmTransferProtocol, config, &client));
+  return client;
+}
+
+TEST(ShmDataTransferTest, RoundTrip) {
+  std::shared_ptr<DataTransferServer> server = StartServer(GetTestElement);
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+
+  // Keep every element alive so that later elements land after them in the
+  // ring.
+  std::vector<GetElementResult> results(10);
+  for (int i = 0; i < results.size(); ++i) {
+    GetElementRequest req;
+    req.set_task_id(i);
+    TF_ASSERT_OK(client->GetElement(req, results[i]));
+  }
+  for (int i = 0; i < results.size(); ++i) {
+    const GetElementResult& result = results[i];
+    EXPECT_EQ(result.element_index, i);
+    EXPECT_FALSE(result.end_of_sequence);
+    ASSERT_EQ(result.components.size(), 3);
+    test::ExpectTensorEqual<float>(
+        result.components[0],
+        test::AsTensor<float>({1.0, 2.0, 3.0, 4.0}, TensorShape({2, 2})));
+    test::ExpectTensorEqual<tstring>(result.components[1],
+                                     test::AsScalar<tstring>("hello"));
+    test::ExpectTensorEqual<int64_t>(result.components[2],
+                                     test::AsScalar<int64_t>(i));
+  }
+}
+
+TEST(ShmDataTransferTest, ElementLargerThanRing) {
+  setenv("TF_DATA_SERVICE_SHM_RING_BYTES", "1024", /*overwrite=*/1);
+  Tensor large(DT_INT32, TensorShape({4096}));
+  for (int i = 0; i < 4096; ++i) {
+    large.flat<int32_t>()(i) = i;
+  }
+  std::shared_ptr<DataTransferServer> server =
+      StartServer([&large](const GetElementRequest* req,
+                           GetElementResult* result) {
+        result->components.push_back(large);
+        result->components.push_back(test::AsScalar<int32_t>(7));
+        return absl::OkStatus();
+      });
+  unsetenv("TF_DATA_SERVICE_SHM_RING_BYTES");
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+
+  // The ring cannot hold the element, so its components are sent inline.
+  for (int i = 0; i < 3; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ASSERT_EQ(result.components.size(), 2);
+    test::ExpectTensorEqual<int32_t>(result.components[0], large);
+    test::ExpectTensorEqual<int32_t>(result.components[1],
+                                     test::AsScalar<int32_t>(7));
+  }
+}
+
+// Returns the name of the allocator of the buffer of `tensor`: "shm" if it
+// points into the ring.
+std::string AllocatorName(const Tensor& tensor) {
+  TensorDescription description;
+  tensor.FillDescription(&description);
+  return description.allocation_description().allocator_name();
+}
+
+TEST(ShmDataTransferTest, RingWrapsAround) {
+  setenv("TF_DATA_SERVICE_SHM_RING_BYTES", "4096", /*overwrite=*/1);
+  // Elements take 1280 bytes of the ring, which does not divide its size, so
+  // reservations skip the end of the ring as well as reuse released space.
+  std::shared_ptr<DataTransferServer> server =
+      StartServer([](const GetElementRequest* req, GetElementResult* result) {
+        Tensor values(DT_FLOAT, TensorShape({300}));
+        for (int i = 0; i < 300; ++i) {
+          values.flat<float>()(i) = req->task_id() * 1000 + i;
+        }
+        result->components.push_back(values);
+        result->components.push_back(test::AsScalar<int64_t>(req->task_id()));
+        result->element_index = req->task_id();
+        return absl::OkStatus();
+      });
+  unsetenv("TF_DATA_SERVICE_SHM_RING_BYTES");
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+
+  // Each element is dropped before the next one is fetched, releasing its
+  // region, so every element fits in the ring.
+  for (int i = 0; i < 40; ++i) {
+    GetElementRequest req;
+    req.set_task_id(i);
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(req, result));
+    EXPECT_EQ(result.element_index, i);
+    ASSERT_EQ(result.components.size(), 2);
+    EXPECT_EQ(AllocatorName(result.components[0]), kShmTransferProtocol);
+    Tensor expected(DT_FLOAT, TensorShape({300}));
+    for (int j = 0; j < 300; ++j) {
+      expected.flat<float>()(j) = i * 1000 + j;
+    }
+    test::ExpectTensorEqual<float>(result.components[0], expected);
+    test::ExpectTensorEqual<int64_t>(result.components[1],
+                                     test::AsScalar<int64_t>(i));
+  }
+}
+
+TEST(ShmDataTransferTest, RejectsResponsesLargerThanTheFrameLimit) {
+  setenv("TF_DATA_SERVICE_SHM_RING_BYTES", "1024", /*overwrite=*/1);
+  // Two MiB to send inline, more than the ring plus the metadata allowance.
+  Tensor large(DT_INT32, TensorShape({512 << 10}));
+  large.flat<int32_t>().setConstant(1);
+  std::shared_ptr<DataTransferServer> server = StartServer(
+      [&large](const GetElementRequest* req, GetElementResult* result) {
+        if (req->task_id() == 0) {
+          result->components.push_back(large);
+        } else {
+          result->components.push_back(test::AsScalar<int32_t>(7));
+        }
+        return absl::OkStatus();
+      });
+  unsetenv("TF_DATA_SERVICE_SHM_RING_BYTES");
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+
+  GetElementResult result;
+  absl::Status status = client->GetElement(GetElementRequest(), result);
+  EXPECT_EQ(status.code(), absl::StatusCode::kResourceExhausted);
+  EXPECT_THAT(status.message(), HasSubstr("TF_DATA_SERVICE_SHM_RING_BYTES"));
+
+  // The connection is still usable afterwards.
+  GetElementRequest req;
+  req.set_task_id(1);
+  TF_ASSERT_OK(client->GetElement(req, result));
+  test::ExpectTensorEqual<int32_t>(result.components[0],
+                                   test::AsScalar<int32_t>(7));
+}
+
+TEST(ShmDataTransferTest, PropagatesErrors) {
+  std::shared_ptr<DataTransferServer> server = StartServer(GetTestElement);
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+
+  GetElementRequest req;
+  req.set_task_id(-1);
+  GetElementResult result;
+  absl::Status status = client->GetElement(req, result);
+  EXPECT_EQ(status.code(), absl::StatusCode::kNotFound);
+  EXPECT_THAT(status.message(), HasSubstr("No task -1"));
+
+  // The connection is still usable afterwards.
+  req.set_task_id(1);
+  TF_EXPECT_OK(client->GetElement(req, result));
+}
+
+TEST(ShmDataTransferTest, Cancel) {
+  std::shared_ptr<DataTransferServer> server = StartServer(GetTestElement);
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  client->TryCancel();
+  GetElementResult result;
+  EXPECT_EQ(client->GetElement(GetElementRequest(), result).code(),
+            absl::StatusCode::kCancelled);
+}
+
+TEST(ShmDataTransferTest, ManySequentialConnections) {
+  std::shared_ptr<DataTransferServer> server = StartServer(GetTestElement);
+  // Threads of closed connections are joined as new connections arrive.
+  for (int i = 0; i < 100; ++i) {
+    std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+    GetElementRequest req;
+    req.set_task_id(i);
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(req, result));
+    EXPECT_EQ(result.element_index, i);
+  }
+}
+
+TEST(ShmDataTransferTest, CompatibleOnlyOnSameHost) {
+  std::shared_ptr<DataTransferServer> server = StartServer(GetTestElement);
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+
+  TF_ASSERT_OK_AND_ASSIGN(std::string server_info,
+                          server->GetCompatibilityInfo());
+  EXPECT_EQ(server_info, tsl::port::Hostname());
+  TF_EXPECT_OK(client->CheckCompatibility(server_info));
+  EXPECT_EQ(client->CheckCompatibility(server_info + "-other").code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -44,7 +44,11 @@ std::string LocalityOptimizedPath(const std::string& path) { return path; }
 absl::StatusOr<bool> DisableCompressionAtRuntime(
     const std::string& data_transfer_protocol, DeploymentMode deployment_mode,
     DataServiceMetadata::Compression compression) {
-  return false;
+  // Co-located clients of the shared-memory protocol ("shm") read elements
+  // straight from the worker's memory, so compressing them only costs CPU.
+  return data_transfer_protocol == "shm" &&
+         deployment_mode == DEPLOYMENT_MODE_COLOCATED &&
+         compression == DataServiceMetadata::COMPRESSION_SNAPPY;
 }
 
 void LogFilenames(const std::vector<std::string>& files) {}
@@ -25,6 +25,18 @@ TEST(Util, DefaultDataTransferProtocol) {
   EXPECT_EQ(DefaultDataTransferProtocol(), "grpc");
 }
 
+TEST(Util, DisableCompressionAtRuntime) {
+  EXPECT_TRUE(*DisableCompressionAtRuntime(
+      "shm", DEPLOYMENT_MODE_COLOCATED,
+      DataServiceMetadata::COMPRESSION_SNAPPY));
+  EXPECT_FALSE(*DisableCompressionAtRuntime(
+      "grpc", DEPLOYMENT_MODE_COLOCATED,
+      DataServiceMetadata::COMPRESSION_SNAPPY));
+  EXPECT_FALSE(*DisableCompressionAtRuntime(
+      "shm", DEPLOYMENT_MODE_REMOTE,
+      DataServiceMetadata::COMPRESSION_SNAPPY));
+}
+
 TEST(TranslateFileName, NoOp) {
   constexpr char file[] = "/home/tfdata/file1";
   EXPECT_EQ(TranslateFileName(file), file);
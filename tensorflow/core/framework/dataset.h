@@ -1622,6 +1622,15 @@ class DatasetBaseIterator : public IteratorBase {
     }
   }
 
+  // When modeling is enabled, this method records that this iterator has
+  // spilled (positive delta) or read back (negative delta) the given number of
+  // bytes of its internal buffer to or from local storage.
+  void RecordBufferSpill(IteratorContext* ctx, int64_t bytes_delta) {
+    if (collect_resource_usage(ctx)) {
+      node_->record_spill_event(bytes_delta);
+    }
+  }
+
   // When modeling is enabled, this method records the fact that this iterator
   // has produced an element and its size in bytes.
   void RecordElement(IteratorContext* ctx, std::vector<Tensor>* out_tensors) {
@@ -1653,6 +1662,24 @@ class DatasetBaseIterator : public IteratorBase {
     }
   }
 
+  // When modeling is enabled, this method records the fact that a consumer of
+  // this iterator, which started waiting for an element at `start_nanos`, has
+  // stopped waiting.
+  void RecordConsumerWait(IteratorContext* ctx, int64_t start_nanos) {
+    if (collect_resource_usage(ctx)) {
+      node_->record_consumer_wait(EnvTime::NowNanos() - start_nanos);
+    }
+  }
+
+  // When modeling is enabled, this method records the fact that a producer of
+  // this iterator, which started waiting for room in the buffer or for a free
+  // parallel call at `start_nanos`, has stopped waiting.
+  void RecordProducerWait(IteratorContext* ctx, int64_t start_nanos) {
+    if (collect_resource_usage(ctx)) {
+      node_->record_producer_wait(EnvTime::NowNanos() - start_nanos);
+    }
+  }
+
   // Returns whether work is currently being recorded, i.e. whether we are
   // currently between a `RecordStart` and a `RecordStop`.
   bool IsRecording(IteratorContext* ctx) {
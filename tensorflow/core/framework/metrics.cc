@@ -63,6 +63,11 @@ auto* graph_pending_queue_length_histogram = tsl::monitoring::Sampler<0>::New(
     // Power of 1.5 with bucket count 30 (> 191k)
     {tsl::monitoring::Buckets::Exponential(1, 1.5, 30)});
 
+auto* work_stealing_stalled_nodes = tsl::monitoring::Counter<0>::New(
+    "/tensorflow/core/work_stealing_stalled_nodes",
+    "The number of ready nodes taken from workers of the work-stealing "
+    "executor that were blocked for too long.");
+
 auto* graph_run_input_tensor_bytes = tsl::monitoring::Sampler<0>::New(
     {"/tensorflow/core/graph_run_input_tensor_bytes",
      "The size of input tensors in bytes."},
@@ -305,6 +310,13 @@ auto* tf_data_pipeline_processing_time = tsl::monitoring::Gauge<double, 1>::New(
     "in microseconds",
     "id");
 
+auto* tf_data_autotune_budget = tsl::monitoring::Gauge<int64, 2>::New(
+    "/tensorflow/data/autotune_budget",
+    "The share of the CPU (in cores) and RAM (in bytes) budgets of the process "
+    "allocated to the input pipeline by the tf.data autotuning budget "
+    "coordinator.",
+    "id", "resource");
+
 auto* tf_data_auto_shard = tsl::monitoring::Gauge<int64, 2>::New(
     "/tensorflow/data/autoshard", "tf.data autoshard statistics.", "id",
     "name");
@@ -586,6 +598,12 @@ void RecordTFDataAutotuneMaxBufferBudgetRatio(const double ratio) {
   tf_data_buffered_vs_budget_ratio_histogram_cell->Add(ratio);
 }
 
+void RecordTFDataAutotuneBudget(const string& id, int64_t cpu_budget,
+                                int64_t ram_budget) {
+  tf_data_autotune_budget->GetCell(id, "cpu")->Set(cpu_budget);
+  tf_data_autotune_budget->GetCell(id, "ram")->Set(ram_budget);
+}
+
 void RecordTFDataIteratorBusy(uint64 duration_us) {
   static auto* tf_data_iterator_busy_cell =
       tf_data_iterator_busy_counter->GetCell();
@@ -815,6 +833,12 @@ void UpdateGraphPendingQueueLength(uint64 len) {
   graph_pending_queue_length_cell->Add(len);
 }
 
+void RecordWorkStealingStalledNodes(int64_t num_nodes) {
+  static auto* work_stealing_stalled_nodes_cell =
+      work_stealing_stalled_nodes->GetCell();
+  work_stealing_stalled_nodes_cell->IncrementBy(num_nodes);
+}
+
 void UpdateGraphBuildTime(const uint64 running_time_usecs) {
   if (running_time_usecs > 0) {
     static auto* build_graph_calls_cell = build_graph_calls->GetCell();
@@ -110,6 +110,11 @@ void RecordTFDataAutotuneUsedRamBudgetRatio(const double ratio);
 // bytes over the ram budget.
 void RecordTFDataAutotuneMaxBufferBudgetRatio(const double ratio);
 
+// Records the number of cores and bytes of RAM allocated to the tf.data
+// autotuning model `id` by the budget coordinator.
+void RecordTFDataAutotuneBudget(const string& id, int64_t cpu_budget,
+                                int64_t ram_budget);
+
 // Records the number of times each tf.data fingerprint is used
 // to measure duplicate pre-processing.
 //
@@ -269,6 +274,10 @@ void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica);
 void UpdateGraphExecTime(const uint64 running_time_usecs);
 void UpdateGraphPendingQueueLength(uint64 len);
 
+// Records `num_nodes` ready nodes of a blocked worker of the work-stealing
+// executor being run by another worker.
+void RecordWorkStealingStalledNodes(int64_t num_nodes);
+
 // Records that one output of an op of type `op_name` was unused.
 void RecordUnusedOutput(const string& op_name);
 
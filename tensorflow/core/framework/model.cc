@@ -361,6 +361,21 @@ inline void UpdateStateValues(Node::ModelParameters* parameters) {
   }
 }
 
+// Returns the value of the shared state of `parameter`, or its minimum if the
+// state hasn't been set yet.
+double StateValue(const Parameter& parameter) {
+  tf_shared_lock l(*parameter.state->mu);
+  return std::max(parameter.state->value, parameter.min);
+}
+
+// Sets the shared state of `parameter` to `value`.
+void SetStateValue(const Parameter& parameter, double value) {
+  VLOG(2) << "Setting tunable parameter " << parameter.name << " to " << value;
+  mutex_lock l(*parameter.state->mu);
+  parameter.state->value = value;
+  parameter.state->cond_var->notify_all();
+}
+
 // Recursively produces protos for nodes in a subtree of `output` node and
 // appends them to nodes of the given model.
 Status ModelToProtoHelper(std::shared_ptr<Node> output, ModelProto* model) {
@@ -1419,6 +1434,138 @@ std::shared_ptr<Parameter> MakeNonTunableParameter(const string& name,
                                      /*max=*/value);
 }
 
+BudgetCoordinator* BudgetCoordinator::Global() {
+  static BudgetCoordinator* coordinator = new BudgetCoordinator();
+  return coordinator;
+}
+
+BudgetCoordinator::Allocation BudgetCoordinator::Update(
+    const std::string& model_id, const Demand& demand, int64_t cpu_budget,
+    int64_t ram_budget) {
+  std::vector<std::string> model_ids;
+  std::vector<Demand> demands;
+  {
+    mutex_lock l(mu_);
+    demands_[model_id] = demand;
+    for (const auto& [id, model_demand] : demands_) {
+      model_ids.push_back(id);
+      demands.push_back(model_demand);
+    }
+  }
+  std::vector<Allocation> allocations =
+      Allocate(demands, cpu_budget, ram_budget);
+  Allocation allocation;
+  for (size_t i = 0; i < model_ids.size(); ++i) {
+    if (model_ids[i] == model_id) {
+      allocation = allocations[i];
+      break;
+    }
+  }
+  VLOG(2) << "Allocated " << allocation.cpu_budget << " of " << cpu_budget
+          << " cores and " << allocation.ram_budget << " of " << ram_budget
+          << " bytes to model " << model_id << " shared by "
+          << model_ids.size() << " models.";
+  metrics::RecordTFDataAutotuneBudget(model_id, allocation.cpu_budget,
+                                      allocation.ram_budget);
+  return allocation;
+}
+
+void BudgetCoordinator::Remove(const std::string& model_id) {
+  {
+    mutex_lock l(mu_);
+    if (demands_.erase(model_id) == 0) {
+      return;
+    }
+  }
+  metrics::RecordTFDataAutotuneBudget(model_id, 0, 0);
+}
+
+std::vector<BudgetCoordinator::Allocation> BudgetCoordinator::Allocate(
+    const std::vector<Demand>& demands, int64_t cpu_budget,
+    int64_t ram_budget) {
+  const int num_pipelines = demands.size();
+  std::vector<Allocation> allocations(num_pipelines);
+  if (num_pipelines == 0) {
+    return allocations;
+  }
+
+  // The number of cores each pipeline needs to keep up with its consumer. A
+  // pipeline whose consumer or processing time isn't known yet is assumed to be
+  // able to use the whole budget.
+  std::vector<double> needed_cores(num_pipelines);
+  for (int i = 0; i < num_pipelines; ++i) {
+    const Demand& demand = demands[i];
+    if (demand.processing_time_nsec > 0 && demand.target_time_nsec > 0) {
+      needed_cores[i] = demand.processing_time_nsec / demand.target_time_nsec;
+    } else {
+      needed_cores[i] = std::max<double>(cpu_budget, 1);
+    }
+  }
+  // The increase of the throughput of pipeline `i`, relative to the rate its
+  // consumer requests elements at, from one more core.
+  auto marginal_benefit = [&](int i) {
+    const double cores = allocations[i].cpu_budget;
+    return std::min(1.0, (cores + 1) / needed_cores[i]) -
+           std::min(1.0, cores / needed_cores[i]);
+  };
+
+  int64_t remaining_cores = cpu_budget;
+  for (Allocation& allocation : allocations) {
+    allocation.cpu_budget = 1;
+    --remaining_cores;
+  }
+  for (; remaining_cores > 0; --remaining_cores) {
+    int best = 0;
+    double best_benefit = marginal_benefit(0);
+    for (int i = 1; i < num_pipelines; ++i) {
+      const double benefit = marginal_benefit(i);
+      // Break ties in favor of the pipeline with fewer cores, so that
+      // pipelines with the same demand get the same share.
+      if (benefit > best_benefit ||
+          (benefit == best_benefit &&
+           allocations[i].cpu_budget < allocations[best].cpu_budget)) {
+        best = i;
+        best_benefit = benefit;
+      }
+    }
+    if (best_benefit <= 0) {
+      break;
+    }
+    ++allocations[best].cpu_budget;
+  }
+  // Once all pipelines keep up with their consumers, the spare cores are split
+  // evenly so that the pipelines can absorb bursts.
+  for (int i = 0; remaining_cores > 0; --remaining_cores) {
+    ++allocations[i].cpu_budget;
+    i = (i + 1) % num_pipelines;
+  }
+
+  ram_budget = std::max<int64_t>(ram_budget, 0);
+  int64_t total_buffered_bytes = 0;
+  int64_t total_cores = 0;
+  for (int i = 0; i < num_pipelines; ++i) {
+    total_buffered_bytes += demands[i].buffered_bytes;
+    total_cores += allocations[i].cpu_budget;
+  }
+  const double buffered_share =
+      total_buffered_bytes > ram_budget
+          ? static_cast<double>(ram_budget) / total_buffered_bytes
+          : 1.0;
+  int64_t spare_ram = ram_budget;
+  for (int i = 0; i < num_pipelines; ++i) {
+    allocations[i].ram_budget =
+        static_cast<int64_t>(demands[i].buffered_bytes * buffered_share);
+    spare_ram -= allocations[i].ram_budget;
+  }
+  spare_ram = std::max<int64_t>(spare_ram, 0);
+  for (int i = 0; i < num_pipelines; ++i) {
+    allocations[i].ram_budget += static_cast<int64_t>(
+        static_cast<double>(spare_ram) * allocations[i].cpu_budget /
+        total_cores);
+  }
+  return allocations;
+}
+
 std::shared_ptr<Node> MakeInterleaveManyNode(
     Node::Args args, std::vector<std::shared_ptr<Parameter>> parameters) {
   DCHECK(absl::c_any_of(parameters,
@@ -2040,6 +2187,7 @@ void Node::DebugStringHelper(absl::flat_hash_map<string, string>* debug_strings)
   strings::StrAppend(&result, "  autotune=", autotune_.load(), "\n");
   strings::StrAppend(&result, "  buffered_bytes=", buffered_bytes_.load(),
                      "\n");
+  strings::StrAppend(&result, "  spilled_bytes=", spilled_bytes_.load(), "\n");
   strings::StrAppend(&result, "  buffered_elements=", buffered_elements_.load(),
                      "\n");
   strings::StrAppend(&result, "  bytes_consumed=", bytes_consumed_.load(),
@@ -2071,6 +2219,7 @@ std::shared_ptr<Node> Node::SnapshotHelper(
   {
     cloned_current->autotune_.store(autotune_);
     cloned_current->buffered_bytes_.store(buffered_bytes_);
+    cloned_current->spilled_bytes_.store(spilled_bytes_);
     cloned_current->buffered_elements_.store(buffered_elements_);
     cloned_current->buffered_elements_low_.store(buffered_elements_low_);
     cloned_current->buffered_elements_high_.store(buffered_elements_high_);
@@ -2079,6 +2228,8 @@ std::shared_ptr<Node> Node::SnapshotHelper(
     cloned_current->num_elements_.store(num_elements_);
     cloned_current->record_metrics_.store(false);
     cloned_current->processing_time_.store(processing_time_);
+    cloned_current->consumer_wait_time_.store(consumer_wait_time_);
+    cloned_current->producer_wait_time_.store(producer_wait_time_);
     {
       mutex_lock l2(cloned_current->mu_);
       cloned_current->parameters_ =
@@ -2144,6 +2295,7 @@ Status Node::ToProto(ModelProto::Node* node_proto) const {
   node_proto->set_name(name_);
   node_proto->set_autotune(autotune_);
   node_proto->set_buffered_bytes(buffered_bytes_);
+  node_proto->set_spilled_bytes(spilled_bytes_);
   node_proto->set_buffered_elements(buffered_elements_);
   node_proto->set_bytes_consumed(bytes_consumed_);
   node_proto->set_bytes_produced(bytes_produced_);
@@ -2177,6 +2329,7 @@ Status Node::FromProtoHelper(ModelProto::Node node_proto,
     tf_shared_lock l(node->mu_);
     node->autotune_.store(node_proto.autotune());
     node->buffered_bytes_.store(node_proto.buffered_bytes());
+    node->spilled_bytes_.store(node_proto.spilled_bytes());
     node->buffered_elements_.store(node_proto.buffered_elements());
     if (node_proto.buffered_elements() == 0) {
       node->buffered_elements_low_.store(std::numeric_limits<int64_t>::max());
@@ -2297,6 +2450,9 @@ Model::~Model() {
   safe_to_collect_metrics_->val = false;
   // Reset the pipeline processing time to 0
   metrics::RecordPipelineProcessingTime(model_id_, 0);
+  if (experiments_.contains("autotune_global_budget")) {
+    BudgetCoordinator::Global()->Remove(model_id_);
+  }
 }
 
 void Model::AddNode(Node::Factory factory, const string& name,
@@ -2369,6 +2525,20 @@ void Model::Optimize(AutotuneAlgorithm algorithm,
                        (port::AvailableRam() + TotalBufferedBytes(snapshot));
   }
 
+  int64_t cpu_budget = cpu_budget_func();
+  if (experiments_.contains("autotune_global_budget")) {
+    // Share the budgets with the other input pipelines of the process.
+    BudgetCoordinator::Demand demand;
+    demand.processing_time_nsec = TotalProcessingTime(snapshot);
+    demand.target_time_nsec = ComputeTargetTimeNsec();
+    demand.buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+    BudgetCoordinator::Allocation allocation =
+        BudgetCoordinator::Global()->Update(model_id_, demand, cpu_budget,
+                                            total_ram_budget);
+    cpu_budget = allocation.cpu_budget;
+    total_ram_budget = allocation.ram_budget;
+  }
+
   ram_budget_manager.UpdateBudget(total_ram_budget);
   int64_t model_ram_budget = ram_budget_manager.AvailableModelRam();
   int64_t original_model_bytes = TotalMaximumBufferedBytes(snapshot);
@@ -2377,7 +2547,7 @@ void Model::Optimize(AutotuneAlgorithm algorithm,
   }
   OptimizationParams optimization_params;
   optimization_params.set_algorithm(algorithm);
-  optimization_params.set_cpu_budget(cpu_budget_func());
+  optimization_params.set_cpu_budget(cpu_budget);
   optimization_params.set_ram_budget(model_ram_budget);
   optimization_params.set_model_input_time(model_input_time);
   switch (algorithm) {
@@ -2403,6 +2573,10 @@ void Model::Optimize(AutotuneAlgorithm algorithm,
       OptimizeStageBased(snapshot, optimization_params, cancellation_manager,
                          ram_budget_manager);
       break;
+    case AutotuneAlgorithm::MEASUREMENT_BASED:
+      OptimizeMeasurementBased(snapshot, optimization_params,
+                               ram_budget_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -2589,8 +2763,17 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm,
     // threshold is reached.
     {
       mutex_lock l(mu_);
+      int64_t max_optimization_period_ms = kOptimizationPeriodMaxMs;
+      if (algorithm == AutotuneAlgorithm::MEASUREMENT_BASED) {
+        // Experiments are evaluated as soon as they have been measured for
+        // long enough.
+        max_optimization_period_ms = std::max<int64_t>(
+            std::min(max_optimization_period_ms,
+                     measurement_options_.interval_ms),
+            kOptimizationPeriodMinMs);
+      }
       optimization_period_ms_ =
-          std::min(optimization_period_ms_ << 1, kOptimizationPeriodMaxMs);
+          std::min(optimization_period_ms_ << 1, max_optimization_period_ms);
     }
     current_time_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
     last_optimization_ms = current_time_ms;
@@ -2757,6 +2940,194 @@ void Model::OptimizeHillClimbHelper(
     UpdateStateValues(&parameters);
   }
 }
+void Model::OptimizeMeasurementBased(
+    std::shared_ptr<Node> snapshot,
+    const OptimizationParams& optimization_params,
+    RamBudgetManager& ram_budget_manager) {
+  // Fraction of the interval a consumer needs to wait for elements for its
+  // input to be considered too slow.
+  constexpr double kMinConsumerWaitFraction = 0.05;
+  // Fraction of the interval producers need to wait for their consumer for
+  // the node to be considered to have more resources than it needs.
+  constexpr double kMinProducerWaitFraction = 0.5;
+  // Relative size of the changes made to parameter values.
+  constexpr double kStepRatio = 0.25;
+  // Number of intervals for which a parameter is left alone after a change to
+  // it was reverted.
+  constexpr int64_t kRevertedIntervals = 10;
+
+  MeasurementOptions options;
+  {
+    tf_shared_lock l(mu_);
+    options = measurement_options_;
+  }
+  MeasurementState& state = measurement_state_;
+  const int64_t now_nanos = EnvTime::NowNanos();
+  Node::NodeVector nodes =
+      snapshot->CollectNodes(TraversalOrder::BFS, IsAutotuneNode);
+  nodes.insert(nodes.begin(), snapshot);
+  auto start_interval = [&]() {
+    state.interval_start_nanos = now_nanos;
+    state.interval_start_elements = snapshot->num_elements();
+    state.interval_start_wait_times.clear();
+    for (const auto& node : nodes) {
+      state.interval_start_wait_times[node->long_name()] = {
+          node->consumer_wait_time(), node->producer_wait_time()};
+    }
+  };
+  if (state.interval_start_nanos == 0) {
+    start_interval();
+    return;
+  }
+  const int64_t interval_nanos = now_nanos - state.interval_start_nanos;
+  if (interval_nanos <= 0 ||
+      interval_nanos < options.interval_ms * EnvTime::kMillisToNanos) {
+    return;
+  }
+  ++state.num_intervals;
+  const double throughput =
+      (snapshot->num_elements() - state.interval_start_elements) *
+      static_cast<double>(EnvTime::kSecondsToNanos) / interval_nanos;
+
+  if (state.experiment_parameter != nullptr) {
+    const Parameter& parameter = *state.experiment_parameter;
+    const bool increased =
+        StateValue(parameter) > state.experiment_previous_value;
+    const double min_throughput =
+        state.baseline_throughput * (increased ? 1 + options.min_improvement
+                                               : 1 - options.min_improvement);
+    VLOG(2) << "Throughput changed from " << state.baseline_throughput
+            << " to " << throughput << " elements/s after changing "
+            << state.experiment_key << ".";
+    if (throughput < min_throughput) {
+      SetStateValue(parameter, state.experiment_previous_value);
+      state.reverted_until_interval[state.experiment_key] =
+          state.num_intervals + kRevertedIntervals;
+      state.experiment_parameter = nullptr;
+      // Measure the original configuration again before the next experiment.
+      start_interval();
+      return;
+    }
+    state.experiment_parameter = nullptr;
+  }
+  state.baseline_throughput = throughput;
+
+  ModelParameters parameters = CollectTunableParameters(snapshot);
+  absl::flat_hash_map<std::string, Node::ModelParameters> node_parameters;
+  double total_parallelism = 0;
+  for (auto& [node_name, parameter] : parameters) {
+    parameter->value = StateValue(*parameter);
+    if (parameter->name == kParallelism) {
+      total_parallelism += parameter->value;
+    }
+    node_parameters[node_name].emplace_back(node_name, parameter);
+  }
+  auto find_parameter = [&](const Node& node, const std::string& name,
+                            bool increase) -> std::shared_ptr<Parameter> {
+    auto it = node_parameters.find(node.long_name());
+    if (it == node_parameters.end()) {
+      return nullptr;
+    }
+    for (auto& [node_name, parameter] : it->second) {
+      if (parameter->name != name ||
+          (increase ? parameter->value >= parameter->max
+                    : parameter->value <= parameter->min)) {
+        continue;
+      }
+      auto reverted = state.reverted_until_interval.find(
+          strings::StrCat(node_name, ":", name));
+      if (reverted != state.reverted_until_interval.end() &&
+          reverted->second > state.num_intervals) {
+        continue;
+      }
+      return parameter;
+    }
+    return nullptr;
+  };
+  auto wait_fractions = [&](const Node& node) -> std::pair<double, double> {
+    auto it = state.interval_start_wait_times.find(node.long_name());
+    if (it == state.interval_start_wait_times.end()) {
+      return {0, 0};
+    }
+    return {static_cast<double>(node.consumer_wait_time() - it->second.first) /
+                interval_nanos,
+            static_cast<double>(node.producer_wait_time() - it->second.second) /
+                interval_nanos};
+  };
+
+  // Nodes are visited in BFS order, so the last node whose consumer waited is
+  // the deepest one.
+  std::shared_ptr<Parameter> experiment_parameter;
+  std::shared_ptr<Node> experiment_node;
+  bool increase = true;
+  for (const auto& node : nodes) {
+    if (!node->IsAsync() ||
+        wait_fractions(*node).first < kMinConsumerWaitFraction) {
+      continue;
+    }
+    std::shared_ptr<Parameter> parameter;
+    if (total_parallelism < optimization_params.cpu_budget()) {
+      parameter = find_parameter(*node, kParallelism, /*increase=*/true);
+    }
+    if (parameter == nullptr) {
+      parameter = find_parameter(*node, kBufferSize, /*increase=*/true);
+    }
+    if (parameter != nullptr) {
+      experiment_parameter = parameter;
+      experiment_node = node;
+    }
+  }
+  if (experiment_parameter == nullptr) {
+    double max_producer_wait_fraction = kMinProducerWaitFraction;
+    for (const auto& node : nodes) {
+      if (!node->IsAsync()) {
+        continue;
+      }
+      const auto [consumer_wait_fraction, producer_wait_fraction] =
+          wait_fractions(*node);
+      if (consumer_wait_fraction >= kMinConsumerWaitFraction ||
+          producer_wait_fraction < max_producer_wait_fraction) {
+        continue;
+      }
+      std::shared_ptr<Parameter> parameter =
+          find_parameter(*node, kParallelism, /*increase=*/false);
+      if (parameter != nullptr) {
+        experiment_parameter = parameter;
+        experiment_node = node;
+        max_producer_wait_fraction = producer_wait_fraction;
+        increase = false;
+      }
+    }
+  }
+  if (experiment_parameter == nullptr) {
+    VLOG(2) << "No bottleneck found at " << throughput << " elements/s.";
+    start_interval();
+    return;
+  }
+
+  const double previous_value = experiment_parameter->value;
+  const double step = std::max(1.0, std::round(previous_value * kStepRatio));
+  experiment_parameter->value =
+      increase ? std::min(previous_value + step, experiment_parameter->max)
+               : std::max(previous_value - step, experiment_parameter->min);
+  const std::string key = strings::StrCat(experiment_node->long_name(), ":",
+                                          experiment_parameter->name);
+  if (!ram_budget_manager.RequestModelAllocation(
+          TotalMaximumBufferedBytes(snapshot))) {
+    VLOG(2) << "Not changing " << key << " as it would exceed the RAM budget.";
+    experiment_parameter->value = previous_value;
+    state.reverted_until_interval[key] =
+        state.num_intervals + kRevertedIntervals;
+    start_interval();
+    return;
+  }
+  SetStateValue(*experiment_parameter, experiment_parameter->value);
+  state.experiment_parameter = experiment_parameter;
+  state.experiment_key = key;
+  state.experiment_previous_value = previous_value;
+  start_interval();
+}
+
 void Model::RecordIteratorGapTime(uint64_t duration_usec) {
   mutex_lock l(gap_mu_);
   // Drop duration if it is too large.
@@ -259,6 +259,59 @@ class RamBudgetManager {
   int64_t model_allocated_ TF_GUARDED_BY(mu_) = 0;
 };
 
+// Class for sharing the CPU and RAM budgets of the process between the models
+// of all input pipelines that are autotuned at the same time, e.g. the training
+// and evaluation iterators of a trainer. Otherwise each model optimizes for the
+// whole budget and concurrent pipelines oversubscribe the host.
+//
+// Every model reports its demand when it optimizes and gets back its share.
+// Cores are handed out one at a time to the pipeline whose throughput, as a
+// fraction of the rate at which its consumer requests elements, increases the
+// most, i.e. to the pipelines that need the fewest cores to keep up with their
+// consumer first. Each pipeline keeps the RAM its buffers currently hold as
+// long as they all fit in the budget, and the rest of the RAM is split in
+// proportion to the allocated cores, since the number of elements that a
+// pipeline buffers grows with its parallelism.
+class BudgetCoordinator {
+ public:
+  struct Demand {
+    // CPU time in nanoseconds that the pipeline spends to produce an element.
+    double processing_time_nsec = 0;
+    // Time in nanoseconds between consecutive requests of the consumer of the
+    // pipeline, or 0 if it isn't known yet.
+    double target_time_nsec = 0;
+    // Number of bytes held by the buffers of the pipeline when they are full.
+    int64_t buffered_bytes = 0;
+  };
+
+  struct Allocation {
+    int64_t cpu_budget = 0;
+    int64_t ram_budget = 0;
+  };
+
+  // Returns the coordinator shared by all models of the process.
+  static BudgetCoordinator* Global();
+
+  // Records the latest demand of the model `model_id` and returns its share of
+  // the `cpu_budget` cores and `ram_budget` bytes available to the process.
+  Allocation Update(const std::string& model_id, const Demand& demand,
+                    int64_t cpu_budget, int64_t ram_budget)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Stops sharing the budgets with the model `model_id`.
+  void Remove(const std::string& model_id) TF_LOCKS_EXCLUDED(mu_);
+
+  // Splits `cpu_budget` and `ram_budget` between pipelines with the given
+  // `demands`. Every pipeline gets at least one core.
+  static std::vector<Allocation> Allocate(const std::vector<Demand>& demands,
+                                          int64_t cpu_budget,
+                                          int64_t ram_budget);
+
+ private:
+  mutex mu_;
+  absl::flat_hash_map<std::string, Demand> demands_ TF_GUARDED_BY(mu_);
+};
+
 // Abstract representation of a TensorFlow input pipeline node. It collects
 // information about inputs to this node, processing time spent executing the
 // node logic, number of elements produced by the node, various other
@@ -303,6 +356,7 @@ class Node {
         autotune_(true),
         buffered_bytes_(0),
         peak_buffered_bytes_(0),
+        spilled_bytes_(0),
         buffered_elements_(0),
         buffered_elements_low_(std::numeric_limits<int64_t>::max()),
         buffered_elements_high_(std::numeric_limits<int64_t>::min()),
@@ -310,6 +364,8 @@ class Node {
         bytes_produced_(0),
         num_elements_(0),
         processing_time_(0),
+        consumer_wait_time_(0),
+        producer_wait_time_(0),
         record_metrics_(true),
         metrics_(name_),
         output_(args.output.get()),
@@ -365,6 +421,12 @@ class Node {
     return peak_buffered_bytes_;
   }
 
+  // Returns the number of bytes this node has spilled from its buffer to local
+  // storage.
+  int64_t spilled_bytes() const TF_LOCKS_EXCLUDED(mu_) {
+    return spilled_bytes_;
+  }
+
   // Returns the number of elements stored in this node's buffer.
   int64_t buffered_elements() const TF_LOCKS_EXCLUDED(mu_) {
     return buffered_elements_;
@@ -436,6 +498,17 @@ class Node {
     return processing_time_;
   }
 
+  // Returns the aggregate time consumers of the node waited for an element.
+  int64_t consumer_wait_time() const TF_LOCKS_EXCLUDED(mu_) {
+    return consumer_wait_time_;
+  }
+
+  // Returns the aggregate time producers of the node waited for room in its
+  // buffer or for a free parallel call.
+  int64_t producer_wait_time() const TF_LOCKS_EXCLUDED(mu_) {
+    return producer_wait_time_;
+  }
+
   // Records that the node consumed the given number of bytes.
   void record_bytes_consumed(int64_t num_bytes) {
     bytes_consumed_ += num_bytes;
@@ -446,6 +519,12 @@ class Node {
     bytes_produced_ += num_bytes;
   }
 
+  // Records the change in the number of bytes spilled from this node's buffer
+  // to local storage.
+  void record_spill_event(int64_t bytes_delta) {
+    spilled_bytes_ += bytes_delta;
+  }
+
   // Records the change in this node's buffer.
   void record_buffer_event(int64_t bytes_delta, int64_t elements_delta) {
     buffered_bytes_ += bytes_delta;
@@ -463,6 +542,17 @@ class Node {
     }
   }
 
+  // Records that a consumer of the node waited `time_nanos` for an element.
+  void record_consumer_wait(int64_t time_nanos) {
+    consumer_wait_time_ += time_nanos;
+  }
+
+  // Records that a producer of the node waited `time_nanos` for room in its
+  // buffer or for a free parallel call.
+  void record_producer_wait(int64_t time_nanos) {
+    producer_wait_time_ += time_nanos;
+  }
+
   // Records that the node produced an element.
   void record_element() TF_LOCKS_EXCLUDED(mu_) {
     num_elements_++;
@@ -835,6 +925,7 @@ class Node {
   std::atomic<bool> autotune_;
   std::atomic<int64_t> buffered_bytes_;
   std::atomic<int64_t> peak_buffered_bytes_;
+  std::atomic<int64_t> spilled_bytes_;
   std::atomic<int64_t> buffered_elements_;
   std::atomic<int64_t> buffered_elements_low_;
   std::atomic<int64_t> buffered_elements_high_;
@@ -842,6 +933,8 @@ class Node {
   std::atomic<int64_t> bytes_produced_;
   std::atomic<int64_t> num_elements_;
   std::atomic<int64_t> processing_time_;
+  std::atomic<int64_t> consumer_wait_time_;
+  std::atomic<int64_t> producer_wait_time_;
   std::atomic<bool> record_metrics_;
   Metrics metrics_;
   absl::flat_hash_map<string, std::shared_ptr<Parameter>> parameters_
@@ -946,11 +1039,31 @@ class Model {
     return output_;
   }
 
+  // Options of the `MEASUREMENT_BASED` autotuning algorithm.
+  struct MeasurementOptions {
+    // Time in milliseconds for which the throughput of each configuration is
+    // measured. Longer intervals make the measurements less noisy, but
+    // configurations that turn out worse are kept for longer.
+    int64_t interval_ms = 1000;
+    // Relative change of the throughput an experiment has to make for it to be
+    // kept. Parallelism or buffers are only added if they increase the
+    // throughput by at least this much, and only removed if they decrease it by
+    // less than this much.
+    double min_improvement = 0.02;
+  };
+
   // Set the experiment that this job is part of.
   void AddExperiment(const std::string& experiment) {
     experiments_.insert(experiment);
   }
 
+  // Sets the options of the `MEASUREMENT_BASED` autotuning algorithm.
+  void SetMeasurementOptions(const MeasurementOptions& options)
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    measurement_options_ = options;
+  }
+
   // Adds a node with the given name and given parent.
   void AddNode(Node::Factory factory, const string& name,
                std::shared_ptr<Node> parent, std::shared_ptr<Node>* out_node)
@@ -1150,6 +1263,22 @@ class Model {
       CancellationManager* cancellation_manager,
       RamBudgetManager& ram_budget_manager);
 
+  // This optimization algorithm measures the throughput of the pipeline instead
+  // of estimating it with the analytical model of its nodes, which can be off
+  // for user-defined functions or remote I/O. Each round runs one experiment:
+  // it changes one tunable parameter, measures how many elements the pipeline
+  // produces per second over the next interval, and reverts the change unless
+  // the throughput changed by at least `min_improvement` in its favor.
+  //
+  // The parameter to change is picked using the times the asynchronous nodes
+  // recorded waiting. The parallelism, or else the buffer size, of the deepest
+  // node whose consumer waited for elements is increased. If no consumer waits,
+  // the parallelism of the node whose producers waited the most for room in
+  // its buffer is decreased to release resources.
+  void OptimizeMeasurementBased(std::shared_ptr<Node> snapshot,
+                                const OptimizationParams& optimization_params,
+                                RamBudgetManager& ram_budget_manager);
+
   // Determines if we should stop the gradient descent optimization iterations
   // based on number of increasable parameters, CPU budget, RAM budget and
   // current resource usage.
@@ -1218,6 +1347,32 @@ class Model {
   OptimizationParams optimization_params_ TF_GUARDED_BY(mu_);
   // Stores the model id in the string format
   std::string model_id_;
+
+  // State of the `MEASUREMENT_BASED` algorithm that is carried over between
+  // optimization rounds.
+  struct MeasurementState {
+    // Start of the current measurement interval, and the number of elements
+    // produced by the output node and the consumer and producer wait times of
+    // each node at that time.
+    int64_t interval_start_nanos = 0;
+    int64_t interval_start_elements = 0;
+    absl::flat_hash_map<std::string, std::pair<int64_t, int64_t>>
+        interval_start_wait_times;
+    // Throughput in elements per second before the running experiment.
+    double baseline_throughput = 0;
+    // Parameter changed by the running experiment, if any, its key and its
+    // value before the experiment.
+    std::shared_ptr<Parameter> experiment_parameter;
+    std::string experiment_key;
+    double experiment_previous_value = 0;
+    // Number of measured intervals, and the interval until which parameters
+    // whose changes were reverted are left alone.
+    int64_t num_intervals = 0;
+    absl::flat_hash_map<std::string, int64_t> reverted_until_interval;
+  };
+  MeasurementOptions measurement_options_ TF_GUARDED_BY(mu_);
+  // Only accessed by the optimization thread.
+  MeasurementState measurement_state_;
 };
 
 // Class to compute timing information for a model.
@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -3574,6 +3575,168 @@ TEST(RamBudgetManagerTest, RequestAllocationsWithBudgetAdjustment) {
   EXPECT_TRUE(rbm.RequestLegacyPrefetchBytes(4));
 }
 
+TEST(BudgetCoordinatorTest, SinglePipelineGetsWholeBudget) {
+  auto allocations = BudgetCoordinator::Allocate(
+      {{/*processing_time_nsec=*/1000, /*target_time_nsec=*/1000,
+        /*buffered_bytes=*/10}},
+      /*cpu_budget=*/8, /*ram_budget=*/100);
+  ASSERT_EQ(allocations.size(), 1);
+  EXPECT_EQ(allocations[0].cpu_budget, 8);
+  EXPECT_EQ(allocations[0].ram_budget, 100);
+}
+
+TEST(BudgetCoordinatorTest, AllocatesCoresByMarginalBenefit) {
+  // The first pipeline needs 10 cores to keep up with its consumer and the
+  // second one 2, so the second one benefits more from its second core.
+  auto allocations = BudgetCoordinator::Allocate(
+      {{10000, 1000, 0}, {2000, 1000, 0}}, /*cpu_budget=*/3,
+      /*ram_budget=*/0);
+  ASSERT_EQ(allocations.size(), 2);
+  EXPECT_EQ(allocations[0].cpu_budget, 1);
+  EXPECT_EQ(allocations[1].cpu_budget, 2);
+
+  // Once the second pipeline keeps up, the first one gets the other cores.
+  allocations = BudgetCoordinator::Allocate(
+      {{10000, 1000, 0}, {2000, 1000, 0}}, /*cpu_budget=*/8,
+      /*ram_budget=*/0);
+  EXPECT_EQ(allocations[0].cpu_budget, 6);
+  EXPECT_EQ(allocations[1].cpu_budget, 2);
+}
+
+TEST(BudgetCoordinatorTest, SplitsSpareCoresEvenly) {
+  auto allocations = BudgetCoordinator::Allocate(
+      {{4000, 1000, 0}, {1000, 1000, 0}}, /*cpu_budget=*/8,
+      /*ram_budget=*/0);
+  EXPECT_EQ(allocations[0].cpu_budget, 6);
+  EXPECT_EQ(allocations[1].cpu_budget, 2);
+
+  // Pipelines whose demand isn't known yet get the same share.
+  allocations = BudgetCoordinator::Allocate({{0, 0, 0}, {0, 0, 0}},
+                                            /*cpu_budget=*/8,
+                                            /*ram_budget=*/0);
+  EXPECT_EQ(allocations[0].cpu_budget, 4);
+  EXPECT_EQ(allocations[1].cpu_budget, 4);
+}
+
+TEST(BudgetCoordinatorTest, AllocatesRam) {
+  // The spare RAM is split in proportion to the allocated cores.
+  auto allocations = BudgetCoordinator::Allocate(
+      {{4000, 1000, 100}, {1000, 1000, 300}}, /*cpu_budget=*/8,
+      /*ram_budget=*/1000);
+  EXPECT_EQ(allocations[0].ram_budget, 550);
+  EXPECT_EQ(allocations[1].ram_budget, 450);
+
+  // Buffers that don't fit in the budget are scaled down.
+  allocations = BudgetCoordinator::Allocate(
+      {{4000, 1000, 600}, {1000, 1000, 200}}, /*cpu_budget=*/8,
+      /*ram_budget=*/400);
+  EXPECT_EQ(allocations[0].ram_budget, 300);
+  EXPECT_EQ(allocations[1].ram_budget, 100);
+}
+
+TEST(BudgetCoordinatorTest, UpdateAndRemove) {
+  CellReader<int64_t> cell_reader("/tensorflow/data/autotune_budget");
+  BudgetCoordinator coordinator;
+  BudgetCoordinator::Allocation allocation =
+      coordinator.Update("a", {}, /*cpu_budget=*/8, /*ram_budget=*/100);
+  EXPECT_EQ(allocation.cpu_budget, 8);
+  EXPECT_EQ(allocation.ram_budget, 100);
+
+  allocation = coordinator.Update("b", {}, /*cpu_budget=*/8,
+                                  /*ram_budget=*/100);
+  EXPECT_EQ(allocation.cpu_budget, 4);
+  EXPECT_EQ(allocation.ram_budget, 50);
+  EXPECT_EQ(cell_reader.Read("b", "cpu"), 4);
+  EXPECT_EQ(cell_reader.Read("b", "ram"), 50);
+
+  coordinator.Remove("b");
+  EXPECT_EQ(cell_reader.Read("b", "cpu"), 0);
+  allocation = coordinator.Update("a", {}, /*cpu_budget=*/8,
+                                  /*ram_budget=*/100);
+  EXPECT_EQ(allocation.cpu_budget, 8);
+}
+
+class OptimizeMeasurementBasedTest : public ::testing::Test {
+ protected:
+  // Builds a model `root <- async` where `async` has a tunable parallelism
+  // with the given initial value.
+  void BuildModel(int64_t parallelism) {
+    auto state = std::make_shared<SharedState>(
+        /*value=*/model::kAutotune, std::make_shared<mutex>(),
+        std::make_shared<condition_variable>());
+    state->value = parallelism;
+    root_ = model::MakeKnownRatioNode({0, "root", nullptr}, 1);
+    async_ = model::MakeAsyncKnownRatioNode(
+        {1, "async", root_}, 1,
+        {model::MakeParameter("parallelism", state, /*min=*/1,
+                              /*max=*/16)});
+    model_.AddNode([this](model::Node::Args args) { return root_; }, "root",
+                   nullptr, &root_);
+    model_.AddNode([this](model::Node::Args args) { return async_; }, "async",
+                   root_, &async_);
+    model_.SetMeasurementOptions({/*interval_ms=*/0, /*min_improvement=*/0.5});
+  }
+
+  // Produces `num_elements` elements and runs an optimization round.
+  void Optimize(int64_t num_elements) {
+    for (int64_t i = 0; i < num_elements; ++i) {
+      root_->record_element();
+      async_->record_element();
+    }
+    Env::Default()->SleepForMicroseconds(10000);
+    model_.Optimize(model::AutotuneAlgorithm::MEASUREMENT_BASED,
+                    CpuBudgetFunc(100), /*ram_budget_share=*/1.0,
+                    /*fixed_ram_budget=*/1LL << 30,
+                    /*model_input_time=*/0, ram_budget_manager_,
+                    &cancellation_manager_);
+  }
+
+  double parallelism() { return async_->parameter_value("parallelism"); }
+
+  std::shared_ptr<Node> root_;
+  std::shared_ptr<Node> async_;
+  model::Model model_;
+  CancellationManager cancellation_manager_;
+  RamBudgetManager ram_budget_manager_{1LL << 30};
+};
+
+TEST_F(OptimizeMeasurementBasedTest, KeepsChangesThatImproveThroughput) {
+  BuildModel(/*parallelism=*/4);
+  // The first round only starts measuring.
+  Optimize(/*num_elements=*/1);
+  EXPECT_EQ(parallelism(), 4);
+
+  // The consumer of `async` waits, so its parallelism is increased.
+  async_->record_consumer_wait(/*nanos=*/1000000000);
+  Optimize(/*num_elements=*/10);
+  EXPECT_EQ(parallelism(), 5);
+
+  // The throughput improved, so the change is kept and the next one made.
+  async_->record_consumer_wait(/*nanos=*/1000000000);
+  Optimize(/*num_elements=*/1000);
+  EXPECT_EQ(parallelism(), 6);
+
+  // The throughput didn't improve, so the change is reverted.
+  async_->record_consumer_wait(/*nanos=*/1000000000);
+  Optimize(/*num_elements=*/1);
+  EXPECT_EQ(parallelism(), 5);
+}
+
+TEST_F(OptimizeMeasurementBasedTest, DecreasesParallelismOfIdleProducers) {
+  BuildModel(/*parallelism=*/8);
+  Optimize(/*num_elements=*/100);
+  EXPECT_EQ(parallelism(), 8);
+
+  // The producers of `async` wait for its consumer most of the time.
+  async_->record_producer_wait(/*nanos=*/1000000000);
+  Optimize(/*num_elements=*/100);
+  EXPECT_EQ(parallelism(), 6);
+
+  // The throughput didn't drop, so the change is kept.
+  Optimize(/*num_elements=*/100);
+  EXPECT_EQ(parallelism(), 6);
+}
+
 TEST(NodeTest, OnlyCollectParametersThatHaveElementsProduced) {
   // Builds a graph:
   // root <- parallel_map <- parallel_interleave
@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/grappler/clusters/utils.h"
+#include "tensorflow/core/grappler/costs/op_cost_database.h"
 #include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
 
 namespace tensorflow {
@@ -26,7 +27,7 @@ namespace grappler {
 
 VirtualCluster::VirtualCluster(
     const std::unordered_map<string, DeviceProperties>& devices)
-    : VirtualCluster(devices, std::make_unique<OpLevelCostEstimator>(),
+    : VirtualCluster(devices, NewOpLevelCostEstimator(),
                      ReadyNodeManagerFactory("FirstReady")) {}
 
 VirtualCluster::VirtualCluster(
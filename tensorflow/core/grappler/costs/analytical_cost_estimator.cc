@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/graph/types.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/op_cost_database.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/grappler/costs/utils.h"
 #include "tensorflow/core/grappler/costs/virtual_placer.h"
@@ -117,7 +118,7 @@ AnalyticalCostEstimator::AnalyticalCostEstimator(
     Cluster* cluster, bool use_static_shapes,
     bool use_aggressive_shape_inference)
     : AnalyticalCostEstimator(
-          cluster, std::make_unique<OpLevelCostEstimator>(),
+          cluster, NewOpLevelCostEstimator(),
           ReadyNodeManagerFactory("FirstReady"), use_static_shapes,
           use_aggressive_shape_inference) {}
 
@@ -0,0 +1,305 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_database.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kDatabaseEnvVar[] = "TF_GRAPPLER_OP_COST_DATABASE";
+// Suffix of the device names of GPU stream timings, e.g.
+// "/device:GPU:0/stream:all" or "/device:GPU:0/stream:7".
+constexpr char kStreamSuffix[] = "/stream:";
+constexpr char kAllStreams[] = "all";
+
+// Returns the key `op_info` is stored under, or an empty string if its input
+// shapes aren't all known. Attributes starting with an underscore, e.g.
+// placement constraints, don't affect the cost of the op and are ignored.
+std::string Key(const OpInfo& op_info) {
+  std::string key = absl::StrCat(op_info.op(), ";", op_info.device().type());
+  for (const OpInfo::TensorProperties& input : op_info.inputs()) {
+    if (!PartialTensorShape(input.shape()).IsFullyDefined()) return "";
+    absl::StrAppend(&key, ";", DataTypeString(input.dtype()),
+                    PartialTensorShape::DebugString(input.shape()));
+  }
+  std::vector<std::string> attr_names;
+  for (const auto& attr : op_info.attr()) {
+    if (!absl::StartsWith(attr.first, "_")) attr_names.push_back(attr.first);
+  }
+  std::sort(attr_names.begin(), attr_names.end());
+  for (const std::string& name : attr_names) {
+    absl::StrAppend(&key, ";", name, "=",
+                    SummarizeAttrValue(op_info.attr().at(name)));
+  }
+  return key;
+}
+
+// Returns the parts of `op_info` that make up its key.
+OpInfo StripOpInfo(const OpInfo& op_info) {
+  OpInfo stripped;
+  stripped.set_op(op_info.op());
+  for (const auto& attr : op_info.attr()) {
+    if (!absl::StartsWith(attr.first, "_")) {
+      (*stripped.mutable_attr())[attr.first] = attr.second;
+    }
+  }
+  for (const OpInfo::TensorProperties& input : op_info.inputs()) {
+    OpInfo::TensorProperties* stripped_input = stripped.add_inputs();
+    stripped_input->set_dtype(input.dtype());
+    *stripped_input->mutable_shape() = input.shape();
+  }
+  stripped.mutable_device()->set_type(op_info.device().type());
+  return stripped;
+}
+
+}  // namespace
+
+OpCostDatabase* OpCostDatabase::Global() {
+  static OpCostDatabase* database = []() -> OpCostDatabase* {
+    std::string path;
+    TF_CHECK_OK(ReadStringFromEnvVar(kDatabaseEnvVar, "", &path));
+    if (path.empty()) return nullptr;
+    auto* loaded = new OpCostDatabase();
+    absl::Status status = loaded->Load(path);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to load the op cost database from " << path
+                   << ": " << status;
+      delete loaded;
+      return nullptr;
+    }
+    VLOG(1) << "Loaded " << loaded->size() << " measured op costs from "
+            << path;
+    return loaded;
+  }();
+  return database;
+}
+
+void OpCostDatabase::AddStepStats(const StepStats& step_stats,
+                                  const GraphDef& graph) {
+  std::unordered_map<std::string, const NodeDef*> nodes;
+  for (const NodeDef& node : graph.node()) {
+    nodes[node.name()] = &node;
+  }
+  std::unordered_map<std::string, const NodeExecStats*> node_stats_by_name;
+  // The kernel time of each node on the GPU streams, by device and node name,
+  // summed over its kernels. Timings from "stream:all" are preferred over the
+  // sum of the per-stream ones, which they already include.
+  std::unordered_map<std::string, std::unordered_map<std::string, int64_t>>
+      all_stream_micros, per_stream_micros;
+  for (const DeviceStepStats& dev_stats : step_stats.dev_stats()) {
+    const size_t stream_pos = dev_stats.device().rfind(kStreamSuffix);
+    if (stream_pos == std::string::npos) {
+      for (const NodeExecStats& node_stats : dev_stats.node_stats()) {
+        node_stats_by_name[node_stats.node_name()] = &node_stats;
+      }
+      continue;
+    }
+    const std::string device = dev_stats.device().substr(0, stream_pos);
+    const bool all_streams =
+        dev_stats.device().substr(stream_pos + sizeof(kStreamSuffix) - 1) ==
+        kAllStreams;
+    auto& micros = (all_streams ? all_stream_micros : per_stream_micros)[device];
+    for (const NodeExecStats& node_stats : dev_stats.node_stats()) {
+      // Kernels are named after the node that launched them, followed by a
+      // colon and the op or kernel name.
+      const std::string node_name =
+          node_stats.node_name().substr(0, node_stats.node_name().find(':'));
+      micros[node_name] +=
+          node_stats.op_end_rel_micros() - node_stats.op_start_rel_micros();
+    }
+  }
+  auto find_output = [&](const TensorId& tensor_id)
+      -> const TensorDescription* {
+    auto it = node_stats_by_name.find(std::string(tensor_id.node()));
+    if (it == node_stats_by_name.end()) return nullptr;
+    for (const NodeOutput& output : it->second->output()) {
+      if (output.slot() == tensor_id.index()) {
+        return &output.tensor_description();
+      }
+    }
+    return nullptr;
+  };
+
+  for (const DeviceStepStats& dev_stats : step_stats.dev_stats()) {
+    DeviceNameUtils::ParsedName device;
+    if (!DeviceNameUtils::ParseFullName(dev_stats.device(), &device) ||
+        !device.has_type) {
+      continue;
+    }
+    // On other devices than the CPU, the node stats only time the host-side
+    // launch of asynchronous kernels, so the time on the device is taken from
+    // the stream timings, and devices without them are skipped.
+    const std::unordered_map<std::string, int64_t>* device_micros = nullptr;
+    if (device.type != DEVICE_CPU) {
+      auto all_it = all_stream_micros.find(dev_stats.device());
+      auto per_it = per_stream_micros.find(dev_stats.device());
+      if (all_it != all_stream_micros.end()) {
+        device_micros = &all_it->second;
+      } else if (per_it != per_stream_micros.end()) {
+        device_micros = &per_it->second;
+      } else {
+        continue;
+      }
+    }
+    for (const NodeExecStats& node_stats : dev_stats.node_stats()) {
+      auto it = nodes.find(node_stats.node_name());
+      // Nodes inserted by the runtime, e.g. _Send/_Recv, aren't in the graph.
+      if (it == nodes.end()) continue;
+      const NodeDef& node = *it->second;
+
+      OpInfo op_info;
+      op_info.set_op(node.op());
+      *op_info.mutable_attr() = node.attr();
+      op_info.mutable_device()->set_type(device.type);
+      bool inputs_known = true;
+      for (const std::string& input : node.input()) {
+        const TensorId tensor_id = ParseTensorName(input);
+        if (tensor_id.index() < 0) continue;
+        const TensorDescription* description = find_output(tensor_id);
+        if (description == nullptr) {
+          inputs_known = false;
+          break;
+        }
+        OpInfo::TensorProperties* properties = op_info.add_inputs();
+        properties->set_dtype(description->dtype());
+        *properties->mutable_shape() = description->shape();
+      }
+      if (!inputs_known) continue;
+
+      int64_t micros =
+          node_stats.op_end_rel_micros() - node_stats.op_start_rel_micros();
+      if (device_micros != nullptr) {
+        auto micros_it = device_micros->find(node.name());
+        // Nodes that launched no kernel, e.g. with host memory outputs.
+        if (micros_it == device_micros->end()) continue;
+        micros = micros_it->second;
+      }
+      AddMeasurement(op_info, Costs::NanoSeconds(Costs::MicroSeconds(micros)));
+    }
+  }
+}
+
+void OpCostDatabase::AddMeasurement(const OpInfo& op_info,
+                                    Costs::Duration time) {
+  mutex_lock l(mu_);
+  MergeLocked(op_info, /*count=*/1, time.count(), /*m2=*/0);
+}
+
+std::optional<Costs::Duration> OpCostDatabase::Lookup(
+    const OpInfo& op_info) const {
+  const std::string key = Key(op_info);
+  if (key.empty()) return std::nullopt;
+  tf_shared_lock l(mu_);
+  auto it = measurements_.find(key);
+  if (it == measurements_.end()) return std::nullopt;
+  return Costs::NanoSeconds(it->second.mean);
+}
+
+absl::Status OpCostDatabase::Load(const std::string& path) {
+  OpPerformanceList list;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(Env::Default(), path, &list));
+  mutex_lock l(mu_);
+  for (const OpPerformance& perf : list.op_performance()) {
+    if (perf.num_measurements() <= 0) continue;
+    const double sigma = perf.execution_time_normal().sigma();
+    MergeLocked(perf.op(), perf.num_measurements(),
+                perf.execution_time_normal().mu(),
+                sigma * sigma * perf.num_measurements());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status OpCostDatabase::Save(const std::string& path) const {
+  OpPerformanceList list;
+  {
+    tf_shared_lock l(mu_);
+    for (const auto& [key, measurements] : measurements_) {
+      OpPerformance* perf = list.add_op_performance();
+      *perf->mutable_op() = measurements.op_info;
+      perf->set_compute_cost(static_cast<int64_t>(measurements.mean));
+      perf->set_num_measurements(measurements.count);
+      perf->mutable_execution_time_normal()->set_mu(measurements.mean);
+      perf->mutable_execution_time_normal()->set_sigma(
+          std::sqrt(measurements.m2 / measurements.count));
+    }
+  }
+  return WriteBinaryProto(Env::Default(), path, list);
+}
+
+int64_t OpCostDatabase::size() const {
+  tf_shared_lock l(mu_);
+  return measurements_.size();
+}
+
+void OpCostDatabase::MergeLocked(const OpInfo& op_info, int64_t count,
+                                 double mean, double m2) {
+  const std::string key = Key(op_info);
+  if (key.empty()) return;
+  auto [it, inserted] = measurements_.try_emplace(key);
+  Measurements& measurements = it->second;
+  if (inserted) measurements.op_info = StripOpInfo(op_info);
+  // Chan et al.'s parallel update of the mean and the sum of squared
+  // differences from it.
+  const int64_t total = measurements.count + count;
+  const double delta = mean - measurements.mean;
+  measurements.m2 += m2 + delta * delta * measurements.count * count / total;
+  measurements.mean += delta * count / total;
+  measurements.count = total;
+}
+
+Costs MeasuredOpLevelCostEstimator::PredictCosts(
+    const OpContext& op_context) const {
+  Costs costs = OpLevelCostEstimator::PredictCosts(op_context);
+  std::optional<Costs::Duration> measured =
+      database_->Lookup(op_context.op_info);
+  if (measured.has_value()) {
+    costs.execution_time = *measured;
+    costs.inaccurate = false;
+  }
+  return costs;
+}
+
+std::unique_ptr<OpLevelCostEstimator> NewOpLevelCostEstimator() {
+  const OpCostDatabase* database = OpCostDatabase::Global();
+  if (database == nullptr) return std::make_unique<OpLevelCostEstimator>();
+  return std::make_unique<MeasuredOpLevelCostEstimator>(database);
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
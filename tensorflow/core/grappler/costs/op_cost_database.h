@@ -0,0 +1,116 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_DATABASE_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_DATABASE_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_context.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Execution times of ops measured in real runs, keyed by op, attributes,
+// input dtypes and shapes, and device type. The database is persisted as an
+// OpPerformanceList, so that it can be collected once on the target hardware
+// and consulted by later optimizations.
+class OpCostDatabase {
+ public:
+  OpCostDatabase() = default;
+
+  OpCostDatabase(const OpCostDatabase&) = delete;
+  OpCostDatabase& operator=(const OpCostDatabase&) = delete;
+
+  // Returns the database loaded from the file named by the
+  // TF_GRAPPLER_OP_COST_DATABASE environment variable, or nullptr if it isn't
+  // set or the file can't be read.
+  static OpCostDatabase* Global();
+
+  // Records the ops executed in `step_stats`, which was collected by running
+  // `graph`. Ops whose input shapes aren't all known are skipped. Ops on
+  // other devices than the CPU are timed by their kernels in the
+  // ".../stream:all" (or per-stream) device stats, and skipped without them.
+  void AddStepStats(const StepStats& step_stats, const GraphDef& graph)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Records one execution of the op described by `op_info` that took `time`.
+  void AddMeasurement(const OpInfo& op_info, Costs::Duration time)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the mean measured execution time of the op described by
+  // `op_info`, if it has been measured.
+  std::optional<Costs::Duration> Lookup(const OpInfo& op_info) const
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Merges the measurements stored in the file `path` into the database.
+  absl::Status Load(const std::string& path) TF_LOCKS_EXCLUDED(mu_);
+
+  // Writes all measurements to the file `path`.
+  absl::Status Save(const std::string& path) const TF_LOCKS_EXCLUDED(mu_);
+
+  int64_t size() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Running mean and variance of the execution time in nanoseconds.
+  struct Measurements {
+    OpInfo op_info;
+    int64_t count = 0;
+    double mean = 0;
+    double m2 = 0;
+  };
+
+  void MergeLocked(const OpInfo& op_info, int64_t count, double mean,
+                   double m2) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable mutex mu_;
+  absl::flat_hash_map<std::string, Measurements> measurements_
+      TF_GUARDED_BY(mu_);
+};
+
+// Predicts the cost of an op from its measured execution time when `database`
+// has one, and with the analytical model of OpLevelCostEstimator otherwise.
+class MeasuredOpLevelCostEstimator : public OpLevelCostEstimator {
+ public:
+  // Does not take ownership of `database`.
+  explicit MeasuredOpLevelCostEstimator(const OpCostDatabase* database)
+      : database_(database) {}
+
+  Costs PredictCosts(const OpContext& op_context) const override;
+
+ private:
+  const OpCostDatabase* const database_;
+};
+
+// Returns a MeasuredOpLevelCostEstimator backed by OpCostDatabase::Global() if
+// there is one, and an OpLevelCostEstimator otherwise.
+std::unique_ptr<OpLevelCostEstimator> NewOpLevelCostEstimator();
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_DATABASE_H_
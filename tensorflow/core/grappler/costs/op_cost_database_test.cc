@@ -0,0 +1,227 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_database.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/grappler/costs/op_context.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpInfo DescribeMatMul(int m, int n, int k) {
+  OpInfo op_info;
+  op_info.set_op("MatMul");
+  SetAttrValue(false, &(*op_info.mutable_attr())["transpose_a"]);
+  SetAttrValue(false, &(*op_info.mutable_attr())["transpose_b"]);
+  op_info.mutable_device()->set_type("CPU");
+  for (const auto& dims : std::vector<std::vector<int64_t>>{{m, k}, {k, n}}) {
+    OpInfo::TensorProperties* input = op_info.add_inputs();
+    input->set_dtype(DT_FLOAT);
+    TensorShape(dims).AsProto(input->mutable_shape());
+  }
+  return op_info;
+}
+
+TEST(OpCostDatabaseTest, ReturnsMeanOfMeasurements) {
+  OpCostDatabase database;
+  EXPECT_FALSE(database.Lookup(DescribeMatMul(32, 32, 32)).has_value());
+
+  database.AddMeasurement(DescribeMatMul(32, 32, 32), Costs::NanoSeconds(100));
+  database.AddMeasurement(DescribeMatMul(32, 32, 32), Costs::NanoSeconds(300));
+  EXPECT_EQ(database.size(), 1);
+  EXPECT_EQ(database.Lookup(DescribeMatMul(32, 32, 32)),
+            Costs::NanoSeconds(200));
+  // Other shapes and devices are measured separately.
+  EXPECT_FALSE(database.Lookup(DescribeMatMul(64, 32, 32)).has_value());
+  OpInfo gpu_op_info = DescribeMatMul(32, 32, 32);
+  gpu_op_info.mutable_device()->set_type("GPU");
+  EXPECT_FALSE(database.Lookup(gpu_op_info).has_value());
+}
+
+TEST(OpCostDatabaseTest, IgnoresInternalAttributes) {
+  OpCostDatabase database;
+  OpInfo op_info = DescribeMatMul(32, 32, 32);
+  SetAttrValue("/job:localhost", &(*op_info.mutable_attr())["_class"]);
+  database.AddMeasurement(op_info, Costs::NanoSeconds(100));
+  EXPECT_EQ(database.Lookup(DescribeMatMul(32, 32, 32)),
+            Costs::NanoSeconds(100));
+}
+
+TEST(OpCostDatabaseTest, SkipsUnknownShapes) {
+  OpCostDatabase database;
+  OpInfo op_info = DescribeMatMul(32, 32, 32);
+  op_info.mutable_inputs(0)->mutable_shape()->mutable_dim(0)->set_size(-1);
+  database.AddMeasurement(op_info, Costs::NanoSeconds(100));
+  EXPECT_EQ(database.size(), 0);
+  EXPECT_FALSE(database.Lookup(op_info).has_value());
+}
+
+TEST(OpCostDatabaseTest, SaveAndLoad) {
+  OpCostDatabase database;
+  database.AddMeasurement(DescribeMatMul(32, 32, 32), Costs::NanoSeconds(100));
+  database.AddMeasurement(DescribeMatMul(32, 32, 32), Costs::NanoSeconds(300));
+  database.AddMeasurement(DescribeMatMul(64, 64, 64), Costs::NanoSeconds(800));
+  const string path = io::JoinPath(testing::TmpDir(), "op_costs.pb");
+  TF_ASSERT_OK(database.Save(path));
+
+  OpCostDatabase loaded;
+  loaded.AddMeasurement(DescribeMatMul(32, 32, 32), Costs::NanoSeconds(500));
+  TF_ASSERT_OK(loaded.Load(path));
+  EXPECT_EQ(loaded.size(), 2);
+  // The loaded measurements are weighted by their number.
+  EXPECT_EQ(loaded.Lookup(DescribeMatMul(32, 32, 32)),
+            Costs::NanoSeconds(300));
+  EXPECT_EQ(loaded.Lookup(DescribeMatMul(64, 64, 64)),
+            Costs::NanoSeconds(800));
+}
+
+TEST(OpCostDatabaseTest, AddStepStats) {
+  GraphDef graph;
+  NodeDef* a = graph.add_node();
+  a->set_name("a");
+  a->set_op("Const");
+  NodeDef* b = graph.add_node();
+  b->set_name("b");
+  b->set_op("Const");
+  NodeDef* matmul = graph.add_node();
+  matmul->set_name("matmul");
+  matmul->set_op("MatMul");
+  matmul->add_input("a");
+  matmul->add_input("b:0");
+  matmul->add_input("^a");
+  SetAttrValue(false, &(*matmul->mutable_attr())["transpose_a"]);
+  SetAttrValue(false, &(*matmul->mutable_attr())["transpose_b"]);
+
+  StepStats step_stats;
+  DeviceStepStats* dev_stats = step_stats.add_dev_stats();
+  dev_stats->set_device("/job:localhost/replica:0/task:0/device:CPU:0");
+  for (const char* name : {"a", "b"}) {
+    NodeExecStats* node_stats = dev_stats->add_node_stats();
+    node_stats->set_node_name(name);
+    NodeOutput* output = node_stats->add_output();
+    output->set_slot(0);
+    output->mutable_tensor_description()->set_dtype(DT_FLOAT);
+    TensorShape({32, 32}).AsProto(
+        output->mutable_tensor_description()->mutable_shape());
+  }
+  NodeExecStats* node_stats = dev_stats->add_node_stats();
+  node_stats->set_node_name("matmul");
+  node_stats->set_op_start_rel_micros(10);
+  node_stats->set_op_end_rel_micros(15);
+
+  OpCostDatabase database;
+  database.AddStepStats(step_stats, graph);
+  EXPECT_EQ(database.Lookup(DescribeMatMul(32, 32, 32)),
+            Costs::NanoSeconds(5000));
+}
+
+TEST(OpCostDatabaseTest, AddStepStatsTimesGpuOpsOnStreams) {
+  GraphDef graph;
+  NodeDef* a = graph.add_node();
+  a->set_name("a");
+  a->set_op("Const");
+  NodeDef* b = graph.add_node();
+  b->set_name("b");
+  b->set_op("Const");
+  NodeDef* matmul = graph.add_node();
+  matmul->set_name("matmul");
+  matmul->set_op("MatMul");
+  matmul->add_input("a");
+  matmul->add_input("b");
+  SetAttrValue(false, &(*matmul->mutable_attr())["transpose_a"]);
+  SetAttrValue(false, &(*matmul->mutable_attr())["transpose_b"]);
+
+  StepStats step_stats;
+  DeviceStepStats* dev_stats = step_stats.add_dev_stats();
+  dev_stats->set_device("/job:localhost/replica:0/task:0/device:GPU:0");
+  for (const char* name : {"a", "b"}) {
+    NodeExecStats* node_stats = dev_stats->add_node_stats();
+    node_stats->set_node_name(name);
+    NodeOutput* output = node_stats->add_output();
+    output->set_slot(0);
+    output->mutable_tensor_description()->set_dtype(DT_FLOAT);
+    TensorShape({32, 32}).AsProto(
+        output->mutable_tensor_description()->mutable_shape());
+  }
+  // The executor only times the launch of the kernel.
+  NodeExecStats* node_stats = dev_stats->add_node_stats();
+  node_stats->set_node_name("matmul");
+  node_stats->set_op_start_rel_micros(10);
+  node_stats->set_op_end_rel_micros(11);
+
+  OpInfo op_info = DescribeMatMul(32, 32, 32);
+  op_info.mutable_device()->set_type("GPU");
+
+  // Without stream timings, the GPU ops aren't recorded.
+  OpCostDatabase database;
+  database.AddStepStats(step_stats, graph);
+  EXPECT_FALSE(database.Lookup(op_info).has_value());
+
+  // The kernels are timed on the streams, named after the node and the op.
+  DeviceStepStats* stream_stats = step_stats.add_dev_stats();
+  stream_stats->set_device(
+      "/job:localhost/replica:0/task:0/device:GPU:0/stream:all");
+  NodeExecStats* kernel_stats = stream_stats->add_node_stats();
+  kernel_stats->set_node_name("matmul:MatMul");
+  kernel_stats->set_op_start_rel_micros(20);
+  kernel_stats->set_op_end_rel_micros(28);
+  // Per-stream timings are already included in "stream:all".
+  stream_stats = step_stats.add_dev_stats();
+  stream_stats->set_device(
+      "/job:localhost/replica:0/task:0/device:GPU:0/stream:7");
+  *stream_stats->add_node_stats() = *kernel_stats;
+
+  database.AddStepStats(step_stats, graph);
+  EXPECT_EQ(database.Lookup(op_info), Costs::NanoSeconds(8000));
+}
+
+TEST(OpCostDatabaseTest, MeasuredOpLevelCostEstimator) {
+  OpCostDatabase database;
+  database.AddMeasurement(DescribeMatMul(32, 32, 32), Costs::NanoSeconds(123));
+  MeasuredOpLevelCostEstimator estimator(&database);
+
+  OpContext op_context;
+  op_context.op_info = DescribeMatMul(32, 32, 32);
+  op_context.op_info.mutable_device()->set_num_cores(1);
+  op_context.op_info.mutable_device()->set_frequency(1000);
+  op_context.op_info.mutable_device()->set_bandwidth(1000000);
+  Costs costs = estimator.PredictCosts(op_context);
+  EXPECT_EQ(costs.execution_time, Costs::NanoSeconds(123));
+  EXPECT_FALSE(costs.inaccurate);
+
+  // Ops that haven't been measured fall back to the analytical model.
+  op_context.op_info = DescribeMatMul(64, 64, 64);
+  op_context.op_info.mutable_device()->set_num_cores(1);
+  op_context.op_info.mutable_device()->set_frequency(1000);
+  op_context.op_info.mutable_device()->set_bandwidth(1000000);
+  costs = estimator.PredictCosts(op_context);
+  EXPECT_EQ(costs.execution_time,
+            OpLevelCostEstimator().PredictCosts(op_context).execution_time);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
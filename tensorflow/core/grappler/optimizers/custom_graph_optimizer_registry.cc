@@ -69,6 +69,7 @@ const ConfigList& DefaultPluginConfigs() {
        {"auto_mixed_precision_mkl", RewriterConfig::ON},
        {"auto_mixed_precision_cpu", RewriterConfig::ON},
        {"pin_to_host_optimization", RewriterConfig::ON},
+       {"horizontal_fusion", RewriterConfig::ON},
        {"layout_optimizer", RewriterConfig::ON},
        {"remapping", RewriterConfig::ON},
        {"loop_optimization", RewriterConfig::ON},
@@ -40,6 +40,7 @@ constexpr char kShuffleAndRepeatDataset[] = "ShuffleAndRepeatDataset";
 constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
 
 constexpr char kReshuffleEachIteration[] = "reshuffle_each_iteration";
+constexpr char kMemoryBudgetBytes[] = "memory_budget_bytes";
 
 absl::Status FuseShuffleV1AndRepeat(const NodeDef& shuffle_node,
                                     const NodeDef& repeat_node,
@@ -145,6 +146,9 @@ absl::Status FuseShuffleV3AndRepeat(const NodeDef& shuffle_node,
   // attributes.
   graph_utils::CopyShapesAndTypesAttrs(shuffle_node, fused_node);
   graph_utils::CopyAttribute(kReshuffleEachIteration, shuffle_node, fused_node);
+  if (shuffle_node.attr().contains(kMemoryBudgetBytes)) {
+    graph_utils::CopyAttribute(kMemoryBudgetBytes, shuffle_node, fused_node);
+  }
 
   // Optionally set the `metadata` attribute.
   graph_utils::MaybeSetFusedMetadata(shuffle_node, repeat_node, fused_node);
@@ -0,0 +1,336 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/horizontal_fusion.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/frame.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kHorizontalFusionPrefix[] = "HorizontalFusion";
+
+// The fused computation copies every input and output once more through
+// Pack and Unpack, and adds those two kernels to the step. That only pays off
+// once enough launches are saved.
+constexpr int kMinGroupSize = 5;
+
+// MatMuls larger than this many flops are bound by compute rather than by
+// launch overhead, and batching them only adds copies.
+constexpr int64_t kMaxMatMulFlops = int64_t{1} << 22;
+
+bool IsSupportedType(DataType dtype) {
+  return dtype == DT_HALF || dtype == DT_BFLOAT16 || dtype == DT_FLOAT ||
+         dtype == DT_DOUBLE;
+}
+
+// Returns the value of the bool attribute `name`, which is false when the
+// attribute is missing, e.g. because default attributes were stripped.
+bool GetBoolAttr(const NodeDef& node, const string& name) {
+  const AttrValue* value = AttrSlice(node).Find(name);
+  return value != nullptr && value->b();
+}
+
+// Returns the length of the longest path from a source to every node. A node
+// can only depend on nodes of a smaller depth, so nodes of the same depth are
+// independent of each other. Back edges of loops are ignored.
+absl::Status ComputeDepths(const GraphDef& graph,
+                           absl::flat_hash_map<string, int>* depths) {
+  std::vector<const NodeDef*> topo_order;
+  TF_RETURN_IF_ERROR(ComputeTopologicalOrder(graph, &topo_order));
+  depths->reserve(topo_order.size());
+  for (const NodeDef* node : topo_order) {
+    int depth = 0;
+    for (const string& input : node->input()) {
+      auto it = depths->find(NodeName(input));
+      if (it != depths->end()) depth = std::max(depth, it->second + 1);
+    }
+    (*depths)[node->name()] = depth;
+  }
+  return absl::OkStatus();
+}
+
+// Returns a key that is the same for two MatMul nodes iff they can be computed
+// by the same BatchMatMulV2, or an empty string if `node` can't be fused.
+string MatMulFusionKey(const NodeDef& node, int depth,
+                       const GraphProperties& properties) {
+  if (HasControlInputs(node) || node.input_size() != 2) return "";
+  if (!node.device().empty() && !NodeIsOnCpu(&node) && !NodeIsOnGpu(&node)) {
+    return "";
+  }
+  const DataType dtype = GetDataTypeFromAttr(node, "T");
+  if (!IsSupportedType(dtype)) return "";
+
+  const auto& input_props = properties.GetInputProperties(node.name());
+  if (input_props.size() != 2) return "";
+  const bool transpose_a = GetBoolAttr(node, "transpose_a");
+  const bool transpose_b = GetBoolAttr(node, "transpose_b");
+  string key = absl::StrCat(node.op(), ";", depth, ";", node.device(), ";",
+                            DataType_Name(dtype), ";", transpose_a, ";",
+                            transpose_b);
+  PartialTensorShape shapes[2];
+  for (int i = 0; i < 2; ++i) {
+    const OpInfo::TensorProperties& prop = input_props[i];
+    shapes[i] = PartialTensorShape(prop.shape());
+    if (prop.dtype() != dtype || !shapes[i].IsFullyDefined() ||
+        shapes[i].dims() != 2) {
+      return "";
+    }
+    absl::StrAppend(&key, ";", shapes[i].DebugString());
+  }
+  // 2 * m * k * n, where the inner dimension k is shared by both inputs.
+  const int64_t n = shapes[1].dim_size(transpose_b ? 0 : 1);
+  if (2 * shapes[0].num_elements() * n > kMaxMatMulFlops) return "";
+  return key;
+}
+
+// Returns the Const node that produces `input` in `nodes`, or nullptr.
+const NodeDef* GetConstantInput(
+    const string& input,
+    const absl::flat_hash_map<string, const NodeDef*>& nodes) {
+  const TensorId tensor_id = ParseTensorName(input);
+  if (tensor_id.index() != 0) return nullptr;
+  auto it = nodes.find(tensor_id.node());
+  if (it == nodes.end() || !IsConstant(*it->second)) return nullptr;
+  return it->second;
+}
+
+// Stacks the values of the Const nodes producing `inputs` along a new first
+// dimension. Returns false if any input is not a constant of type `dtype`.
+bool StackConstants(const std::vector<string>& inputs, DataType dtype,
+                    const absl::flat_hash_map<string, const NodeDef*>& nodes,
+                    Tensor* stacked) {
+  std::vector<Tensor> values(inputs.size());
+  for (int i = 0; i < inputs.size(); ++i) {
+    const NodeDef* node = GetConstantInput(inputs[i], nodes);
+    if (node == nullptr) return false;
+    const AttrValue* value = AttrSlice(*node).Find("value");
+    if (value == nullptr || !values[i].FromProto(value->tensor()) ||
+        values[i].dtype() != dtype ||
+        values[i].shape() != values.front().shape()) {
+      return false;
+    }
+  }
+  // Concat joins the matrices along their rows, which has the same layout as
+  // stacking them.
+  Tensor concat;
+  if (!tensor::Concat(values, &concat).ok()) return false;
+  TensorShape shape = values.front().shape();
+  shape.InsertDim(0, values.size());
+  return stacked->CopyFrom(concat, shape);
+}
+
+NodeDef* AddFusedNode(const string& name, const string& op,
+                      const NodeDef& like, DataType dtype,
+                      GraphDef* optimized_graph) {
+  NodeDef* node = optimized_graph->add_node();
+  node->set_name(name);
+  node->set_op(op);
+  node->set_device(like.device());
+  (*node->mutable_attr())["T"].set_type(dtype);
+  return node;
+}
+
+// Replaces the MatMul nodes `group` by a BatchMatMulV2 over their stacked
+// inputs, naming the new nodes `prefix`/Pack_a, `prefix`/Pack_b,
+// `prefix`/BatchMatMulV2 and `prefix`/Unpack. Returns the name of the Unpack
+// node whose i-th output replaces the i-th node of the group.
+//
+// If all nodes of the group read the same operand from constants, as with the
+// frozen weights of an inference graph, the stacked operand is a Const node
+// rather than a Pack, so that it is not copied again on every step.
+string FuseMatMuls(const std::vector<const NodeDef*>& group,
+                   const string& prefix,
+                   const absl::flat_hash_map<string, const NodeDef*>& nodes,
+                   GraphDef* optimized_graph) {
+  const NodeDef& first = *group.front();
+  const DataType dtype = GetDataTypeFromAttr(first, "T");
+
+  NodeDef* packs[2];
+  for (int input = 0; input < 2; ++input) {
+    const string name = absl::StrCat(prefix, "Pack_", input == 0 ? "a" : "b");
+    std::vector<string> inputs;
+    for (const NodeDef* node : group) {
+      inputs.push_back(node->input(input));
+    }
+    Tensor stacked;
+    if (StackConstants(inputs, dtype, nodes, &stacked)) {
+      packs[input] = optimized_graph->add_node();
+      packs[input]->set_name(name);
+      packs[input]->set_op("Const");
+      packs[input]->set_device(first.device());
+      (*packs[input]->mutable_attr())["dtype"].set_type(dtype);
+      stacked.AsProtoTensorContent(
+          (*packs[input]->mutable_attr())["value"].mutable_tensor());
+      continue;
+    }
+    packs[input] = AddFusedNode(name, "Pack", first, dtype, optimized_graph);
+    for (const string& input_name : inputs) {
+      packs[input]->add_input(input_name);
+    }
+    (*packs[input]->mutable_attr())["N"].set_i(group.size());
+    (*packs[input]->mutable_attr())["axis"].set_i(0);
+  }
+
+  // For the real types we fuse, the adjoint is the transpose.
+  NodeDef* matmul = AddFusedNode(absl::StrCat(prefix, "BatchMatMulV2"),
+                                 "BatchMatMulV2", first, dtype,
+                                 optimized_graph);
+  matmul->add_input(packs[0]->name());
+  matmul->add_input(packs[1]->name());
+  (*matmul->mutable_attr())["adj_x"].set_b(GetBoolAttr(first, "transpose_a"));
+  (*matmul->mutable_attr())["adj_y"].set_b(GetBoolAttr(first, "transpose_b"));
+
+  NodeDef* unpack = AddFusedNode(absl::StrCat(prefix, "Unpack"), "Unpack",
+                                 first, dtype, optimized_graph);
+  unpack->add_input(matmul->name());
+  (*unpack->mutable_attr())["num"].set_i(group.size());
+  (*unpack->mutable_attr())["axis"].set_i(0);
+  return unpack->name();
+}
+
+}  // namespace
+
+absl::Status HorizontalFusion::Optimize(Cluster* cluster,
+                                        const GrapplerItem& item,
+                                        GraphDef* optimized_graph) {
+  // Fused nodes are removed, so we must know which nodes are fetched.
+  if (item.fetch.empty()) {
+    return absl::AbortedError("Nothing to do.");
+  }
+  int num_matmuls = 0;
+  for (const NodeDef& node : item.graph.node()) {
+    if (IsMatMul(node)) ++num_matmuls;
+  }
+  if (num_matmuls < kMinGroupSize) {
+    return absl::AbortedError("Nothing to do.");
+  }
+
+  absl::flat_hash_map<string, int> depths;
+  TF_RETURN_IF_ERROR(ComputeDepths(item.graph, &depths));
+  FrameView frame_view;
+  TF_RETURN_IF_ERROR(frame_view.InferFromGraph(item.graph));
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(/*assume_valid_feeds=*/false));
+
+  // Group the fusable nodes, in the order of their first member in the graph
+  // so that the output is deterministic.
+  const std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+  absl::flat_hash_map<string, int> group_ids;
+  std::vector<std::vector<const NodeDef*>> groups;
+  for (const NodeDef& node : item.graph.node()) {
+    if (!IsMatMul(node) || nodes_to_preserve.count(node.name()) > 0 ||
+        frame_view.IsInFrame(node)) {
+      continue;
+    }
+    const string key = MatMulFusionKey(node, depths[node.name()], properties);
+    if (key.empty()) continue;
+    auto [it, inserted] = group_ids.try_emplace(key, groups.size());
+    if (inserted) groups.emplace_back();
+    groups[it->second].push_back(&node);
+  }
+
+  // Fused nodes are named after the first node of their group, which is
+  // unique, unless a node of the graph happens to have that name already.
+  std::vector<absl::string_view> taken_prefixes;
+  for (const NodeDef& node : item.graph.node()) {
+    if (absl::StartsWith(node.name(), kHorizontalFusionPrefix)) {
+      taken_prefixes.push_back(node.name());
+    }
+  }
+
+  absl::flat_hash_map<string, const NodeDef*> nodes;
+  nodes.reserve(item.graph.node_size());
+  for (const NodeDef& node : item.graph.node()) {
+    nodes[node.name()] = &node;
+  }
+
+  *optimized_graph = item.graph;
+  // Maps every fused node to the output of the Unpack that replaces it.
+  absl::flat_hash_map<string, std::pair<string, int>> replacements;
+  for (const std::vector<const NodeDef*>& group : groups) {
+    if (group.size() < kMinGroupSize) continue;
+    const string prefix =
+        absl::StrCat(kHorizontalFusionPrefix, "/", group.front()->name(), "/");
+    if (absl::c_any_of(taken_prefixes, [&](absl::string_view name) {
+          return absl::StartsWith(name, prefix);
+        })) {
+      continue;
+    }
+    const string unpack = FuseMatMuls(group, prefix, nodes, optimized_graph);
+    VLOG(2) << "Fused " << group.size() << " MatMul nodes into " << unpack;
+    for (int i = 0; i < group.size(); ++i) {
+      replacements[group[i]->name()] = {unpack, i};
+    }
+  }
+  if (replacements.empty()) {
+    return absl::AbortedError("Nothing to do.");
+  }
+
+  // Rewire the consumers of the fused nodes, then remove them.
+  std::set<int> nodes_to_delete;
+  for (int i = 0; i < optimized_graph->node_size(); ++i) {
+    NodeDef* node = optimized_graph->mutable_node(i);
+    if (replacements.contains(node->name())) {
+      nodes_to_delete.insert(i);
+      continue;
+    }
+    bool has_fused_control_input = false;
+    for (string& input : *node->mutable_input()) {
+      const TensorId tensor_id = ParseTensorName(input);
+      auto it = replacements.find(tensor_id.node());
+      if (it == replacements.end()) continue;
+      const auto& [unpack, index] = it->second;
+      if (IsControlInput(tensor_id)) {
+        input = AsControlDependency(unpack);
+        has_fused_control_input = true;
+      } else {
+        input = absl::StrCat(unpack, ":", index);
+      }
+    }
+    if (has_fused_control_input) DedupControlInputs(node);
+  }
+  EraseNodesFromGraph(nodes_to_delete, optimized_graph);
+  return absl::OkStatus();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
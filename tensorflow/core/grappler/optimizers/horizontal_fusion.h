@@ -0,0 +1,57 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_HORIZONTAL_FUSION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_HORIZONTAL_FUSION_H_
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Fuses independent nodes that perform the same computation on different
+// inputs into a single batched kernel, e.g. the many small parallel MatMuls of
+// a multi-tower model. Where Remapper fuses chains of ops vertically, this
+// optimizer fuses them horizontally:
+//
+//   MatMul(a_0, b_0), ..., MatMul(a_n, b_n)
+//     => Unpack(BatchMatMulV2(Pack(a_0, ..., a_n), Pack(b_0, ..., b_n)))
+//
+// Only nodes with the same op, attributes, device and statically known input
+// shapes are fused, and only if none of them depends on another. Since the
+// stacked inputs and outputs are copied, only groups of at least five MatMuls
+// small enough to be bound by launch overhead are fused.
+class HorizontalFusion : public GraphOptimizer {
+ public:
+  HorizontalFusion() = default;
+  explicit HorizontalFusion(RewriterConfig::Toggle opt_level) {}
+
+  ~HorizontalFusion() override = default;
+
+  string name() const override { return "horizontal_fusion"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  absl::Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                        GraphDef* optimized_graph) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_HORIZONTAL_FUSION_H_
@@ -0,0 +1,218 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/horizontal_fusion.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/cc/ops/array_ops.h"
+#include "tensorflow/cc/ops/math_ops.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class HorizontalFusionTest : public GrapplerTest {
+ protected:
+  Output Placeholder(const Scope& s, const string& name,
+                     const TensorShape& shape) {
+    inputs_.emplace_back(name, GenerateRandomTensor<DT_FLOAT>(shape));
+    return ops::Placeholder(s.WithOpName(name), DT_FLOAT,
+                            ops::Placeholder::Shape(shape));
+  }
+
+  std::vector<std::pair<string, Tensor>> inputs_;
+};
+
+TEST_F(HorizontalFusionTest, FusesIndependentMatMuls) {
+  constexpr int kNumMatMuls = 5;
+  Scope s = Scope::NewRootScope();
+  auto transpose_b = ops::MatMul::TransposeB(true);
+  std::vector<Output> matmuls;
+  for (int i = 0; i < kNumMatMuls; ++i) {
+    Output a = Placeholder(s, absl::StrCat("a", i), {2, 3});
+    Output b = Placeholder(s, absl::StrCat("b", i), {4, 3});
+    matmuls.push_back(
+        ops::MatMul(s.WithOpName(absl::StrCat("m", i)), a, b, transpose_b));
+  }
+  Output concat = ops::Concat(s.WithOpName("concat"), matmuls, /*axis=*/0);
+  Output sum = ops::AddN(
+      s.WithOpName("sum").WithControlDependencies({matmuls[1]}),
+      {matmuls[0], matmuls[2]});
+
+  GrapplerItem item;
+  item.fetch = {"concat", "sum"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+
+  EXPECT_EQ(CountOpNodes(output, "MatMul"), 0);
+  EXPECT_EQ(CountOpNodes(output, "BatchMatMulV2"), 1);
+  EXPECT_EQ(CountOpNodes(output, "Pack"), 2);
+  for (const NodeDef& node : output.node()) {
+    if (node.op() == "BatchMatMulV2") {
+      EXPECT_EQ(node.input(0), "HorizontalFusion/m0/Pack_a");
+      EXPECT_EQ(node.input(1), "HorizontalFusion/m0/Pack_b");
+      EXPECT_FALSE(node.attr().at("adj_x").b());
+      EXPECT_TRUE(node.attr().at("adj_y").b());
+    } else if (node.name() == "concat") {
+      for (int i = 0; i < kNumMatMuls; ++i) {
+        EXPECT_EQ(node.input(i),
+                  absl::StrCat("HorizontalFusion/m0/Unpack:", i));
+      }
+    } else if (node.name() == "sum") {
+      // The control dependency on `m1` is subsumed by the data inputs.
+      ASSERT_EQ(node.input_size(), 2);
+      EXPECT_EQ(node.input(0), "HorizontalFusion/m0/Unpack:0");
+      EXPECT_EQ(node.input(1), "HorizontalFusion/m0/Unpack:2");
+    }
+  }
+
+  auto expected = EvaluateNodes(item.graph, item.fetch, inputs_);
+  auto actual = EvaluateNodes(output, item.fetch, inputs_);
+  ASSERT_EQ(actual.size(), 2);
+  test::ExpectTensorNear<float>(actual[0], expected[0], 1e-6);
+  test::ExpectTensorNear<float>(actual[1], expected[1], 1e-6);
+}
+
+TEST_F(HorizontalFusionTest, StacksConstantWeightsOnce) {
+  constexpr int kNumMatMuls = 6;
+  Scope s = Scope::NewRootScope();
+  std::vector<Output> matmuls;
+  for (int i = 0; i < kNumMatMuls; ++i) {
+    Output a = Placeholder(s, absl::StrCat("a", i), {2, 3});
+    Output w = ops::Const(s.WithOpName(absl::StrCat("w", i)),
+                          GenerateRandomTensor<DT_FLOAT>({3, 4}));
+    matmuls.push_back(ops::MatMul(s.WithOpName(absl::StrCat("m", i)), a, w));
+  }
+  Output concat = ops::Concat(s.WithOpName("concat"), matmuls, /*axis=*/0);
+
+  GrapplerItem item;
+  item.fetch = {"concat"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+
+  // Only the placeholders are packed on every step.
+  EXPECT_EQ(CountOpNodes(output, "Pack"), 1);
+  const NodeDef* weights = nullptr;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "HorizontalFusion/m0/Pack_b") weights = &node;
+  }
+  ASSERT_NE(weights, nullptr);
+  EXPECT_EQ(weights->op(), "Const");
+  EXPECT_EQ(weights->input_size(), 0);
+
+  auto expected = EvaluateNodes(item.graph, item.fetch, inputs_);
+  auto actual = EvaluateNodes(output, item.fetch, inputs_);
+  ASSERT_EQ(actual.size(), 1);
+  test::ExpectTensorNear<float>(actual[0], expected[0], 1e-6);
+}
+
+TEST_F(HorizontalFusionTest, DoesNotFuseFewOrLargeMatMuls) {
+  Scope s = Scope::NewRootScope();
+  std::vector<Output> outputs;
+  // Too few small MatMuls to pay for the copies.
+  for (int i = 0; i < 4; ++i) {
+    Output a = Placeholder(s, absl::StrCat("a", i), {2, 3});
+    Output b = Placeholder(s, absl::StrCat("b", i), {3, 4});
+    outputs.push_back(ops::MatMul(s.WithOpName(absl::StrCat("m", i)), a, b));
+  }
+  // Enough MatMuls, but each is large enough to be bound by compute.
+  for (int i = 0; i < 5; ++i) {
+    Output a = Placeholder(s, absl::StrCat("big_a", i), {256, 256});
+    Output b = Placeholder(s, absl::StrCat("big_b", i), {256, 256});
+    outputs.push_back(
+        ops::MatMul(s.WithOpName(absl::StrCat("big_m", i)), a, b));
+  }
+  GrapplerItem item;
+  for (int i = 0; i < outputs.size(); ++i) {
+    const string name = absl::StrCat("out", i);
+    ops::Identity(s.WithOpName(name), outputs[i]);
+    item.fetch.push_back(name);
+  }
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalFusion optimizer;
+  GraphDef output;
+  EXPECT_TRUE(
+      absl::IsAborted(optimizer.Optimize(/*cluster=*/nullptr, item, &output)));
+}
+
+TEST_F(HorizontalFusionTest, DoesNotFuseDependentMatMuls) {
+  Scope s = Scope::NewRootScope();
+  Output a = Placeholder(s, "a", {3, 3});
+  Output b = Placeholder(s, "b", {3, 3});
+  Output m0 = ops::MatMul(s.WithOpName("m0"), a, b);
+  Output m1 = ops::MatMul(s.WithOpName("m1"), m0, b);
+  Output out = ops::Identity(s.WithOpName("out"), m1);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalFusion optimizer;
+  GraphDef output;
+  EXPECT_TRUE(
+      absl::IsAborted(optimizer.Optimize(/*cluster=*/nullptr, item, &output)));
+}
+
+TEST_F(HorizontalFusionTest, DoesNotFuseMismatchedOrFetchedMatMuls) {
+  Scope s = Scope::NewRootScope();
+  Output b = Placeholder(s, "b", {3, 4});
+  GrapplerItem item;
+  for (int i = 0; i < 5; ++i) {
+    Output a = Placeholder(s, absl::StrCat("a", i), {2, 3});
+    Output m = ops::MatMul(s.WithOpName(absl::StrCat("m", i)), a, b);
+    ops::Identity(s.WithOpName(absl::StrCat("out", i)), m);
+    item.fetch.push_back(absl::StrCat("out", i));
+  }
+  Output a5 = Placeholder(s, "a5", {3, 2});
+  Output m5 = ops::MatMul(s.WithOpName("m5"), a5, b,
+                          ops::MatMul::TransposeA(true));
+  ops::Identity(s.WithOpName("out5"), m5);
+
+  // `m1` is fetched and `m5` is transposed differently, so only four MatMuls
+  // could be fused together.
+  item.fetch.push_back("m1");
+  item.fetch.push_back("out5");
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalFusion optimizer;
+  GraphDef output;
+  EXPECT_TRUE(
+      absl::IsAborted(optimizer.Optimize(/*cluster=*/nullptr, item, &output)));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
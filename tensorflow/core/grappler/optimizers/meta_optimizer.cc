@@ -46,6 +46,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/dependency_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/horizontal_fusion.h"
 #include "tensorflow/core/grappler/optimizers/implementation_selector.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
@@ -261,6 +262,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
                                       cfg_.scoped_allocator_opts()));
   MK_OPT("pin_to_host", "pin_to_host_optimization",
          new PinToHostOptimizer(cfg_.pin_to_host_optimization()));
+  MK_OPT("horizontal_fusion", "horizontal_fusion",
+         new HorizontalFusion(cfg_.horizontal_fusion()));
 
   return std::unique_ptr<GraphOptimizer>();
 }
@@ -452,6 +455,11 @@ absl::Status MetaOptimizer::InitializeOptimizers(
           xla_auto_clustering_on_));
     }
   }
+  if (BOTH_ARE_ON(horizontal_fusion))
+    optimizers->push_back(std::make_unique<HorizontalFusion>());
+  else if (BOTH_ARE_EXPERIMENTAL_MLIR(horizontal_fusion) ||
+           BOTH_ARE_EXPERIMENTAL_BOTH(horizontal_fusion))
+    VLOG(2) << "horizontal_fusion is not implemented in TFG yet";
   if (BOTH_NOT_OFF(loop_optimization)) {
     if (USER_IS_EXPERIMENTAL_MLIR(loop_optimization) ||
         USER_IS_EXPERIMENTAL_BOTH(loop_optimization)) {
@@ -637,6 +645,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
     PRINT_CFG(constant_folding)
     PRINT_CFG(shape_optimization)
     PRINT_CFG(pin_to_host_optimization)
+    PRINT_CFG(horizontal_fusion)
     PRINT_CFG(layout_optimizer)
     PRINT_CFG(remapping)
     PRINT_CFG(loop_optimization)
@@ -690,6 +699,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
       PRINT_CFG("auto_mixed_precision_mkl", "auto_mixed_precision_mkl")
       PRINT_CFG("auto_mixed_precision_cpu", "auto_mixed_precision_cpu")
       PRINT_CFG("pin_to_host", "pin_to_host_optimization")
+      PRINT_CFG("horizontal_fusion", "horizontal_fusion")
       PRINT_CFG("layout", "layout_optimizer")
       PRINT_CFG("remap", "remapping")
       PRINT_CFG("loop", "loop_optimization")
@@ -731,6 +741,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
         pair.first == "auto_mixed_precision_mkl" ||
         pair.first == "auto_mixed_precision_cpu" ||
         pair.first == "pin_to_host_optimization" ||
+        pair.first == "horizontal_fusion" ||
         pair.first == "scoped_allocator_optimization") {
       // These optimizers are turned off by default.
       // TODO(penporn): Remove the hard-coded length and change it to max length
@@ -1359,6 +1370,7 @@ bool MetaOptimizerEnabled(const ConfigProto& cfg) {
          rewrite_cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
 #endif
          rewrite_cfg.pin_to_host_optimization() == RewriterConfig::ON ||
+         rewrite_cfg.horizontal_fusion() == RewriterConfig::ON ||
          AutoMixedPrecisionEnabled(rewrite_cfg.auto_mixed_precision()) ||
          AutoMixedPrecisionEnabled(
              rewrite_cfg.auto_mixed_precision_onednn_bfloat16()) ||
@@ -179,7 +179,8 @@ class BatchResource : public serving::BatchResourceBase {
                   serving::MixedPriorityBatchingPolicy::
                       kLowPriorityPaddingWithMaxBatchSize,
                   enable_large_batch_splitting,
-                  /*batch_padding_policy=*/"PAD_UP", resource);
+                  /*batch_padding_policy=*/"PAD_UP",
+                  /*latency_slo_micros=*/0, resource);
   }
 
   static absl::Status Create(
@@ -193,22 +194,23 @@ class BatchResource : public serving::BatchResourceBase {
       const std::vector<int32>& low_priority_allowed_batch_sizes,
       serving::MixedPriorityBatchingPolicy mixed_priority_batching_policy,
       bool enable_large_batch_splitting, absl::string_view batch_padding_policy,
-      std::unique_ptr<BatchResource>* resource) {
+      int64_t latency_slo_micros, std::unique_ptr<BatchResource>* resource) {
     BatcherT::Options batcher_options;
     batcher_options.num_batch_threads = num_batch_threads;
     std::shared_ptr<BatcherT> batcher;
     TF_RETURN_IF_ERROR(BatcherT::Create(batcher_options, &batcher));
 
+    BatcherT::QueueOptions batcher_queue_options = GetBatcherQueueOptions(
+        num_batch_threads, max_execution_batch_size, batch_timeout_micros,
+        max_enqueued_batches, allowed_batch_sizes, enable_large_batch_splitting,
+        /*disable_padding=*/false, batch_padding_policy,
+        low_priority_max_batch_size, low_priority_batch_timeout_micros,
+        low_priority_max_enqueued_batches, low_priority_allowed_batch_sizes,
+        mixed_priority_batching_policy);
+    batcher_queue_options.latency_slo_micros = latency_slo_micros;
+
     resource->reset(new BatchResource(
-        has_process_batch_function, std::move(batcher),
-        GetBatcherQueueOptions(
-            num_batch_threads, max_execution_batch_size, batch_timeout_micros,
-            max_enqueued_batches, allowed_batch_sizes,
-            enable_large_batch_splitting,
-            /*disable_padding=*/false, batch_padding_policy,
-            low_priority_max_batch_size, low_priority_batch_timeout_micros,
-            low_priority_max_enqueued_batches, low_priority_allowed_batch_sizes,
-            mixed_priority_batching_policy),
+        has_process_batch_function, std::move(batcher), batcher_queue_options,
         allowed_batch_sizes));
     return absl::OkStatus();
   }
@@ -308,6 +310,13 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
   OP_REQUIRES_OK(c,
                  c->GetAttr("mixed_priority_policy", &mixed_priority_policy_));
   OP_REQUIRES_OK(c, c->GetAttr("batch_padding_policy", &batch_padding_policy_));
+  if (c->HasAttr("latency_slo_micros")) {
+    OP_REQUIRES_OK(c, c->GetAttr("latency_slo_micros", &latency_slo_micros_));
+  }
+  if (c->HasAttr("sequence_length_buckets")) {
+    OP_REQUIRES_OK(c, c->GetAttr("sequence_length_buckets",
+                                 &sequence_length_buckets_));
+  }
 
   OP_REQUIRES_OK(c, c->GetAttr("f", &func_));
 
@@ -341,6 +350,7 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
   }
 
   OP_REQUIRES_OK(c, ValidateAllowedBatchSizes());
+  OP_REQUIRES_OK(c, ValidateSequenceLengthBuckets());
 }
 
 bool BatchFunctionKernel::IsExpensive() { return false; }
@@ -423,6 +433,7 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
       if (session_metadata) {
         new_resource->set_session_metadata(*session_metadata);
       }
+      new_resource->set_sequence_length_buckets(sequence_length_buckets_);
       *r = new_resource.release();
       return absl::OkStatus();
     };
@@ -441,10 +452,11 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
           low_priority_batch_timeout_micros_,
           low_priority_max_enqueued_batches_, low_priority_allowed_batch_sizes_,
           mixed_priority_batching_policy, enable_large_batch_splitting_,
-          batch_padding_policy_, &new_resource));
+          batch_padding_policy_, latency_slo_micros_, &new_resource));
       if (session_metadata) {
         new_resource->set_session_metadata(*session_metadata);
       }
+      new_resource->set_sequence_length_buckets(sequence_length_buckets_);
       *r = new_resource.release();
       return absl::OkStatus();
     };
@@ -575,6 +587,19 @@ absl::Status BatchFunctionKernel::ValidateAllowedBatchSizes() const {
   return absl::OkStatus();
 }
 
+absl::Status BatchFunctionKernel::ValidateSequenceLengthBuckets() const {
+  int32_t last_length = 0;
+  for (const int32_t length : sequence_length_buckets_) {
+    if (length <= last_length) {
+      return errors::InvalidArgument(
+          "sequence_length_buckets entries must be positive and monotonically "
+          "increasing");
+    }
+    last_length = length;
+  }
+  return absl::OkStatus();
+}
+
 // Initialize vars by reading from op-kernel-construction.
 // Vars
 // - enable_adaptive_batch_threads_
@@ -80,6 +80,10 @@ class BatchFunctionKernel : public AsyncOpKernel {
   // to `max_batch_size_`.
   absl::Status ValidateAllowedBatchSizes() const;
 
+  // Validates 'sequence_length_buckets_'. The entries must be positive and
+  // increase monotonically.
+  absl::Status ValidateSequenceLengthBuckets() const;
+
   // Creates the function handle if it isn't initialized yet; and re-use it
   // afterwards.
   absl::Status GetOrCreateFunctionHandle(
@@ -112,6 +116,8 @@ class BatchFunctionKernel : public AsyncOpKernel {
   std::vector<int32> low_priority_allowed_batch_sizes_;
   std::string mixed_priority_policy_;
   std::string batch_padding_policy_;
+  int64_t latency_slo_micros_ = 0;
+  std::vector<int32> sequence_length_buckets_;
   NameAttrList func_;
   absl::optional<FunctionLibraryRuntime::Handle> fhandle_ TF_GUARDED_BY(mu_);
   bool enable_large_batch_splitting_ = false;
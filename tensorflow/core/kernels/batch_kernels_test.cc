@@ -441,6 +441,70 @@ TEST_P(BatchFunctionTest,
 INSTANTIATE_TEST_SUITE_P(BatchFunctionTest, BatchFunctionTest,
                          ::testing::Bool());
 
+class BatchFunctionSequenceLengthBucketsTestState
+    : public SharedBatchFunctionTestState {
+ public:
+  // Init test fixture with a batch kernel instance that pads inputs to
+  // sequence lengths 4 or 16. The caller guarantees that the device pointer is
+  // valid throughout the life of this class.
+  absl::Status Init(Device *device, const TensorShape &expected_output_shape) {
+    device_ = device;
+
+    TF_ASSIGN_OR_RETURN(
+        NodeDefBuilder builder,
+        CreateBatchFunctionBuilder({4, 8}, 8, "PAD_UP", expected_output_shape));
+    TF_RETURN_IF_ERROR(builder
+                           .Attr("sequence_length_buckets",
+                                 std::vector<int>{4, 16})
+                           .Finalize(node_def()));
+
+    return OpsTestBase::InitOp();
+  }
+
+  void TestBody() override {}
+};
+
+TEST_F(BatchFunctionTest, BatchesInputsPaddedToSequenceLengthBucket) {
+  tsl::BlockingCounter blocking_counter(2);
+  // Inputs of sequence lengths 2 and 3 are both padded to 4 and batched to
+  // form a tensor with [4, 4] shape which is verified within the function.
+  Env::Default()->SchedClosure([&]() {
+    BatchFunctionSequenceLengthBucketsTestState test_state;
+    TF_ASSERT_OK(test_state.Init(cpu_device_.get(), TensorShape({4, 4})));
+    test_state.AddInputFromList<int64_t>(TensorShape({1, 2}), {123, 456});
+    TF_EXPECT_OK(test_state.RunOpKernel());
+
+    test::ExpectTensorEqual<int64_t>(
+        *test_state.GetOutput(0),
+        test::AsTensor<int64_t>({123, 456, 0, 0}, TensorShape({1, 4})));
+    blocking_counter.DecrementCount();
+  });
+  Env::Default()->SchedClosure([&]() {
+    BatchFunctionSequenceLengthBucketsTestState test_state;
+    TF_ASSERT_OK(test_state.Init(cpu_device_.get(), TensorShape({4, 4})));
+    test_state.AddInputFromList<int64_t>(TensorShape({1, 3}), {1, 2, 3});
+    TF_EXPECT_OK(test_state.RunOpKernel());
+
+    test::ExpectTensorEqual<int64_t>(
+        *test_state.GetOutput(0),
+        test::AsTensor<int64_t>({1, 2, 3, 0}, TensorShape({1, 4})));
+    blocking_counter.DecrementCount();
+  });
+
+  blocking_counter.Wait();
+}
+
+TEST_F(BatchFunctionTest, RejectsInputsLongerThanLargestSequenceLengthBucket) {
+  BatchFunctionSequenceLengthBucketsTestState test_state;
+  TF_ASSERT_OK(test_state.Init(cpu_device_.get(), TensorShape({4, 20})));
+  test_state.AddInputFromArray<int64_t>(TensorShape({1, 20}),
+                                        std::vector<int64_t>(20, 1));
+  absl::Status status = test_state.RunOpKernel();
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(),
+              ::testing::HasSubstr("exceeds the largest entry"));
+}
+
 #if defined(PLATFORM_GOOGLE)
 TEST_F(BatchFunctionTest, HighPriorityBatchNotPaddedWithLowPriorityTasks) {
   SessionMetadata session_metadata;
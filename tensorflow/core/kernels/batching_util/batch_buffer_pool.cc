@@ -0,0 +1,97 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/batch_buffer_pool.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace serving {
+
+Tensor BatchBufferPool::Get(Allocator* allocator, DataType dtype,
+                            const TensorShape& shape) {
+  if (!DataTypeCanUseMemcpy(dtype)) {
+    return Tensor(allocator, dtype, shape);
+  }
+
+  const auto dims = shape.dim_sizes();
+  Key key(dtype, absl::InlinedVector<int64_t, 4>(dims.begin(), dims.end()));
+  mutex_lock l(mu_);
+  auto it = tensors_.find(key);
+  const bool new_shape = it == tensors_.end();
+  if (!new_shape) {
+    for (const Tensor& tensor : it->second) {
+      if (tensor.RefCountIsOne()) return tensor;
+    }
+    if (it->second.size() >= kMaxTensorsPerKey) {
+      return Tensor(allocator, dtype, shape);
+    }
+  }
+
+  Tensor tensor(allocator, dtype, shape);
+  if (tensor.IsInitialized() && MakeRoom(tensor.TotalBytes(), new_shape)) {
+    // `MakeRoom` may have dropped the entry of `key`, so it is looked up again.
+    tensors_[key].push_back(tensor);
+    pooled_bytes_ += tensor.TotalBytes();
+  }
+  return tensor;
+}
+
+int64_t BatchBufferPool::pooled_bytes() const {
+  mutex_lock l(mu_);
+  return pooled_bytes_;
+}
+
+int64_t BatchBufferPool::num_pooled_shapes() const {
+  mutex_lock l(mu_);
+  return tensors_.size();
+}
+
+bool BatchBufferPool::HasRoom(int64_t bytes, bool new_shape) const {
+  return pooled_bytes_ + bytes <= max_bytes_ &&
+         (!new_shape || tensors_.size() < kMaxPooledShapes);
+}
+
+bool BatchBufferPool::MakeRoom(int64_t bytes, bool new_shape) {
+  if (bytes > max_bytes_) return false;
+  for (auto it = tensors_.begin();
+       it != tensors_.end() && !HasRoom(bytes, new_shape);) {
+    std::vector<Tensor>& tensors = it->second;
+    for (auto tensor_it = tensors.begin(); tensor_it != tensors.end();) {
+      if (tensor_it->RefCountIsOne()) {
+        pooled_bytes_ -= tensor_it->TotalBytes();
+        tensor_it = tensors.erase(tensor_it);
+      } else {
+        ++tensor_it;
+      }
+    }
+    if (tensors.empty()) {
+      tensors_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  return HasRoom(bytes, new_shape);
+}
+
+}  // namespace serving
+}  // namespace tensorflow
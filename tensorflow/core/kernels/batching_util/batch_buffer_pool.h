@@ -0,0 +1,96 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_BUFFER_POOL_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_BUFFER_POOL_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace serving {
+
+// A pool of tensors that a batch resource reuses across batches, e.g. as the
+// concatenated inputs of each batch, keyed by dtype and shape.
+//
+// Callers never return tensors to the pool: a pooled tensor is handed out
+// again once every other reference to its buffer has been dropped. Tensors
+// that downstream ops keep alive, e.g. because they alias an output, are
+// therefore never overwritten.
+//
+// Only types that can be copied with memcpy are pooled.
+class BatchBufferPool {
+ public:
+  // The maximum number of distinct dtypes and shapes with pooled tensors.
+  // Bounds the pool when batch shapes vary, e.g. with padded sequence length
+  // buckets.
+  static constexpr int kMaxPooledShapes = 64;
+
+  // `max_bytes` bounds the total size of the pooled tensors.
+  explicit BatchBufferPool(int64_t max_bytes) : max_bytes_(max_bytes) {}
+
+  BatchBufferPool(const BatchBufferPool&) = delete;
+  BatchBufferPool& operator=(const BatchBufferPool&) = delete;
+
+  // Returns a tensor of `dtype` and `shape` with undefined contents. Reuses a
+  // pooled tensor that nobody else references if there is one, and allocates
+  // one with `allocator` otherwise.
+  Tensor Get(Allocator* allocator, DataType dtype, const TensorShape& shape)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the total size of the pooled tensors.
+  int64_t pooled_bytes() const TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of distinct dtypes and shapes with pooled tensors.
+  int64_t num_pooled_shapes() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  using Key = std::pair<DataType, absl::InlinedVector<int64_t, 4>>;
+
+  // The maximum number of pooled tensors of one dtype and shape. Bounds the
+  // time spent looking for a free tensor.
+  static constexpr int kMaxTensorsPerKey = 8;
+
+  // Drops pooled tensors that nobody else references, of any dtype and shape,
+  // until `bytes` more fit within `max_bytes_` and, if `new_shape` is true,
+  // another dtype and shape fits within `kMaxPooledShapes`. Returns false if
+  // they don't.
+  bool MakeRoom(int64_t bytes, bool new_shape)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  bool HasRoom(int64_t bytes, bool new_shape) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t max_bytes_;
+
+  mutable mutex mu_;
+  // Never holds an empty vector.
+  absl::flat_hash_map<Key, std::vector<Tensor>> tensors_ TF_GUARDED_BY(mu_);
+  int64_t pooled_bytes_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_BUFFER_POOL_H_
@@ -0,0 +1,115 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/batch_buffer_pool.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(BatchBufferPoolTest, ReusesUnreferencedTensors) {
+  BatchBufferPool pool(/*max_bytes=*/1 << 20);
+
+  const void* data;
+  {
+    Tensor tensor = pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8}));
+    data = tensor.data();
+  }
+  Tensor tensor = pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8}));
+  EXPECT_EQ(tensor.data(), data);
+  EXPECT_EQ(pool.pooled_bytes(), 4 * 8 * sizeof(float));
+}
+
+TEST(BatchBufferPoolTest, DoesNotReuseReferencedTensors) {
+  BatchBufferPool pool(/*max_bytes=*/1 << 20);
+
+  Tensor first = pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8}));
+  // A slice, e.g. a task's share of the batch output, keeps the buffer alive.
+  Tensor slice = first.Slice(0, 2);
+  first = Tensor();
+  Tensor second = pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8}));
+  EXPECT_NE(second.data(), slice.data());
+  EXPECT_EQ(pool.pooled_bytes(), 2 * 4 * 8 * sizeof(float));
+}
+
+TEST(BatchBufferPoolTest, KeysOnDtypeAndShape) {
+  BatchBufferPool pool(/*max_bytes=*/1 << 20);
+
+  const void* data =
+      pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8})).data();
+  EXPECT_NE(pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({8, 4})).data(),
+            data);
+  EXPECT_NE(pool.Get(cpu_allocator(), DT_INT32, TensorShape({4, 8})).data(),
+            data);
+  EXPECT_EQ(pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8})).data(),
+            data);
+}
+
+TEST(BatchBufferPoolTest, EvictsUnreferencedTensorsToStayWithinBudget) {
+  BatchBufferPool pool(/*max_bytes=*/4 * 8 * sizeof(float));
+
+  pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8}));
+  Tensor tensor = pool.Get(cpu_allocator(), DT_INT32, TensorShape({4, 8}));
+  EXPECT_EQ(pool.pooled_bytes(), 4 * 8 * sizeof(float));
+
+  // Nothing can be evicted while `tensor` is referenced.
+  Tensor other = pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({4, 8}));
+  EXPECT_TRUE(other.IsInitialized());
+  EXPECT_EQ(pool.pooled_bytes(), 4 * 8 * sizeof(float));
+}
+
+TEST(BatchBufferPoolTest, BoundsNumberOfShapes) {
+  BatchBufferPool pool(/*max_bytes=*/1 << 20);
+  constexpr int kNumShapes = 2 * BatchBufferPool::kMaxPooledShapes;
+
+  // Shapes whose tensors are referenced can't be dropped.
+  std::vector<Tensor> referenced;
+  for (int i = 1; i <= kNumShapes; ++i) {
+    referenced.push_back(pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({i})));
+  }
+  EXPECT_EQ(pool.num_pooled_shapes(), BatchBufferPool::kMaxPooledShapes);
+  referenced.clear();
+
+  // Unreferenced tensors of old shapes make room for new ones.
+  for (int i = kNumShapes + 1; i <= 2 * kNumShapes; ++i) {
+    pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({i}));
+  }
+  EXPECT_EQ(pool.num_pooled_shapes(), BatchBufferPool::kMaxPooledShapes);
+  const void* data =
+      pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({2 * kNumShapes}))
+          .data();
+  EXPECT_EQ(
+      pool.Get(cpu_allocator(), DT_FLOAT, TensorShape({2 * kNumShapes})).data(),
+      data);
+}
+
+TEST(BatchBufferPoolTest, DoesNotPoolStrings) {
+  BatchBufferPool pool(/*max_bytes=*/1 << 20);
+
+  Tensor tensor = pool.Get(cpu_allocator(), DT_STRING, TensorShape({4}));
+  EXPECT_EQ(tensor.NumElements(), 4);
+  EXPECT_EQ(pool.pooled_bytes(), 0);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <memory>
@@ -72,6 +73,7 @@ limitations under the License.
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
+#include "tensorflow/core/util/batch_util.h"
 #include "tensorflow/core/util/incremental_barrier.h"
 #include "tsl/platform/criticality.h"
 #include "tsl/platform/errors.h"
@@ -214,6 +216,31 @@ void RecordBatchDelayUsV2(int64_t batch_delay_us, const string& model_name,
       ->Add(static_cast<double>(batch_delay_us));
 }
 
+void RecordQueueingDelayUs(int64_t queueing_delay_us, const string& model_name,
+                           const string& op_name, absl::string_view priority) {
+  static auto* cell = tensorflow::monitoring::Sampler<3>::New(
+      {"/tensorflow/serving/batching/queueing_delay_us",
+       "Tracks the time (in microseconds) inputs wait in the batcher before "
+       "being processed, by model_name (if available) and priority lane.",
+       "model_name", "op_name", "priority"},
+      // It's 27 buckets with the last bucket being 2^26 to DBL_MAX;
+      // so the limits are [1, 2, 4, 8, ..., 64 * 1024 * 1024, DBL_MAX].
+      monitoring::Buckets::Exponential(1, 2, 27));
+  cell->GetCell(model_name, op_name, std::string(priority))
+      ->Add(static_cast<double>(queueing_delay_us));
+}
+
+void RecordExpiredTask(const string& model_name, const string& op_name,
+                       absl::string_view priority) {
+  static auto* cell = monitoring::Counter<3>::New(
+      "/tensorflow/serving/batching/expired_tasks",
+      "Tracks the number of inputs dropped by the batcher because their "
+      "deadline could not be met, by model_name (if available) and priority "
+      "lane.",
+      "model_name", "op_name", "priority");
+  cell->GetCell(model_name, op_name, std::string(priority))->IncrementBy(1);
+}
+
 void RecordBatchParamBatchTimeoutMicros(int64_t batch_timeout_micros,
                                         const string& model_name,
                                         const string& op_name) {
@@ -287,6 +314,19 @@ const string& GetModelName(OpKernelContext* ctx) {
   return ctx->session_metadata()->name();
 }
 
+// Returns the priority lane the batcher queues `task` in.
+absl::string_view GetPriorityLane(const BatchResourceBase::BatchTask& task,
+                                  bool enable_priority_queue) {
+  // TODO(b/316379576): Once the criticality and priority become configurable,
+  // this should rely on the batch parameters instead of the hard coded value.
+  if (enable_priority_queue &&
+      (task.criticality() == tsl::criticality::Criticality::kSheddablePlus ||
+       task.criticality() == tsl::criticality::Criticality::kSheddable)) {
+    return "low";
+  }
+  return "high";
+}
+
 // Returns the sum of the task sizes. The caller must guarantee that the
 // unique_ptrs in the argument vectors are not null.
 int GetTotalTaskSize(
@@ -298,6 +338,55 @@ int GetTotalTaskSize(
   return tasks_size;
 }
 
+// Pads `inputs` with zeros along their second dimension, the sequence
+// dimension, up to the smallest entry of `sequence_length_buckets` that fits
+// them. Returns the padded sequence length.
+absl::StatusOr<int32> PadToSequenceLengthBucket(
+    const std::vector<int32>& sequence_length_buckets,
+    std::vector<Tensor>& inputs) {
+  const int64_t sequence_length =
+      inputs[0].dims() >= 2 ? inputs[0].dim_size(1) : -1;
+  for (const Tensor& input : inputs) {
+    if (input.dims() < 2 || input.dim_size(1) != sequence_length) {
+      return errors::InvalidArgument(
+          "With sequence_length_buckets, batching input tensors must all have "
+          "the sequence length as their second dimension; got shapes ",
+          input.shape().DebugString(), " and ",
+          inputs[0].shape().DebugString());
+    }
+  }
+  auto bucket =
+      std::lower_bound(sequence_length_buckets.begin(),
+                       sequence_length_buckets.end(), sequence_length);
+  if (bucket == sequence_length_buckets.end()) {
+    return errors::InvalidArgument(
+        "Sequence length ", sequence_length,
+        " exceeds the largest entry in sequence_length_buckets, ",
+        sequence_length_buckets.back());
+  }
+  if (*bucket == sequence_length) return *bucket;
+
+  for (Tensor& input : inputs) {
+    TensorShape padded_shape = input.shape();
+    padded_shape.set_dim(1, *bucket);
+    Tensor padded(input.dtype(), padded_shape);
+    // Non-memcpy types are default-initialized, which is their zero value.
+    if (DataTypeCanUseMemcpy(input.dtype())) {
+      std::memset(padded.data(), 0, padded.TotalBytes());
+    }
+    TensorShape row_shape = input.shape();
+    row_shape.RemoveDim(0);
+    Tensor row(input.dtype(), row_shape);
+    for (int64_t i = 0; i < input.dim_size(0); ++i) {
+      TF_RETURN_IF_ERROR(batch_util::CopySliceToElement(input, &row, i));
+      TF_RETURN_IF_ERROR(
+          batch_util::CopyElementToLargerSlice(row, &padded, i));
+    }
+    input = std::move(padded);
+  }
+  return *bucket;
+}
+
 }  // namespace
 
 std::unique_ptr<BatchResourceBase::BatchTask>
@@ -316,6 +405,7 @@ BatchResourceBase::BatchTask::CreateSplitTask(
   task->status = this->status;
   task->is_partial = true;
   task->start_time = this->start_time;
+  task->session_deadline = this->session_deadline;
   task->request_cost = this->request_cost;
   task->forced_warmup_batch_size = this->forced_warmup_batch_size;
 
@@ -323,6 +413,8 @@ BatchResourceBase::BatchTask::CreateSplitTask(
 }
 
 using ::tensorflow::concat_split_util::Concat;
+using ::tensorflow::concat_split_util::ConcatInto;
+using ::tensorflow::concat_split_util::ConcatShape;
 using ::tensorflow::concat_split_util::Split;
 using TensorMatrix = std::vector<std::vector<Tensor>>;
 
@@ -380,6 +472,7 @@ absl::Status BatchResourceBase::RegisterInput(
   TF_ASSIGN_OR_RETURN(std::unique_ptr<BatchTask> batch_components,
                       create_batch_task_fn());
   batch_components->start_time = EnvTime::NowNanos();
+  batch_components->session_deadline = context->deadline();
   batch_components->guid = guid;
   batch_components->propagated_context = Context(ContextKind::kThread);
 
@@ -484,9 +577,20 @@ absl::Status BatchResourceBase::RegisterInput(
     batch_components->request_cost = request_cost_accessor->GetRequestCost();
   }
 
+  // Inputs padded to different sequence lengths can't be concatenated, so
+  // each sequence length bucket gets a queue of its own.
+  string queue_name = batcher_queue_name;
+  if (!sequence_length_buckets_.empty()) {
+    TF_ASSIGN_OR_RETURN(int32 sequence_length,
+                        PadToSequenceLengthBucket(sequence_length_buckets_,
+                                                  batch_components->inputs));
+    queue_name =
+        absl::StrCat(batcher_queue_name, "/sequence_length_", sequence_length);
+  }
+
   BatcherQueueT* batcher_queue;
   TF_RETURN_IF_ERROR(LookupOrCreateBatcherQueue(
-      /* queue_name= */ batcher_queue_name,
+      /* queue_name= */ queue_name,
       /* model_name= */ GetModelName(context),
       /* op_name= */ context->op_kernel().name(), /* queue= */ &batcher_queue));
 
@@ -752,10 +856,26 @@ absl::Status BatchResourceBase::ConcatInputTensors(
       }
     }
 
-    Tensor concatenated_tensor;
-    absl::Status concat_status =
-        Concat(context, to_concatenate, &concatenated_tensor);
-    TF_RETURN_IF_ERROR(concat_status);
+    // A single tensor is already laid out as the batch; pass it through.
+    if (to_concatenate.size() == 1) {
+      concatenated_tensors->push_back(to_concatenate[0]);
+      continue;
+    }
+
+    TensorShape concatenated_shape;
+    TF_RETURN_IF_ERROR(ConcatShape(to_concatenate, &concatenated_shape));
+    AllocatorAttributes attr;
+    attr.set_on_host(true);
+    Tensor concatenated_tensor = concat_buffer_pool_.Get(
+        context->get_allocator(attr), to_concatenate[0].dtype(),
+        concatenated_shape);
+    if (!concatenated_tensor.IsInitialized()) {
+      return errors::ResourceExhausted(
+          "OOM when allocating the batched input tensor with shape ",
+          concatenated_shape.DebugString());
+    }
+    TF_RETURN_IF_ERROR(
+        ConcatInto(context, to_concatenate, &concatenated_tensor));
     concatenated_tensors->push_back(concatenated_tensor);
   }
   return absl::OkStatus();
@@ -1049,11 +1169,34 @@ void BatchResourceBase::ProcessFuncBatch(
                          model_name, last_task_context->op_kernel().name(),
                          processed_size);
   }
+  for (int i = 0; i < batch->num_tasks(); ++i) {
+    RecordQueueingDelayUs(
+        (current_time - batch->task(i).start_time) * 1e-3, model_name,
+        op_name,
+        GetPriorityLane(batch->task(i),
+                        batcher_queue_options_.enable_priority_queue));
+  }
+  for (const std::unique_ptr<BatchTask>& task : unbatched_tasks) {
+    RecordQueueingDelayUs(
+        (current_time - task->start_time) * 1e-3, model_name, op_name,
+        GetPriorityLane(*task, batcher_queue_options_.enable_priority_queue));
+  }
   // Releases the cleanup method here, because the callback of the function
   // library runtime will handle it now.
   finally.release();
+  const uint64 processing_start_time = EnvTime::NowNanos();
   ProcessFuncBatchImpl(
       last_task, args, &combined_outputs, [&](const absl::Status& run_status) {
+        if (run_status.ok() && batcher_ &&
+            batcher_queue_options_.latency_slo_micros > 0) {
+          // Feed the latency model that the batcher uses to meet the target.
+          GlobalBatchStatsRegistry()
+              .model(/* model_name= */ model_name, /* op_name= */ op_name)
+              .batch_latency()
+              .Register(processed_size,
+                        absl::Nanoseconds(EnvTime::NowNanos() -
+                                          processing_start_time));
+        }
         absl::Status final_status;
         auto run_finally = gtl::MakeCleanup([&]() {
           // We do the cleanup here as an optimization, so that
@@ -1183,6 +1326,20 @@ void BatchResourceBase::ProcessBatch(std::unique_ptr<BatchT> batch) const {
   return absl::OkStatus();
 }
 
+void BatchResourceBase::ProcessExpiredTask(std::unique_ptr<BatchTask> task) {
+  if (!session_metadata().name().empty()) {
+    absl::MutexLock lock(&outstanding_batch_mu_);
+    num_outstanding_batched_items_ -= task->size();
+  }
+  RecordExpiredTask(
+      GetModelName(task->context), task->context->op_kernel().name(),
+      GetPriorityLane(*task, batcher_queue_options_.enable_priority_queue));
+  CleanUpFunctionHelper(
+      *task, errors::DeadlineExceeded(
+                 "The batched input could not be processed before the "
+                 "deadline of its session."));
+}
+
 void BatchResourceBase::ProcessBatchCallBack(
     std::unique_ptr<Batch<BatchTask>> batch,
     std::vector<std::unique_ptr<BatchTask>> unbatched_tasks) {
@@ -1213,6 +1370,12 @@ absl::Status BatchResourceBase::LookupOrCreateBatcherQueue(
     BatcherT::QueueOptions batcher_queue_options = batcher_queue_options_;
     batcher_queue_options.model_batch_stats = &GlobalBatchStatsRegistry().model(
         /* model_name= */ model_name, /* op_name= */ op_name);
+    if (has_process_batch_function_) {
+      // Only BatchFunction completes every task on its own, so tasks can be
+      // failed individually.
+      batcher_queue_options.expired_task_callback =
+          absl::bind_front(&BatchResourceBase::ProcessExpiredTask, this);
+    }
 
     TF_RETURN_IF_ERROR(batcher_->AddQueue(
         batcher_queue_options,
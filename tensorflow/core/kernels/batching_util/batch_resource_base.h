@@ -20,6 +20,7 @@ limitations under the License.
 #include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -27,6 +28,7 @@ limitations under the License.
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/blocking_counter.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
 #include "tensorflow/core/common_runtime/request_cost.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -34,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/batching_util/adaptive_shared_batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/batch_buffer_pool.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
@@ -137,6 +140,14 @@ class BatchResourceBase : public ResourceBase {
       return criticality_val;
     };
 
+    // The deadline of the session running the op, if any. The batcher drops
+    // the task once the deadline can no longer be met.
+    std::optional<absl::Time> session_deadline;
+
+    std::optional<absl::Time> deadline() const override {
+      return session_deadline;
+    }
+
     // If nonzero, make a batch of this size entirely out of padding. This
     // batch is processed, but is not propagated to the kernel outputs.
     int forced_warmup_batch_size = 0;
@@ -186,6 +197,14 @@ class BatchResourceBase : public ResourceBase {
 
   const SessionMetadata& session_metadata() const { return session_metadata_; }
 
+  // If non-empty, inputs are padded along their second dimension, the
+  // sequence dimension, up to the smallest of `sequence_length_buckets` that
+  // fits them, and are only batched with inputs padded to the same length.
+  // The entries must increase monotonically.
+  void set_sequence_length_buckets(std::vector<int32> sequence_length_buckets) {
+    sequence_length_buckets_ = std::move(sequence_length_buckets);
+  }
+
   using CreateBatchTaskFn =
       std::function<StatusOr<std::unique_ptr<BatchTask>>()>;
 
@@ -319,6 +338,10 @@ class BatchResourceBase : public ResourceBase {
   // Processes a batch of one or more BatchTask entries.
   void ProcessBatch(std::unique_ptr<BatchT> batch) const;
 
+  // Fails a task that the batcher dropped because its deadline can no longer
+  // be met.
+  void ProcessExpiredTask(std::unique_ptr<BatchTask> task);
+
   // Callback function that wraps the Process*Batch functions above. The caller
   // of the callback must guarantee that the unique pointers passed as argument
   // are not null.
@@ -348,6 +371,8 @@ class BatchResourceBase : public ResourceBase {
 
   SessionMetadata session_metadata_;
 
+  std::vector<int32> sequence_length_buckets_;
+
   absl::Mutex outstanding_batch_mu_;
   int num_outstanding_batched_items_ TF_GUARDED_BY(outstanding_batch_mu_) = 0;
 
@@ -372,6 +397,11 @@ class BatchResourceBase : public ResourceBase {
   // A concatenated string of <allowed_batch_sizes_>, separated by ",". This is
   // used to record batching parameter.
   string allowed_batch_sizes_str_;
+
+  // Buffers reused as the concatenated inputs of batches, so that batching
+  // the same shapes over and over does not allocate.
+  static constexpr int64_t kMaxConcatBufferPoolBytes = int64_t{64} << 20;
+  mutable BatchBufferPool concat_buffer_pool_{kMaxConcatBufferPoolBytes};
 };
 
 }  // namespace serving
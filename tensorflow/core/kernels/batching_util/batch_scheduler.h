@@ -41,6 +41,7 @@ limitations under the License.
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
@@ -94,6 +95,11 @@ class BatchTask {
   virtual tsl::criticality::Criticality criticality() const {
     return tsl::criticality::Criticality::kCritical;
   }
+
+  // Returns the time by which the task must be done, or std::nullopt if it has
+  // no deadline. Schedulers that support deadlines may drop a task instead of
+  // processing it once the deadline can no longer be met.
+  virtual std::optional<absl::Time> deadline() const { return std::nullopt; }
 };
 
 // A thread-safe collection of BatchTasks. Tasks can be either added or removed
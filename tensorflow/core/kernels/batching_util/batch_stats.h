@@ -50,7 +50,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_STATS_H_
 #define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_STATS_H_
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <optional>
 #include <string>
@@ -115,6 +117,143 @@ class CostTracker {
   absl::Duration sample_sum_ TF_GUARDED_BY(mu_);
 };
 
+// Learns the processing latency of a batch as a function of its size.
+//
+// Fits `latency = fixed_cost + per_item_cost * batch_size` by least squares
+// over the registered samples. Each new sample multiplies the weight of all
+// older samples by `kDecay`, so the fit follows the last few hundred batches
+// and adapts when the load on the device changes. The spread of the samples
+// around the fit is used to estimate the 99th percentile.
+//
+// Thread-safe.
+class BatchLatencyModel {
+ public:
+  // Registers that processing a batch of `batch_size` took `latency`.
+  void Register(int64_t batch_size, absl::Duration latency) {
+    DCHECK_GT(batch_size, 0);
+
+    const double x = batch_size;
+    const double y = absl::ToDoubleMicroseconds(latency);
+    mutex_lock l(mu_);
+    weight_ = weight_ * kDecay + 1;
+    sum_x_ = sum_x_ * kDecay + x;
+    sum_y_ = sum_y_ * kDecay + y;
+    sum_xx_ = sum_xx_ * kDecay + x * x;
+    sum_xy_ = sum_xy_ * kDecay + x * y;
+    sum_yy_ = sum_yy_ * kDecay + y * y;
+  }
+
+  // Returns the predicted mean latency of a batch of `batch_size`.
+  //
+  // Returns std::nullopt if no samples have been registered.
+  std::optional<absl::Duration> mean(int64_t batch_size) const {
+    std::optional<Fit> fit = GetFit();
+    if (!fit.has_value()) return std::nullopt;
+    return absl::Microseconds(fit->Predict(batch_size));
+  }
+
+  // Returns the predicted 99th percentile of the latency of a batch of
+  // `batch_size`, assuming that the latency is normally distributed around
+  // the mean.
+  //
+  // Returns std::nullopt if no samples have been registered.
+  std::optional<absl::Duration> p99(int64_t batch_size) const {
+    // The 99th percentile of the standard normal distribution.
+    constexpr double kZ99 = 2.326;
+
+    std::optional<Fit> fit = GetFit();
+    if (!fit.has_value()) return std::nullopt;
+    return absl::Microseconds(fit->Predict(batch_size) +
+                              kZ99 * fit->StdDev(batch_size));
+  }
+
+ private:
+  // Weight of a sample relative to the one registered after it. Gives a
+  // sample half the weight of the newest one after about 70 more samples.
+  static constexpr double kDecay = 0.99;
+
+  // A snapshot of the fitted model, in microseconds.
+  struct Fit {
+    double fixed_cost;
+    double per_item_cost;
+    // Standard deviation of the samples around the fit, at `mean_batch_size`.
+    double stddev;
+    double mean_batch_size;
+    // Whether all samples had (almost) the same batch size, so that only
+    // their mean is known.
+    bool single_size;
+
+    double Predict(int64_t batch_size) const {
+      if (single_size) {
+        // Without a slope, assume that smaller batches are no cheaper and that
+        // larger batches grow proportionally, which overestimates both.
+        return fixed_cost *
+               std::max(1.0, static_cast<double>(batch_size) / mean_batch_size);
+      }
+      return fixed_cost + per_item_cost * batch_size;
+    }
+
+    double StdDev(int64_t batch_size) const {
+      return stddev *
+             std::max(1.0, static_cast<double>(batch_size) / mean_batch_size);
+    }
+  };
+
+  std::optional<Fit> GetFit() const {
+    double w, sx, sy, sxx, sxy, syy;
+    {
+      mutex_lock l(mu_);
+      w = weight_;
+      sx = sum_x_;
+      sy = sum_y_;
+      sxx = sum_xx_;
+      sxy = sum_xy_;
+      syy = sum_yy_;
+    }
+    if (w == 0) return std::nullopt;
+
+    Fit fit;
+    const double mean_x = sx / w;
+    const double mean_y = sy / w;
+    const double var_x = sxx / w - mean_x * mean_x;
+    const double cov_xy = sxy / w - mean_x * mean_y;
+    fit.mean_batch_size = mean_x;
+    fit.single_size = var_x <= 1e-6 * mean_x * mean_x;
+    if (fit.single_size) {
+      fit.fixed_cost = mean_y;
+      fit.per_item_cost = 0;
+    } else {
+      // Latency is not expected to decrease with the batch size, nor to be
+      // negative for tiny batches.
+      fit.per_item_cost = std::max(0.0, cov_xy / var_x);
+      fit.fixed_cost = mean_y - fit.per_item_cost * mean_x;
+      if (fit.fixed_cost < 0) {
+        fit.fixed_cost = 0;
+        fit.per_item_cost = sxy / sxx;
+      }
+    }
+    // Mean squared residual of the samples, expanded in terms of the sums.
+    const double a = fit.single_size ? mean_y : fit.fixed_cost;
+    const double b = fit.per_item_cost;
+    const double mean_squared_residual =
+        syy / w - 2 * a * mean_y - 2 * b * sxy / w + a * a +
+        2 * a * b * mean_x + b * b * sxx / w;
+    fit.stddev = std::sqrt(std::max(0.0, mean_squared_residual));
+    return fit;
+  }
+
+  mutable mutex mu_;
+
+  // Decayed sums of the sample weights, batch sizes (x) and latencies in
+  // microseconds (y).
+  double weight_ TF_GUARDED_BY(mu_) = 0;
+  double sum_x_ TF_GUARDED_BY(mu_) = 0;
+  double sum_y_ TF_GUARDED_BY(mu_) = 0;
+  double sum_xx_ TF_GUARDED_BY(mu_) = 0;
+  double sum_xy_ TF_GUARDED_BY(mu_) = 0;
+  double sum_yy_ TF_GUARDED_BY(mu_) = 0;
+};
+
 // Tracks statistics for a particular model and batch size.
 //
 // Thread-safe.
@@ -171,6 +310,9 @@ class ModelBatchStats {
     return result;
   }
 
+  // Returns the model of the processing latency of batches of this model.
+  BatchLatencyModel& batch_latency() { return batch_latency_; }
+
   void SetNumBatchThreads(int64_t num_batch_threads) {
     num_batch_threads_.store(num_batch_threads, std::memory_order_relaxed);
   }
@@ -201,6 +343,9 @@ class ModelBatchStats {
   absl::node_hash_map<int32, BatchSizeStats> batch_size_stats_by_batch_size_
       TF_GUARDED_BY(mu_);
 
+  // The processing latency of batches, by batch size.
+  BatchLatencyModel batch_latency_;
+
   // The total count of individual unit-sized queries processed by this model.
   // Can be used to generate an internal load metric per model. See
   // RegisterQuerySize for more details.
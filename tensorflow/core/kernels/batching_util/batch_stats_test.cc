@@ -148,6 +148,77 @@ TEST(BatchStatsTest, NumBatchThreadsIsCorrect) {
   ASSERT_EQ(stats.num_batch_threads(), 16);
 }
 
+TEST(BatchStatsTest, LatencyModelHasNoPredictionWithoutSamples) {
+  ModelBatchStats stats;
+
+  ASSERT_FALSE(stats.batch_latency().mean(1).has_value());
+  ASSERT_FALSE(stats.batch_latency().p99(1).has_value());
+}
+
+TEST(BatchStatsTest, LatencyModelLearnsLinearLatency) {
+  ModelBatchStats stats;
+
+  // Batches take 100us plus 10us per task.
+  for (int i = 0; i < 3; ++i) {
+    for (int batch_size = 1; batch_size <= 8; ++batch_size) {
+      stats.batch_latency().Register(
+          batch_size, absl::Microseconds(100 + 10 * batch_size));
+    }
+  }
+
+  // Check that the model extrapolates to unseen batch sizes.
+  ASSERT_NEAR(absl::ToDoubleMicroseconds(*stats.batch_latency().mean(16)),
+              260, 0.01);
+  ASSERT_NEAR(absl::ToDoubleMicroseconds(*stats.batch_latency().p99(16)),
+              260, 0.01);
+}
+
+TEST(BatchStatsTest, LatencyModelExtrapolatesFromSingleBatchSize) {
+  ModelBatchStats stats;
+
+  stats.batch_latency().Register(4, absl::Microseconds(100));
+  stats.batch_latency().Register(4, absl::Microseconds(100));
+
+  // Latency is assumed to be proportional to the batch size.
+  ASSERT_NEAR(absl::ToDoubleMicroseconds(*stats.batch_latency().mean(2)), 100,
+              0.01);
+  ASSERT_NEAR(absl::ToDoubleMicroseconds(*stats.batch_latency().mean(8)), 200,
+              0.01);
+}
+
+TEST(BatchStatsTest, LatencyModelFollowsRecentSamples) {
+  ModelBatchStats stats;
+
+  for (int i = 0; i < 1000; ++i) {
+    const int batch_size = i % 8 + 1;
+    stats.batch_latency().Register(batch_size,
+                                   absl::Microseconds(100 + 10 * batch_size));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    const int batch_size = i % 8 + 1;
+    stats.batch_latency().Register(batch_size,
+                                   absl::Microseconds(200 + 20 * batch_size));
+  }
+
+  // Old samples have decayed away.
+  ASSERT_NEAR(absl::ToDoubleMicroseconds(*stats.batch_latency().mean(4)), 280,
+              1);
+}
+
+TEST(BatchStatsTest, LatencyModelP99AccountsForSpread) {
+  ModelBatchStats stats;
+
+  for (int i = 0; i < 1000; ++i) {
+    stats.batch_latency().Register(
+        4, absl::Microseconds(i % 2 == 0 ? 90 : 110));
+  }
+
+  ASSERT_NEAR(absl::ToDoubleMicroseconds(*stats.batch_latency().mean(4)), 100,
+              0.1);
+  ASSERT_NEAR(absl::ToDoubleMicroseconds(*stats.batch_latency().p99(4)), 123.3,
+              0.5);
+}
+
 }  // namespace
 
 }  // namespace tensorflow::serving
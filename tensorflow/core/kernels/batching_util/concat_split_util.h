@@ -30,21 +30,14 @@ namespace concat_split_util {
 typedef Eigen::ThreadPoolDevice CPUDevice;
 typedef Eigen::GpuDevice GPUDevice;
 
-// Concatenates 'inputs' into a single tensor along the zeroth dimension.
-// Requires that all elements of 'inputs' have element type T. Writes to
-// 'output' using 'context' for the allocation to ensure proper device
-// placement.
-template <typename T>
-absl::Status Concat(OpKernelContext* context,
-                    const absl::Span<const Tensor> inputs, Tensor* output) {
+// Computes the shape of the concatenation of 'inputs' along the zeroth
+// dimension, which requires that all of them have the same rank and the same
+// sizes in all but the zeroth dimension.
+inline absl::Status ConcatShape(const absl::Span<const Tensor> inputs,
+                                TensorShape* output_shape) {
   const int input_dims = inputs[0].dims();
   const TensorShape& input_shape = inputs[0].shape();
 
-  // Note that we reduce the concat of k-dimensional tensors into a two
-  // dimensional concat. Assuming the dimensions of any input tensor are
-  // {y0, y1,...,ym-1}, we flatten it to {1, y}, where y = Prod_i(yi).
-  std::vector<std::unique_ptr<typename TTypes<T, 2>::ConstMatrix>> inputs_flat;
-  inputs_flat.reserve(inputs.size());
   int64_t output_dim0 = 0;
   for (size_t i = 0; i < inputs.size(); ++i) {
     const Tensor& input = inputs[i];
@@ -62,19 +55,32 @@ absl::Status Concat(OpKernelContext* context,
             "] = ", input.shape().DebugString());
       }
     }
+    output_dim0 += input.dim_size(0);
+  }
+
+  *output_shape = input_shape;
+  output_shape->set_dim(0, output_dim0);
+  return absl::OkStatus();
+}
+
+// Concatenates 'inputs' along the zeroth dimension into 'output', which the
+// caller has allocated with the shape returned by 'ConcatShape'. Requires that
+// all elements of 'inputs' have element type T.
+template <typename T>
+absl::Status ConcatInto(OpKernelContext* context,
+                        const absl::Span<const Tensor> inputs, Tensor* output) {
+  // Note that we reduce the concat of k-dimensional tensors into a two
+  // dimensional concat. Assuming the dimensions of any input tensor are
+  // {y0, y1,...,ym-1}, we flatten it to {1, y}, where y = Prod_i(yi).
+  std::vector<std::unique_ptr<typename TTypes<T, 2>::ConstMatrix>> inputs_flat;
+  inputs_flat.reserve(inputs.size());
+  for (const Tensor& input : inputs) {
     if (input.NumElements() > 0) {
       inputs_flat.emplace_back(new typename TTypes<T, 2>::ConstMatrix(
           input.shaped<T, 2>({1, input.NumElements()})));
     }
-    output_dim0 += input.dim_size(0);
   }
 
-  TensorShape output_shape(input_shape);
-  output_shape.set_dim(0, output_dim0);
-  AllocatorAttributes attr;
-  attr.set_on_host(true);
-  TF_RETURN_IF_ERROR(context->allocate_temp(DataTypeToEnum<T>::value,
-                                            output_shape, output, attr));
   if (output->NumElements() > 0) {
     auto output_flat = output->shaped<T, 2>({1, output->NumElements()});
 #if (defined(GOOGLE_CUDA) && GOOGLE_CUDA) || \
@@ -90,6 +96,22 @@ absl::Status Concat(OpKernelContext* context,
   return absl::OkStatus();
 }
 
+// Concatenates 'inputs' into a single tensor along the zeroth dimension.
+// Requires that all elements of 'inputs' have element type T. Writes to
+// 'output' using 'context' for the allocation to ensure proper device
+// placement.
+template <typename T>
+absl::Status Concat(OpKernelContext* context,
+                    const absl::Span<const Tensor> inputs, Tensor* output) {
+  TensorShape output_shape;
+  TF_RETURN_IF_ERROR(ConcatShape(inputs, &output_shape));
+  AllocatorAttributes attr;
+  attr.set_on_host(true);
+  TF_RETURN_IF_ERROR(context->allocate_temp(DataTypeToEnum<T>::value,
+                                            output_shape, output, attr));
+  return ConcatInto<T>(context, inputs, output);
+}
+
 // Same as 'Concat' above, but handles Tensor dtype deduction automatically.
 inline absl::Status Concat(OpKernelContext* context,
                            const absl::Span<const Tensor> inputs,
@@ -110,6 +132,27 @@ inline absl::Status Concat(OpKernelContext* context,
   return concat_status;
 }
 
+// Same as 'ConcatInto' above, but handles Tensor dtype deduction
+// automatically.
+inline absl::Status ConcatInto(OpKernelContext* context,
+                               const absl::Span<const Tensor> inputs,
+                               Tensor* output) {
+  const DataType type = inputs[0].dtype();
+  absl::Status concat_status;
+  switch (type) {
+#define CASE(type)                                             \
+  case DataTypeToEnum<type>::value:                            \
+    concat_status = ConcatInto<type>(context, inputs, output); \
+    break;
+    TF_CALL_ALL_TYPES(CASE);
+#undef CASE
+    default:
+      concat_status = errors::InvalidArgument("Unsupported data type: ", type);
+      break;
+  }
+  return concat_status;
+}
+
 // The Split*() functions split 'input' with element type T into 'sizes.size()'
 // tensors along the zeroth dimension, with the ith split having zeroth-
 // dimension size 'sizes[i]'. They allocate the output tensors using 'context',
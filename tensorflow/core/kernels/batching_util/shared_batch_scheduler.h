@@ -34,6 +34,7 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/kernels/batching_util/batch_input_task.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
@@ -249,6 +250,22 @@ class SharedBatchScheduler
     // requested.
     ModelBatchStats* model_batch_stats = nullptr;
 
+    // If positive, the queue picks the size and the timeout of each batch
+    // itself, so that tasks complete within this many microseconds at the
+    // 99th percentile while batches are as large as the target allows.
+    //
+    // The queue estimates the arrival rate of tasks and reads the processing
+    // latency of batches from `model_batch_stats->batch_latency()`, where the
+    // process-batch callback is expected to register it. A batch becomes
+    // schedulable once it is as large as can be filled and processed within
+    // the target, or once waiting longer would miss the target.
+    // `max_execution_batch_size` still bounds the batch size, and
+    // `batch_timeout_micros` applies until the first batch latency has been
+    // registered. Low priority tasks are not covered by the target.
+    //
+    // Requires `model_batch_stats`.
+    int64_t latency_slo_micros = 0;
+
     // If true, queue implementation would split high priority and low priority
     // inputs into two sub queues.
     bool enable_priority_queue = false;
@@ -278,6 +295,17 @@ class SharedBatchScheduler
     // effective only when enable_priority_queue is true.
     MixedPriorityBatchingPolicy mixed_priority_batching_policy =
         MixedPriorityBatchingPolicy::kLowPriorityPaddingWithMaxBatchSize;
+
+    // If set, tasks whose deadline() can no longer be met are removed from
+    // their batch, or from the low priority tasks padding it, right before
+    // the batch is processed, and are handed to this callback instead. The
+    // callback takes ownership of the task and is expected to fail it.
+    //
+    // A deadline can't be met if it falls before the batch is expected to be
+    // done processing, as predicted by `model_batch_stats->batch_latency()`
+    // when available, or if it has passed otherwise. If unset, deadlines are
+    // ignored.
+    std::function<void(std::unique_ptr<TaskType> task)> expired_task_callback;
   };
   // This method is marked virtual for testing purposes only.
   virtual absl::Status AddQueue(
@@ -469,6 +497,18 @@ class Queue {
   // Pads the open batch until it is full with low priority tasks.
   void PadOpenBatchWithLowPriorityTasks() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Removes the tasks whose deadline can't be met from `batch` and
+  // `padding_task`, and hands them to `options_.expired_task_callback`. If
+  // every task of `batch` is removed, the remaining padding tasks are moved
+  // into it.
+  void DropExpiredTasks(std::unique_ptr<Batch<TaskType>>* batch,
+                        std::vector<std::unique_ptr<TaskType>>* padding_task);
+
+  // Records that a task of `task_size` arrived, and recomputes the size and
+  // timeout of the open batch that meet `options_.latency_slo_micros`.
+  void UpdateLatencySloTargets(size_t task_size)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Closes the open batch residing at the back of std::deque, and inserts a
   // fresh open batch behind it.
   void StartNewBatch() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
@@ -582,6 +622,20 @@ class Queue {
   // might contain an approximate value.
   uint64 open_batch_start_time_micros_ TF_GUARDED_BY(mu_);
 
+  // Exponential moving averages of the size of high priority tasks (zero until
+  // the first one arrives) and of the time between their arrivals (negative
+  // until the second one arrives). Only maintained if
+  // `options_.latency_slo_micros` is positive.
+  double mean_task_size_ TF_GUARDED_BY(mu_) = 0;
+  double mean_interarrival_micros_ TF_GUARDED_BY(mu_) = -1;
+  uint64 last_arrival_time_micros_ TF_GUARDED_BY(mu_) = 0;
+
+  // If `options_.latency_slo_micros` is positive, the size at which the open
+  // batch becomes schedulable, its timeout, and when they were last computed.
+  size_t latency_slo_batch_size_ TF_GUARDED_BY(mu_);
+  int64_t latency_slo_batch_timeout_micros_ TF_GUARDED_BY(mu_);
+  uint64 latency_slo_update_time_micros_ TF_GUARDED_BY(mu_) = 0;
+
   // Whether this queue contains a batch that is eligible to be scheduled.
   // Used to keep track of when to call 'schedulable_batch_callback_'.
   bool schedulable_batch_ TF_GUARDED_BY(mu_) = false;
@@ -710,6 +764,17 @@ absl::Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
         "max_enqueued_batches must be positive; was ",
         options.max_enqueued_batches);
   }
+  if (options.latency_slo_micros < 0) {
+    return errors::InvalidArgument(
+        "latency_slo_micros must be non-negative; was ",
+        options.latency_slo_micros);
+  }
+  if (options.latency_slo_micros > 0 && options.model_batch_stats == nullptr) {
+    return errors::InvalidArgument(
+        "model_batch_stats must be specified when latency_slo_micros is "
+        "positive: ",
+        options.latency_slo_micros);
+  }
 
   if (options.enable_large_batch_splitting &&
       options.split_input_task_func == nullptr) {
@@ -872,7 +937,9 @@ Queue<TaskType>::Queue(
       env_(env),
       max_execution_batch_size_(GetMaxExecutionBatchSize(options_)),
       process_batch_callback_(process_batch_callback),
-      schedulable_batch_callback_(schedulable_batch_callback) {
+      schedulable_batch_callback_(schedulable_batch_callback),
+      latency_slo_batch_size_(max_execution_batch_size_),
+      latency_slo_batch_timeout_micros_(options_.batch_timeout_micros) {
   // Set the higher 32 bits of traceme_context_id_counter_ to be the creation
   // time of the queue. This prevents the batches in different queues to have
   // the same traceme_context_id_counter_.
@@ -1028,6 +1095,91 @@ void Queue<TaskType>::PadOpenBatchWithLowPriorityTasks() {
   }
 }
 
+template <typename TaskType>
+void Queue<TaskType>::UpdateLatencySloTargets(size_t task_size) {
+  // The weight of the newest sample in the moving averages of the arrivals.
+  constexpr double kArrivalSmoothing = 0.05;
+  // The minimum time between two updates of the batch size and timeout.
+  constexpr uint64 kLatencySloUpdateIntervalMicros = 1000;
+
+  const uint64 now_micros = env_->NowMicros();
+  if (mean_task_size_ == 0) {
+    // This is the first task.
+    mean_task_size_ = task_size;
+  } else {
+    const double interarrival_micros =
+        now_micros > last_arrival_time_micros_
+            ? static_cast<double>(now_micros - last_arrival_time_micros_)
+            : 0.0;
+    mean_task_size_ +=
+        kArrivalSmoothing * (static_cast<double>(task_size) - mean_task_size_);
+    mean_interarrival_micros_ =
+        mean_interarrival_micros_ < 0
+            ? interarrival_micros
+            : mean_interarrival_micros_ +
+                  kArrivalSmoothing *
+                      (interarrival_micros - mean_interarrival_micros_);
+  }
+  last_arrival_time_micros_ = now_micros;
+
+  if (mean_interarrival_micros_ < 0 ||
+      (latency_slo_update_time_micros_ != 0 &&
+       now_micros < latency_slo_update_time_micros_ +
+                        kLatencySloUpdateIntervalMicros)) {
+    return;
+  }
+  const BatchLatencyModel& batch_latency =
+      options_.model_batch_stats->batch_latency();
+  if (!batch_latency.p99(1).has_value()) {
+    // No batch has been measured yet, so keep the configured options.
+    return;
+  }
+  latency_slo_update_time_micros_ = now_micros;
+
+  const double slo_micros = options_.latency_slo_micros;
+  auto p99_micros = [&batch_latency](size_t batch_size) {
+    return absl::ToDoubleMicroseconds(*batch_latency.p99(batch_size));
+  };
+  // Whether a batch of `batch_size` can fill up at the current arrival rate
+  // and then be processed within the target. Monotonic in `batch_size`.
+  auto meets_slo = [&](size_t batch_size) {
+    const double fill_micros =
+        batch_size / mean_task_size_ * mean_interarrival_micros_;
+    return fill_micros + p99_micros(batch_size) <= slo_micros;
+  };
+
+  // Pick the largest batch size that meets the target, or the smallest one if
+  // none does.
+  size_t batch_size;
+  if (!options_.allowed_batch_sizes.empty()) {
+    batch_size = options_.allowed_batch_sizes.front();
+    for (int32 allowed_batch_size : options_.allowed_batch_sizes) {
+      if (static_cast<size_t>(allowed_batch_size) >
+          max_execution_batch_size()) {
+        break;
+      }
+      if (!meets_slo(allowed_batch_size)) break;
+      batch_size = allowed_batch_size;
+    }
+  } else {
+    size_t lo = 1;
+    size_t hi = max_execution_batch_size();
+    while (lo < hi) {
+      const size_t mid = lo + (hi - lo + 1) / 2;
+      if (meets_slo(mid)) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    batch_size = lo;
+  }
+
+  latency_slo_batch_size_ = batch_size;
+  latency_slo_batch_timeout_micros_ = static_cast<int64_t>(
+      std::max(0.0, slo_micros - p99_micros(batch_size)));
+}
+
 template <typename TaskType>
 absl::Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
   const bool large_batch_splitting = options_.enable_large_batch_splitting;
@@ -1050,7 +1202,11 @@ absl::Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
       TF_RETURN_IF_ERROR(ValidateLowPriorityTaskQueueCapacity(**task));
       low_priority_tasks_.AddTask(std::move(*task), env_->NowMicros());
     } else {
+      const size_t task_size = (*task)->size();
       TF_RETURN_IF_ERROR(ScheduleWithoutOrEagerSplitImpl(task));
+      if (options_.latency_slo_micros > 0) {
+        UpdateLatencySloTargets(task_size);
+      }
     }
 
     // Check if the batch queue has a schedulable batch and mark it schedulable
@@ -1315,6 +1471,10 @@ void Queue<TaskType>::ProcessBatch(
       tsl::profiler::ContextType::kSharedBatchScheduler,
       batch->traceme_context_id());
 
+  if (options_.expired_task_callback) {
+    DropExpiredTasks(&batch, &padding_task);
+  }
+
   if (std::holds_alternative<ProcessBatchCallbackWithoutPaddingTasks>(
           process_batch_callback_)) {
     std::get<ProcessBatchCallbackWithoutPaddingTasks>(process_batch_callback_)(
@@ -1333,6 +1493,78 @@ void Queue<TaskType>::ProcessBatch(
   }
 }
 
+template <typename TaskType>
+void Queue<TaskType>::DropExpiredTasks(
+    std::unique_ptr<Batch<TaskType>>* batch,
+    std::vector<std::unique_ptr<TaskType>>* padding_task) {
+  size_t batch_size = (*batch)->size();
+  for (const auto& task : *padding_task) {
+    batch_size += task->size();
+  }
+  absl::Time done_time = absl::FromUnixMicros(env_->NowMicros());
+  if (options_.model_batch_stats != nullptr && batch_size > 0) {
+    std::optional<absl::Duration> latency =
+        options_.model_batch_stats->batch_latency().mean(batch_size);
+    if (latency.has_value()) done_time += *latency;
+  }
+  auto is_expired = [done_time](const TaskType& task) {
+    // The deadline is defined only when the task is a derived class of
+    // BatchTask.
+    if constexpr (std::is_base_of_v<BatchTask, TaskType>) {
+      std::optional<absl::Time> deadline = task.deadline();
+      return deadline.has_value() && *deadline < done_time;
+    }
+    return false;
+  };
+
+  bool has_expired_task = false;
+  for (int i = 0; i < (*batch)->num_tasks() && !has_expired_task; ++i) {
+    has_expired_task = is_expired((*batch)->task(i));
+  }
+  for (int i = 0; i < padding_task->size() && !has_expired_task; ++i) {
+    has_expired_task = is_expired(*(*padding_task)[i]);
+  }
+  if (!has_expired_task) return;
+
+  // Closed batches can't take tasks back, so rebuild the batch from the tasks
+  // that can still meet their deadline.
+  std::vector<std::unique_ptr<TaskType>> expired_tasks;
+  const uint64 start_time_micros =
+      (*batch)->EarliestTaskStartTime().value_or(0);
+  auto unexpired_batch =
+      std::make_unique<Batch<TaskType>>((*batch)->traceme_context_id());
+  for (std::unique_ptr<TaskType>& task : (*batch)->RemoveAllTasks()) {
+    if (is_expired(*task)) {
+      expired_tasks.push_back(std::move(task));
+    } else {
+      unexpired_batch->AddTask(std::move(task), start_time_micros);
+    }
+  }
+  std::vector<std::unique_ptr<TaskType>> unexpired_padding_task;
+  for (std::unique_ptr<TaskType>& task : *padding_task) {
+    if (is_expired(*task)) {
+      expired_tasks.push_back(std::move(task));
+    } else {
+      unexpired_padding_task.push_back(std::move(task));
+    }
+  }
+  if (unexpired_batch->empty()) {
+    // Callers skip empty batches, so let the padding tasks form the batch
+    // rather than leaving them unprocessed.
+    for (std::unique_ptr<TaskType>& task : unexpired_padding_task) {
+      unexpired_batch->AddTask(std::move(task), start_time_micros);
+    }
+    unexpired_padding_task.clear();
+  }
+  unexpired_batch->Close();
+  *batch = std::move(unexpired_batch);
+  *padding_task = std::move(unexpired_padding_task);
+
+  for (std::unique_ptr<TaskType>& task : expired_tasks) {
+    options_.expired_task_callback(std::move(task));
+  }
+}
+
 template <typename TaskType>
 bool Queue<TaskType>::IsEmpty() const {
   mutex_lock l(mu_);
@@ -1413,6 +1645,11 @@ Queue<TaskType>::PeekBatchPriorityImpl() const {
   size_t effective_batch_size = open_batch->size();
   uint64 effective_start_time_micros = open_batch_start_time_micros_;
   int64_t effective_batch_timeout_micros = options_.batch_timeout_micros;
+  size_t effective_max_batch_size = max_execution_batch_size();
+  if (options_.latency_slo_micros > 0) {
+    effective_batch_timeout_micros = latency_slo_batch_timeout_micros_;
+    effective_max_batch_size = latency_slo_batch_size_;
+  }
   if (effective_batch_size == 0) {
     // open_batch_start_time_micros_ is not valid for an empty batch.
     effective_start_time_micros = env_->NowMicros();
@@ -1441,7 +1678,7 @@ Queue<TaskType>::PeekBatchPriorityImpl() const {
   }
 
   bool schedulable = closed_ ||
-                     effective_batch_size >= max_execution_batch_size() ||
+                     effective_batch_size >= effective_max_batch_size ||
                      env_->NowMicros() >= effective_start_time_micros +
                                               effective_batch_timeout_micros;
 
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <tuple>
@@ -31,6 +32,7 @@ limitations under the License.
 #include "xla/tsl/lib/core/status_test_util.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
+#include "tensorflow/core/kernels/batching_util/batch_stats.h"
 #include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
 #include "tensorflow/core/kernels/batching_util/input_split_metadata.h"
 #include "tensorflow/core/lib/core/notification.h"
@@ -66,9 +68,14 @@ class FakeTask : public BatchTask {
     return criticality_;
   }
 
+  std::optional<absl::Time> deadline() const override { return deadline_; }
+
+  void set_deadline(absl::Time deadline) { deadline_ = deadline; }
+
  private:
   const size_t size_;
   const tsl::criticality::Criticality criticality_;
+  std::optional<absl::Time> deadline_;
 
   FakeTask(const FakeTask&) = delete;
   void operator=(const FakeTask&) = delete;
@@ -1094,6 +1101,155 @@ TEST_P(SharedBatchSchedulerTest, BatchPaddingPolicyBatchDown) {
   stop_teardown.Notify();
 }
 
+TEST_P(SharedBatchSchedulerTest, LatencySloPicksBatchSizeAndTimeout) {
+  // Set up a fake clock, which only advances when we explicitly tell it to.
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    // Batches take 100us plus 10us per task to process.
+    ModelBatchStats stats;
+    for (int batch_size = 10; batch_size <= 80; batch_size += 10) {
+      stats.batch_latency().Register(
+          batch_size, absl::Microseconds(100 + 10 * batch_size));
+    }
+
+    Notification first_batch_processed;
+    Notification second_batch_processed;
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      if (!first_batch_processed.HasBeenNotified()) {
+        // With a task every 10us, a batch of 45 tasks fills up in 450us and
+        // takes 550us to process, which is the largest batch that meets the
+        // target.
+        EXPECT_EQ(batch->size(), 45);
+        first_batch_processed.Notify();
+        return;
+      }
+      if (!second_batch_processed.HasBeenNotified()) {
+        EXPECT_EQ(batch->size(), 1);
+        second_batch_processed.Notify();
+        return;
+      }
+      ADD_FAILURE() << "Batch callback must not be invoked more than expected";
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+
+    QueueOptions options =
+        CreateQueueOptions(/* max_execution_batch_size= */ 100,
+                           /* input_batch_size_limit= */ 100,
+                           /* batch_timeout_micros= */ 1000 * 1000,
+                           /* max_enqueued_batches= */ 10);
+    options.latency_slo_micros = 1000;
+    options.model_batch_stats = &stats;
+
+    auto queue = CreateQueue(scheduler, options, callback);
+
+    // The batch becomes schedulable once it reaches the picked size, long
+    // before the configured timeout.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    for (int i = 1; i < 45; ++i) {
+      env.AdvanceByMicroseconds(10);
+      TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    }
+    first_batch_processed.WaitForNotification();
+
+    // A batch that does not fill up is scheduled once waiting longer would
+    // miss the target: 1000us minus the 550us it may take to process.
+    env.AdvanceByMicroseconds(10);
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    env.AdvanceByMicroseconds(449);
+    EXPECT_FALSE(second_batch_processed.WaitForNotificationWithTimeout(
+        absl::Milliseconds(10)));
+    env.AdvanceByMicroseconds(1);
+    second_batch_processed.WaitForNotification();
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST_P(SharedBatchSchedulerTest, DropsTasksThatCannotMeetTheirDeadline) {
+  // Set up a fake clock, which only advances when we explicitly tell it to.
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    // Batches of 10 take 200us to process.
+    ModelBatchStats stats;
+    stats.batch_latency().Register(10, absl::Microseconds(200));
+    stats.batch_latency().Register(10, absl::Microseconds(200));
+
+    mutex mu;
+    std::vector<size_t> expired_task_sizes;
+    Notification batch_processed;
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      EXPECT_EQ(batch->num_tasks(), 2);
+      EXPECT_EQ(batch->size(), 5);
+      {
+        mutex_lock l(mu);
+        EXPECT_THAT(expired_task_sizes, ::testing::UnorderedElementsAre(1, 4));
+      }
+      batch_processed.Notify();
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+
+    QueueOptions options =
+        CreateQueueOptions(/* max_execution_batch_size= */ 20,
+                           /* input_batch_size_limit= */ 20,
+                           /* batch_timeout_micros= */ 100,
+                           /* max_enqueued_batches= */ 1);
+    options.model_batch_stats = &stats;
+    options.expired_task_callback = [&](std::unique_ptr<FakeTask> task) {
+      mutex_lock l(mu);
+      expired_task_sizes.push_back(task->size());
+    };
+
+    auto queue = CreateQueue(scheduler, options, callback);
+
+    auto schedule_task = [&](size_t size, std::optional<int64_t> deadline) {
+      auto task = std::make_unique<FakeTask>(size);
+      if (deadline.has_value()) {
+        task->set_deadline(absl::FromUnixMicros(*deadline));
+      }
+      TF_ASSERT_OK(queue->Schedule(&task));
+    };
+    // The batch times out at 100us and is expected to be done at 300us.
+    schedule_task(1, /*deadline=*/250);
+    schedule_task(2, /*deadline=*/std::nullopt);
+    schedule_task(3, /*deadline=*/1000);
+    schedule_task(4, /*deadline=*/50);
+
+    env.AdvanceByMicroseconds(100);
+    batch_processed.WaitForNotification();
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST_P(SharedBatchSchedulerTest, LatencySloRequiresModelBatchStats) {
+  auto scheduler = CreateSharedBatchScheduler(1);
+  QueueOptions options =
+      CreateQueueOptions(/* max_execution_batch_size= */ 10,
+                         /* input_batch_size_limit= */ 10,
+                         /* batch_timeout_micros= */ 10,
+                         /* max_enqueued_batches= */ 10);
+  options.latency_slo_micros = 1000;
+  std::unique_ptr<Queue> queue;
+  EXPECT_THAT(
+      scheduler->AddQueue(
+          options, [](std::unique_ptr<Batch<FakeTask>> batch) {}, &queue),
+      testing::StatusIs(error::INVALID_ARGUMENT,
+                        HasSubstr("model_batch_stats must be specified")));
+}
+
 // TODO(b/161857471):
 // Add test coverage when input-split and no-split returns differently.
 INSTANTIATE_TEST_SUITE_P(Parameter, SharedBatchSchedulerTest,
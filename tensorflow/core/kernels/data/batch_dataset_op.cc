@@ -198,6 +198,12 @@ class BatchDatasetOp::Dataset : public DatasetBase {
 
     absl::Status Initialize(IteratorContext* ctx) override {
       tsl::mutex_lock l(mu_);
+      // Batches are only allocated before their elements are produced if the
+      // input is known to fill them, as `batch_size` may be chosen to batch
+      // the entire input.
+      const int64_t input_cardinality = dataset()->input_->Cardinality();
+      preallocate_batches_ = input_cardinality == kInfiniteCardinality ||
+                             input_cardinality >= dataset()->batch_size_;
       return dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_);
     }
 
@@ -205,15 +211,24 @@ class BatchDatasetOp::Dataset : public DatasetBase {
                                  std::vector<Tensor>* out_tensors,
                                  bool* end_of_sequence) override {
       // Each row of `batch_elements` is a tuple of tensors from the
-      // input iterator.
+      // input iterator. If batches are preallocated, the elements are instead
+      // copied into the batch by `batch_builder` as they are produced.
       std::vector<std::vector<Tensor>> batch_elements;
+      std::optional<BatchBuilder> batch_builder;
       {
         mutex_lock l(mu_);
         if (!input_impl_) {
           *end_of_sequence = true;
           return absl::OkStatus();
         }
-        batch_elements.reserve(dataset()->reserve_size_);
+        if (preallocate_batches_) {
+          batch_builder.emplace(AnyContext(ctx), dataset()->batch_size_,
+                                dataset()->parallel_copy_
+                                    ? BatchBuilder::CopyMode::kParallel
+                                    : BatchBuilder::CopyMode::kSynchronous);
+        } else {
+          batch_elements.reserve(dataset()->reserve_size_);
+        }
         *end_of_sequence = false;
         IteratorContextWithIndexMapper ctx_with_index_mapper(ctx, this);
         for (int i = 0; i < dataset()->batch_size_ && !*end_of_sequence; ++i) {
@@ -222,7 +237,11 @@ class BatchDatasetOp::Dataset : public DatasetBase {
                                                   &batch_element_tuple,
                                                   end_of_sequence));
           if (!*end_of_sequence) {
-            batch_elements.emplace_back(std::move(batch_element_tuple));
+            if (batch_builder) {
+              batch_builder->Add(std::move(batch_element_tuple));
+            } else {
+              batch_elements.emplace_back(std::move(batch_element_tuple));
+            }
           } else {
             input_impl_.reset();
           }
@@ -230,27 +249,29 @@ class BatchDatasetOp::Dataset : public DatasetBase {
         ctx_with_index_mapper.MergeCheckpoint();
       }
 
-      if (batch_elements.empty()) {
+      const int64_t num_elements = batch_builder
+                                       ? batch_builder->num_elements()
+                                       : batch_elements.size();
+      if (num_elements == 0) {
         DCHECK(*end_of_sequence);
         return absl::OkStatus();
       }
 
       if (dataset()->drop_remainder_ &&
-          batch_elements.size() < dataset()->batch_size_) {
+          num_elements < dataset()->batch_size_) {
         *end_of_sequence = true;
         return absl::OkStatus();
       }
 
-      // Copy the retrieved batch elements into one output tensor per tuple
-      // component.
-      //
-      // NOTE(mrry): If the input or output sizes are statically known, we
-      // could potentially read the input values in-place into their
-      // respective slice locations. This would require a different GetNext()
-      // overload that supports zero-copy, and might make sense in an
-      // optimization pass.
-      TF_RETURN_IF_ERROR(CopyBatch(AnyContext(ctx), std::move(batch_elements),
-                                   dataset()->parallel_copy_, out_tensors));
+      if (batch_builder) {
+        TF_RETURN_IF_ERROR(batch_builder->Finish(out_tensors));
+      } else {
+        // Copy the retrieved batch elements into one output tensor per tuple
+        // component.
+        TF_RETURN_IF_ERROR(CopyBatch(AnyContext(ctx),
+                                     std::move(batch_elements),
+                                     dataset()->parallel_copy_, out_tensors));
+      }
 
       *end_of_sequence = false;
       return absl::OkStatus();
@@ -322,6 +343,9 @@ class BatchDatasetOp::Dataset : public DatasetBase {
    private:
     mutex mu_;
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    // Whether batches are copied into by a `BatchBuilder` as their elements
+    // are produced.
+    bool preallocate_batches_ TF_GUARDED_BY(mu_) = false;
   };
 
   const int64_t batch_size_;
@@ -14,10 +14,13 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -52,6 +55,7 @@ namespace data {
 /* static */ constexpr const char* const CacheDatasetOp::kFileName;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const CacheDatasetOp::kMemoryBudget;
 
 namespace {
 
@@ -65,6 +69,8 @@ constexpr char kCurIndex[] = "cur_index";
 constexpr char kShardId[] = "shard_id";
 constexpr char kCreatedAt[] = "Created at";
 constexpr char kMemoryDatasetPrefix[] = "Memory";
+constexpr char kPartialMemoryDatasetPrefix[] = "PartialMemory";
+constexpr char kInputIndex[] = "input_index";
 constexpr char kMemoryCache[] = "MemoryCache";
 constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
@@ -1175,15 +1181,321 @@ class CacheDatasetOp::MemoryDatasetV2
   ResourceMgr* const resource_mgr_;  // Not owned.
 };
 
+// This version of memory dataset caches the longest prefix of its input that
+// fits within `memory_budget` bytes. Iterators read the cached prefix from
+// memory, and then continue reading the input from where the iterator that
+// filled the cache saved it, so that the cached elements are not computed
+// again.
+class CacheDatasetOp::PartialMemoryDataset : public DatasetBase {
+ public:
+  PartialMemoryDataset(OpKernelContext* ctx, const DatasetBase* input,
+                       int64_t memory_budget,
+                       std::optional<Tensor> resource_handle)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        memory_budget_(memory_budget),
+        cache_(std::make_shared<PartialMemoryCache>(memory_budget)),
+        resource_handle_(std::move(resource_handle)) {
+    input_->Ref();
+  }
+
+  ~PartialMemoryDataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    name_utils::IteratorPrefixParams params;
+    params.dataset_prefix = kPartialMemoryDatasetPrefix;
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix, params)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.dataset_prefix = kPartialMemoryDatasetPrefix;
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return input_->Cardinality(options);
+  }
+
+  absl::Status InputDatasets(
+      std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return absl::OkStatus();
+  }
+
+  absl::Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  absl::Status AsGraphDefInternal(SerializationContext* ctx,
+                                  DatasetGraphDefBuilder* b,
+                                  Node** output) const override {
+    Node* input_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
+    Node* filename_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(tstring(""), &filename_node));
+    std::vector<Node*> inputs = {input_node, filename_node};
+    if (resource_handle_.has_value()) {
+      Node* resource_handle_node = nullptr;
+      TF_RETURN_IF_ERROR(
+          b->AddTensor(*resource_handle_, &resource_handle_node));
+      inputs.push_back(resource_handle_node);
+    }
+    AttrValue memory_budget;
+    b->BuildAttrValue(memory_budget_, &memory_budget);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, inputs, {{kMemoryBudget, memory_budget}}, output));
+    return absl::OkStatus();
+  }
+
+ private:
+  // Reads the cached prefix from the cache if the rest of the input can be
+  // read without computing it again, i.e. if the whole dataset is cached or
+  // the input can be restored from the cache's resume point. Otherwise reads
+  // every element from the input, offering it to the cache.
+  class Iterator : public DatasetIterator<PartialMemoryDataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<PartialMemoryDataset>(params) {}
+
+    absl::Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      read_from_cache_ = CanReadFromCache();
+      return dataset()->input_->MakeIterator(ctx, this, prefix(),
+                                             &input_impl_);
+    }
+
+    absl::Status GetNextInternal(IteratorContext* ctx,
+                                 std::vector<Tensor>* out_tensors,
+                                 bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      PartialMemoryCache& cache = *dataset()->cache_;
+      *end_of_sequence = false;
+      if (read_from_cache_) {
+        if (cache.Lookup(index_, out_tensors)) {
+          ++index_;
+          return absl::OkStatus();
+        }
+        if (cache.IsCompleted()) {
+          *end_of_sequence = true;
+          return absl::OkStatus();
+        }
+      }
+      if (input_index_ < index_) {
+        bool resumed = false;
+        TF_RETURN_IF_ERROR(ResumeInput(ctx, out_tensors, &resumed));
+        if (resumed) {
+          return absl::OkStatus();
+        }
+        TF_RETURN_IF_ERROR(SkipInput(ctx, end_of_sequence));
+        if (*end_of_sequence) {
+          return absl::OkStatus();
+        }
+      }
+      TF_RETURN_IF_ERROR(
+          input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+      if (*end_of_sequence) {
+        cache.SetNumElements(input_index_);
+        return absl::OkStatus();
+      }
+      if (cache.Offer(index_, *out_tensors)) {
+        cache.SetResumePoint(SaveResumePoint(ctx, *out_tensors));
+      }
+      ++index_;
+      ++input_index_;
+      return absl::OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    absl::Status SaveInternal(SerializationContext* ctx,
+                              IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kIndex, index_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kInputIndex, input_index_));
+      return SaveInput(ctx, writer, input_impl_);
+    }
+
+    absl::Status RestoreInternal(IteratorContext* ctx,
+                                 IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kIndex, &index_));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kInputIndex, &input_index_));
+      read_from_cache_ = CanReadFromCache();
+      return RestoreInput(ctx, reader, input_impl_);
+    }
+
+   private:
+    bool CanReadFromCache() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      PartialMemoryCache& cache = *dataset()->cache_;
+      if (cache.IsCompleted()) {
+        return true;
+      }
+      std::shared_ptr<const PartialMemoryCache::ResumePoint> resume_point =
+          cache.resume_point();
+      return resume_point != nullptr &&
+             resume_point->iterator_prefix == prefix();
+    }
+
+    // Saves the state of `input_impl_`, which has just produced `element`, the
+    // first element that didn't fit into the cache. Returns nullptr if the
+    // state can't be saved, e.g. because the input depends on external state.
+    std::shared_ptr<const PartialMemoryCache::ResumePoint> SaveResumePoint(
+        IteratorContext* ctx, const std::vector<Tensor>& element)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      SerializationContext::Params params;
+      params.resource_mgr = ctx->resource_mgr();
+      params.external_state_policy = ExternalStatePolicy::POLICY_FAIL;
+      params.symbolic_checkpoint = ctx->symbolic_checkpoint();
+      SerializationContext serialization_ctx(params);
+      VariantTensorDataWriter writer;
+      absl::Status s = input_impl_->Save(&serialization_ctx, &writer);
+      if (!s.ok()) {
+        LOG(WARNING) << "The input of " << dataset()->DebugString()
+                     << " can't be saved, so only iterations that fit within "
+                        "the memory budget will read elements from the "
+                        "cache: "
+                     << s;
+        return nullptr;
+      }
+      auto resume_point = std::make_shared<PartialMemoryCache::ResumePoint>();
+      resume_point->iterator_prefix = prefix();
+      resume_point->element = element;
+      writer.ReleaseData(&resume_point->state);
+      return resume_point;
+    }
+
+    // Restores `input_impl_`, which hasn't been read while the cached prefix
+    // was, from the cache's resume point and returns the first element after
+    // the prefix in `out_tensors`. Sets `resumed` to false and leaves a new
+    // input iterator if that isn't possible.
+    absl::Status ResumeInput(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors, bool* resumed)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      PartialMemoryCache& cache = *dataset()->cache_;
+      std::shared_ptr<const PartialMemoryCache::ResumePoint> resume_point =
+          cache.resume_point();
+      *resumed = false;
+      if (resume_point == nullptr || input_index_ != 0 ||
+          index_ != cache.size() ||
+          resume_point->iterator_prefix != prefix()) {
+        return absl::OkStatus();
+      }
+      std::vector<const VariantTensorData*> data;
+      data.reserve(resume_point->state.size());
+      for (const auto& state : resume_point->state) {
+        data.push_back(state.get());
+      }
+      VariantTensorDataReader reader(data);
+      absl::Status s = RestoreInput(ctx, &reader, input_impl_);
+      if (!s.ok()) {
+        LOG(WARNING) << "Failed to restore the input of "
+                     << dataset()->DebugString()
+                     << " after the cached elements, which are therefore "
+                        "computed again: "
+                     << s;
+        return dataset()->input_->MakeIterator(ctx, this, prefix(),
+                                               &input_impl_);
+      }
+      *out_tensors = resume_point->element;
+      ++index_;
+      input_index_ = index_;
+      *resumed = true;
+      return absl::OkStatus();
+    }
+
+    // Skips `input_impl_` forward to `index_`. This computes the skipped
+    // elements again, and is only needed if the input couldn't be resumed.
+    absl::Status SkipInput(IteratorContext* ctx, bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (input_index_ < index_) {
+        const int num_to_skip = static_cast<int>(std::min<int64_t>(
+            index_ - input_index_, std::numeric_limits<int>::max()));
+        int num_skipped = 0;
+        TF_RETURN_IF_ERROR(input_impl_->Skip(ctx, num_to_skip,
+                                             end_of_sequence, &num_skipped));
+        input_index_ += num_skipped;
+        if (*end_of_sequence) {
+          dataset()->cache_->SetNumElements(input_index_);
+          return absl::OkStatus();
+        }
+      }
+      return absl::OkStatus();
+    }
+
+    mutex mu_;
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    // Index of the next element to return.
+    int64_t index_ TF_GUARDED_BY(mu_) = 0;
+    // Index of the next element of `input_impl_`.
+    int64_t input_index_ TF_GUARDED_BY(mu_) = 0;
+    // Whether the cached prefix is read from the cache rather than from the
+    // input.
+    bool read_from_cache_ TF_GUARDED_BY(mu_) = false;
+  };
+
+  const DatasetBase* const input_;
+  const int64_t memory_budget_;
+  const std::shared_ptr<PartialMemoryCache> cache_;
+  // The `cache` input of `CacheDatasetV2`, which this dataset doesn't use.
+  const std::optional<Tensor> resource_handle_;
+};
+
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kMemoryBudget, &memory_budget_));
+}
 
 void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                                  DatasetBase** output) {
   // Parse out the filenames tensor.
   tstring filename;
   OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, kFileName, &filename));
+  if (memory_budget_ > 0) {
+    OP_REQUIRES(ctx, filename.empty(),
+                errors::InvalidArgument(
+                    "A memory budget can only be used for caching in memory, "
+                    "but got filename ",
+                    filename, "."));
+    // Iterations after the first continue the input from a saved checkpoint
+    // after the cached prefix, which isn't possible for inputs that depend on
+    // external state. Their elements are then computed again in every
+    // iteration, and may differ from those of the first one.
+    absl::Status external_state = input->CheckExternalState();
+    if (!external_state.ok()) {
+      LOG(WARNING) << "The input of " << ctx->op_kernel().name()
+                   << " depends on external state, so unless it fits within "
+                      "the memory budget its elements aren't read from the "
+                      "cache: "
+                   << external_state;
+    }
+    std::optional<Tensor> resource_handle;
+    if (op_version_ == 2) {
+      resource_handle = ctx->input(2);
+    }
+    *output = new PartialMemoryDataset(ctx, input, memory_budget_,
+                                       std::move(resource_handle));
+    return;
+  }
   if (filename.empty()) {
     static std::atomic<int64_t> resource_id_counter(0);
     const string& container = ctx->resource_manager()->default_container();
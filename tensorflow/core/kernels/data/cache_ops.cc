@@ -14,6 +14,11 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -68,6 +73,67 @@ const std::vector<std::vector<Tensor>>& MemoryCache::data() {
   return cache_;
 }
 
+bool PartialMemoryCache::Offer(int64_t index,
+                               const std::vector<Tensor>& element) {
+  mutex_lock l(mu_);
+  // Only the element right after the cached prefix can extend it.
+  if (full_ || completed_ ||
+      index != static_cast<int64_t>(elements_.size())) {
+    return false;
+  }
+  const int64_t element_bytes = GetTotalBytes(element);
+  if (bytes_ + element_bytes > budget_bytes_) {
+    full_ = true;
+    return true;
+  }
+  elements_.push_back(element);
+  bytes_ += element_bytes;
+  return false;
+}
+
+void PartialMemoryCache::SetResumePoint(
+    std::shared_ptr<const ResumePoint> resume_point) {
+  mutex_lock l(mu_);
+  resume_point_ = std::move(resume_point);
+}
+
+std::shared_ptr<const PartialMemoryCache::ResumePoint>
+PartialMemoryCache::resume_point() {
+  tf_shared_lock l(mu_);
+  return resume_point_;
+}
+
+void PartialMemoryCache::SetNumElements(int64_t num_elements) {
+  mutex_lock l(mu_);
+  if (!full_ && num_elements == static_cast<int64_t>(elements_.size())) {
+    completed_ = true;
+  }
+}
+
+bool PartialMemoryCache::IsCompleted() {
+  tf_shared_lock l(mu_);
+  return completed_;
+}
+
+bool PartialMemoryCache::Lookup(int64_t index, std::vector<Tensor>* element) {
+  tf_shared_lock l(mu_);
+  if (index >= static_cast<int64_t>(elements_.size())) {
+    return false;
+  }
+  *element = elements_[index];
+  return true;
+}
+
+int64_t PartialMemoryCache::size() {
+  tf_shared_lock l(mu_);
+  return elements_.size();
+}
+
+int64_t PartialMemoryCache::bytes() {
+  tf_shared_lock l(mu_);
+  return bytes_;
+}
+
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
     OpKernelConstruction* ctx)
     : AnonymousResourceOp<MemoryCacheManager>(ctx,
@@ -16,8 +16,14 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/variant_tensor_data.h"
 
 namespace tensorflow {
 namespace data {
@@ -57,6 +63,77 @@ class MemoryCache {
   std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
 };
 
+// A thread-safe cache for the longest prefix of a dataset that fits within a
+// budget of bytes.
+//
+// Unlike `MemoryCache`, the cache is useful for datasets that don't fit in
+// memory. Elements are admitted in order, up to the first one that doesn't
+// fit, and are never evicted: a cache that evicted earlier elements to admit
+// later ones would, for a dataset read sequentially, evict every element
+// before it is read again.
+//
+// The iterator that produces the first element that doesn't fit records a
+// `ResumePoint`, so that later iterators can read the cached prefix from
+// memory and then continue reading the input where the prefix ends, without
+// computing the cached elements again.
+class PartialMemoryCache {
+ public:
+  // The state of an input iterator that has produced the cached prefix and the
+  // first element after it.
+  struct ResumePoint {
+    // The prefix of the iterator that saved its input. Only the input of an
+    // iterator with the same prefix can be restored from `state`.
+    std::string iterator_prefix;
+    // The first element that didn't fit into the cache.
+    std::vector<Tensor> element;
+    // The saved state of the input iterator.
+    std::vector<std::unique_ptr<VariantTensorData>> state;
+  };
+
+  explicit PartialMemoryCache(int64_t budget_bytes)
+      : budget_bytes_(budget_bytes) {}
+
+  // Offers `element`, the element at `index` read from the input, for caching.
+  // Returns true if `element` is the first element that doesn't fit, in which
+  // case the caller should record the state of its input with
+  // `SetResumePoint`.
+  bool Offer(int64_t index, const std::vector<Tensor>& element);
+
+  // Records the state of the input after the first element that doesn't fit,
+  // or nullptr if it couldn't be saved.
+  void SetResumePoint(std::shared_ptr<const ResumePoint> resume_point);
+
+  // Returns the recorded resume point, or nullptr if there is none.
+  std::shared_ptr<const ResumePoint> resume_point();
+
+  // Records that the dataset has `num_elements` elements, which is known once
+  // an iterator reached its end.
+  void SetNumElements(int64_t num_elements);
+
+  // Returns whether all elements of the dataset are cached.
+  bool IsCompleted();
+
+  // Looks up the element at `index`. If it is cached, stores it in `element`
+  // and returns true.
+  bool Lookup(int64_t index, std::vector<Tensor>* element);
+
+  // Returns the number of cached elements.
+  int64_t size();
+
+  // Returns the number of bytes of the cached elements.
+  int64_t bytes();
+
+ private:
+  const int64_t budget_bytes_;
+  mutex mu_;
+  std::vector<std::vector<Tensor>> elements_ TF_GUARDED_BY(mu_);
+  int64_t bytes_ TF_GUARDED_BY(mu_) = 0;
+  // Whether an element didn't fit into the cache.
+  bool full_ TF_GUARDED_BY(mu_) = false;
+  bool completed_ TF_GUARDED_BY(mu_) = false;
+  std::shared_ptr<const ResumePoint> resume_point_ TF_GUARDED_BY(mu_);
+};
+
 // A resource wrapping a shared instance of a memory cache.
 class MemoryCacheManager : public ResourceBase {
  public:
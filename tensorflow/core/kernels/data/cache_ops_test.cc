@@ -0,0 +1,105 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/cache_ops.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Returns an element of 8 bytes.
+std::vector<Tensor> Element(int64_t value) {
+  return {CreateTensor<int64_t>(TensorShape({}), {value})};
+}
+
+TEST(PartialMemoryCacheTest, OfferAndLookup) {
+  PartialMemoryCache cache(/*budget_bytes=*/64);
+  std::vector<Tensor> element;
+  EXPECT_FALSE(cache.Lookup(0, &element));
+  EXPECT_FALSE(cache.Offer(0, Element(10)));
+  ASSERT_TRUE(cache.Lookup(0, &element));
+  ASSERT_EQ(element.size(), 1);
+  EXPECT_EQ(element[0].scalar<int64_t>()(), 10);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.bytes(), 8);
+}
+
+TEST(PartialMemoryCacheTest, OnlyExtendsPrefix) {
+  PartialMemoryCache cache(/*budget_bytes=*/64);
+  EXPECT_FALSE(cache.Offer(1, Element(1)));
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_FALSE(cache.Offer(0, Element(0)));
+  EXPECT_FALSE(cache.Offer(0, Element(0)));
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(PartialMemoryCacheTest, HitsInSecondEpochOfLargerScan) {
+  // The budget fits 3 of 10 elements.
+  PartialMemoryCache cache(/*budget_bytes=*/24);
+  std::vector<Tensor> element;
+  int64_t num_full = 0;
+  for (int64_t i = 0; i < 10; ++i) {
+    EXPECT_FALSE(cache.Lookup(i, &element));
+    if (cache.Offer(i, Element(i))) {
+      ++num_full;
+      EXPECT_EQ(i, 3);
+    }
+  }
+  EXPECT_EQ(num_full, 1);
+  cache.SetNumElements(10);
+  EXPECT_FALSE(cache.IsCompleted());
+
+  // A second scan hits on the cached prefix instead of on nothing.
+  int64_t num_hits = 0;
+  for (int64_t i = 0; i < 10; ++i) {
+    if (cache.Lookup(i, &element)) {
+      ++num_hits;
+      EXPECT_EQ(element[0].scalar<int64_t>()(), i);
+    }
+    EXPECT_FALSE(cache.Offer(i, Element(i)));
+  }
+  EXPECT_EQ(num_hits, 3);
+  EXPECT_EQ(cache.bytes(), 24);
+}
+
+TEST(PartialMemoryCacheTest, Completed) {
+  PartialMemoryCache cache(/*budget_bytes=*/64);
+  cache.Offer(0, Element(0));
+  cache.Offer(1, Element(1));
+  EXPECT_FALSE(cache.IsCompleted());
+  cache.SetNumElements(2);
+  EXPECT_TRUE(cache.IsCompleted());
+}
+
+TEST(PartialMemoryCacheTest, ResumePoint) {
+  PartialMemoryCache cache(/*budget_bytes=*/8);
+  EXPECT_EQ(cache.resume_point(), nullptr);
+  auto resume_point = std::make_shared<PartialMemoryCache::ResumePoint>();
+  resume_point->iterator_prefix = "Iterator::Cache";
+  resume_point->element = Element(1);
+  cache.SetResumePoint(resume_point);
+  EXPECT_EQ(cache.resume_point(), resume_point);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
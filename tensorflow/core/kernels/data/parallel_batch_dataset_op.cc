@@ -17,6 +17,7 @@ limitations under the License.
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <utility>
 
 #include "tensorflow/core/common_runtime/function.h"
@@ -217,6 +218,15 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
           num_parallel_calls_->value = GetAutotuneDefaultParallelism(ctx);
         }
       }
+      // Batches are only allocated before their elements are produced if the
+      // input is known to fill them, as `batch_size` may be chosen to batch
+      // the entire input. Without `parallel_copy`, the whole batch is copied
+      // by a single closure off the thread that reads the input, so the
+      // elements are collected first.
+      const int64_t input_cardinality = dataset()->input_->Cardinality();
+      preallocate_batches_ = dataset()->parallel_copy_ &&
+                             (input_cardinality == kInfiniteCardinality ||
+                              input_cardinality >= dataset()->batch_size_);
       cancellation_manager_ = std::make_unique<CancellationManager>();
       TF_RETURN_IF_ERROR(RegisterCancellationCallback(
           ctx->cancellation_manager(),
@@ -388,9 +398,16 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
       }
 
       // Each row of `batch_elements` is a tuple of tensors from the input
-      // iterator.
+      // iterator. If batches are preallocated, the elements are instead copied
+      // into the batch by `batch_builder` as they are produced.
       std::vector<std::vector<Tensor>> batch_elements;
-      batch_elements.reserve(dataset()->reserve_size_);
+      std::optional<BatchBuilder> batch_builder;
+      if (preallocate_batches_) {
+        batch_builder.emplace(AnyContext(ctx.get()), dataset()->batch_size_,
+                              BatchBuilder::CopyMode::kParallel);
+      } else {
+        batch_elements.reserve(dataset()->reserve_size_);
+      }
 
       bool end_of_input = false;
       for (int i = 0; i < dataset()->batch_size_ && !end_of_input; ++i) {
@@ -405,7 +422,11 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
           if (result->end_of_input || !result->status.ok()) break;
         }
         if (!end_of_input) {
-          batch_elements.emplace_back(std::move(batch_element_tuple));
+          if (batch_builder) {
+            batch_builder->Add(std::move(batch_element_tuple));
+          } else {
+            batch_elements.emplace_back(std::move(batch_element_tuple));
+          }
           mutex_lock l(result->mu);
           result->num_elements++;
         } else {
@@ -413,11 +434,33 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
         }
       }
 
-      if (batch_elements.empty()) {
+      if (batch_builder ? batch_builder->num_elements() == 0
+                        : batch_elements.empty()) {
         CallCompleted(ctx, result);
         return;
       }
 
+      if (batch_builder) {
+        batch_builder->FinishAsync(
+            [this, ctx, result](absl::Status status,
+                                std::vector<Tensor> output) {
+              {
+                mutex_lock l(result->mu);
+                result->status.Update(status);
+                if (result->status.ok()) {
+                  result->output = std::move(output);
+                  result->output_allocated = true;
+                  RecordBufferEnqueue(ctx.get(), result->output);
+                } else {
+                  result->output.clear();
+                  result->output_allocated = false;
+                }
+              }
+              CallCompleted(ctx, result);
+            });
+        return;
+      }
+
       auto copy_elements_fn = [this, ctx, result,
                                batch_elements =
                                    std::move(batch_elements)]() mutable {
@@ -621,6 +664,9 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
     // Counts the number of outstanding calls for this batch.
     int64_t num_calls_ TF_GUARDED_BY(*mu_) = 0;
     std::unique_ptr<IteratorBase> input_impl_;
+    // Whether batches are copied into by a `BatchBuilder` as their elements
+    // are produced. Set by `Initialize()`, before the runner thread starts.
+    bool preallocate_batches_ = false;
     // Buffer for storing the (intermediate) batch results. Whenever a non-empty
     // batch result is added to or removed from `batch_results_`, call
     // `RecordBufferEnqueue` or `RecordBufferDequeue` respectively.
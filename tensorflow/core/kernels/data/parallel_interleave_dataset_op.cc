@@ -429,6 +429,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
         EnsureThreadsStarted(ctx);
         while (!cancelled_ && !Consume(ctx, &result)) {
           RecordStop(ctx);
+          const int64_t wait_start_nanos = EnvTime::NowNanos();
           if (deterministic_) {
             VLOG(3) << "Blocked waiting for element "
                     << current_elements_[cycle_index_]->id;
@@ -436,6 +437,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           } else {
             any_element_available_cond_var_.wait(l);
           }
+          RecordConsumerWait(ctx, wait_start_nanos);
           RecordStart(ctx);
         }
         if (cancelled_) {
@@ -981,7 +983,11 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
               break;
             }
             DecrementCurrentActiveWorkers();
+            // No element of the cycle needs processing, i.e. their buffers
+            // are full.
+            const int64_t wait_start_nanos = EnvTime::NowNanos();
             WaitWorkerThread(ctx.get(), &current_workers_cond_var_, &l);
+            RecordProducerWait(ctx.get(), wait_start_nanos);
             IncrementCurrentActiveWorkers();
           }
           if (cancelled_) {
@@ -325,7 +325,9 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
         EnsureThreadsStarted(ctx);
         while (ShouldWait(&result)) {
           RecordStop(ctx);
+          const int64_t wait_start_nanos = EnvTime::NowNanos();
           cond_var_->wait(l);
+          RecordConsumerWait(ctx, wait_start_nanos);
           RecordStart(ctx);
         }
         if (cancelled_) {
@@ -333,7 +335,9 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
         }
       }
       RecordStop(ctx);
+      const int64_t wait_start_nanos = EnvTime::NowNanos();
       result->notification.WaitForNotification();
+      RecordConsumerWait(ctx, wait_start_nanos);
       RecordStart(ctx);
       tsl::profiler::TraceMe traceme([&] {
         return tsl::profiler::TraceMeEncode("ParallelMapConsume",
@@ -658,7 +662,15 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
           mutex_lock l(*mu_);
           while (!cancelled_ && busy()) {
             RecordStop(ctx.get());
+            // Only waits for the consumer to take results count as producer
+            // wait time, not waits for one of the parallel calls to finish.
+            const bool waits_for_consumer =
+                num_calls_ < num_parallel_calls_->value;
+            const int64_t wait_start_nanos = EnvTime::NowNanos();
             cond_var_->wait(l);
+            if (waits_for_consumer) {
+              RecordProducerWait(ctx.get(), wait_start_nanos);
+            }
             RecordStart(ctx.get());
           }
           if (cancelled_) {
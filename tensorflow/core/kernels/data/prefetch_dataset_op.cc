@@ -218,7 +218,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
             buffer_size_->value = auto_tuner_->buffer_limit();
           }
           RecordStop(ctx);
+          const int64_t wait_start_nanos = EnvTime::NowNanos();
           cond_var_->wait(l);
+          RecordConsumerWait(ctx, wait_start_nanos);
           RecordStart(ctx);
         }
 
@@ -521,7 +523,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           mutex_lock l(*mu_);
           while (!cancelled_ && buffer_.size() >= buffer_limit()) {
             RecordStop(ctx.get());
+            const int64_t wait_start_nanos = EnvTime::NowNanos();
             cond_var_->wait(l);
+            RecordProducerWait(ctx.get(), wait_start_nanos);
             RecordStart(ctx.get());
           }
 
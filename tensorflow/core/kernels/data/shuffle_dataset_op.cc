@@ -28,12 +28,15 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/snapshot_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/compression.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
@@ -54,6 +57,8 @@ namespace data {
 /* static */ constexpr const char* const ShuffleDatasetOpBase::kOutputShapes;
 /* static */ constexpr const char* const
     ShuffleDatasetOpBase::kReshuffleEachIteration;
+/* static */ constexpr const char* const
+    ShuffleDatasetOpBase::kMemoryBudgetBytes;
 
 /* static */ constexpr const char* const ShuffleDatasetOp::kDatasetType;
 
@@ -63,6 +68,10 @@ namespace data {
 
 const int64_t kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64_t kMaxEpochsInBuffer = 3;
+// When spilling is enabled, the fraction of the memory budget that is set
+// aside for elements collected into the next spilled runs, across all epochs
+// in the buffer.
+const int64_t kSpillRunBudgetFraction = 8;
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kDataProduced[] = "data_produced";
@@ -75,6 +84,9 @@ constexpr char kSlicesEnd[] = "slices_end";
 constexpr char kSlicesReachedEndOfSequence[] = "slices_reached_end_of_sequence";
 constexpr char kSeedGenerator[] = "SeedGenerator";
 constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
+constexpr char kSlicesPending[] = "slices_pending";
+constexpr char kSlicesNumRuns[] = "slices_num_runs";
+constexpr char kSlicesRun[] = "slices_run";
 constexpr char kShuffleDatasetV1[] = "ShuffleDataset";
 constexpr char kShuffleDatasetV2[] = "ShuffleDatasetV2";
 constexpr char kShuffleDatasetV3[] = "ShuffleDatasetV3";
@@ -82,7 +94,109 @@ constexpr char kShuffleAndRepeatDatasetV1[] = "ShuffleAndRepeatDataset";
 constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
 
 ShuffleDatasetOpBase::ShuffleDatasetOpBase(OpKernelConstruction* ctx)
-    : UnaryDatasetOpKernel(ctx) {}
+    : UnaryDatasetOpKernel(ctx) {
+  if (ctx->HasAttr(kMemoryBudgetBytes)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+    OP_REQUIRES(ctx, memory_budget_bytes_ >= 0,
+                errors::InvalidArgument(
+                    "memory_budget_bytes must be greater than or equal to 0."));
+  }
+}
+
+namespace {
+
+// A run of shuffle buffer elements spilled to a compressed file in local
+// storage. Callers permute the elements before writing them, so reading the
+// run back in order yields a uniformly random choice among the elements that
+// remain in it. The file is deleted when the run is destroyed.
+class SpilledRun {
+ public:
+  static absl::Status Write(Env* env, const std::string& filename,
+                            const DataTypeVector& dtypes,
+                            const std::vector<std::vector<Tensor>>& elements,
+                            std::unique_ptr<SpilledRun>* run) {
+    std::vector<int64_t> element_bytes;
+    element_bytes.reserve(elements.size());
+    {
+      snapshot_util::TFRecordWriter writer(filename,
+                                           io::compression::kSnappy);
+      TF_RETURN_IF_ERROR(writer.Initialize(env));
+      for (const auto& element : elements) {
+        TF_RETURN_IF_ERROR(writer.WriteTensors(element));
+        element_bytes.push_back(GetAllocatedBytes(element));
+      }
+      TF_RETURN_IF_ERROR(writer.Close());
+    }
+    auto reader = std::make_unique<snapshot_util::TFRecordReader>(
+        filename, io::compression::kSnappy, dtypes);
+    TF_RETURN_IF_ERROR(reader->Initialize(env));
+    run->reset(new SpilledRun(env, filename, dtypes, std::move(reader),
+                              std::move(element_bytes)));
+    return absl::OkStatus();
+  }
+
+  ~SpilledRun() {
+    reader_.reset();
+    absl::Status s = env_->DeleteFile(filename_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete shuffle spill file " << filename_
+                   << ": " << s;
+    }
+  }
+
+  // Returns the number of elements that have not been read back yet.
+  int64_t size() const { return element_bytes_.size() - next_; }
+
+  // Returns the number of bytes of the elements that have not been read back
+  // yet, as they were accounted for in memory.
+  int64_t num_bytes() const { return num_bytes_; }
+
+  // Reads the next element of the run and returns its size in bytes.
+  absl::Status ReadNext(std::vector<Tensor>* element, int64_t* bytes) {
+    DCHECK_GT(size(), 0);
+    TF_RETURN_IF_ERROR(reader_->ReadTensors(element));
+    *bytes = element_bytes_[next_++];
+    num_bytes_ -= *bytes;
+    return absl::OkStatus();
+  }
+
+  // Reads the elements that have not been read back yet into `elements`,
+  // without consuming them.
+  absl::Status ReadRemaining(std::vector<std::vector<Tensor>>* elements) const {
+    snapshot_util::TFRecordReader reader(filename_, io::compression::kSnappy,
+                                         dtypes_);
+    TF_RETURN_IF_ERROR(reader.Initialize(env_));
+    TF_RETURN_IF_ERROR(reader.SkipRecords(next_));
+    elements->resize(size());
+    for (auto& element : *elements) {
+      TF_RETURN_IF_ERROR(reader.ReadTensors(&element));
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  SpilledRun(Env* env, std::string filename, const DataTypeVector& dtypes,
+             std::unique_ptr<snapshot_util::TFRecordReader> reader,
+             std::vector<int64_t> element_bytes)
+      : env_(env),
+        filename_(std::move(filename)),
+        dtypes_(dtypes),
+        reader_(std::move(reader)),
+        element_bytes_(std::move(element_bytes)),
+        num_bytes_(std::accumulate(element_bytes_.begin(),
+                                   element_bytes_.end(), int64_t{0})) {}
+
+  Env* const env_;
+  const std::string filename_;
+  const DataTypeVector dtypes_;
+  std::unique_ptr<snapshot_util::TFRecordReader> reader_;
+  const std::vector<int64_t> element_bytes_;
+  size_t next_ = 0;
+  int64_t num_bytes_;
+};
+
+}  // namespace
 
 // Abstract base dataset that implements a shuffling iterator.
 class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
@@ -90,12 +204,13 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   ShuffleDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
                      int64_t buffer_size,
                      std::shared_ptr<SeedGenerator> seed_generator,
-                     int64_t count)
+                     int64_t count, int64_t memory_budget_bytes = 0)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        memory_budget_bytes_(memory_budget_bytes),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
@@ -231,11 +346,19 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       DCHECK(!slices_.empty());
       // Choose an element to produce uniformly at random from the first
       // slice, and then remove the element from the slice.
+      const int64_t num_in_memory =
+          slices_.front()->end - slices_.front()->start;
       int64_t offset =
-          Random() % (slices_.front()->end - slices_.front()->start);
+          Random() % (num_in_memory + slices_.front()->num_spilled);
+      if (offset >= num_in_memory) {
+        return TakeSpilledElement(ctx, offset - num_in_memory, out_tensors);
+      }
       int64_t index = (slices_.front()->start + offset) % buffer_->size();
       *out_tensors = std::move(buffer_->at(index));
       this->RecordBufferDequeue(ctx, *out_tensors);
+      if (SpillEnabled()) {
+        memory_bytes_ -= GetAllocatedBytes(*out_tensors);
+      }
       std::swap(buffer_->at(index),
                 buffer_->at(slices_.front()->start % buffer_->size()));
       checkpoint_indices_.insert(index);
@@ -311,6 +434,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             prefix(),
             absl::StrJoin(std::make_tuple(kSlicesReachedEndOfSequence, i), "_"),
             static_cast<int64_t>(slices_[i]->reached_end_of_sequence)));
+        if (SpillEnabled()) {
+          TF_RETURN_IF_ERROR(SaveSpilledElements(writer, i, *slices_[i]));
+        }
       }
       if (data_produced_) {
         TF_RETURN_IF_ERROR(
@@ -368,13 +494,19 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           checkpoint_indices_.insert(i);
         }
       }
+      memory_bytes_ = 0;
       for (const auto& element : *buffer_) {
         RecordBufferEnqueue(ctx, element);
+        if (SpillEnabled()) {
+          memory_bytes_ += GetAllocatedBytes(element);
+        }
       }
       if (!IsShuffleAll()) {
         buffer_->resize(dataset()->buffer_size_);
       }
       slices_.clear();
+      num_spilled_ = 0;
+      pending_bytes_ = 0;
       for (size_t i = 0; i < slices_size; ++i) {
         int64_t start;
         TF_RETURN_IF_ERROR(reader->ReadScalar(
@@ -391,6 +523,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             &reached_end_of_sequence));
         slices_.push_back(std::make_unique<Slice>(
             start, end, static_cast<bool>(reached_end_of_sequence)));
+        if (SpillEnabled()) {
+          TF_RETURN_IF_ERROR(
+              RestoreSpilledElements(ctx, reader, i, *slices_.back()));
+        }
       }
       data_produced_ = reader->Contains(this->prefix(), kDataProduced);
 
@@ -407,15 +543,28 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     // When using `start` and `end` to index into `buffer_`, their values
     // should be taken modulo the size of `buffer_` as their absolute value
     // can be greater than the range of `buffer_`.
+    //
+    // When spilling is enabled, the elements of the epoch that did not fit in
+    // the memory budget are held outside of `buffer_`: first in `pending`,
+    // and once that has grown large enough, in a run in local storage.
     struct Slice {
       Slice(int64_t start, int64_t end, bool reached_end_of_sequence)
           : start(start),
             end(end),
             reached_end_of_sequence(reached_end_of_sequence) {}
 
+      // Returns the number of elements of the epoch left in the shuffle
+      // buffer.
+      int64_t size() const { return end - start + num_spilled; }
+
       int64_t start;
       int64_t end;
       bool reached_end_of_sequence = false;
+      // Elements waiting to be written out as the next spilled run.
+      std::vector<std::vector<Tensor>> pending;
+      std::vector<std::unique_ptr<SpilledRun>> runs;
+      // The number of elements in `pending` and `runs`.
+      int64_t num_spilled = 0;
     };
 
     random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
@@ -429,7 +578,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     // the slice that will serve the next GetNext() request has been exhausted.
     bool IsServingSliceComplete() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       for (auto& slice : slices_) {
-        if (slice->start != slice->end) {
+        if (slice->size() != 0) {
           return slice->reached_end_of_sequence;
         }
       }
@@ -440,6 +589,22 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return dataset()->buffer_size_ == kUnknownCardinality;
     }
 
+    bool SpillEnabled() const { return dataset()->memory_budget_bytes_ > 0; }
+
+    // Returns the number of bytes of the memory budget set aside for the
+    // `pending` elements of all slices.
+    int64_t SpillRunBytes() const {
+      return dataset()->memory_budget_bytes_ / kSpillRunBudgetFraction;
+    }
+
+    // Returns whether an element of the given size should be spilled instead
+    // of being stored in `buffer_`.
+    bool ShouldSpill(int64_t element_bytes) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return SpillEnabled() && memory_bytes_ + element_bytes >
+                                   dataset()->memory_budget_bytes_ -
+                                       SpillRunBytes();
+    }
+
     // Fills the shuffle buffer, preparing the buffer for sampling.
     absl::Status FillBuffer(IteratorContext* ctx)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -465,7 +630,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           slices_.back()->reached_end_of_sequence = true;
         }
         if (!end_of_input_sequence) {
-          AddToShuffleBuffer(ctx, std::move(input_element));
+          TF_RETURN_IF_ERROR(AddToShuffleBuffer(ctx, std::move(input_element)));
           continue;
         }
         input_impl_.reset();
@@ -522,7 +687,8 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return absl::OkStatus();
     }
 
-    void AddToShuffleBuffer(IteratorContext* ctx, std::vector<Tensor>&& element)
+    absl::Status AddToShuffleBuffer(IteratorContext* ctx,
+                                    std::vector<Tensor>&& element)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       data_produced_ = true;
       if (num_elements_ == 0) {
@@ -530,7 +696,14 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                 << BufferSizeString();
       }
       this->RecordBufferEnqueue(ctx, element);
-      if (num_elements_ == buffer_->size()) {
+      if (SpillEnabled()) {
+        const int64_t element_bytes = GetAllocatedBytes(element);
+        if (ShouldSpill(element_bytes)) {
+          return SpillElement(ctx, std::move(element), element_bytes);
+        }
+        memory_bytes_ += element_bytes;
+      }
+      if (num_elements_ - num_spilled_ == buffer_->size()) {
         DCHECK(IsShuffleAll());
         checkpoint_indices_.insert(buffer_->size());
         buffer_->push_back(element);
@@ -541,11 +714,193 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
       num_elements_++;
       slices_.back()->end++;
+      return absl::OkStatus();
+    }
+
+    // Adds `element` to the elements of the current epoch that are held
+    // outside of `buffer_`. Pending elements of all slices are written out as
+    // runs whenever they would exceed their share of the memory budget, so
+    // that `memory_bytes_` plus `pending_bytes_` stays within the budget.
+    absl::Status SpillElement(IteratorContext* ctx,
+                              std::vector<Tensor>&& element,
+                              int64_t element_bytes)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (pending_bytes_ + element_bytes > SpillRunBytes()) {
+        TF_RETURN_IF_ERROR(WritePendingRuns(ctx));
+      }
+      Slice& slice = *slices_.back();
+      slice.pending.push_back(std::move(element));
+      pending_bytes_ += element_bytes;
+      slice.num_spilled++;
+      num_spilled_++;
+      num_elements_++;
+      if (pending_bytes_ >= SpillRunBytes()) {
+        // A single element larger than the share goes straight to storage.
+        TF_RETURN_IF_ERROR(WritePendingRuns(ctx));
+      }
+      return absl::OkStatus();
+    }
+
+    // Writes out the `pending` elements of every slice as a new run of that
+    // slice.
+    absl::Status WritePendingRuns(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      for (auto& slice : slices_) {
+        if (!slice->pending.empty()) {
+          TF_RETURN_IF_ERROR(WritePendingRun(ctx, *slice));
+        }
+      }
+      pending_bytes_ = 0;
+      return absl::OkStatus();
+    }
+
+    absl::Status WritePendingRun(IteratorContext* ctx, Slice& slice)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      // Permute the run as it is written so that reading it back in order
+      // samples its elements uniformly at random.
+      for (int64_t i = slice.pending.size() - 1; i > 0; --i) {
+        std::swap(slice.pending[i], slice.pending[Random() % (i + 1)]);
+      }
+      std::string filename;
+      TF_RETURN_IF_ERROR(NewSpillFilename(ctx, &filename));
+      std::unique_ptr<SpilledRun> run;
+      TF_RETURN_IF_ERROR(SpilledRun::Write(ctx->env(), filename,
+                                           dataset()->output_dtypes(),
+                                           slice.pending, &run));
+      for (const auto& pending_element : slice.pending) {
+        this->RecordBufferDequeue(ctx, pending_element);
+      }
+      this->RecordBufferSpill(ctx, run->num_bytes());
+      VLOG(2) << "Spilled " << run->size() << " shuffle buffer elements ("
+              << run->num_bytes() << " bytes) to " << filename;
+      slice.runs.push_back(std::move(run));
+      slice.pending.clear();
+      return absl::OkStatus();
+    }
+
+    // Writes the spilled elements of the `index`-th slice to the checkpoint.
+    // The elements of each run are written in the order in which they will
+    // be read back, so that the restored iterator produces the same elements
+    // as the saved one.
+    absl::Status SaveSpilledElements(IteratorStateWriter* writer,
+                                     size_t index, const Slice& slice)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+          writer, absl::StrCat(prefix(), kColon, kSlicesPending, "_", index),
+          slice.pending));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          prefix(), absl::StrJoin(std::make_tuple(kSlicesNumRuns, index), "_"),
+          slice.runs.size()));
+      for (size_t j = 0; j < slice.runs.size(); ++j) {
+        std::vector<std::vector<Tensor>> elements;
+        TF_RETURN_IF_ERROR(slice.runs[j]->ReadRemaining(&elements));
+        TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+            writer,
+            absl::StrCat(prefix(), kColon, kSlicesRun, "_", index, "_", j),
+            elements));
+      }
+      return absl::OkStatus();
+    }
+
+    // Restores the spilled elements of the `index`-th slice, writing its runs
+    // back out to local storage.
+    absl::Status RestoreSpilledElements(IteratorContext* ctx,
+                                        IteratorStateReader* reader,
+                                        size_t index, Slice& slice)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+          ctx, reader,
+          absl::StrCat(prefix(), kColon, kSlicesPending, "_", index),
+          &slice.pending));
+      for (const auto& element : slice.pending) {
+        this->RecordBufferEnqueue(ctx, element);
+        pending_bytes_ += GetAllocatedBytes(element);
+      }
+      slice.num_spilled = slice.pending.size();
+      int64_t num_runs;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(
+          prefix(), absl::StrJoin(std::make_tuple(kSlicesNumRuns, index), "_"),
+          &num_runs));
+      for (int64_t j = 0; j < num_runs; ++j) {
+        std::vector<std::vector<Tensor>> elements;
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+            ctx, reader,
+            absl::StrCat(prefix(), kColon, kSlicesRun, "_", index, "_", j),
+            &elements));
+        std::string filename;
+        TF_RETURN_IF_ERROR(NewSpillFilename(ctx, &filename));
+        std::unique_ptr<SpilledRun> run;
+        TF_RETURN_IF_ERROR(SpilledRun::Write(
+            ctx->env(), filename, dataset()->output_dtypes(), elements, &run));
+        this->RecordBufferSpill(ctx, run->num_bytes());
+        slice.num_spilled += run->size();
+        slice.runs.push_back(std::move(run));
+      }
+      num_spilled_ += slice.num_spilled;
+      return absl::OkStatus();
+    }
+
+    // Removes the element at `offset` among the spilled elements of the first
+    // slice and returns it in `out_tensors`.
+    absl::Status TakeSpilledElement(IteratorContext* ctx, int64_t offset,
+                                    std::vector<Tensor>* out_tensors)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      Slice& slice = *slices_.front();
+      if (offset < static_cast<int64_t>(slice.pending.size())) {
+        *out_tensors = std::move(slice.pending[offset]);
+        std::swap(slice.pending[offset], slice.pending.back());
+        slice.pending.pop_back();
+        pending_bytes_ -= GetAllocatedBytes(*out_tensors);
+        this->RecordBufferDequeue(ctx, *out_tensors);
+      } else {
+        offset -= slice.pending.size();
+        auto it = slice.runs.begin();
+        while (offset >= (*it)->size()) {
+          offset -= (*it)->size();
+          ++it;
+        }
+        // Every remaining element of a run is equally likely to be next, so
+        // taking the next one is as good as taking the one at `offset`.
+        int64_t element_bytes;
+        TF_RETURN_IF_ERROR((*it)->ReadNext(out_tensors, &element_bytes));
+        this->RecordBufferSpill(ctx, -element_bytes);
+        if ((*it)->size() == 0) {
+          slice.runs.erase(it);
+        }
+      }
+      slice.num_spilled--;
+      num_spilled_--;
+      num_elements_--;
+      return absl::OkStatus();
+    }
+
+    absl::Status NewSpillFilename(IteratorContext* ctx, std::string* filename)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (spill_dir_.empty()) {
+        std::vector<std::string> dirs;
+        ctx->env()->GetLocalTempDirectories(&dirs);
+        if (dirs.empty()) {
+          return errors::FailedPrecondition(
+              "Cannot spill the shuffle buffer: no local temporary directory "
+              "is available.");
+        }
+        spill_dir_ = dirs[0];
+        TF_RETURN_IF_ERROR(ctx->env()->RecursivelyCreateDir(spill_dir_));
+      }
+      *filename = io::JoinPath(
+          spill_dir_,
+          absl::StrCat("tf_data_shuffle_", num_spill_files_++, "_"));
+      if (!ctx->env()->CreateUniqueFileName(filename, ".spill")) {
+        return errors::Internal(
+            "Failed to create a unique shuffle spill file name in ",
+            spill_dir_);
+      }
+      return absl::OkStatus();
     }
 
     void ClearEmptySlices() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       // Garbage collect all empty slices.
-      while (slices_.front()->start == slices_.front()->end) {
+      while (slices_.front()->size() == 0) {
         slices_.pop_front();
         // Reinitialize the RNG state for the next epoch.
         num_random_samples_ = 0;
@@ -581,6 +936,14 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         TF_GUARDED_BY(mu_);
     int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
+    // When spilling is enabled, the number of bytes of elements in `buffer_`.
+    int64_t memory_bytes_ TF_GUARDED_BY(mu_) = 0;
+    // The number of elements of all slices held outside of `buffer_`.
+    int64_t num_spilled_ TF_GUARDED_BY(mu_) = 0;
+    // The number of bytes of the `pending` elements of all slices.
+    int64_t pending_bytes_ TF_GUARDED_BY(mu_) = 0;
+    std::string spill_dir_ TF_GUARDED_BY(mu_);
+    int64_t num_spill_files_ TF_GUARDED_BY(mu_) = 0;
   };
 
   const DatasetBase* const input_;
@@ -590,6 +953,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  // If positive, the shuffle buffer keeps at most this many bytes of elements
+  // in memory and spills the rest to local storage.
+  const int64_t memory_budget_bytes_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
@@ -715,8 +1081,10 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
  public:
   DatasetV3(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
             int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            ResourceHandle&& resource_handle, bool owns_resource,
+            int64_t memory_budget_bytes)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           memory_budget_bytes),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -755,13 +1123,20 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
-    TF_RETURN_IF_ERROR(
-        b->AddDataset(this,
-                      {input_graph_node, buffer_size_node, seed_node,
-                       seed2_node, resource_handle_node},  // Inputs
-                      {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
-                      output));
+    std::vector<std::pair<StringPiece, AttrValue>> attrs = {
+        std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration)};
+    // Only serialize the spill budget when spilling is enabled, so that the
+    // graphs (and fingerprints) of existing pipelines stay unchanged.
+    if (memory_budget_bytes_ > 0) {
+      AttrValue memory_budget_bytes;
+      b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
+      attrs.emplace_back(kMemoryBudgetBytes, memory_budget_bytes);
+    }
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, buffer_size_node, seed_node, seed2_node,
+         resource_handle_node},  // Inputs
+        attrs, output));
     return absl::OkStatus();
   }
 
@@ -838,9 +1213,9 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     }
 
     // Ownership of manager is transferred onto `DatasetV3`.
-    *output = new ShuffleDatasetOp::DatasetV3(ctx, input, buffer_size, count,
-                                              std::move(seeds), manager,
-                                              std::move(handle), owns_resource);
+    *output = new ShuffleDatasetOp::DatasetV3(
+        ctx, input, buffer_size, count, std::move(seeds), manager,
+        std::move(handle), owns_resource, memory_budget_bytes_);
   } else if (op_version_ == 2) {
     auto handle = HandleFromInput(ctx, 2);
     SeedGeneratorManager* manager = nullptr;
@@ -965,8 +1340,10 @@ class ShuffleAndRepeatDatasetOp::DatasetV2 : public ShuffleDatasetBase {
  public:
   DatasetV2(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
             int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            ResourceHandle&& resource_handle, bool owns_resource,
+            int64_t memory_budget_bytes)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           memory_budget_bytes),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -1007,13 +1384,20 @@ class ShuffleAndRepeatDatasetOp::DatasetV2 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
-    TF_RETURN_IF_ERROR(
-        b->AddDataset(this,
-                      {input_graph_node, buffer_size_node, seed_node,
-                       seed2_node, count_node, resource_handle_node},  // Inputs
-                      {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
-                      output));
+    std::vector<std::pair<StringPiece, AttrValue>> attrs = {
+        std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration)};
+    // Only serialize the spill budget when spilling is enabled, so that the
+    // graphs (and fingerprints) of existing pipelines stay unchanged.
+    if (memory_budget_bytes_ > 0) {
+      AttrValue memory_budget_bytes;
+      b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
+      attrs.emplace_back(kMemoryBudgetBytes, memory_budget_bytes);
+    }
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, buffer_size_node, seed_node, seed2_node, count_node,
+         resource_handle_node},  // Inputs
+        attrs, output));
     return absl::OkStatus();
   }
 
@@ -1100,7 +1484,7 @@ void ShuffleAndRepeatDatasetOp::MakeDataset(OpKernelContext* ctx,
     // Ownership of manager is transferred onto `DatasetV2`.
     *output = new ShuffleAndRepeatDatasetOp::DatasetV2(
         ctx, input, buffer_size, count, std::move(seeds), manager,
-        std::move(handle), owns_resource);
+        std::move(handle), owns_resource, memory_budget_bytes_);
   } else {
     if (op_version_ != 1) {
       LOG(WARNING) << "Unsupported version of shuffle dataset op: "
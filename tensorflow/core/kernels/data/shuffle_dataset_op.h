@@ -30,11 +30,18 @@ class ShuffleDatasetOpBase : public UnaryDatasetOpKernel {
   static constexpr const char* const kOutputShapes = "output_shapes";
   static constexpr const char* const kReshuffleEachIteration =
       "reshuffle_each_iteration";
+  static constexpr const char* const kMemoryBudgetBytes =
+      "memory_budget_bytes";
 
   explicit ShuffleDatasetOpBase(OpKernelConstruction* ctx);
 
  protected:
   class ShuffleDatasetBase;
+
+  // If positive, the number of bytes of the shuffle buffer to keep in memory;
+  // elements beyond the budget are spilled to local storage. Only set by the
+  // ops that have the `memory_budget_bytes` attribute.
+  int64_t memory_budget_bytes_ = 0;
 };
 
 class ShuffleDatasetOp : public ShuffleDatasetOpBase {
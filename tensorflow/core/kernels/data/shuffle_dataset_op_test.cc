@@ -11,12 +11,17 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/node_def.pb.h"
 
 namespace tensorflow {
 namespace data {
@@ -90,7 +95,7 @@ class ShuffleDatasetParams : public DatasetParams {
 
   int64_t count() const { return count_; }
 
- private:
+ protected:
   int64_t buffer_size_;
   int64_t seed_;
   int64_t seed2_;
@@ -98,6 +103,53 @@ class ShuffleDatasetParams : public DatasetParams {
   bool reshuffle_each_iteration_;
 };
 
+// Parameters of a `ShuffleDatasetV3` op, which takes a seed generator resource
+// and a memory budget for its shuffle buffer.
+class ShuffleDatasetV3Params : public ShuffleDatasetParams {
+ public:
+  template <typename T>
+  ShuffleDatasetV3Params(T input_dataset_params, int64_t buffer_size,
+                         int64_t seed, int64_t seed2,
+                         bool reshuffle_each_iteration,
+                         int64_t memory_budget_bytes,
+                         DataTypeVector output_dtypes,
+                         std::vector<PartialTensorShape> output_shapes,
+                         string node_name)
+      : ShuffleDatasetParams(std::move(input_dataset_params), buffer_size,
+                             seed, seed2, /*count=*/1,
+                             reshuffle_each_iteration,
+                             std::move(output_dtypes),
+                             std::move(output_shapes), std::move(node_name)),
+        memory_budget_bytes_(memory_budget_bytes) {
+    op_version_ = 3;
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    std::vector<Tensor> input_tensors =
+        ShuffleDatasetParams::GetInputTensors();
+    Tensor seed_generator(DT_RESOURCE, TensorShape({}));
+    seed_generator.scalar<ResourceHandle>()() = ResourceHandle();
+    input_tensors.push_back(std::move(seed_generator));
+    return input_tensors;
+  }
+
+  absl::Status GetInputNames(std::vector<string>* input_names) const override {
+    TF_RETURN_IF_ERROR(ShuffleDatasetParams::GetInputNames(input_names));
+    input_names->emplace_back("seed_generator");
+    return absl::OkStatus();
+  }
+
+  absl::Status GetAttributes(AttributeVector* attr_vector) const override {
+    TF_RETURN_IF_ERROR(ShuffleDatasetParams::GetAttributes(attr_vector));
+    attr_vector->emplace_back(ShuffleDatasetOpBase::kMemoryBudgetBytes,
+                              memory_budget_bytes_);
+    return absl::OkStatus();
+  }
+
+ private:
+  int64_t memory_budget_bytes_;
+};
+
 class ShuffleDatasetOpTest : public DatasetOpsTestBase {};
 
 // Test case 1: test shuffle_dataset with reshuffle_each_iteration = false.
@@ -583,6 +635,113 @@ INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+// Test case: the memory budget only fits a fraction of the shuffle buffer, so
+// most elements are spilled to local storage before they are produced. The
+// bytes held in memory, including elements waiting to be spilled, stay within
+// the budget.
+TEST_F(ShuffleDatasetOpTest, SpillToLocalStorage) {
+  auto dataset_params =
+      ShuffleDatasetV3Params(RangeDatasetParams(0, 100, 1),
+                             /*buffer_size=*/100,
+                             /*seed=*/1,
+                             /*seed2=*/2,
+                             /*reshuffle_each_iteration=*/false,
+                             /*memory_budget_bytes=*/256,
+                             /*output_dtypes=*/{DT_INT64},
+                             /*output_shapes=*/{PartialTensorShape({})},
+                             /*node_name=*/kShuffleNodeName);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  // Iterators only record buffer and spill events on their model node, which
+  // exists for iterators with a parent in a modeled pipeline.
+  auto model = std::make_shared<model::Model>();
+  iterator_ctx_->SetModel(model);
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), iterator_.get(),
+                                      dataset_params.iterator_prefix(),
+                                      &iterator));
+  std::shared_ptr<model::Node> node = model->output();
+  ASSERT_NE(node, nullptr);
+
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  int64_t max_spilled_bytes = 0;
+  VariantTensorDataWriter writer;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    EXPECT_LE(node->buffered_bytes(), 256);
+    max_spilled_bytes = std::max(max_spilled_bytes, node->spilled_bytes());
+    if (out_tensors.size() == 1) {
+      // Checkpoint the iterator while most of its buffer is spilled.
+      EXPECT_GT(node->spilled_bytes(), 0);
+      TF_ASSERT_OK(iterator->Save(serialization_ctx.get(), &writer));
+    }
+  }
+  EXPECT_GT(max_spilled_bytes, 0);
+  EXPECT_EQ(node->spilled_bytes(), 0);
+
+  // The restored iterator produces the same elements as the saved one.
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator));
+  std::vector<Tensor> restored_tensors;
+  end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    restored_tensors.insert(restored_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(
+      restored_tensors,
+      std::vector<Tensor>(out_tensors.begin() + 1, out_tensors.end()),
+      /*compare_order=*/true));
+
+  std::vector<Tensor> expected_outputs;
+  for (int64_t i = 0; i < 100; ++i) {
+    expected_outputs.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/false));
+}
+
+// Test case: the spill budget is only serialized when spilling is enabled, so
+// the graphs of pipelines that do not spill are unchanged.
+TEST_F(ShuffleDatasetOpTest, MemoryBudgetBytesOnlySerializedWhenSet) {
+  for (int64_t memory_budget_bytes : {0, 256}) {
+    auto dataset_params =
+        ShuffleDatasetV3Params(RangeDatasetParams(0, 10, 1),
+                               /*buffer_size=*/3,
+                               /*seed=*/1,
+                               /*seed2=*/2,
+                               /*reshuffle_each_iteration=*/false,
+                               memory_budget_bytes,
+                               /*output_dtypes=*/{DT_INT64},
+                               /*output_shapes=*/{PartialTensorShape({})},
+                               /*node_name=*/kShuffleNodeName);
+    TF_ASSERT_OK(Initialize(dataset_params));
+    GraphDef graph_def;
+    TF_ASSERT_OK(AsGraphDef(
+        dataset_, SerializationContext(SerializationContext::Params{}),
+        &graph_def));
+    int num_shuffle_nodes = 0;
+    for (const NodeDef& node : graph_def.node()) {
+      if (node.op() != "ShuffleDatasetV3") continue;
+      ++num_shuffle_nodes;
+      EXPECT_EQ(node.attr().contains(ShuffleDatasetOpBase::kMemoryBudgetBytes),
+                memory_budget_bytes > 0);
+    }
+    EXPECT_EQ(num_shuffle_nodes, 1);
+  }
+}
+
 TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   std::vector<ShuffleDatasetParams> dataset_params_vec(
       {ShuffleDatasetParamsWithInvalidBufferSize(),
@@ -15,8 +15,11 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
 #include <cstdint>
+#include <string>
 
+#include "absl/status/status.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/queued_read_file.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -134,6 +137,21 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
     bool SymbolicCheckpointCompatible() const override { return true; }
 
+    absl::Status Initialize(IteratorContext* ctx) override {
+      if (ctx->options() == nullptr ||
+          ctx->options()->optional_read_queue_depth_case() ==
+              Options::OPTIONAL_READ_QUEUE_DEPTH_NOT_SET) {
+        return absl::OkStatus();
+      }
+      read_queue_depth_ = ctx->options()->read_queue_depth();
+      if (read_queue_depth_ <= 0 || read_queue_depth_ > kMaxReadQueueDepth) {
+        return errors::InvalidArgument(
+            "The `read_queue_depth` option must be in [1, ",
+            kMaxReadQueueDepth, "], got ", read_queue_depth_, ".");
+      }
+      return absl::OkStatus();
+    }
+
     absl::Status GetNextInternal(IteratorContext* ctx,
                                  std::vector<Tensor>* out_tensors,
                                  bool* end_of_sequence) override {
@@ -276,9 +294,8 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
           },
           tsl::profiler::kInfo);
 
-      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
-          TranslateFileName(dataset()->filenames_[current_file_index_]),
-          &file_));
+      TF_RETURN_IF_ERROR(OpenFileLocked(
+          env, TranslateFileName(dataset()->filenames_[current_file_index_])));
       reader_ = std::make_unique<io::SequentialRecordReader>(
           file_.get(), dataset()->options_);
       if (!dataset()->byte_offsets_.empty()) {
@@ -288,6 +305,24 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       return absl::OkStatus();
     }
 
+    // Opens `filename` into `file_`. Local files are read through a queued
+    // read file if the `read_queue_depth` option is set.
+    absl::Status OpenFileLocked(Env* env, const std::string& filename)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (read_queue_depth_ > 0) {
+        QueuedReadFileOptions options;
+        options.queue_depth = read_queue_depth_;
+        if (dataset()->options_.buffer_size > 0) {
+          options.block_size = dataset()->options_.buffer_size;
+        }
+        absl::Status s = NewQueuedReadFile(filename, options, &file_);
+        if (!absl::IsUnimplemented(s)) {
+          return s;
+        }
+      }
+      return env->NewRandomAccessFile(filename, &file_);
+    }
+
     // Resets all reader streams.
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       reader_.reset();
@@ -296,6 +331,9 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
     mutex mu_;
     size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
+    // Maximum number of reads in flight for local files, or 0 to read them
+    // through the file system's `RandomAccessFile`.
+    int64_t read_queue_depth_ = 0;
 
     // `reader_` will borrow the object that `file_` points to, so
     // we must destroy `reader_` before `file_`.
@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
@@ -100,5 +101,77 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+TEST_F(LookupOpsTest, MutableHashTable_LargeBatches) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTable")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_INT64)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  auto table_or = handle.GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.value();
+
+  // Large enough to be spread over the intra-op threads.  Every key is
+  // inserted twice and the later value must win.
+  constexpr int64_t kNumKeys = 1 << 16;
+  Tensor keys(DT_INT64, TensorShape({2 * kNumKeys}));
+  Tensor values(DT_INT64, TensorShape({2 * kNumKeys}));
+  for (int64_t i = 0; i < 2 * kNumKeys; ++i) {
+    keys.vec<int64_t>()(i) = (i % kNumKeys) * 7;
+    values.vec<int64_t>()(i) = i;
+  }
+  TF_ASSERT_OK(table->Insert(context_.get(), keys, values));
+  EXPECT_EQ(table->size(), size_t{kNumKeys});
+
+  Tensor lookup_keys(DT_INT64, TensorShape({kNumKeys + 1}));
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    lookup_keys.vec<int64_t>()(i) = i * 7;
+  }
+  lookup_keys.vec<int64_t>()(kNumKeys) = -1;
+  Tensor found(DT_INT64, TensorShape({kNumKeys + 1}));
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &found,
+                           test::AsScalar<int64_t>(-5)));
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(found.vec<int64_t>()(i), kNumKeys + i);
+  }
+  EXPECT_EQ(found.vec<int64_t>()(kNumKeys), -5);
+
+  Tensor remove_keys(DT_INT64, TensorShape({kNumKeys / 2}));
+  for (int64_t i = 0; i < kNumKeys / 2; ++i) {
+    remove_keys.vec<int64_t>()(i) = i * 7;
+  }
+  TF_ASSERT_OK(table->Remove(context_.get(), remove_keys));
+  EXPECT_EQ(table->size(), size_t{kNumKeys / 2});
+}
+
+TEST_F(LookupOpsTest, MutableHashTable_SmallBatches) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTable")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_INT64)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  auto table_or = handle.GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.value();
+
+  // Small batches lock the shard of each key in turn; the later value of a
+  // duplicate key must still win.
+  TF_ASSERT_OK(table->Insert(context_.get(), test::AsTensor<int64_t>({3, 5, 3}),
+                             test::AsTensor<int64_t>({1, 2, 3})));
+  EXPECT_EQ(table->size(), size_t{2});
+
+  Tensor found(DT_INT64, TensorShape({3}));
+  TF_ASSERT_OK(table->Find(context_.get(), test::AsTensor<int64_t>({3, 5, 9}),
+                           &found, test::AsScalar<int64_t>(-5)));
+  test::ExpectTensorEqual<int64_t>(found, test::AsTensor<int64_t>({3, 2, -5}));
+
+  TF_ASSERT_OK(table->Remove(context_.get(), test::AsTensor<int64_t>({5})));
+  EXPECT_EQ(table->size(), size_t{1});
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -16,10 +16,15 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "absl/types/span.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
@@ -36,11 +41,232 @@ std::string UniqueNodeName(const std::string& base) {
   return strings::StrCat(base, "/", counter.fetch_add(1), "/", random::New64());
 }
 
-// Lookup table that wraps an unordered_map, where the key and value data type
-// is specified. Each individual value must be a scalar. If vector values are
-// required, use MutableHashTableOfTensors.
+// A hash map split into independently locked shards, so that concurrent
+// lookups and updates of different keys rarely contend on the same lock.
+// Small batches lock the shard of each key in turn.  Larger batches group the
+// keys by shard first and then take every shard lock once, spreading large
+// batches over the intra-op threads.
+template <class K, class V>
+class ShardedHashMap {
+ public:
+  using Map = std::unordered_map<K, V>;
+
+  // Creates a map with one shard per intra-op thread of the device of `ctx`,
+  // rounded up to a power of two and capped at 2^`kMaxNumShardBits`, so that
+  // tables on small hosts do not pay for locks they cannot contend on.
+  explicit ShardedHashMap(OpKernelContext* ctx) {
+    const DeviceBase::CpuWorkerThreads* worker_threads =
+        ctx != nullptr ? ctx->device()->tensorflow_cpu_worker_threads()
+                       : nullptr;
+    const int num_threads =
+        worker_threads != nullptr ? worker_threads->num_threads : 1;
+    while (num_shard_bits_ < kMaxNumShardBits &&
+           (1 << num_shard_bits_) < num_threads) {
+      ++num_shard_bits_;
+    }
+    num_shards_ = 1 << num_shard_bits_;
+    shards_ = std::make_unique<Shard[]>(num_shards_);
+  }
+
+  size_t size() const {
+    size_t size = 0;
+    for (const Shard& shard : shards()) {
+      tf_shared_lock l(shard.mu);
+      size += shard.map.size();
+    }
+    return size;
+  }
+
+  // Calls `fn(&map, key, i)` for every index `i` of `keys`, where `key` is
+  // `keys(i)` and `map` is its shard, holding the shard lock exclusively if
+  // `exclusive` is true and shared otherwise.  The indices of a shard are
+  // visited in increasing order, so the last duplicate of a key wins.
+  template <typename KeyFlat, typename Fn>
+  void ForEachKey(OpKernelContext* ctx, const KeyFlat& keys, bool exclusive,
+                  Fn fn) {
+    const int64_t n = keys.size();
+    if (n <= kMaxPerKeyBatchSize || num_shards_ == 1) {
+      // Not worth grouping: visit the keys in order, locking the shard of
+      // each one.
+      for (int64_t i = 0; i < n; ++i) {
+        // Integral keys are read once, as with SubtleMustCopyIfIntegral, so
+        // that a key changing concurrently in the input cannot be looked up in
+        // another shard than the one locked for it.
+        if constexpr (std::is_integral_v<K>) {
+          WithShardLock(SubtleMustCopyIfIntegral(keys(i)), i, exclusive, fn);
+        } else {
+          WithShardLock(keys(i), i, exclusive, fn);
+        }
+      }
+      return;
+    }
+
+    std::vector<K> copied_keys;
+    if constexpr (std::is_integral_v<K>) {
+      copied_keys.resize(n);
+      for (int64_t i = 0; i < n; ++i) {
+        copied_keys[i] = SubtleMustCopyIfIntegral(keys(i));
+      }
+    }
+    auto key_at = [&](int64_t i) -> const K& {
+      if constexpr (std::is_integral_v<K>) {
+        return copied_keys[i];
+      } else {
+        return keys(i);
+      }
+    };
+
+    // Orders the indices by shard with a counting sort.
+    std::vector<uint8> shard_ids(n);
+    std::vector<int64_t> offsets(num_shards_ + 1);
+    for (int64_t i = 0; i < n; ++i) {
+      shard_ids[i] = ShardOf(key_at(i));
+      ++offsets[shard_ids[i] + 1];
+    }
+    for (int s = 0; s < num_shards_; ++s) {
+      offsets[s + 1] += offsets[s];
+    }
+    std::vector<int64_t> order(n);
+    std::vector<int64_t> next(offsets.begin(), offsets.end() - 1);
+    for (int64_t i = 0; i < n; ++i) {
+      order[next[shard_ids[i]]++] = i;
+    }
+
+    auto process_shards = [&](int64_t start, int64_t limit) {
+      for (int64_t s = start; s < limit; ++s) {
+        if (offsets[s] == offsets[s + 1]) continue;
+        Shard& shard = shards_[s];
+        // Called with the shard lock held.
+        auto process = [&]() TF_NO_THREAD_SAFETY_ANALYSIS {
+          for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+            fn(&shard.map, key_at(order[j]), order[j]);
+          }
+        };
+        if (exclusive) {
+          mutex_lock l(shard.mu);
+          process();
+        } else {
+          tf_shared_lock l(shard.mu);
+          process();
+        }
+      }
+    };
+    const DeviceBase::CpuWorkerThreads* worker_threads =
+        ctx != nullptr ? ctx->device()->tensorflow_cpu_worker_threads()
+                       : nullptr;
+    if (worker_threads != nullptr && n >= kMinParallelBatchSize) {
+      worker_threads->workers->ParallelFor(
+          num_shards_, kCostPerKey * (n / num_shards_), process_shards);
+    } else {
+      process_shards(0, num_shards_);
+    }
+  }
+
+  // Replaces the contents of the table, calling `fn(&map, key, i)` for every
+  // index `i` of `keys` as in `ForEachKey`.  All shards stay locked, so that
+  // no reader sees a partially replaced table.
+  template <typename KeyFlat, typename Fn>
+  void Assign(const KeyFlat& keys, Fn fn) TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (Shard& shard : shards()) {
+      shard.mu.lock();
+      shard.map.clear();
+    }
+    for (int64_t i = 0; i < keys.size(); ++i) {
+      const K key = SubtleMustCopyIfIntegral(keys(i));
+      fn(&shards_[ShardOf(key)].map, key, i);
+    }
+    for (Shard& shard : shards()) {
+      shard.mu.unlock();
+    }
+  }
+
+  // Calls `fn(size, for_each_entry)` holding shared locks on all shards, for
+  // operations that need a consistent view of the table.
+  // `for_each_entry(visit)` calls `visit(key, value)` for every entry.
+  template <typename Fn>
+  auto WithAllShards(Fn fn) const TF_NO_THREAD_SAFETY_ANALYSIS {
+    size_t size = 0;
+    for (const Shard& shard : shards()) {
+      shard.mu.lock_shared();
+      size += shard.map.size();
+    }
+    auto for_each_entry = [this](auto visit) TF_NO_THREAD_SAFETY_ANALYSIS {
+      for (const Shard& shard : shards()) {
+        for (const auto& it : shard.map) {
+          visit(it.first, it.second);
+        }
+      }
+    };
+    auto result = fn(static_cast<int64_t>(size), for_each_entry);
+    for (const Shard& shard : shards()) {
+      shard.mu.unlock_shared();
+    }
+    return result;
+  }
+
+  // Calls `fn(map)` for every shard, each under its shared lock.
+  template <typename Fn>
+  void ForEachShard(Fn fn) const {
+    for (const Shard& shard : shards()) {
+      tf_shared_lock l(shard.mu);
+      fn(shard.map);
+    }
+  }
+
+ private:
+  static constexpr int kMaxNumShardBits = 6;
+  // Batches with at most this many keys lock the shard of each key in turn.
+  static constexpr int64_t kMaxPerKeyBatchSize = 16;
+  // Batches with fewer keys are processed on the calling thread.
+  static constexpr int64_t kMinParallelBatchSize = 1 << 14;
+  static constexpr int64_t kCostPerKey = 500;
+
+  struct Shard {
+    mutable mutex mu;
+    Map map TF_GUARDED_BY(mu);
+  };
+
+  absl::Span<Shard> shards() {
+    return {shards_.get(), static_cast<size_t>(num_shards_)};
+  }
+  absl::Span<const Shard> shards() const {
+    return {shards_.get(), static_cast<size_t>(num_shards_)};
+  }
+
+  // Calls `fn(&map, key, i)` holding the lock of the shard of `key`.
+  template <typename Fn>
+  void WithShardLock(const K& key, int64_t i, bool exclusive, Fn& fn) {
+    Shard& shard = shards_[ShardOf(key)];
+    if (exclusive) {
+      mutex_lock l(shard.mu);
+      fn(&shard.map, key, i);
+    } else {
+      tf_shared_lock l(shard.mu);
+      fn(&shard.map, key, i);
+    }
+  }
+
+  // The map hash is not necessarily mixed (e.g. for integers), and it also
+  // picks the bucket within the shard, so scramble it and use the top bits.
+  int ShardOf(const K& key) const {
+    if (num_shard_bits_ == 0) return 0;
+    const uint64 h = static_cast<uint64>(typename Map::hasher()(key)) *
+                     uint64{0x9E3779B97F4A7C15};
+    return static_cast<int>(h >> (64 - num_shard_bits_));
+  }
+
+  int num_shard_bits_ = 0;
+  int num_shards_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// Lookup table that wraps a sharded unordered_map, where the key and value
+// data type is specified. Each individual value must be a scalar. If vector
+// values are required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// Keys are spread over independently locked shards, so concurrent Find and
+// Insert calls only contend when they touch the same shard.
 //
 // Sample use case:
 //
@@ -53,12 +279,10 @@ std::string UniqueNodeName(const std::string& base) {
 template <class K, class V>
 class MutableHashTableOfScalars final : public LookupInterface {
  public:
-  MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
+  MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel)
+      : table_(ctx) {}
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   absl::Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
                     const Tensor& default_value) override {
@@ -70,69 +294,69 @@ class MutableHashTableOfScalars final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      // is_full_size_default is true:
-      //   Each key has an independent default value, key_values(i)
-      //   corresponding uses default_flat(i) as its default value.
-      //
-      // is_full_size_default is false:
-      //   All keys will share the default_flat(0) as default value.
-      value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyIfIntegral(key_values(i)),
-          is_full_size_default ? default_flat(i) : default_flat(0));
-    }
+    table_.ForEachKey(
+        ctx, key_values, /*exclusive=*/false,
+        [&](const Map* map, const K& k, int64_t i) {
+          // is_full_size_default is true:
+          //   Each key has an independent default value, key_values(i)
+          //   corresponding uses default_flat(i) as its default value.
+          //
+          // is_full_size_default is false:
+          //   All keys will share the default_flat(0) as default value.
+          value_values(i) = gtl::FindWithDefault(
+              *map, k,
+              is_full_size_default ? default_flat(i) : default_flat(0));
+        });
 
     return absl::OkStatus();
   }
 
-  absl::Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+  absl::Status DoInsert(OpKernelContext* ctx, bool clear, const Tensor& keys,
+                        const Tensor& values) {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
+    auto insert = [&](Map* map, const K& k, int64_t i) {
+      gtl::InsertOrUpdate(map, k, SubtleMustCopyIfIntegral(value_values(i)));
+    };
     if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          SubtleMustCopyIfIntegral(value_values(i)));
+      table_.Assign(key_values, insert);
+    } else {
+      table_.ForEachKey(ctx, key_values, /*exclusive=*/true, insert);
     }
     return absl::OkStatus();
   }
 
   absl::Status Insert(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override {
-    return DoInsert(false, keys, values);
+    return DoInsert(ctx, false, keys, values);
   }
 
   absl::Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.ForEachKey(ctx, key_values, /*exclusive=*/true,
+                      [](Map* map, const K& k, int64_t i) { map->erase(k); });
     return absl::OkStatus();
   }
 
   absl::Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                             const Tensor& values) override {
-    return DoInsert(true, keys, values);
+    return DoInsert(ctx, true, keys, values);
   }
 
   absl::Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("values", TensorShape({size}), &values));
-    ExportKeysAndValues(keys, values);
-    return absl::OkStatus();
+    return table_.WithAllShards(
+        [&](int64_t size, const auto& for_each_entry) -> absl::Status {
+          Tensor* keys;
+          Tensor* values;
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("keys", TensorShape({size}), &keys));
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("values", TensorShape({size}), &values));
+          ExportKeysAndValues(for_each_entry, keys, values);
+          return absl::OkStatus();
+        });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -145,24 +369,28 @@ class MutableHashTableOfScalars final : public LookupInterface {
 
   int64_t MemoryUsed() const override {
     int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
+    table_.ForEachShard([&ret](const Map& map) {
+      for (unsigned i = 0; i < map.bucket_count(); ++i) {
+        size_t bucket_size = map.bucket_size(i);
+        if (bucket_size == 0) {
+          ret++;
+        } else {
+          ret += bucket_size;
+        }
       }
-    }
+    });
     return sizeof(MutableHashTableOfScalars) + ret;
   }
 
   absl::Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    table_.WithAllShards([&](int64_t size, const auto& for_each_entry) {
+      keys = Tensor(key_dtype(), TensorShape({size}));
+      values = Tensor(value_dtype(), TensorShape({size}));
+      ExportKeysAndValues(for_each_entry, &keys, &values);
+      return true;
+    });
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableV2 kernel. This means that the lifetime
@@ -195,29 +423,33 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  using Map = typename ShardedHashMap<K, V>::Map;
+
+  // Writes all entries visited by `for_each_entry` into `keys` and `values`,
+  // which must point to tensors of the table size.
+  template <typename ForEachEntry>
+  static void ExportKeysAndValues(const ForEachEntry& for_each_entry,
+                                  Tensor* keys, Tensor* values) {
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
-    }
+    for_each_entry([&](const K& key, const V& value) {
+      keys_data(i) = key;
+      values_data(i) = value;
+      ++i;
+    });
   }
 
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, V> table_;
 };
 
-// Lookup table that wraps an unordered_map. Behaves identical to
+// Lookup table that wraps a sharded unordered_map. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
 template <class K, class V>
 class MutableHashTableOfTensors final : public LookupInterface {
  public:
-  MutableHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel) {
+  MutableHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel)
+      : table_(ctx) {
     OP_REQUIRES_OK(ctx,
                    GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
     OP_REQUIRES(
@@ -226,10 +458,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
                                 value_shape_.DebugString()));
   }
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   absl::Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
                     const Tensor& default_value) override {
@@ -242,85 +471,84 @@ class MutableHashTableOfTensors final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec =
-          gtl::FindOrNull(table_, SubtleMustCopyIfIntegral(key_values(i)));
-      if (value_vec != nullptr) {
-        for (int64_t j = 0; j < value_dim; j++) {
-          value_values(i, j) = value_vec->at(j);
-        }
-      } else {
-        // is_full_size_default is true:
-        //   Each key has an independent default value, key_values(i)
-        //   corresponding uses default_flat(i) as its default value.
-        //
-        // is_full_size_default is false:
-        //   All keys will share the default_flat(0) as default value.
-        for (int64_t j = 0; j < value_dim; j++) {
-          value_values(i, j) =
-              is_full_size_default ? default_flat(i, j) : default_flat(0, j);
-        }
-      }
-    }
+    table_.ForEachKey(
+        ctx, key_values, /*exclusive=*/false,
+        [&](const Map* map, const K& k, int64_t i) {
+          const ValueArray* value_vec = gtl::FindOrNull(*map, k);
+          if (value_vec != nullptr) {
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(i, j) = value_vec->at(j);
+            }
+          } else {
+            // is_full_size_default is true:
+            //   Each key has an independent default value, key_values(i)
+            //   corresponding uses default_flat(i) as its default value.
+            //
+            // is_full_size_default is false:
+            //   All keys will share the default_flat(0) as default value.
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(i, j) = is_full_size_default ? default_flat(i, j)
+                                                        : default_flat(0, j);
+            }
+          }
+        });
 
     return absl::OkStatus();
   }
 
-  absl::Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+  absl::Status DoInsert(OpKernelContext* ctx, bool clear, const Tensor& keys,
+                        const Tensor& values) {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64_t value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
+    auto insert = [&](Map* map, const K& k, int64_t i) {
       ValueArray value_vec;
       for (int64_t j = 0; j < value_dim; j++) {
         V value = value_values(i, j);
         value_vec.push_back(value);
       }
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          value_vec);
+      gtl::InsertOrUpdate(map, k, value_vec);
+    };
+    if (clear) {
+      table_.Assign(key_values, insert);
+    } else {
+      table_.ForEachKey(ctx, key_values, /*exclusive=*/true, insert);
     }
     return absl::OkStatus();
   }
 
   absl::Status Insert(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override {
-    return DoInsert(false, keys, values);
+    return DoInsert(ctx, false, keys, values);
   }
 
   absl::Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.ForEachKey(ctx, key_values, /*exclusive=*/true,
+                      [](Map* map, const K& k, int64_t i) { map->erase(k); });
     return absl::OkStatus();
   }
 
   absl::Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                             const Tensor& values) override {
-    return DoInsert(true, keys, values);
+    return DoInsert(ctx, true, keys, values);
   }
 
   absl::Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
     int64_t value_dim = value_shape_.dim_size(0);
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(ctx->allocate_output(
-        "values", TensorShape({size, value_dim}), &values));
-    ExportKeysAndValues(keys, values);
-    return absl::OkStatus();
+    return table_.WithAllShards(
+        [&](int64_t size, const auto& for_each_entry) -> absl::Status {
+          Tensor* keys;
+          Tensor* values;
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("keys", TensorShape({size}), &keys));
+          TF_RETURN_IF_ERROR(ctx->allocate_output(
+              "values", TensorShape({size, value_dim}), &values));
+          ExportKeysAndValues(for_each_entry, keys, values);
+          return absl::OkStatus();
+        });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -333,24 +561,29 @@ class MutableHashTableOfTensors final : public LookupInterface {
 
   int64_t MemoryUsed() const override {
     int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
+    table_.ForEachShard([&ret](const Map& map) {
+      for (unsigned i = 0; i < map.bucket_count(); ++i) {
+        size_t bucket_size = map.bucket_size(i);
+        if (bucket_size == 0) {
+          ret++;
+        } else {
+          ret += bucket_size;
+        }
       }
-    }
+    });
     return sizeof(MutableHashTableOfTensors) + ret;
   }
 
   absl::Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    table_.WithAllShards([&](int64_t size, const auto& for_each_entry) {
+      keys = Tensor(key_dtype(), TensorShape({size}));
+      values =
+          Tensor(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
+      ExportKeysAndValues(for_each_entry, &keys, &values);
+      return true;
+    });
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableOfTensorsV2 kernel. This means that the
@@ -384,28 +617,29 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+  using Map = typename ShardedHashMap<K, ValueArray>::Map;
+
+  // Writes all entries visited by `for_each_entry` into `keys` and `values`,
+  // which must point to tensors of the table size.
+  template <typename ForEachEntry>
+  void ExportKeysAndValues(const ForEachEntry& for_each_entry, Tensor* keys,
+                           Tensor* values) const {
     int64_t value_dim = value_shape_.dim_size(0);
     auto keys_data = keys->flat<K>();
     auto values_data = values->matrix<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      K key = it->first;
-      ValueArray value = it->second;
+    for_each_entry([&](const K& key, const ValueArray& value) {
       keys_data(i) = key;
       for (int64_t j = 0; j < value_dim; j++) {
         values_data(i, j) = value[j];
       }
-    }
+      ++i;
+    });
   }
 
   TensorShape value_shape_;
-  mutable mutex mu_;
-  typedef gtl::InlinedVector<V, 4> ValueArray;
-  std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, ValueArray> table_;
 };
 
 namespace {
@@ -13,10 +13,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
 #include <complex>
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/device.h"
@@ -24,16 +30,24 @@ limitations under the License.
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/kernels/save_restore_tensor.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
 namespace {
@@ -356,5 +370,268 @@ TEST_F(RestoreV2OpTest, RestoreAfterSaveV2) { RunTest("SaveV2"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveSlicesV1) { RunTest("SaveSlices"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveV1) { RunTest("Save"); }
 
+// Writes a synthetic bundle of "total_mb" megabytes of float tensors of
+// "tensor_mb" megabytes each, spread over "num_shards" data files.
+void WriteSyntheticBundle(const string& prefix, int64_t total_mb,
+                          int64_t tensor_mb, int num_shards,
+                          std::vector<string>* tensor_names) {
+  const int64_t num_tensors = total_mb / tensor_mb;
+  Tensor t(DT_FLOAT, TensorShape({tensor_mb << 18}));  // 4 bytes per float.
+  t.flat<float>().setConstant(42.0f);
+  std::vector<tstring> shard_prefixes;
+  for (int shard = 0; shard < num_shards; ++shard) {
+    shard_prefixes.push_back(strings::StrCat(prefix, "_tmp_", shard));
+    BundleWriter writer(Env::Default(), shard_prefixes.back());
+    for (int64_t i = shard; i < num_tensors; i += num_shards) {
+      const string name = strings::StrCat("tensor_", i);
+      TF_CHECK_OK(writer.Add(name, t));
+      tensor_names->push_back(name);
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  TF_CHECK_OK(MergeBundles(Env::Default(), shard_prefixes, prefix));
+}
+
+// RestoreV2 with the size of the restore pool given as an attribute, so that
+// the benchmark does not need to set TF_RESTORE_V2_NUM_THREADS.
+REGISTER_OP("RestoreV2WithThreadsForTest")
+    .Input("prefix: string")
+    .Input("tensor_names: string")
+    .Input("shape_and_slices: string")
+    .Output("tensors: dtypes")
+    .Attr("dtypes: list(type)")
+    .Attr("num_threads: int");
+
+class RestoreV2WithThreadsOp : public OpKernel {
+ public:
+  explicit RestoreV2WithThreadsOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("dtypes", &dtypes_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_threads", &num_threads_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    OP_REQUIRES_OK(context,
+                   RestoreTensorsV2(context, context->input(0),
+                                    context->input(1), context->input(2),
+                                    dtypes_, num_threads_));
+  }
+
+ private:
+  DataTypeVector dtypes_;
+  int64_t num_threads_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("RestoreV2WithThreadsForTest").Device(DEVICE_CPU),
+    RestoreV2WithThreadsOp);
+
+TEST_F(RestoreV2OpTest, ShardedRestoreOfNoTensors) {
+  const string prefix =
+      io::JoinPath(testing::TmpDir(), "sharded_restore_of_no_tensors");
+  {
+    BundleWriter writer(Env::Default(), prefix);
+    TF_ASSERT_OK(writer.Add("tensor", Tensor(1.0f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_ASSERT_OK(NodeDefBuilder("restore", "RestoreV2WithThreadsForTest")
+                   .Input(FakeInput())
+                   .Input(FakeInput())
+                   .Input(FakeInput())
+                   .Attr("dtypes", DataTypeVector())
+                   .Attr("num_threads", 4)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<tstring>(TensorShape({}), {prefix});
+  AddInputFromArray<tstring>(TensorShape({0}), {});
+  AddInputFromArray<tstring>(TensorShape({0}), {});
+  TF_ASSERT_OK(RunOpKernel());
+}
+
+// Returns a 1-D tensor of "num_elements" elements whose values vary with
+// their position.
+template <typename T>
+Tensor MakeSequence(int64_t num_elements) {
+  Tensor t(DataTypeToEnum<T>::value, TensorShape({num_elements}));
+  auto flat = t.flat<T>();
+  for (int64_t i = 0; i < num_elements; ++i) flat(i) = static_cast<T>(i % 127);
+  return t;
+}
+
+// Expects "restored" to equal "saved", which has one of the dtypes used by
+// ShardedRestoreMatchesSavedTensors.
+void ExpectRestoredEqual(const Tensor& restored, const Tensor& saved) {
+  switch (saved.dtype()) {
+    case DT_FLOAT:
+      test::ExpectTensorEqual<float>(restored, saved);
+      break;
+    case DT_DOUBLE:
+      test::ExpectTensorEqual<double>(restored, saved);
+      break;
+    case DT_INT64:
+      test::ExpectTensorEqual<int64_t>(restored, saved);
+      break;
+    case DT_INT32:
+      test::ExpectTensorEqual<int32>(restored, saved);
+      break;
+    case DT_INT8:
+      test::ExpectTensorEqual<int8>(restored, saved);
+      break;
+    case DT_UINT8:
+      test::ExpectTensorEqual<uint8>(restored, saved);
+      break;
+    case DT_BOOL:
+      test::ExpectTensorEqual<bool>(restored, saved);
+      break;
+    case DT_STRING:
+      test::ExpectTensorEqual<tstring>(restored, saved);
+      break;
+    default:
+      FAIL() << "Unexpected dtype " << DataTypeString(saved.dtype());
+  }
+}
+
+TEST_F(RestoreV2OpTest, ShardedRestoreMatchesSavedTensors) {
+  const string prefix =
+      io::JoinPath(testing::TmpDir(), "sharded_restore_matches_saved_tensors");
+  Tensor string_tensor(DT_STRING, TensorShape({3}));
+  string_tensor.flat<tstring>()(0) = "first";
+  string_tensor.flat<tstring>()(1) = "";
+  string_tensor.flat<tstring>()(2) = string(1000, 'x');
+  // Several runs of small tensors, and one tensor above the large-shape
+  // threshold that is restored by its own task.
+  const std::vector<std::pair<string, Tensor>> tensors = {
+      {"small_float", MakeSequence<float>(7)},
+      {"mid_double", MakeSequence<double>(1 << 20)},
+      {"mid_int64", MakeSequence<int64_t>(1 << 20)},
+      {"small_int32", MakeSequence<int32>(100)},
+      {"strings", string_tensor},
+      {"scalar_bool", Tensor(true)},
+      {"large_uint8", MakeSequence<uint8>((16 << 20) + 1)},
+      {"mid_float", MakeSequence<float>(2 << 20)},
+      {"small_int8", MakeSequence<int8>(5)},
+  };
+  constexpr int kNumShards = 3;
+  std::vector<tstring> shard_prefixes;
+  for (int shard = 0; shard < kNumShards; ++shard) {
+    shard_prefixes.push_back(strings::StrCat(prefix, "_tmp_", shard));
+    BundleWriter writer(Env::Default(), shard_prefixes.back());
+    for (size_t i = shard; i < tensors.size(); i += kNumShards) {
+      TF_ASSERT_OK(writer.Add(tensors[i].first, tensors[i].second));
+    }
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_ASSERT_OK(MergeBundles(Env::Default(), shard_prefixes, prefix));
+
+  DataTypeVector dtypes;
+  for (const auto& [name, tensor] : tensors) dtypes.push_back(tensor.dtype());
+  TF_ASSERT_OK(NodeDefBuilder("restore", "RestoreV2WithThreadsForTest")
+                   .Input(FakeInput())
+                   .Input(FakeInput())
+                   .Input(FakeInput())
+                   .Attr("dtypes", dtypes)
+                   .Attr("num_threads", 4)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  const int num_tensors = tensors.size();
+  AddInputFromArray<tstring>(TensorShape({}), {prefix});
+  AddInput<tstring>(TensorShape({num_tensors}),
+                    [&tensors](int x) { return tensors[x].first; });
+  AddInput<tstring>(TensorShape({num_tensors}), [](int x) { return ""; });
+  TF_ASSERT_OK(RunOpKernel());
+  for (int i = 0; i < num_tensors; ++i) {
+    SCOPED_TRACE(tensors[i].first);
+    ExpectRestoredEqual(*GetOutput(i), tensors[i].second);
+  }
+}
+
+// Evicts the files of the bundle at "prefix" from the page cache, so that
+// restores read from storage.
+void DropPageCache(const string& prefix) {
+#if defined(__linux__)
+  std::vector<string> filenames;
+  TF_CHECK_OK(Env::Default()->GetMatchingPaths(strings::StrCat(prefix, "*"),
+                                               &filenames));
+  for (const string& filename : filenames) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << filename;
+    fdatasync(fd);
+    CHECK_EQ(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED), 0) << filename;
+    close(fd);
+  }
+#else
+  LOG_FIRST_N(WARNING, 1) << "Restores may be served from the page cache.";
+#endif  // defined(__linux__)
+}
+
+class RestoreV2Benchmark : public OpsTestBase {
+ public:
+  // Restores a synthetic bundle of "total_mb" megabytes on a pool of
+  // "num_threads" threads, from storage, once per benchmark iteration.
+  void Run(::testing::benchmark::State& state, int64_t total_mb,
+           int64_t num_threads) {
+    constexpr int64_t kTensorMb = 16;
+    constexpr int kNumShards = 16;
+    const string prefix = io::JoinPath(
+        testing::TmpDir(), strings::StrCat("bm_restore_v2_", total_mb));
+    std::vector<string> tensor_names;
+    WriteSyntheticBundle(prefix, total_mb, kTensorMb, kNumShards,
+                         &tensor_names);
+    const int num_tensors = tensor_names.size();
+
+    TF_CHECK_OK(
+        NodeDefBuilder("restore", "RestoreV2WithThreadsForTest")
+            .Input(FakeInput())
+            .Input(FakeInput())
+            .Input(FakeInput())
+            .Attr("dtypes", std::vector<DataType>(num_tensors, DT_FLOAT))
+            .Attr("num_threads", num_threads)
+            .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    AddInputFromArray<tstring>(TensorShape({}), {prefix});
+    AddInput<tstring>(TensorShape({num_tensors}),
+                      [&tensor_names](int x) { return tensor_names[x]; });
+    AddInput<tstring>(TensorShape({num_tensors}), [](int x) { return ""; });
+
+    for (auto s : state) {
+      state.PauseTiming();
+      DropPageCache(prefix);
+      state.ResumeTiming();
+      TF_CHECK_OK(RunOpKernel());
+    }
+    state.SetBytesProcessed(state.iterations() * num_tensors *
+                            (kTensorMb << 20));
+
+    std::vector<string> filenames;
+    TF_CHECK_OK(Env::Default()->GetMatchingPaths(strings::StrCat(prefix, "*"),
+                                                 &filenames));
+    for (const string& filename : filenames) {
+      TF_CHECK_OK(Env::Default()->DeleteFile(filename));
+    }
+  }
+
+ private:
+  void TestBody() override {}
+};
+
+// Restores a synthetic bundle with RestoreV2 and reports restore bandwidth
+// (bytes/second).  The page cache is dropped before every restore.
+// Args: bundle size in MB, number of restore threads (0 keeps the default
+// restore path).
+void BM_RestoreV2(::testing::benchmark::State& state) {
+  RestoreV2Benchmark benchmark;
+  benchmark.Run(state, /*total_mb=*/state.range(0),
+                /*num_threads=*/state.range(1));
+}
+
+BENCHMARK(BM_RestoreV2)
+    ->ArgPair(1 << 10, 0)
+    ->ArgPair(1 << 10, 16)
+    ->ArgPair(20 << 10, 0)
+    ->ArgPair(20 << 10, 16)
+    ->ArgPair(20 << 10, 64)
+    ->UseRealTime()
+    ->Iterations(3);
+
 }  // namespace
 }  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <unordered_map>
@@ -33,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -251,6 +253,14 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
 
+// With sharded restore, consecutive small tensors (in file order) are grouped
+// into runs of at least this many bytes, each restored by one BundleReader.
+const int64_t kMinRestoreRunBytes = 8 << 20;  // 8MB
+
+// Size of the read buffer used by each reader in a sharded restore.  Runs are
+// read sequentially, so large blocks amortize the per-read overhead.
+const int64_t kShardedRestoreReadBufferSize = 8 << 20;  // 8MB
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -356,16 +366,107 @@ struct RestoreOp {
   string shape_and_slice;
   string reader_prefix;
   DataType dtype;
+  // Estimated number of bytes read from the bundle; filled in after lookup.
+  int64_t num_bytes = 0;
 
   absl::Status status;
 };
 
+// Returns the size of the pool used for sharded restore, read from
+// TF_RESTORE_V2_NUM_THREADS.  Zero disables sharded restore.
+int64_t ShardedRestoreNumThreads() {
+  int64_t num_threads = 0;
+  absl::Status s =
+      ReadInt64FromEnvVar("TF_RESTORE_V2_NUM_THREADS", 0, &num_threads);
+  if (!s.ok()) {
+    LOG(WARNING) << s;
+    return 0;
+  }
+  return num_threads;
+}
+
+// Restores "ops" in order through a single BundleReader.  "ops" are expected
+// to be sorted by file offset, so that reads are sequential.
+absl::Status RunRestoreOps(absl::Span<RestoreOp* const> ops,
+                           const string& prefix, BundleCache* cache) {
+  BundleReader::Options options;
+  options.cache = cache;
+  options.read_buffer_size = kShardedRestoreReadBufferSize;
+  BundleReader reader(tsl::Env::Default(), prefix, options);
+  TF_RETURN_IF_ERROR(reader.status());
+  for (RestoreOp* op : ops) {
+    TF_RETURN_IF_ERROR(op->run(&reader));
+  }
+  return absl::OkStatus();
+}
+
+// Restores "large_ops" and "small_ops" on a pool of "num_threads" threads.
+// Each large op is restored by its own task, scheduled first.  Small ops,
+// sorted by (shard, offset), are cut into contiguous runs of roughly equal
+// size, so that every task streams a sequential range of one or a few data
+// files, and reads from different shards proceed concurrently.
+absl::Status ShardedRestore(absl::Span<RestoreOp* const> large_ops,
+                            absl::Span<RestoreOp* const> small_ops,
+                            const string& prefix, BundleCache* cache,
+                            int64_t num_threads) {
+  if (large_ops.empty() && small_ops.empty()) {
+    return absl::OkStatus();
+  }
+  int64_t small_bytes = 0;
+  for (const RestoreOp* op : small_ops) small_bytes += op->num_bytes;
+  const int64_t run_bytes =
+      std::max(kMinRestoreRunBytes, small_bytes / (4 * num_threads));
+
+  std::vector<absl::Span<RestoreOp* const>> runs;
+  size_t run_start = 0;
+  int64_t bytes_in_run = 0;
+  for (size_t i = 0; i < small_ops.size(); ++i) {
+    bytes_in_run += small_ops[i]->num_bytes;
+    if (bytes_in_run >= run_bytes || i + 1 == small_ops.size()) {
+      runs.push_back(small_ops.subspan(run_start, i + 1 - run_start));
+      run_start = i + 1;
+      bytes_in_run = 0;
+    }
+  }
+
+  std::vector<absl::Status> run_statuses(runs.size());
+  {
+    thread::ThreadPool pool(
+        tsl::Env::Default(), "restore_tensors",
+        std::min<int64_t>(num_threads, large_ops.size() + runs.size()));
+    for (RestoreOp* op : large_ops) {
+      pool.Schedule([op, cache]() { op->run_with_new_reader(cache); });
+    }
+    for (size_t i = 0; i < runs.size(); ++i) {
+      pool.Schedule([&runs, &run_statuses, &prefix, cache, i]() {
+        run_statuses[i] = RunRestoreOps(runs[i], prefix, cache);
+      });
+    }
+  }
+  for (const RestoreOp* op : large_ops) {
+    TF_RETURN_IF_ERROR(op->status);
+  }
+  for (const absl::Status& status : run_statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 absl::Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                               const Tensor& tensor_names,
                               const Tensor& shape_and_slices,
                               absl::Span<const DataType> dtypes) {
+  return RestoreTensorsV2(context, prefix, tensor_names, shape_and_slices,
+                          dtypes, ShardedRestoreNumThreads());
+}
+
+absl::Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
+                              const Tensor& tensor_names,
+                              const Tensor& shape_and_slices,
+                              absl::Span<const DataType> dtypes,
+                              int64_t num_restore_threads) {
   const string& prefix_string = prefix.scalar<tstring>()();
 
   const auto& tensor_names_flat = tensor_names.flat<tstring>();
@@ -387,11 +488,15 @@ absl::Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
       restore_ops, [](const RestoreOp& op) { return op.tensor_name; }));
 
   std::vector<string> mismatched_errors;
-  for (const RestoreOp& restore_op : restore_ops) {
+  for (RestoreOp& restore_op : restore_ops) {
     TensorShape restored_full_shape;
     DataType original_dtype;
     TF_RETURN_IF_ERROR(default_reader.LookupDtypeAndShape(
         restore_op.tensor_name, &original_dtype, &restored_full_shape));
+    // Strings and variants are counted as one byte per element.
+    restore_op.num_bytes =
+        restored_full_shape.num_elements() *
+        std::max(DataTypeSize(original_dtype), 1);
     if (restore_op.dtype != original_dtype) {
       string error_msg = strings::StrCat(
           "tensor_name = ", restore_op.tensor_name, "; expected dtype ",
@@ -417,8 +522,12 @@ absl::Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     }
   }
 
-  if (context->session_config() != nullptr &&
-      context->session_config()->intra_op_parallelism_threads() > 0) {
+  if (num_restore_threads > 0) {
+    TF_RETURN_IF_ERROR(ShardedRestore(large_restore_ops, small_restore_ops,
+                                      prefix_string, &cache,
+                                      num_restore_threads));
+  } else if (context->session_config() != nullptr &&
+             context->session_config()->intra_op_parallelism_threads() > 0) {
     // If an explicit restore parallelism is specified, we use it to run
     // run both small and large restore ops in parallel.
     auto reader_pool = std::make_unique<thread::ThreadPool>(
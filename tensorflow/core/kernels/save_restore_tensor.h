@@ -63,11 +63,25 @@ void RestoreTensor(OpKernelContext* context,
 //   * "prefix" has 1 element, DT_STRING.
 //   * "tensor_names" and "shape_and_slices" shaped {N}, both DT_STRING.
 //   * "dtypes" has N elements, the datatypes of the to-restore tensors.
+//
+// If the environment variable TF_RESTORE_V2_NUM_THREADS is set to a positive
+// value, tensors are restored by a pool of that many threads: large tensors
+// individually, and small tensors in contiguous runs of the data files, so
+// that reads from different shards proceed concurrently.
 absl::Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                               const Tensor& tensor_names,
                               const Tensor& shape_and_slices,
                               absl::Span<const DataType> dtypes);
 
+// As above, but with the size of the restore pool given by
+// "num_restore_threads" instead of TF_RESTORE_V2_NUM_THREADS.  Zero keeps the
+// default restore path.
+absl::Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
+                              const Tensor& tensor_names,
+                              const Tensor& shape_and_slices,
+                              absl::Span<const DataType> dtypes,
+                              int64_t num_restore_threads);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_SAVE_RESTORE_TENSOR_H_
@@ -13,9 +13,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -26,12 +28,17 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace {
 
 typedef Eigen::ThreadPoolDevice CPUDevice;
 
+// Inputs with fewer elements are uniquified on a single thread, where the
+// extra passes of the partitioned implementation do not pay off.
+constexpr int64_t kParallelUniqueMinElements = 1 << 17;
+
 // `UniqueOpHashMap` defines the map type that is used when elements of type
 // `T` are to be uniquified. By default, we use `absl::flat_hash_map<T, TIndex>`
 // as the map type. Subsequent specializations are provided for
@@ -143,7 +150,13 @@ class UniqueOp : public OpKernel {
     auto idx_vec = idx->template vec<TIndex>();
 
     int64_t uniq_size;
-    if (new_sizes[0] == 1 && new_sizes[2] == 1) {
+    const int num_threads =
+        context->device()->tensorflow_cpu_worker_threads()->num_threads;
+    if (new_sizes[0] == 1 && new_sizes[2] == 1 && num_threads > 1 &&
+        input.NumElements() >= kParallelUniqueMinElements) {
+      ComputeParallel(context, input, axis, idx_vec, &uniq_size);
+      if (!context->status().ok()) return;
+    } else if (new_sizes[0] == 1 && new_sizes[2] == 1) {
       // Specialized and faster implementation when unique is run over single
       // elements. Here we put T directly into the map rather than ints pointing
       // to them as in the general case.
@@ -237,6 +250,143 @@ class UniqueOp : public OpKernel {
       }
     }
   }
+
+ private:
+  // Multi-threaded version of the single-element case.  Elements are
+  // hash-partitioned across the intra-op threads and every partition is
+  // deduplicated independently; ranking the first occurrences with a prefix
+  // sum over the input then yields the same `y` and `idx` as the sequential
+  // loop, in first-occurrence order.
+  void ComputeParallel(OpKernelContext* context, const Tensor& input,
+                       int64_t axis, typename TTypes<TIndex>::Vec idx_vec,
+                       int64_t* uniq_size) {
+    using MapType = typename UniqueOpHashMap<T, TIndex>::map_type;
+    using KeyType = typename MapType::key_type;
+
+    auto Tin = input.flat<T>();
+    const int64_t N = static_cast<int64_t>(Tin.size());
+    thread::ThreadPool* workers =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    const int num_partitions = workers->NumThreads();
+    const int num_blocks = num_partitions;
+    const int64_t block_size = (N + num_blocks - 1) / num_blocks;
+    // Each block and partition is a unit of work of its own.
+    const int64_t cost_per_unit = 100 * block_size;
+
+    // The map hashers are not necessarily well mixed (e.g. `std::hash` of
+    // floating-point types), so scramble them before picking a partition.
+    const typename MapType::hasher hasher;
+    auto partition_of = [&](int64_t i) -> int {
+      const uint64 h = static_cast<uint64>(hasher(KeyType(Tin(i)))) *
+                       uint64{0x9E3779B97F4A7C15};
+      return static_cast<int>(((h >> 32) * num_partitions) >> 32);
+    };
+
+    // Input positions of every block, by partition.  The input has fewer
+    // than 2^31 elements, which is checked in `Compute`.
+    std::vector<std::vector<std::vector<int32>>> positions(
+        num_blocks, std::vector<std::vector<int32>>(num_partitions));
+    workers->ParallelFor(
+        num_blocks, cost_per_unit, [&](int64_t start, int64_t limit) {
+          for (int64_t b = start; b < limit; ++b) {
+            const int64_t begin = b * block_size;
+            const int64_t end = std::min(N, begin + block_size);
+            for (auto& p : positions[b]) {
+              p.reserve((end - begin) / num_partitions + 1);
+            }
+            for (int64_t i = begin; i < end; ++i) {
+              positions[b][partition_of(i)].push_back(i);
+            }
+          }
+        });
+
+    // Deduplicates every partition, visiting its elements in input order.
+    // `idx_vec` temporarily holds partition-local indices.
+    std::vector<MapType> uniqs(num_partitions);
+    std::vector<std::vector<int32>> first_positions(num_partitions);
+    std::vector<uint8> is_first(N, 0);
+    workers->ParallelFor(
+        num_partitions, cost_per_unit, [&](int64_t start, int64_t limit) {
+          for (int64_t p = start; p < limit; ++p) {
+            MapType& uniq = uniqs[p];
+            std::vector<int32>& first = first_positions[p];
+            int64_t partition_size = 0;
+            for (int b = 0; b < num_blocks; ++b) {
+              partition_size += positions[b][p].size();
+            }
+            uniq.reserve(2 * partition_size);
+            for (int b = 0; b < num_blocks; ++b) {
+              for (const int32 i : positions[b][p]) {
+                auto it =
+                    uniq.emplace(Tin(i), static_cast<TIndex>(first.size()));
+                if (it.second) {
+                  first.push_back(i);
+                  is_first[i] = 1;
+                }
+                idx_vec(i) = it.first->second;
+              }
+            }
+          }
+        });
+
+    // Ranks the first occurrences in input order.  Their `idx_vec` entries
+    // become the final indices.
+    std::vector<int64_t> block_offsets(num_blocks + 1, 0);
+    workers->ParallelFor(
+        num_blocks, cost_per_unit, [&](int64_t start, int64_t limit) {
+          for (int64_t b = start; b < limit; ++b) {
+            const int64_t begin = b * block_size;
+            const int64_t end = std::min(N, begin + block_size);
+            block_offsets[b + 1] =
+                std::count(is_first.begin() + begin, is_first.begin() + end, 1);
+          }
+        });
+    for (int b = 0; b < num_blocks; ++b) {
+      block_offsets[b + 1] += block_offsets[b];
+    }
+    workers->ParallelFor(
+        num_blocks, cost_per_unit, [&](int64_t start, int64_t limit) {
+          for (int64_t b = start; b < limit; ++b) {
+            const int64_t begin = b * block_size;
+            const int64_t end = std::min(N, begin + block_size);
+            TIndex next = static_cast<TIndex>(block_offsets[b]);
+            for (int64_t i = begin; i < end; ++i) {
+              if (is_first[i]) {
+                idx_vec(i) = next++;
+              }
+            }
+          }
+        });
+
+    *uniq_size = block_offsets[num_blocks];
+    TensorShape output_shape(input.shape());
+    output_shape.set_dim(axis, *uniq_size);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+    auto Tout = output->flat<T>();
+
+    // Maps the remaining partition-local indices to the final ones.
+    workers->ParallelFor(
+        num_partitions, cost_per_unit, [&](int64_t start, int64_t limit) {
+          for (int64_t p = start; p < limit; ++p) {
+            const std::vector<int32>& first = first_positions[p];
+            std::vector<TIndex> final_idx(first.size());
+            for (size_t j = 0; j < first.size(); ++j) {
+              final_idx[j] = idx_vec(first[j]);
+            }
+            for (int b = 0; b < num_blocks; ++b) {
+              for (const int32 i : positions[b][p]) {
+                if (!is_first[i]) {
+                  idx_vec(i) = final_idx[idx_vec(i)];
+                }
+              }
+            }
+            for (const auto& it : uniqs[p]) {
+              Tout(final_idx[it.second]) = it.first;
+            }
+          }
+        });
+  }
 };
 
 #define REGISTER_UNIQUE(type)                                      \
@@ -15,11 +15,17 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
@@ -30,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
 
@@ -37,6 +44,51 @@ namespace {
 
 const int kMaxStrLen = 40;
 
+class UniqueOpTest : public OpsTestBase {};
+
+// Large enough for the multi-threaded implementation.
+TEST_F(UniqueOpTest, LargeInputKeepsFirstOccurrenceOrder) {
+  TF_ASSERT_OK(NodeDefBuilder("unique", "UniqueWithCounts")
+                   .Input(FakeInput(DT_INT64))
+                   .Attr("out_idx", DT_INT32)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  const int kNumElements = 1 << 20;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int64_t> dist(0, kNumElements / 4);
+  std::vector<int64_t> x(kNumElements);
+  for (int64_t& v : x) {
+    v = dist(rng);
+  }
+  AddInputFromArray<int64_t>(TensorShape({kNumElements}), x);
+  TF_ASSERT_OK(RunOpKernel());
+
+  std::unordered_map<int64_t, int32> uniq;
+  std::vector<int64_t> expected_y;
+  std::vector<int32> expected_idx(kNumElements);
+  std::vector<int32> expected_count;
+  for (int i = 0; i < kNumElements; ++i) {
+    auto it = uniq.emplace(x[i], static_cast<int32>(expected_y.size()));
+    if (it.second) {
+      expected_y.push_back(x[i]);
+      expected_count.push_back(0);
+    }
+    expected_idx[i] = it.first->second;
+    ++expected_count[it.first->second];
+  }
+  const int64_t num_unique = expected_y.size();
+  test::ExpectTensorEqual<int64_t>(
+      *GetOutput(0),
+      test::AsTensor<int64_t>(expected_y, TensorShape({num_unique})));
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(1),
+      test::AsTensor<int32>(expected_idx, TensorShape({kNumElements})));
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(2),
+      test::AsTensor<int32>(expected_count, TensorShape({num_unique})));
+}
+
 TensorProto GetRandomInt32TensorProto(int dim, int max_int) {
   TensorProto tensor_proto;
   tensor_proto.set_dtype(DT_INT32);
@@ -203,5 +255,50 @@ BENCHMARK(BM_Unique_STRING)
     ->Arg(64 * 1024)
     ->Arg(256 * 1024);
 
+// Args: number of elements, intra-op threads.
+void BM_Unique_INT64_Threads(::testing::benchmark::State& state) {
+  const int dim = state.range(0);
+  const int num_threads = state.range(1);
+
+  Graph* g = new Graph(OpRegistry::Global());
+
+  // About one unique id per 8 elements, as in deduplicated embedding lookups.
+  Tensor input(DT_INT64, TensorShape({dim}));
+  auto input_vec = input.vec<int64_t>();
+  std::mt19937_64 rng(0);
+  std::uniform_int_distribution<int64_t> dist(0, dim / 8);
+  for (int i = 0; i < dim; ++i) {
+    input_vec(i) = dist(rng);
+  }
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Unique")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("T", DT_INT64)
+                  .Finalize(g, &node));
+  FixupSourceAndSinkEdges(g);
+
+  SessionOptions options;
+  options.config.set_intra_op_parallelism_threads(num_threads);
+  test::Benchmark("cpu", g, &options, nullptr, nullptr,
+                  "SINGLE_THREADED_EXECUTOR", /*old_benchmark_api*/ false)
+      .Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * dim *
+                          sizeof(int64_t));
+}
+
+BENCHMARK(BM_Unique_INT64_Threads)
+    ->UseRealTime()
+    ->ArgPair(1024 * 1024, 1)
+    ->ArgPair(1024 * 1024, 4)
+    ->ArgPair(1024 * 1024, 16)
+    ->ArgPair(16 * 1024 * 1024, 1)
+    ->ArgPair(16 * 1024 * 1024, 4)
+    ->ArgPair(16 * 1024 * 1024, 16)
+    ->ArgPair(16 * 1024 * 1024, 32)
+    ->ArgPair(64 * 1024 * 1024, 1)
+    ->ArgPair(64 * 1024 * 1024, 16)
+    ->ArgPair(64 * 1024 * 1024, 32);
+
 }  // namespace
 }  // namespace tensorflow
@@ -93,6 +93,26 @@ REGISTER_OP("BatchFunction")
     .Attr(
         "batch_padding_policy: "
         "{'PAD_UP', 'BATCH_DOWN', 'MINIMIZE_TPU_COST_PER_REQUEST'} = 'PAD_UP'")
+    // If positive, the batch scheduler picks the size and the timeout of each
+    // batch itself, so that batched calls complete within this many
+    // microseconds at the 99th percentile. It learns the processing latency of
+    // batches as a function of their size while serving, and makes batches as
+    // large as the target allows at the current request rate.
+    // 'max_batch_size' and 'allowed_batch_sizes' still bound the batch size,
+    // and 'batch_timeout_micros' applies until the first batch has been
+    // measured.
+    //
+    // WARNING: Not all batch schedulers might support this attribute.
+    .Attr("latency_slo_micros: int = 0")
+    // If non-empty, a sorted list of sequence lengths. Every batched input
+    // must then have the sequence length as its second dimension. Each call is
+    // zero-padded along that dimension up to the smallest of these lengths that
+    // fits it, and only calls padded to the same length are batched together,
+    // so that short sequences are not padded to the longest one in flight.
+    // Outputs keep the padded sequence length.
+    //
+    // WARNING: Warmup only covers the bucket of the warmup request.
+    .Attr("sequence_length_buckets: list(int) = []")
     .Attr("Tin: list(type)")
     .Attr("Tcaptured: list(type) >= 0")
     .Attr("Tout: list(type)")
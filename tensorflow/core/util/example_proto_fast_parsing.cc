@@ -15,13 +15,16 @@ limitations under the License.
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
+#include <numeric>
 #include <optional>
 #include <utility>
 #include <vector>
 
 #include "absl/base/casts.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/numeric/bits.h"
 #include "absl/status/status.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/core/example/example.pb.h"
@@ -39,7 +42,6 @@ limitations under the License.
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
-#include "tensorflow/core/util/presized_cuckoo_map.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
 namespace tensorflow {
@@ -115,6 +117,61 @@ uint8 PeekTag(protobuf::io::CodedInputStream* stream) {
   return *static_cast<const uint8*>(ptr);
 }
 
+// Returns the number of varints in the packed varint data [p, p + size), i.e.
+// the number of bytes without continuation bit, eight bytes at a time.
+size_t CountPackedVarints(const uint8* p, size_t size) {
+  constexpr uint64 kContinuationBits = 0x8080808080808080;
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64 word;
+    std::memcpy(&word, p + i, sizeof(word));
+    count += 8 - absl::popcount(word & kContinuationBits);
+  }
+  for (; i < size; ++i) {
+    count += (p[i] & 0x80) == 0;
+  }
+  return count;
+}
+
+// Decodes the packed varint data [p, end) into `out`, which has room for
+// `capacity` values; further values are dropped.  Runs of eight one-byte
+// varints, common for ids and small counts, are detected and widened eight
+// bytes at a time.  Returns false on malformed data, like
+// CodedInputStream::ReadVarint64.
+bool DecodePackedVarints(const uint8* p, const uint8* end, int64_t* out,
+                         size_t capacity) {
+  constexpr uint64 kContinuationBits = 0x8080808080808080;
+  size_t n = 0;
+  while (p < end) {
+    if (end - p >= 8 && n + 8 <= capacity) {
+      uint64 word;
+      std::memcpy(&word, p, sizeof(word));
+      if ((word & kContinuationBits) == 0) {
+        for (int k = 0; k < 8; ++k) {
+          out[n + k] = p[k];
+        }
+        p += 8;
+        n += 8;
+        continue;
+      }
+    }
+    uint64 value = 0;
+    uint8 byte;
+    int shift = 0;
+    do {
+      // A varint has at most ten bytes.
+      if (p == end || shift > 63) return false;
+      byte = *p++;
+      value |= static_cast<uint64>(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    if (n < capacity) out[n] = static_cast<int64_t>(value);
+    ++n;
+  }
+  return true;
+}
+
 constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
@@ -305,15 +362,28 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64_t>(n));
+        // The whole packed payload is in the buffer, since the stream reads
+        // from a flat array.  Count the values to size the output once, then
+        // decode them straight into it.
+        const void* packed_data = nullptr;
+        int available = 0;
+        if (packed_length > 0 &&
+            (!stream.GetDirectBufferPointer(&packed_data, &available) ||
+             static_cast<uint32>(available) < packed_length)) {
+          return false;
         }
-
-        stream.PopLimit(packed_limit);
+        const uint8* packed_begin = static_cast<const uint8*>(packed_data);
+        const size_t initial_size = int64_list->size();
+        int64_list->resize(initial_size +
+                           CountPackedVarints(packed_begin, packed_length));
+        // Can be less than requested in resize for a LimitedArraySlice.
+        const size_t capacity = int64_list->size() - initial_size;
+        if (!DecodePackedVarints(packed_begin, packed_begin + packed_length,
+                                 int64_list->data() + initial_size,
+                                 capacity)) {
+          return false;
+        }
+        if (!stream.Skip(packed_length)) return false;
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
@@ -560,11 +630,123 @@ struct SparseBuffer {
   std::vector<size_t> example_end_indices;
 };
 
-struct SeededHasher {
-  uint64 operator()(StringPiece s) const {
-    return Hash64(s.data(), s.size(), seed);
+// Index of the features of a Config by name, built as a perfect hash with
+// the "hash and displace" scheme: names are grouped into buckets by their
+// hash, and every bucket gets a displacement that sends its names to free
+// slots.  A lookup thus costs one hash, one probe and one comparison to reject
+// names that are not configured.
+class FeatureNameIndex {
+ public:
+  struct Entry {
+    size_t index;
+    Type type;
+  };
+
+  absl::Status Init(const Config& config) {
+    std::vector<std::pair<StringPiece, Entry>> features;
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      features.push_back({config.dense[d].feature_name, {d, Type::Dense}});
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      features.push_back({config.sparse[d].feature_name, {d, Type::Sparse}});
+    }
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      features.push_back({config.ragged[d].feature_name, {d, Type::Ragged}});
+    }
+    // About four names per bucket and half the slots in use make finding
+    // displacements quick.
+    size_t num_buckets = 1;
+    while (num_buckets * 4 < features.size()) num_buckets *= 2;
+    size_t num_slots = 1;
+    while (num_slots < 2 * features.size()) num_slots *= 2;
+    bucket_mask_ = num_buckets - 1;
+    slot_mask_ = num_slots - 1;
+
+    // Fails only for duplicate names, which can never be told apart.
+    for (int attempt = 0; attempt < 16; ++attempt, ++seed_) {
+      if (TryBuild(features)) return absl::OkStatus();
+    }
+    return errors::Internal(
+        "Could not avoid collision. This should not happen.");
+  }
+
+  // Returns nullptr if `name` is not a configured feature.
+  const Entry* Find(StringPiece name) const {
+    const uint64 h = Hash64(name.data(), name.size(), seed_);
+    const Slot& slot = slots_[SlotOf(h, displacements_[BucketOf(h)])];
+    if (!slot.used || slot.hash != h || slot.name != name) return nullptr;
+    return &slot.entry;
+  }
+
+ private:
+  struct Slot {
+    bool used = false;
+    uint64 hash = 0;
+    StringPiece name;
+    Entry entry;
+  };
+
+  size_t BucketOf(uint64 h) const { return (h >> 32) & bucket_mask_; }
+
+  size_t SlotOf(uint64 h, uint32 displacement) const {
+    uint64 x = h + displacement * uint64{0x9E3779B97F4A7C15};
+    x = (x ^ (x >> 31)) * uint64{0xD6E8FEB86659FD93};
+    return (x ^ (x >> 32)) & slot_mask_;
+  }
+
+  bool TryBuild(const std::vector<std::pair<StringPiece, Entry>>& features) {
+    constexpr uint32 kMaxDisplacement = 1 << 14;
+    std::vector<uint64> hashes(features.size());
+    std::vector<std::vector<size_t>> buckets(bucket_mask_ + 1);
+    for (size_t i = 0; i < features.size(); ++i) {
+      const StringPiece name = features[i].first;
+      hashes[i] = Hash64(name.data(), name.size(), seed_);
+      buckets[BucketOf(hashes[i])].push_back(i);
+    }
+    std::vector<size_t> order(buckets.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    slots_.assign(slot_mask_ + 1, Slot());
+    displacements_.assign(buckets.size(), 0);
+    std::vector<size_t> bucket_slots;
+    for (const size_t b : order) {
+      if (buckets[b].empty()) break;
+      bool placed = false;
+      for (uint32 d = 0; d < kMaxDisplacement && !placed; ++d) {
+        bucket_slots.clear();
+        placed = true;
+        for (const size_t i : buckets[b]) {
+          const size_t slot = SlotOf(hashes[i], d);
+          if (slots_[slot].used ||
+              std::find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+                  bucket_slots.end()) {
+            placed = false;
+            break;
+          }
+          bucket_slots.push_back(slot);
+        }
+        if (placed) {
+          displacements_[b] = d;
+          for (size_t j = 0; j < buckets[b].size(); ++j) {
+            const size_t i = buckets[b][j];
+            slots_[bucket_slots[j]] = {true, hashes[i], features[i].first,
+                                       features[i].second};
+          }
+        }
+      }
+      if (!placed) return false;
+    }
+    return true;
   }
-  uint64 seed{0xDECAFCAFFE};
+
+  uint64 seed_ = 0xDECAFCAFFE;
+  size_t bucket_mask_ = 0;
+  size_t slot_mask_ = 0;
+  std::vector<uint32> displacements_;
+  std::vector<Slot> slots_;
 };
 
 void LogDenseFeatureDataLoss(StringPiece feature_name) {
@@ -592,8 +774,7 @@ void LogSparseFeatureDataLoss(StringPiece feature_name) {
 absl::Status FastParseSerializedExample(
     const tstring& serialized_example, const tstring& example_name,
     const size_t example_index, const Config& config,
-    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
-    SeededHasher hasher, std::vector<Tensor>* output_dense,
+    const FeatureNameIndex& config_index, std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_varlen_dense,
     std::vector<SparseBuffer>* output_sparse,
     std::vector<SparseBuffer>* output_ragged,
@@ -629,23 +810,12 @@ absl::Status FastParseSerializedExample(
     const StringPiece feature_name = name_and_feature.first;
     parsed::Feature& feature = name_and_feature.second;
 
-    std::pair<size_t, Type> d_and_type;
-    uint64 h = hasher(feature_name);
-    if (!config_index.Find(h, &d_and_type)) continue;
+    const FeatureNameIndex::Entry* entry = config_index.Find(feature_name);
+    if (entry == nullptr) continue;
 
-    size_t d = d_and_type.first;
-    bool is_dense = d_and_type.second == Type::Dense;
-    bool is_ragged = d_and_type.second == Type::Ragged;
-
-    {
-      // Testing for PresizedCuckooMap collision.
-      // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
-      const tstring& config_feature_name =
-          is_dense ? config.dense[d].feature_name
-                   : (is_ragged ? config.ragged[d].feature_name
-                                : config.sparse[d].feature_name);
-      if (feature_name != config_feature_name) continue;
-    }
+    size_t d = entry->index;
+    bool is_dense = entry->type == Type::Dense;
+    bool is_ragged = entry->type == Type::Ragged;
 
     auto example_error = [&](StringPiece suffix) {
       return errors::InvalidArgument("Name: ", example_name,
@@ -1145,36 +1315,9 @@ absl::Status FastParseExample(const Config& config,
     result->feature_stats.resize(serialized.size());
   }
 
-  size_t config_size =
-      config.dense.size() + config.sparse.size() + config.ragged.size();
-  SeededHasher hasher;
   // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    for (size_t d = 0; d < config.ragged.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
-                                      {d, Type::Ragged});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  FeatureNameIndex config_index;
+  TF_RETURN_IF_ERROR(config_index.Init(config));
 
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse and ragged have to be buffered).
@@ -1245,7 +1388,7 @@ absl::Status FastParseExample(const Config& config,
       status_of_minibatch[minibatch] = FastParseSerializedExample(
           serialized[e],
           (!example_names.empty() ? example_names[e] : "<unknown>"), e, config,
-          config_index, hasher, &fixed_dense_values,
+          config_index, &fixed_dense_values,
           &varlen_dense_buffers[minibatch], &sparse_buffers[minibatch],
           &ragged_buffers[minibatch], stats);
       if (!status_of_minibatch[minibatch].ok()) break;
@@ -1460,36 +1603,9 @@ absl::Status FastParseSingleExample(const Config& config,
   }
 
   // TODO(mrry): Cache the construction of this map at Op construction time.
-  size_t config_size =
-      config.dense.size() + config.sparse.size() + config.ragged.size();
-  SeededHasher hasher;
   // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    for (size_t d = 0; d < config.ragged.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
-                                      {d, Type::Ragged});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  FeatureNameIndex config_index;
+  TF_RETURN_IF_ERROR(config_index.Init(config));
 
   result->sparse_indices.reserve(config.sparse.size());
   result->sparse_values.reserve(config.sparse.size());
@@ -1558,23 +1674,12 @@ absl::Status FastParseSingleExample(const Config& config,
     const StringPiece feature_name = name_and_feature.first;
     parsed::Feature& feature = name_and_feature.second;
 
-    std::pair<size_t, Type> d_and_type;
-    uint64 h = hasher(feature_name);
-    if (!config_index.Find(h, &d_and_type)) continue;
+    const FeatureNameIndex::Entry* entry = config_index.Find(feature_name);
+    if (entry == nullptr) continue;
 
-    size_t d = d_and_type.first;
-    bool is_dense = d_and_type.second == Type::Dense;
-    bool is_sparse = d_and_type.second == Type::Sparse;
-
-    {
-      // Testing for PresizedCuckooMap collision.
-      // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
-      const tstring& config_feature_name =
-          is_dense ? config.dense[d].feature_name
-                   : (is_sparse ? config.sparse[d].feature_name
-                                : config.ragged[d].feature_name);
-      if (feature_name != config_feature_name) continue;
-    }
+    size_t d = entry->index;
+    bool is_dense = entry->type == Type::Dense;
+    bool is_sparse = entry->type == Type::Sparse;
 
     auto example_error = [feature_name](StringPiece suffix) {
       return errors::InvalidArgument("Key: ", feature_name, ".  ", suffix);
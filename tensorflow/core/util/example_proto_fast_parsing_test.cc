@@ -255,6 +255,32 @@ static string ExampleWithSomeFeatures() {
 
 TEST(FastParse, SomeFeatures) { TestCorrectness(ExampleWithSomeFeatures()); }
 
+TEST(FastParse, PackedInt64Runs) {
+  Example example;
+  Int64List* int64_list =
+      (*example.mutable_features()->mutable_feature())["ids"]
+          .mutable_int64_list();
+  // Runs of one-byte varints, broken up by multi-byte and ten-byte (negative)
+  // varints at varying offsets.
+  for (int i = 0; i < 100; ++i) {
+    int64_list->add_value(i % 128);
+    if (i % 11 == 0) int64_list->add_value(300 + i);
+    if (i % 17 == 0) int64_list->add_value(-i);
+    if (i % 23 == 0) int64_list->add_value(int64_t{1} << 62);
+  }
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, TruncatedPackedInt64) {
+  // Feature "age" with a packed int64 list whose last varint has its
+  // continuation bit set.
+  Example example;
+  EXPECT_FALSE(TestFastParse(
+      "\x0a\x0f\x0a\x0d\x0a\x03\x61\x67\x65\x12\x06\x1a\x04\x0a\x02\x05"
+      "\x8d",
+      &example));
+}
+
 static void AddDenseFeature(const char* feature_name, DataType dtype,
                             PartialTensorShape shape, bool variable_length,
                             size_t elements_per_stride,
@@ -429,6 +455,54 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(TestFastParseExample, ManyFeatures) {
+  // Enough configured features for the name index to use many buckets.
+  constexpr int kNumFeatures = 1000;
+  FastParseExampleConfig config;
+  Example example;
+  for (int i = 0; i < kNumFeatures; ++i) {
+    const string name = strings::StrCat("feature_", i);
+    config.sparse.push_back({name, DT_INT64});
+    (*example.mutable_features()->mutable_feature())[name]
+        .mutable_int64_list()
+        ->add_value(i);
+  }
+  // Not configured, so ignored.
+  (*example.mutable_features()->mutable_feature())["other"]
+      .mutable_int64_list()
+      ->add_value(-1);
+  const std::vector<tstring> serialized = {Serialize(example)};
+
+  Result result;
+  absl::Status status =
+      FastParseExample(config, serialized, {}, nullptr, &result);
+  ASSERT_TRUE(status.ok()) << status;
+  ASSERT_EQ(result.sparse_values.size(), kNumFeatures);
+  for (int i = 0; i < kNumFeatures; ++i) {
+    ASSERT_EQ(result.sparse_values[i].NumElements(), 1);
+    EXPECT_EQ(result.sparse_values[i].flat<int64_t>()(0), i);
+  }
+}
+
+TEST(TestFastParseExample, DenseInt64WrongCount) {
+  FastParseExampleConfig config;
+  config.dense.push_back({"ids", DT_INT64, PartialTensorShape({3}),
+                          Tensor(DT_INT64, TensorShape({3})),
+                          /*variable_length=*/false,
+                          /*elements_per_stride=*/3});
+  Example example;
+  Int64List* int64_list =
+      (*example.mutable_features()->mutable_feature())["ids"]
+          .mutable_int64_list();
+  for (int i = 0; i < 9; ++i) int64_list->add_value(i);
+  const std::vector<tstring> serialized = {Serialize(example)};
+
+  Result result;
+  absl::Status status =
+      FastParseExample(config, serialized, {}, nullptr, &result);
+  EXPECT_TRUE(absl::IsInvalidArgument(status)) << status;
+}
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -15,8 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <utility>
 
@@ -24,6 +26,8 @@ limitations under the License.
 #include "absl/synchronization/mutex.h"
 #include "xla/tsl/lib/io/buffered_file.h"
 #include "xla/tsl/util/byte_swap_array.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -67,9 +71,6 @@ const int kTensorBundleMinProducer = 0;
 const int kTensorBundleMinConsumer = 0;
 const int kTensorBundleVersion = 1;
 
-// Size of our input buffer for streaming reads
-static const int kBufferSize = 1024 * 1024;
-
 // Key to the special BundleHeaderProto entry.  Do not change this, as clients
 // can make the assumption that the header is always the first entry in the
 // bundle.
@@ -223,6 +224,31 @@ Status ReadVariantTensor(io::InputBuffer* buffered_file, Tensor* ret,
   return absl::OkStatus();
 }
 
+// A TensorBuffer aliasing a range of a memory-mapped data file.  Holds a
+// reference to the mapping, so that restored tensors may outlive the
+// BundleReader that produced them.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(static_cast<int64_t>(size_));
+    proto->set_allocator_name("BundleReaderMmap");
+    proto->set_ptr(reinterpret_cast<uintptr_t>(data()));
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
 char* GetBackingBuffer(const Tensor& val) {
   CHECK(DataTypeCanUseMemcpy(val.dtype())) << val.dtype();
   return const_cast<char*>(val.tensor_data().data());
@@ -424,6 +450,32 @@ Status PadAlignment(tsl::BufferedWritableFile* out, int alignment,
   return status;
 }
 
+// Appends the data bytes of "val" to "out", which currently holds "*size"
+// bytes, and fills in the offset, size and checksum of "entry".  On OK,
+// advances "*size" past the written bytes and the padding to "alignment".
+Status WriteEntry(const Tensor& val, int alignment,
+                  tsl::BufferedWritableFile* out, int64_t* size,
+                  BundleEntryProto* entry) {
+  entry->set_offset(*size);
+  size_t data_bytes_written = 0;
+  uint32 crc32c = 0;
+  out->reset_crc32();
+  if (val.dtype() == DT_STRING) {
+    TF_RETURN_IF_ERROR(
+        WriteStringTensor(val, out, &data_bytes_written, &crc32c));
+  } else if (val.dtype() == DT_VARIANT) {
+    TF_RETURN_IF_ERROR(
+        WriteVariantTensor(val, out, &data_bytes_written, &crc32c));
+  } else {
+    TF_RETURN_IF_ERROR(WriteTensor(val, out, &data_bytes_written));
+    crc32c = out->crc32();
+  }
+  entry->set_size(data_bytes_written);
+  entry->set_crc32c(crc32c::Mask(crc32c));
+  *size += data_bytes_written;
+  return PadAlignment(out, alignment, size);
+}
+
 }  // namespace
 
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
@@ -443,6 +495,11 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
   if (!status_.ok() && !errors::IsAlreadyExists(status_)) {
     return;
   }
+  if (options_.num_shards > 1) {
+    // Data files are opened by Finish(), once their number is known.
+    status_ = absl::OkStatus();
+    return;
+  }
 
   std::unique_ptr<WritableFile> wrapper;
   status_ = env_->NewWritableFile(data_path_, &wrapper);
@@ -465,28 +522,15 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   BundleEntryProto* entry = &entries_[key_string];
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
+  if (options_.num_shards > 1) {
+    pending_.push_back({entry, val});
+    return status_;
+  }
   entry->set_shard_id(0);
-  entry->set_offset(size_);
 
   // Updates the data file.
-  size_t data_bytes_written = 0;
-  uint32 crc32c = 0;
-  out_->reset_crc32();
-  if (val.dtype() == DT_STRING) {
-    status_ = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else if (val.dtype() == DT_VARIANT) {
-    status_ = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else {
-    status_ = WriteTensor(val, out_.get(), &data_bytes_written);
-    crc32c = out_->crc32();
-  }
-
-  if (status_.ok()) {
-    entry->set_size(data_bytes_written);
-    entry->set_crc32c(crc32c::Mask(crc32c));
-    size_ += data_bytes_written;
-    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
-  }
+  status_ =
+      WriteEntry(val, options_.data_alignment, out_.get(), &size_, entry);
   return status_;
 }
 
@@ -534,7 +578,11 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
-  if (out_) {
+  int num_shards = 1;
+  if (options_.num_shards > 1) {
+    if (status_.ok()) status_ = WriteDataShards(&num_shards);
+    pending_.clear();
+  } else if (out_) {
     status_.Update(out_->Close());
     out_ = nullptr;
     if (status_.ok()) {
@@ -559,7 +607,7 @@ Status BundleWriter::Finish() {
     table::TableBuilder builder(options, file.get());
     // Header entry.
     BundleHeaderProto header;
-    header.set_num_shards(1);
+    header.set_num_shards(num_shards);
     header.set_endianness(BundleHeaderProto::LITTLE);
     if (!port::kLittleEndian) header.set_endianness(BundleHeaderProto::BIG);
     VersionDef* version = header.mutable_version();
@@ -586,6 +634,87 @@ Status BundleWriter::Finish() {
   return absl::OkStatus();
 }
 
+Status BundleWriter::WriteDataShards(int* num_shards) {
+  *num_shards = std::max<int>(
+      1, std::min<int64_t>(options_.num_shards, pending_.size()));
+
+  // Greedily assigns the largest remaining tensor to the least loaded shard.
+  // String and variant sizes are estimated by TotalBytes().
+  std::vector<const PendingTensor*> by_size;
+  by_size.reserve(pending_.size());
+  for (const PendingTensor& pending : pending_) by_size.push_back(&pending);
+  std::stable_sort(by_size.begin(), by_size.end(),
+                   [](const PendingTensor* a, const PendingTensor* b) {
+                     return a->val.TotalBytes() > b->val.TotalBytes();
+                   });
+  std::vector<int64_t> shard_bytes(*num_shards, 0);
+  std::vector<std::vector<const PendingTensor*>> shards(*num_shards);
+  for (const PendingTensor* pending : by_size) {
+    const int shard =
+        std::min_element(shard_bytes.begin(), shard_bytes.end()) -
+        shard_bytes.begin();
+    shard_bytes[shard] += pending->val.TotalBytes();
+    pending->entry->set_shard_id(shard);
+    shards[shard].push_back(pending);
+  }
+  // Within a shard, keeps the order in which tensors were added.
+  for (auto& shard : shards) {
+    absl::c_sort(shard, std::less<const PendingTensor*>());
+  }
+
+  std::vector<string> paths(*num_shards);
+  std::vector<Status> statuses(*num_shards);
+  {
+    thread::ThreadPool pool(env_, "bundle_writer", *num_shards);
+    for (int shard = 0; shard < *num_shards; ++shard) {
+      paths[shard] = DataFilename(prefix_, shard, *num_shards);
+      if (use_temp_file_) {
+        paths[shard] =
+            strings::StrCat(paths[shard], ".tempstate", random::New64());
+      }
+      pool.Schedule([this, shard, &paths, &shards, &statuses]() {
+        statuses[shard] = WriteDataShard(paths[shard], shards[shard]);
+      });
+    }
+  }
+
+  Status status;
+  for (const Status& s : statuses) status.Update(s);
+  int num_renamed = 0;
+  if (status.ok() && use_temp_file_) {
+    for (; num_renamed < *num_shards; ++num_renamed) {
+      status = env_->RenameFile(
+          paths[num_renamed], DataFilename(prefix_, num_renamed, *num_shards));
+      if (!status.ok()) break;
+    }
+  }
+  if (!status.ok()) {
+    // No metadata file will refer to the shards, so none is left behind,
+    // whether it was renamed already or not.
+    for (int shard = 0; shard < *num_shards; ++shard) {
+      const string path = shard < num_renamed
+                              ? DataFilename(prefix_, shard, *num_shards)
+                              : paths[shard];
+      env_->DeleteFile(path).IgnoreError();
+    }
+  }
+  return status;
+}
+
+Status BundleWriter::WriteDataShard(
+    const string& path, absl::Span<const PendingTensor* const> tensors) {
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env_->NewWritableFile(path, &file));
+  tsl::BufferedWritableFile out(std::move(file), 8 << 20 /* 8MB */);
+  VLOG(1) << "Writing " << tensors.size() << " tensors to file " << path;
+  int64_t size = 0;
+  for (const PendingTensor* pending : tensors) {
+    TF_RETURN_IF_ERROR(WriteEntry(pending->val, options_.data_alignment, &out,
+                                  &size, pending->entry));
+  }
+  return out.Close();
+}
+
 // Merging tensor bundles.
 
 // Accumulator of metadata states during a merge.
@@ -785,7 +914,10 @@ BundleReader::BundleReader(Env* env, StringPiece prefix, Options options)
       iter_(nullptr),
       need_to_swap_bytes_(false),
       enable_multi_threading_for_testing_(
-          options.enable_multi_threading_for_testing) {
+          options.enable_multi_threading_for_testing),
+      read_buffer_size_(options.read_buffer_size),
+      use_mmap_(options.use_mmap),
+      verify_mmapped_checksums_(options.verify_mmapped_checksums) {
   if (cache_ == nullptr) {
     // Make a cache for use just by this BundleReader.
     owned_cache_ = std::make_unique<BundleCache>(env);
@@ -877,7 +1009,73 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return absl::OkStatus();
 }
 
+Status BundleReader::GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                                    bool* mapped) {
+  DCHECK(use_mmap_);
+  *mapped = false;
+  auto it = mapped_data_.find(entry.shard_id());
+  if (it == mapped_data_.end()) {
+    const string filename =
+        DataFilename(prefix_, entry.shard_id(), num_shards_);
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &region);
+    if (!s.ok()) {
+      VLOG(1) << "Unable to memory-map " << filename
+              << "; falling back to copying tensor data: " << s;
+      region = nullptr;
+    }
+    it = mapped_data_.emplace(entry.shard_id(), std::move(region)).first;
+  }
+  const std::shared_ptr<ReadOnlyMemoryRegion>& region = it->second;
+  if (region == nullptr) return absl::OkStatus();
+
+  if (entry.offset() < 0 || entry.size() < 0 ||
+      static_cast<uint64>(entry.offset()) + entry.size() > region->length()) {
+    return errors::DataLoss("Bundle entry for key ", key(), " (offset ",
+                            entry.offset(), ", size ", entry.size(),
+                            ") lies outside of data file shard ",
+                            entry.shard_id(), " of ", region->length(),
+                            " bytes");
+  }
+  const char* data =
+      static_cast<const char*>(region->data()) + entry.offset();
+  if (reinterpret_cast<uintptr_t>(data) % Allocator::kAllocatorAlignment !=
+      0) {
+    VLOG(2) << "Copying misaligned bundle entry " << key();
+    return absl::OkStatus();
+  }
+
+  core::RefCountPtr<TensorBuffer> buf(
+      new MappedTensorBuffer(region, data, entry.size()));
+  Tensor ret(entry.dtype(), TensorShape(entry.shape()), std::move(buf));
+  if (entry.size() != ret.TotalBytes()) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+                            "; stored size ", entry.size(),
+                            "; expected size ", ret.TotalBytes());
+  }
+  if (verify_mmapped_checksums_) {
+    const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+    if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+      return errors::DataLoss(
+          "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
+          entry.size(), " bytes): Checksum does not match: stored ",
+          strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+          " vs. calculated on the mapped bytes ", actual_crc32c);
+    }
+  }
+  *val = std::move(ret);
+  *mapped = true;
+  return absl::OkStatus();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
+  if (use_mmap_ && DataTypeCanUseMemcpy(entry.dtype()) &&
+      !need_to_swap_bytes_) {
+    bool mapped = false;
+    TF_RETURN_IF_ERROR(GetMappedValue(entry, val, &mapped));
+    if (mapped) return absl::OkStatus();
+  }
+
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
   if (val->NumElements() == 0) {
@@ -912,7 +1110,7 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     RandomAccessFile* file = nullptr;
     TF_RETURN_IF_ERROR(cache_->GetFile(
         DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file = new io::InputBuffer(file, kBufferSize);
+    buffered_file = new io::InputBuffer(file, read_buffer_size_);
     data_[entry.shard_id()] = buffered_file;
   }
   CHECK(buffered_file != nullptr);
@@ -923,7 +1121,8 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   if (DataTypeCanUseMemcpy(entry.dtype())) {
     char* backing_buffer = const_cast<char*>((ret->tensor_data().data()));
     size_t unused_bytes_read;
-    if (entry.size() > kBufferSize || enable_multi_threading_for_testing_) {
+    if (entry.size() > read_buffer_size_ ||
+        enable_multi_threading_for_testing_) {
       StringPiece sp;
       if (!enable_multi_threading_for_testing_ &&
           entry.size() < kLargeTensorThreshold) {
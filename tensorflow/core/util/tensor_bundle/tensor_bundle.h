@@ -39,9 +39,11 @@ limitations under the License.
 //   reader.Lookup("name", &tensor);
 //
 // A tensor bundle can be built using BundleWriter.  Each BundleWriter builds a
-// single data file bundle.  Multiple bundles can then be merged by
-// MergeBundles() without reading and writing large chunk of data: it reads the
-// metadata files and outputs a single merged metadata.  Typical usage:
+// single data file bundle, or, with BundleWriter::Options::num_shards, a bundle
+// whose data files are written concurrently.  Multiple bundles can then be
+// merged by MergeBundles() without reading and writing large chunk of data: it
+// reads the metadata files and outputs a single merged metadata.  Typical
+// usage:
 //
 //   worker 0:
 //     BundleWriter writer(env, "/fs/model/train/ckpt-step/tmp/worker0-step");
@@ -119,6 +121,13 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // Maximum number of data files to write.  With more than one shard,
+    // Add() only records the tensors; Finish() partitions them by size across
+    // the shards and writes (and checksums) all shards concurrently, one
+    // thread per shard.  Tensors must therefore not be mutated between Add()
+    // and Finish().  The number of shards actually written is capped by the
+    // number of data entries.
+    int num_shards{1};
   };
   BundleWriter(Env* env, absl::string_view prefix,
                const Options& options = Options());
@@ -153,6 +162,20 @@ class BundleWriter {
   Status status() const { return status_; }
 
  private:
+  // A tensor recorded by Add() in sharded mode, written out by Finish().
+  struct PendingTensor {
+    BundleEntryProto* entry;  // Points into entries_.
+    Tensor val;
+  };
+
+  // Partitions pending_ across data shards and writes them concurrently.
+  // Sets "*num_shards" to the number of data files written.
+  Status WriteDataShards(int* num_shards);
+
+  // Writes "tensors", in order, into a new data file at "path".
+  Status WriteDataShard(const std::string& path,
+                        absl::Span<const PendingTensor* const> tensors);
+
   Env* const env_;  // Not owned.
   const Options options_;
   const std::string prefix_;
@@ -162,6 +185,7 @@ class BundleWriter {
   std::unique_ptr<tsl::BufferedWritableFile> out_;
   int64_t size_;  // Number of bytes written into out_.
   std::map<std::string, BundleEntryProto> entries_;
+  std::vector<PendingTensor> pending_;  // Only used with multiple shards.
   Status status_;
 
   BundleWriter(const BundleWriter&) = delete;
@@ -212,6 +236,30 @@ class BundleReader {
 
     // For tests only.
     bool enable_multi_threading_for_testing = false;
+
+    // Size of the buffer used for streaming reads from the data files.  Larger
+    // buffers issue fewer, larger sequential reads when many small tensors are
+    // restored in file order.
+    int64_t read_buffer_size = 1 << 20;
+
+    // If true, memory-maps the data files and returns tensors of memcpy-able
+    // dtypes as read-only views into the mapped pages instead of copying them
+    // into freshly allocated buffers.  Entries whose bytes are not aligned to
+    // Allocator::kAllocatorAlignment within the mapping, or which need byte
+    // swapping, fall back to copying.  Writing the bundle with
+    // BundleWriter::Options::data_alignment set to a multiple of the allocator
+    // alignment makes every such entry eligible.
+    //
+    // Tensors returned in this mode share the mapping (which outlives the
+    // reader) and must not be mutated in place.  If the file system does not
+    // support memory-mapping, all entries are copied as usual.
+    bool use_mmap = false;
+
+    // Only meaningful with "use_mmap".  Checksumming a mapped entry faults in
+    // all of its pages; setting this to false skips the crc32c check for
+    // mapped entries so that restore cost scales with the pages that are
+    // actually touched.
+    bool verify_mmapped_checksums = true;
   };
   BundleReader(Env* env, absl::string_view prefix, Options options);
 
@@ -256,6 +304,8 @@ class BundleReader {
   // Caller must make sure "val" has the same shape and dtype as the
   // corresponding contents, so that its buffer can be filled without needing
   // extra allocation.  These can be queried via "LookupDtypeAndShape()".
+  // With Options::use_mmap, "val" may instead be replaced by a tensor that
+  // aliases the mapped data file.
   //
   // On error, "val" may contain nonsense data.  Returns a NotFound error if
   // tensor keyed by "key" does not exist in this bundle.
@@ -322,6 +372,13 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Attempts to satisfy GetValue() with a tensor aliasing the memory-mapped
+  // data file.  Sets "*mapped" to false, leaving "val" untouched, if "entry"
+  // is not eligible for zero-copy restore.
+  // REQUIRES: use_mmap_
+  Status GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                        bool* mapped) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -344,6 +401,11 @@ class BundleReader {
   // Owned InputBuffer objects. cache_ owns the underlying RandomAccessFiles.
   std::unordered_map<int32_t, io::InputBuffer*> data_;
 
+  // Memory-mapped data files, keyed by shard id.  Shared with the tensors
+  // that alias them.  A null entry records that mapping the shard failed.
+  std::unordered_map<int32_t, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
+
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
   std::unordered_map<std::string, checkpoint::TensorSliceSet*> tensor_slices_;
@@ -360,6 +422,10 @@ class BundleReader {
 
   bool enable_multi_threading_for_testing_ = false;
 
+  const int64_t read_buffer_size_;
+  const bool use_mmap_ = false;
+  const bool verify_mmapped_checksums_ = true;
+
   BundleReader(const BundleReader&) = delete;
   void operator=(const BundleReader&) = delete;
 };
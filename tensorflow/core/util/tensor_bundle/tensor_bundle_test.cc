@@ -24,6 +24,7 @@ limitations under the License.
 #endif  // _WIN32
 
 #include "absl/status/status.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -1151,6 +1152,158 @@ TEST(TensorBundleTest, LargeVariableLoadingTest) {
   }
 }
 
+TEST(TensorBundleTest, ShardedWriter) {
+  {
+    BundleWriter::Options opts;
+    opts.num_shards = 3;
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_100x100<float>(3)));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<tstring>("two")));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_100x100<int64_t>(1)));
+    TF_ASSERT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("0,2:-"),
+                                 Constant_2x3<float>(4)));
+    TF_ASSERT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("2,2:-"),
+                                 Constant_2x3<float>(5)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  for (int shard = 0; shard < 3; ++shard) {
+    TF_EXPECT_OK(
+        Env::Default()->FileExists(DataFilename(Prefix("foo"), shard, 3)));
+  }
+  {
+    BundleReader reader(Env::Default(), Prefix("foo"));
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_2x3<float>(0));
+    Expect<int64_t>(&reader, "foo_001", Constant_100x100<int64_t>(1));
+    Expect<tstring>(&reader, "foo_002", Constant_2x3<tstring>("two"));
+    Expect<float>(&reader, "foo_003", Constant_100x100<float>(3));
+    Expect<float>(&reader, "part",
+                  test::AsTensor<float>({4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5},
+                                        TensorShape({4, 3})));
+  }
+}
+
+TEST(TensorBundleTest, ShardedWriterCapsShardsAndMerges) {
+  {
+    BundleWriter::Options opts;
+    opts.num_shards = 8;
+    BundleWriter writer(Env::Default(), Prefix("sharded0"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_EXPECT_OK(
+      Env::Default()->FileExists(DataFilename(Prefix("sharded0"), 1, 2)));
+  {
+    BundleWriter writer(Env::Default(), Prefix("sharded1"));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<float>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_ASSERT_OK(MergeBundles(Env::Default(),
+                            {Prefix("sharded0"), Prefix("sharded1")},
+                            Prefix("merged")));
+  BundleReader reader(Env::Default(), Prefix("merged"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ(AllTensorKeys(&reader),
+            std::vector<string>({"foo_000", "foo_001", "foo_002"}));
+  Expect<float>(&reader, "foo_000", Constant_2x3<float>(0));
+  Expect<float>(&reader, "foo_001", Constant_2x3<float>(1));
+  Expect<float>(&reader, "foo_002", Constant_2x3<float>(2));
+}
+
+TEST(TensorBundleTest, ShardedWriterCleansUpWhenRenameFails) {
+  Env* env = Env::Default();
+  const string prefix = Prefix("rename_fails");
+  // A non-empty directory at the name of the second shard makes its rename
+  // fail after the first shard has been renamed.
+  const string blocker = DataFilename(prefix, 1, 3);
+  TF_ASSERT_OK(env->RecursivelyCreateDir(blocker));
+  TF_ASSERT_OK(
+      WriteStringToFile(env, io::JoinPath(blocker, "file"), "contents"));
+  {
+    BundleWriter::Options opts;
+    opts.num_shards = 3;
+    BundleWriter writer(env, prefix, opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<float>(2)));
+    EXPECT_FALSE(writer.Finish().ok());
+  }
+  EXPECT_TRUE(errors::IsNotFound(env->FileExists(MetaFilename(prefix))));
+  EXPECT_TRUE(
+      errors::IsNotFound(env->FileExists(DataFilename(prefix, 0, 3))));
+  EXPECT_TRUE(
+      errors::IsNotFound(env->FileExists(DataFilename(prefix, 2, 3))));
+  std::vector<string> temp_files;
+  TF_ASSERT_OK(env->GetMatchingPaths(strings::StrCat(prefix, "*tempstate*"),
+                                     &temp_files));
+  EXPECT_TRUE(temp_files.empty());
+  int64_t undeleted_files, undeleted_dirs;
+  TF_EXPECT_OK(env->DeleteRecursively(blocker, &undeleted_files,
+                                      &undeleted_dirs));
+}
+
+bool IsMapped(const Tensor& t) {
+  TensorDescription description;
+  t.FillDescription(&description);
+  return description.allocation_description().allocator_name() ==
+         "BundleReaderMmap";
+}
+
+TEST(TensorBundleTest, MmapAlignedEntries) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_100x100<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<int64_t>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<tstring>("two")));
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_100x100<double>(3)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  Tensor survivor;
+  {
+    BundleReader::Options options;
+    options.use_mmap = true;
+    BundleReader reader(Env::Default(), Prefix("foo"), options);
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_100x100<float>(0));
+    Expect<int64_t>(&reader, "foo_001", Constant_2x3<int64_t>(1));
+    Expect<tstring>(&reader, "foo_002", Constant_2x3<tstring>("two"));
+    Expect<double>(&reader, "foo_003", Constant_100x100<double>(3));
+
+    TF_ASSERT_OK(reader.Lookup("foo_000", &survivor));
+    EXPECT_TRUE(IsMapped(survivor));
+    Tensor str;
+    TF_ASSERT_OK(reader.Lookup("foo_002", &str));
+    EXPECT_FALSE(IsMapped(str));
+  }
+  // The mapping outlives the reader.
+  test::ExpectTensorEqual<float>(survivor, Constant_100x100<float>(0));
+}
+
+TEST(TensorBundleTest, MmapMisalignedEntriesAreCopied) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("foo"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant(true, TensorShape({1}))));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("foo"), options);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  TF_ASSERT_OK(reader.Lookup("foo_000", &val));
+  EXPECT_TRUE(IsMapped(val));
+  TF_ASSERT_OK(reader.Lookup("foo_001", &val));
+  EXPECT_FALSE(IsMapped(val));
+  test::ExpectTensorEqual<float>(val, Constant_2x3<float>(1));
+}
+
 absl::Status CreateFile(Env* env, const std::string& fname) {
   std::unique_ptr<WritableFile> file;
   TF_RETURN_IF_ERROR(env->NewWritableFile(fname, &file));
@@ -1296,6 +1449,34 @@ BENCHMARK(BM_BundleAlignment)->ArgPair(4096, 512);
 BENCHMARK(BM_BundleAlignment)->ArgPair(4096, 4096);
 BENCHMARK(BM_BundleAlignment)->ArgPair(4096, 1048576);
 
+static void BM_BundleReaderMmap(::testing::benchmark::State& state) {
+  const bool use_mmap = state.range(0);
+  const int64_t bytes = static_cast<int64_t>(state.range(1)) << 20;
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    TF_CHECK_OK(writer.Add(
+        "big", Constant(static_cast<int8>('a'), TensorShape({bytes}))));
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = use_mmap;
+  options.verify_mmapped_checksums = false;
+  BundleReader reader(Env::Default(), Prefix("foo"), options);
+  TF_CHECK_OK(reader.status());
+  for (auto s : state) {
+    Tensor t(DT_INT8, TensorShape({bytes}));
+    TF_CHECK_OK(reader.Lookup("big", &t));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+BENCHMARK(BM_BundleReaderMmap)->ArgPair(0, 64);
+BENCHMARK(BM_BundleReaderMmap)->ArgPair(1, 64);
+BENCHMARK(BM_BundleReaderMmap)->ArgPair(0, 1024);
+BENCHMARK(BM_BundleReaderMmap)->ArgPair(1, 1024);
+
 static void BM_BundleWriterSmallTensor(::testing::benchmark::State& state) {
   const int64_t bytes = state.range(0);
   Tensor t = Constant(static_cast<int8>('a'), TensorShape{bytes});
@@ -1321,4 +1502,23 @@ static void BM_BundleWriterLargeTensor(::testing::benchmark::State& state) {
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(1 << 10);
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(4 << 10);
 
+static void BM_BundleWriterShards(::testing::benchmark::State& state) {
+  const int num_shards = state.range(0);
+  const int64_t bytes = 64 << 20;
+  constexpr int kNumTensors = 32;
+  Tensor t = Constant(static_cast<int8>('a'), TensorShape{bytes});
+  for (auto s : state) {
+    BundleWriter::Options opts;
+    opts.num_shards = num_shards;
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    for (int i = 0; i < kNumTensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("big", i), t));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  state.SetBytesProcessed(state.iterations() * kNumTensors * bytes);
+}
+
+BENCHMARK(BM_BundleWriterShards)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
 }  // namespace tensorflow
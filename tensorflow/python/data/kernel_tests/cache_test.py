@@ -423,11 +423,49 @@ class MemoryCacheTest(test_base.DatasetTestBase, parameterized.TestCase):
     with self.assertRaises(StopIteration):
       next(iterator)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testMemoryBudget(self):
+    # The budget only fits the first 5 of the 10 elements, the rest are read
+    # from the input again.
+    dataset = dataset_ops.Dataset.range(10).cache(memory_budget=40).repeat(2)
+    self.assertDatasetProduces(dataset, list(range(10)) * 2)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testMemoryBudgetReplaysFirstEpoch(self):
+    # Later epochs replay the cached prefix and resume the input where the
+    # first epoch stopped caching, instead of drawing a new shuffle order.
+    dataset = dataset_ops.Dataset.range(20).shuffle(
+        20, seed=1, reshuffle_each_iteration=True)
+    dataset = dataset.cache(memory_budget=40).repeat(3)
+    get_next = self.getNext(dataset)
+    output = [self.evaluate(get_next()) for _ in range(60)]
+    self.assertCountEqual(output[:20], range(20))
+    self.assertEqual(output[:20], output[20:40])
+    self.assertEqual(output[:20], output[40:])
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next())
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testMemoryBudgetTake(self):
+    dataset = dataset_ops.Dataset.range(10).cache(memory_budget=40)
+    dataset = dataset.take(5).repeat(2)
+    self.assertDatasetProduces(dataset, list(range(5)) * 2)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testInvalidMemoryBudget(self):
+    with self.assertRaisesRegex(ValueError, "memory_budget"):
+      dataset_ops.Dataset.range(10).cache(memory_budget=0)
+
   @combinations.generate(test_base.default_test_combinations())
   def testName(self):
     dataset = dataset_ops.Dataset.from_tensors(42).cache(name="cache")
     self.assertDatasetProduces(dataset, [42])
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testPositionalName(self):
+    dataset = dataset_ops.Dataset.from_tensors(42).cache("", "cache")
+    self.assertDatasetProduces(dataset, [42])
+
 
 class CacheCheckpointTest(checkpoint_test_base.CheckpointTestBase,
                           parameterized.TestCase):
@@ -145,6 +145,10 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.autotune.enabled = True
     options.autotune.cpu_budget = 10
     options.autotune.ram_budget = 20
+    options.autotune.autotune_algorithm = (
+        options_lib.AutotuneAlgorithm.MEASUREMENT_BASED)
+    options.autotune.measurement_interval_ms = 500
+    options.autotune.min_throughput_improvement = 0.05
     options.deterministic = True
     options.experimental_external_state_policy = (
         options_lib.ExternalStatePolicy.FAIL)
@@ -164,6 +168,7 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.experimental_optimization.shuffle_and_repeat_fusion = True
     options.experimental_optimization.seq_interleave_prefetch = True
     options.experimental_warm_start = True
+    options.experimental_read_queue_depth = 16
     options.experimental_slack = True
     options.dataset_name = "test_name"
     options.framework_type = ["TFDS", "TfGrain"]
@@ -175,6 +180,15 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     self.assertEqual(options.framework_type, result.framework_type)
     self.assertEqual(options, result)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadQueueDepthOutOfRange(self):
+    options = options_lib.Options()
+    for read_queue_depth in [-1, 0, 4097]:
+      with self.assertRaisesRegex(ValueError, r"must be in \[1, 4096\]"):
+        options.experimental_read_queue_depth = read_queue_depth
+    options.experimental_read_queue_depth = 4096
+    self.assertEqual(options.experimental_read_queue_depth, 4096)
+
   @combinations.generate(test_base.default_test_combinations())
   def testOptionsProtoDefaultValuesRoundTrip(self):
     options = options_lib.Options()
@@ -148,6 +148,31 @@ class TFRecordDatasetTest(tf_record_test_base.TFRecordTestBase,
           [self._record(j, i) for i in range(self._num_records)])
     self.assertDatasetProduces(dataset, expected_output=expected_output)
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(compression_type=["", "GZIP"])))
+  def testReadWithQueuedReads(self, compression_type):
+    filenames = self._filenames
+    if compression_type:
+      filenames = []
+      for i, fn in enumerate(self._filenames):
+        with open(fn, "rb") as f:
+          gzfn = os.path.join(self.get_temp_dir(), "tfrecord_%s.gz" % i)
+          with gzip.GzipFile(gzfn, "wb") as gzf:
+            gzf.write(f.read())
+          filenames.append(gzfn)
+    dataset = readers.TFRecordDataset(
+        filenames, compression_type, buffer_size=16)
+    options = options_lib.Options()
+    options.experimental_read_queue_depth = 4
+    dataset = dataset.with_options(options)
+    expected_output = []
+    for j in range(self._num_files):
+      expected_output.extend(
+          [self._record(j, i) for i in range(self._num_records)])
+    self.assertDatasetProduces(dataset, expected_output=expected_output)
+
   @combinations.generate(test_base.default_test_combinations())
   def testReadFromDatasetOfFiles(self):
     files = dataset_ops.Dataset.from_tensor_slices(self._filenames)
@@ -22,28 +22,36 @@ from tensorflow.python.framework import ops
 from tensorflow.python.ops import gen_dataset_ops
 
 
-def _cache(input_dataset, filename, name):  # pylint: disable=unused-private-name
-  return CacheDataset(input_dataset, filename, name)
+def _cache(input_dataset, filename, name, memory_budget):  # pylint: disable=unused-private-name
+  return CacheDataset(input_dataset, filename, name, memory_budget)
 
 
 class CacheDataset(dataset_ops.UnaryUnchangedStructureDataset):
   """A `Dataset` that caches elements of its input."""
 
-  def __init__(self, input_dataset, filename, name=None):
+  def __init__(self, input_dataset, filename, name=None, memory_budget=None):
     """See `Dataset.cache()` for details."""
     self._input_dataset = input_dataset
     self._filename = ops.convert_to_tensor(
         filename, dtype=dtypes.string, name="filename")
     self._name = name
+    kwargs = {}
+    if memory_budget is not None:
+      if memory_budget <= 0:
+        raise ValueError(
+            f"`memory_budget` must be positive, but got {memory_budget}.")
+      kwargs["memory_budget"] = memory_budget
     if tf2.enabled() and (context.executing_eagerly() or ops.inside_function()):
       variant_tensor = gen_dataset_ops.cache_dataset_v2(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
           cache=gen_dataset_ops.dummy_memory_cache(),
+          **kwargs,
           **self._common_args)
     else:
       variant_tensor = gen_dataset_ops.cache_dataset(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
+          **kwargs,
           **self._common_args)
     super().__init__(input_dataset, variant_tensor)
@@ -1510,7 +1510,7 @@ class DatasetV2(
     return shuffle_op._shuffle(  # pylint: disable=protected-access
         self, buffer_size, seed, reshuffle_each_iteration, name=name)
 
-  def cache(self, filename="", name=None) -> "DatasetV2":
+  def cache(self, filename="", name=None, memory_budget=None) -> "DatasetV2":
     """Caches the elements in this dataset.
 
     The first time the dataset is iterated over, its elements will be cached
@@ -1552,11 +1552,34 @@ class DatasetV2(
     through the dataset. If you wish to randomize the iteration order, make sure
     to call `shuffle` *after* calling `cache`.
 
+    When caching in memory, `memory_budget` limits the cache to the given number
+    of bytes, so that a dataset that doesn't fit in memory can still serve part
+    of its elements from the cache. The cache holds the longest prefix of the
+    dataset that fits within the budget. Later iterations read that prefix from
+    memory and then continue reading the input dataset from a checkpoint taken
+    by the first iteration, so cached elements are not computed again. As with
+    `cache()`, every iteration produces the elements of the first one, in the
+    same order.
+
+    The input dataset must be deterministic and must not depend on external
+    state, such as random ops without a seed or a `tf.py_function`. Otherwise
+    its state can't be checkpointed, and iterations only read elements from the
+    cache if the whole dataset fits within the budget. A warning is logged in
+    that case.
+
+    ```python
+    dataset = tf.data.TFRecordDataset(filenames)
+    dataset = dataset.cache(memory_budget=8 << 30)
+    ```
+
     Args:
       filename: A `tf.string` scalar `tf.Tensor`, representing the name of a
         directory on the filesystem to use for caching elements in this Dataset.
         If a filename is not provided, the dataset will be cached in memory.
       name: (Optional.) A name for the tf.data operation.
+      memory_budget: (Optional.) A Python integer, representing the maximum
+        number of bytes of elements to cache in memory. If not set, all elements
+        are cached. Can't be combined with `filename`.
 
     Returns:
       A new `Dataset` with the transformation applied as described above.
@@ -1565,7 +1588,7 @@ class DatasetV2(
     # -> dataset_ops).
     # pylint: disable=g-import-not-at-top,protected-access
     from tensorflow.python.data.ops import cache_op
-    return cache_op._cache(self, filename, name)
+    return cache_op._cache(self, filename, name, memory_budget)
     # pylint: enable=g-import-not-at-top,protected-access
 
   def take(self, count, name=None) -> "DatasetV2":
@@ -4055,8 +4078,10 @@ class DatasetV1(DatasetV2, data_types.DatasetV1):
             buffer_size, seed, reshuffle_each_iteration, name=name))
 
   @functools.wraps(DatasetV2.cache)
-  def cache(self, filename="", name=None):
-    return DatasetV1Adapter(super(DatasetV1, self).cache(filename, name=name))
+  def cache(self, filename="", name=None, memory_budget=None):
+    return DatasetV1Adapter(
+        super(DatasetV1, self).cache(
+            filename, name=name, memory_budget=memory_budget))
 
   @functools.wraps(DatasetV2.take)
   def take(self, count, name=None):
@@ -26,6 +26,16 @@ from tensorflow.python.data.util import options as options_lib
 from tensorflow.python.util import deprecation
 from tensorflow.python.util.tf_export import tf_export
 
+# Must match `kMaxReadQueueDepth` in tensorflow/core/data/queued_read_file.h.
+_MAX_READ_QUEUE_DEPTH = 4096
+
+
+def _validate_read_queue_depth(value):
+  if value <= 0 or value > _MAX_READ_QUEUE_DEPTH:
+    raise ValueError(
+        "`experimental_read_queue_depth` must be in [1, "
+        f"{_MAX_READ_QUEUE_DEPTH}], got {value}.")
+
 
 @tf_export("data.experimental.AutotuneAlgorithm")
 class AutotuneAlgorithm(enum.Enum):
@@ -45,12 +55,18 @@ class AutotuneAlgorithm(enum.Enum):
 
   STAGE_BASED: In each optimization step, this algorithm chooses the worst
   bottleneck parameter and increases its value by 1.
+
+  MEASUREMENT_BASED: In each optimization step, this algorithm changes the
+  parameter of the bottleneck found from the measured wait times of
+  asynchronous transformations, and keeps the change only if the measured
+  throughput of the input pipeline improves.
   """
   DEFAULT = 0
   HILL_CLIMB = 1
   GRADIENT_DESCENT = 2
   MAX_PARALLELISM = 3
   STAGE_BASED = 4
+  MEASUREMENT_BASED = 5
 
   @classmethod
   def _to_proto(cls, obj):
@@ -64,9 +80,12 @@ class AutotuneAlgorithm(enum.Enum):
       return model_pb2.AutotuneAlgorithm.MAX_PARALLELISM
     if obj == cls.STAGE_BASED:
       return model_pb2.AutotuneAlgorithm.STAGE_BASED
+    if obj == cls.MEASUREMENT_BASED:
+      return model_pb2.AutotuneAlgorithm.MEASUREMENT_BASED
     raise ValueError(
         f"Invalid `obj.` Supported values include `DEFAULT`, `HILL_CLIMB` "
-        f"`GRADIENT_DESCENT`, and `STAGE_BASED`. Got {obj.name}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED`, and `MEASUREMENT_BASED`. "
+        f"Got {obj.name}.")
 
   @classmethod
   def _from_proto(cls, pb):
@@ -80,9 +99,12 @@ class AutotuneAlgorithm(enum.Enum):
       return cls.MAX_PARALLELISM
     if pb == model_pb2.AutotuneAlgorithm.STAGE_BASED:
       return cls.STAGE_BASED
+    if pb == model_pb2.AutotuneAlgorithm.MEASUREMENT_BASED:
+      return cls.MEASUREMENT_BASED
     raise ValueError(
         f"Invalid `pb.` Supported values include `DEFAULT`, `HILL_CLIMB`, "
-        f"`GRADIENT_DESCENT` and `STAGE_BASED`. Got {pb}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED` and `MEASUREMENT_BASED`. "
+        f"Got {pb}.")
 
 
 @tf_export("data.experimental.AutoShardPolicy")
@@ -241,6 +263,29 @@ class AutotuneOptions(options_lib.OptionsBase):
       ),
   )
 
+  measurement_interval_ms = options_lib.create_option(
+      name="measurement_interval_ms",
+      ty=int,
+      docstring=(
+          "When autotuning with the `MEASUREMENT_BASED` algorithm, determines"
+          " the time in milliseconds for which the throughput of each"
+          " configuration is measured. Longer intervals make the measurements"
+          " less noisy, but keep worse configurations for longer. If None,"
+          " defaults to 1000."
+      ),
+  )
+
+  min_throughput_improvement = options_lib.create_option(
+      name="min_throughput_improvement",
+      ty=float,
+      docstring=(
+          "When autotuning with the `MEASUREMENT_BASED` algorithm, determines"
+          " the relative change of the throughput a parameter change has to"
+          " make for it to be kept. Higher values converge faster but may"
+          " settle for less throughput. If None, defaults to 0.02."
+      ),
+  )
+
   def _to_proto(self):
     pb = dataset_options_pb2.AutotuneOptions()
     if self.enabled is not None:
@@ -254,6 +299,10 @@ class AutotuneOptions(options_lib.OptionsBase):
           self.autotune_algorithm)
     if self.initial_parallelism is not None:
       pb.initial_parallelism = self.initial_parallelism
+    if self.measurement_interval_ms is not None:
+      pb.measurement_interval_ms = self.measurement_interval_ms
+    if self.min_throughput_improvement is not None:
+      pb.min_throughput_improvement = self.min_throughput_improvement
     return pb
 
   def _from_proto(self, pb):
@@ -268,6 +317,10 @@ class AutotuneOptions(options_lib.OptionsBase):
           pb.autotune_algorithm)
     if pb.WhichOneof("optional_initial_parallelism") is not None:
       self.initial_parallelism = pb.initial_parallelism
+    if pb.WhichOneof("optional_measurement_interval_ms") is not None:
+      self.measurement_interval_ms = pb.measurement_interval_ms
+    if pb.WhichOneof("optional_min_throughput_improvement") is not None:
+      self.min_throughput_improvement = pb.min_throughput_improvement
 
   def _set_mutable(self, mutable):
     """Change the mutability value to `mutable` on this options and children."""
@@ -656,6 +709,17 @@ class Options(options_lib.OptionsBase):
       "Note that symbolic checkpointing is not supported for "
       "transformations that can reorder elements.")
 
+  experimental_read_queue_depth = options_lib.create_option(
+      name="experimental_read_queue_depth",
+      ty=int,
+      docstring="If set, source datasets that support it (currently "
+      "`tf.data.TFRecordDataset`) read local files ahead of the reader, keeping "
+      "up to this many block reads in flight. Reads are submitted through "
+      "io_uring where the kernel supports it, and otherwise fall back to "
+      "blocking reads. Must be in [1, 4096]. If None, files are read through "
+      "the file system without read-ahead.",
+      validator=_validate_read_queue_depth)
+
   experimental_service = options_lib.create_option(
       name="experimental_service",
       ty=ServiceOptions,
@@ -745,6 +809,8 @@ class Options(options_lib.OptionsBase):
           ExternalStatePolicy._to_proto(  # pylint: disable=protected-access
               self.experimental_external_state_policy))
     pb.optimization_options.CopyFrom(self.experimental_optimization._to_proto())  # pylint: disable=protected-access
+    if self.experimental_read_queue_depth is not None:
+      pb.read_queue_depth = self.experimental_read_queue_depth
     if self.experimental_slack is not None:
       pb.slack = self.experimental_slack
     if self.experimental_symbolic_checkpoint is not None:
@@ -770,6 +836,8 @@ class Options(options_lib.OptionsBase):
           ExternalStatePolicy._from_proto(  # pylint: disable=protected-access
               pb.external_state_policy))
     self.experimental_optimization._from_proto(pb.optimization_options)  # pylint: disable=protected-access
+    if pb.WhichOneof("optional_read_queue_depth") is not None:
+      self.experimental_read_queue_depth = pb.read_queue_depth
     if pb.WhichOneof("optional_slack") is not None:
       self.experimental_slack = pb.slack
     if pb.WhichOneof("optional_symbolic_checkpoint") is not None:
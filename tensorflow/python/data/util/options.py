@@ -81,7 +81,11 @@ def graph_rewrites():
                                 ["enabled", "disabled", "default"])
 
 
-def create_option(name, ty, docstring, default_factory=lambda: None):
+def create_option(name,
+                  ty,
+                  docstring,
+                  default_factory=lambda: None,
+                  validator=None):
   """Creates a type-checked property.
 
   Args:
@@ -91,6 +95,8 @@ def create_option(name, ty, docstring, default_factory=lambda: None):
     docstring: The docstring to use.
     default_factory: A callable that takes no arguments and returns a default
       value to use if not set.
+    validator: (Optional.) A callable that takes the value the property is set
+      to and raises `ValueError` if it is invalid.
 
   Returns:
     A type-checked property.
@@ -107,6 +113,8 @@ def create_option(name, ty, docstring, default_factory=lambda: None):
       raise TypeError(
           "Property \"{}\" must be of type {}, got: {} (type: {})".format(
               name, ty, value, type(value)))
+    if validator is not None:
+      validator(value)
     option._options[name] = value  # pylint: disable=protected-access
 
   return property(get_fn, set_fn, None, docstring)
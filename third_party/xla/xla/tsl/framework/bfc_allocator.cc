@@ -29,9 +29,11 @@ limitations under the License.
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "xla/tsl/framework/allocator.h"
 #include "xla/tsl/framework/allocator_retry.h"
 #include "xla/tsl/profiler/utils/trace_filter_utils.h"
@@ -53,6 +55,86 @@ const uint64_t kDefaultMemoryFilterMask = tsl::profiler::TraceMeFiltersToMask(
 
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
 
+namespace {
+
+void UpdateMax(std::atomic<int64_t>* max, int64_t value) {
+  int64_t current = max->load(std::memory_order_relaxed);
+  while (value > current &&
+         !max->compare_exchange_weak(current, value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+// Idle chunks of one thread, by size class.  The mutex is only contended when
+// another thread flushes all caches.
+struct BFCAllocator::ThreadCache {
+  static constexpr int kNumSizeClasses =
+      kMaxThreadCachedBytes / kMinAllocationSize;
+
+  static int SizeClass(size_t rounded_bytes) {
+    return rounded_bytes / kMinAllocationSize - 1;
+  }
+
+  absl::Mutex mu;
+  std::array<std::vector<CachedChunk>, kNumSizeClasses> free_chunks
+      ABSL_GUARDED_BY(mu);
+};
+
+struct BFCAllocator::ThreadCacheState {
+  ThreadCacheState(int capacity, BFCAllocator* allocator)
+      : capacity(capacity), id(next_id.fetch_add(1)), allocator(allocator) {}
+
+  const int capacity;
+  // Identifies the allocator in the thread-local cache maps.  Unlike the
+  // allocator address, it is never reused.
+  const uint64 id;
+  static std::atomic<uint64> next_id;
+
+  // The allocator until it starts being destroyed, after which exiting
+  // threads leave their idle chunks to be freed with the regions.  Acquired
+  // before the allocator's mutex.
+  absl::Mutex allocator_mu;
+  BFCAllocator* allocator ABSL_GUARDED_BY(allocator_mu);
+
+  absl::Mutex caches_mu;
+  std::vector<std::unique_ptr<ThreadCache>> caches ABSL_GUARDED_BY(caches_mu);
+
+  // Every chunk moved out of the bins by a refill, whether idle in a cache or
+  // handed out to a user, until it is released back to the bins.  Lets
+  // DeallocateRaw recognize such chunks without taking the allocator lock.
+  struct ChunkInfo {
+    size_t rounded_bytes;  // Size class the chunk is cached under.
+    size_t size;
+  };
+  struct IndexShard {
+    absl::Mutex mu;
+    absl::flat_hash_map<const void*, ChunkInfo> chunks ABSL_GUARDED_BY(mu);
+  };
+  static constexpr int kNumIndexShards = 64;
+  std::array<IndexShard, kNumIndexShards> index;
+
+  IndexShard& IndexShardFor(const void* ptr) {
+    return index[(reinterpret_cast<uintptr_t>(ptr) >> kMinAllocationBits) %
+                 kNumIndexShards];
+  }
+
+  void Unregister(const void* ptr) {
+    IndexShard& shard = IndexShardFor(ptr);
+    absl::MutexLock l(&shard.mu);
+    shard.chunks.erase(ptr);
+  }
+
+  // Stats as seen by users, i.e. excluding idle cached chunks.
+  std::atomic<int64_t> bytes_in_use{0};
+  std::atomic<int64_t> peak_bytes_in_use{0};
+  std::atomic<int64_t> num_allocs{0};
+  std::atomic<int64_t> largest_alloc_size{0};
+};
+
+std::atomic<uint64> BFCAllocator::ThreadCacheState::next_id{1};
+
 BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
                            size_t total_memory, const string& name,
                            const Options& opts)
@@ -98,9 +180,20 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
       CHECK_NE(BinForSize(bin_size * 2), BinFromIndex(b));
     }
   }
+
+  if (opts.thread_cache_capacity > 0) {
+    thread_cache_ =
+        std::make_shared<ThreadCacheState>(opts.thread_cache_capacity, this);
+  }
 }
 
 BFCAllocator::~BFCAllocator() {
+  if (thread_cache_ != nullptr) {
+    // Waits for the threads exiting concurrently to release their caches.
+    absl::MutexLock l(&thread_cache_->allocator_mu);
+    thread_cache_->allocator = nullptr;
+  }
+
   // Lock the mutex to make sure that all memory effects are safely published
   // and available to a thread running the destructor (i.e., deallocations
   // happened on a different thread right before the destructor).
@@ -278,6 +371,11 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes;
+  if (thread_cache_ != nullptr) {
+    if (void* ptr = AllocateFromThreadCache(num_bytes)) {
+      return ptr;
+    }
+  }
   void* result = [&] {
     if (!opts_.allow_retry_on_failure || !allocation_attr.retry_on_failure) {
       // If we have globally disabled retry-on-failure and fail to allocate an
@@ -324,6 +422,9 @@ void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                           allocation_attr);
     }
   }();
+  if (thread_cache_ != nullptr && result != nullptr) {
+    RecordUserAllocation(AllocatedSize(result));
+  }
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " " << result;
   VLOG(4) << "[mem-debug] AllocateRaw," << Name() << "," << num_bytes << ","
           << result << "," << tsl::CurrentStackTrace();
@@ -480,6 +581,15 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Chunks idling in the thread caches may coalesce into one that fits.
+  if (thread_cache_ != nullptr && FlushThreadCaches()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      AddTraceMe("MemoryAllocation", ptr);
+      return ptr;
+    }
+  }
+
   // Reaching this point means that no chunks can satisfy the request. Also,
   // the unallocated bytes cannot satisfy the request. Before giving up, let's
   // try deallocating free regions so that suballocator can combine them with
@@ -703,6 +813,12 @@ void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(4) << "[mem-debug] DeallocateRaw," << Name() << ","
           << (ptr ? RequestedSize(ptr) : 0) << "," << ptr << ","
           << tsl::CurrentStackTrace();
+  if (thread_cache_ != nullptr && ptr != nullptr) {
+    if (DeallocateToThreadCache(ptr)) {
+      return;
+    }
+    RecordUserDeallocation(AllocatedSize(ptr));
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -713,7 +829,10 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     return;
   }
   absl::MutexLock l(&mutex_);
+  DeallocateRawInternalLocked(ptr);
+}
 
+void BFCAllocator::DeallocateRawInternalLocked(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -742,6 +861,209 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   }
 }
 
+BFCAllocator::ThreadCache* BFCAllocator::GetThreadCache() {
+  // Releases the cache of the thread when it exits, unless the allocator is
+  // gone by then.
+  struct CacheReleaser {
+    std::weak_ptr<ThreadCacheState> state;
+    ThreadCache* cache;
+
+    ~CacheReleaser() {
+      std::shared_ptr<ThreadCacheState> locked_state = state.lock();
+      if (locked_state == nullptr) return;
+      absl::MutexLock l(&locked_state->allocator_mu);
+      if (locked_state->allocator != nullptr) {
+        locked_state->allocator->ReleaseThreadCache(cache);
+      }
+    }
+  };
+  thread_local absl::flat_hash_map<uint64, std::unique_ptr<CacheReleaser>>
+      releasers;
+  std::unique_ptr<CacheReleaser>& releaser = releasers[thread_cache_->id];
+  if (releaser == nullptr) {
+    // Owned by the allocator, which may flush it from any thread.
+    auto owned = std::make_unique<ThreadCache>();
+    releaser.reset(new CacheReleaser{thread_cache_, owned.get()});
+    absl::MutexLock l(&thread_cache_->caches_mu);
+    thread_cache_->caches.push_back(std::move(owned));
+  }
+  return releaser->cache;
+}
+
+void BFCAllocator::ReleaseThreadCache(ThreadCache* cache) {
+  std::vector<CachedChunk> chunks;
+  {
+    absl::MutexLock l(&thread_cache_->caches_mu);
+    auto it = std::find_if(
+        thread_cache_->caches.begin(), thread_cache_->caches.end(),
+        [cache](const std::unique_ptr<ThreadCache>& c) {
+          return c.get() == cache;
+        });
+    DCHECK(it != thread_cache_->caches.end());
+    {
+      absl::MutexLock cl(&cache->mu);
+      for (std::vector<CachedChunk>& free_chunks : cache->free_chunks) {
+        chunks.insert(chunks.end(), free_chunks.begin(), free_chunks.end());
+      }
+    }
+    thread_cache_->caches.erase(it);
+  }
+  if (!chunks.empty()) {
+    ReleaseThreadCacheChunks(chunks);
+  }
+}
+
+void* BFCAllocator::AllocateFromThreadCache(size_t num_bytes) {
+  if (num_bytes == 0 || num_bytes > kMaxThreadCachedBytes) {
+    return nullptr;
+  }
+  const size_t rounded_bytes = RoundedBytes(num_bytes);
+  const int size_class = ThreadCache::SizeClass(rounded_bytes);
+  ThreadCache* cache = GetThreadCache();
+  CachedChunk chunk = {nullptr, 0};
+  {
+    absl::MutexLock l(&cache->mu);
+    std::vector<CachedChunk>& free_chunks = cache->free_chunks[size_class];
+    if (!free_chunks.empty()) {
+      chunk = free_chunks.back();
+      free_chunks.pop_back();
+    }
+  }
+  if (chunk.ptr == nullptr) {
+    // Refill half of the capacity, leaving room for as many frees before the
+    // cache overflows.
+    std::vector<CachedChunk> refill;
+    if (RefillThreadCacheChunks(rounded_bytes,
+                                std::max(1, thread_cache_->capacity / 2),
+                                &refill) == 0) {
+      return nullptr;
+    }
+    chunk = refill.back();
+    refill.pop_back();
+    if (!refill.empty()) {
+      absl::MutexLock l(&cache->mu);
+      std::vector<CachedChunk>& free_chunks = cache->free_chunks[size_class];
+      free_chunks.insert(free_chunks.end(), refill.begin(), refill.end());
+    }
+  }
+  RecordUserAllocation(chunk.size);
+  return chunk.ptr;
+}
+
+bool BFCAllocator::DeallocateToThreadCache(void* ptr) {
+  ThreadCacheState::ChunkInfo info;
+  {
+    ThreadCacheState::IndexShard& shard = thread_cache_->IndexShardFor(ptr);
+    absl::MutexLock l(&shard.mu);
+    auto it = shard.chunks.find(ptr);
+    if (it == shard.chunks.end()) {
+      return false;
+    }
+    info = it->second;
+  }
+  RecordUserDeallocation(info.size);
+
+  ThreadCache* cache = GetThreadCache();
+  std::vector<CachedChunk> overflow;
+  {
+    absl::MutexLock l(&cache->mu);
+    std::vector<CachedChunk>& free_chunks =
+        cache->free_chunks[ThreadCache::SizeClass(info.rounded_bytes)];
+    free_chunks.push_back({ptr, info.size});
+    if (free_chunks.size() > static_cast<size_t>(thread_cache_->capacity)) {
+      // Keep the most recently freed half, which is the most likely to still
+      // be in the CPU caches.
+      auto keep = free_chunks.end() - thread_cache_->capacity / 2;
+      overflow.assign(free_chunks.begin(), keep);
+      free_chunks.erase(free_chunks.begin(), keep);
+    }
+  }
+  if (!overflow.empty()) {
+    ReleaseThreadCacheChunks(overflow);
+  }
+  return true;
+}
+
+int BFCAllocator::RefillThreadCacheChunks(size_t rounded_bytes, int n,
+                                          std::vector<CachedChunk>* out) {
+  const BinNum bin_num = BinNumForSize(rounded_bytes);
+  absl::MutexLock l(&mutex_);
+  if (!timestamped_chunks_.empty()) {
+    MergeTimestampedChunks(0);
+  }
+  int num_chunks = 0;
+  for (; num_chunks < n; ++num_chunks) {
+    void* ptr = FindChunkPtr(bin_num, rounded_bytes, rounded_bytes, 0);
+    if (ptr == nullptr) {
+      // Only grow the pool for the chunk actually requested; a partial batch
+      // is good enough otherwise.
+      if (num_chunks > 0 || !Extend(kAllocatorAlignment, rounded_bytes)) {
+        break;
+      }
+      ptr = FindChunkPtr(bin_num, rounded_bytes, rounded_bytes, 0);
+      if (ptr == nullptr) {
+        break;
+      }
+    }
+    const size_t size = ChunkFromHandle(region_manager_.get_handle(ptr))->size;
+    {
+      ThreadCacheState::IndexShard& shard = thread_cache_->IndexShardFor(ptr);
+      absl::MutexLock sl(&shard.mu);
+      shard.chunks[ptr] = {rounded_bytes, size};
+    }
+    out->push_back({ptr, size});
+  }
+  return num_chunks;
+}
+
+void BFCAllocator::ReleaseThreadCacheChunks(
+    absl::Span<const CachedChunk> chunks) {
+  {
+    absl::MutexLock l(&mutex_);
+    for (const CachedChunk& chunk : chunks) {
+      thread_cache_->Unregister(chunk.ptr);
+      DeallocateRawInternalLocked(chunk.ptr);
+    }
+  }
+  retry_helper_.NotifyDealloc();
+}
+
+bool BFCAllocator::FlushThreadCaches() {
+  std::vector<CachedChunk> chunks;
+  {
+    absl::MutexLock l(&thread_cache_->caches_mu);
+    for (const auto& cache : thread_cache_->caches) {
+      absl::MutexLock cl(&cache->mu);
+      for (std::vector<CachedChunk>& free_chunks : cache->free_chunks) {
+        chunks.insert(chunks.end(), free_chunks.begin(), free_chunks.end());
+        free_chunks.clear();
+      }
+    }
+  }
+  for (const CachedChunk& chunk : chunks) {
+    thread_cache_->Unregister(chunk.ptr);
+    DeallocateRawInternalLocked(chunk.ptr);
+  }
+  if (!chunks.empty()) {
+    VLOG(1) << "Flushed " << chunks.size() << " chunks from the thread caches"
+            << " of allocator " << Name();
+  }
+  return !chunks.empty();
+}
+
+void BFCAllocator::RecordUserAllocation(size_t bytes) {
+  const int64_t bytes_in_use =
+      thread_cache_->bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) +
+      bytes;
+  thread_cache_->num_allocs.fetch_add(1, std::memory_order_relaxed);
+  UpdateMax(&thread_cache_->peak_bytes_in_use, bytes_in_use);
+  UpdateMax(&thread_cache_->largest_alloc_size, bytes);
+}
+
+void BFCAllocator::RecordUserDeallocation(size_t bytes) {
+  thread_cache_->bytes_in_use.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
 // We merge Chunk(h2) into Chunk(h1).
 void BFCAllocator::Merge(BFCAllocator::ChunkHandle h1,
@@ -1227,7 +1549,14 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 
 std::optional<AllocatorStats> BFCAllocator::GetStats() {
   absl::MutexLock l(&mutex_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  if (thread_cache_ != nullptr) {
+    stats.num_allocs = thread_cache_->num_allocs.load();
+    stats.bytes_in_use = thread_cache_->bytes_in_use.load();
+    stats.peak_bytes_in_use = thread_cache_->peak_bytes_in_use.load();
+    stats.largest_alloc_size = thread_cache_->largest_alloc_size.load();
+  }
+  return stats;
 }
 
 bool BFCAllocator::ClearStats() {
@@ -1235,6 +1564,11 @@ bool BFCAllocator::ClearStats() {
   stats_.num_allocs = 0;
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
+  if (thread_cache_ != nullptr) {
+    thread_cache_->num_allocs = 0;
+    thread_cache_->peak_bytes_in_use = thread_cache_->bytes_in_use.load();
+    thread_cache_->largest_alloc_size = 0;
+  }
   return true;
 }
 
@@ -30,6 +30,7 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "xla/tsl/framework/allocator.h"
 #include "xla/tsl/framework/allocator_retry.h"
 #include "xla/tsl/framework/shared_counter.h"
@@ -73,6 +74,18 @@ class BFCAllocator : public Allocator {
     // Controls when a chunk should be split, if its size exceeds the requested
     // allocation size.
     double fragmentation_fraction = 0;
+
+    // If > 0, small allocations (up to kMaxThreadCachedBytes) are served from
+    // per-thread caches of chunks, keeping up to this many chunks per size
+    // class and thread.  Caches are refilled from, and flushed back to, the
+    // bins in batches, so that most small AllocateRaw/DeallocateRaw calls do
+    // not take the allocator-wide lock.
+    //
+    // Cached chunks are reused without regard to the safe frontier, so this is
+    // only suitable for host memory.  While a chunk is reused from a cache,
+    // RequestedSize() reports its size class and AllocationId() is not
+    // refreshed.  GetStats() excludes idle cached chunks from bytes_in_use.
+    int thread_cache_capacity = 0;
   };
   BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator, size_t total_memory,
                const string& name, const Options& opts);
@@ -112,8 +125,49 @@ class BFCAllocator : public Allocator {
 
   MemoryDump RecordMemoryMap();
 
+  // Largest allocation served from the per-thread caches enabled by
+  // Options::thread_cache_capacity.
+  static constexpr size_t kMaxThreadCachedBytes = 32 << 10;
+
  private:
   struct Bin;
+  struct ThreadCache;
+  struct ThreadCacheState;
+  struct CachedChunk {
+    void* ptr;
+    size_t size;  // Full size of the chunk, as accounted in stats.
+  };
+
+  // Fast paths for small allocations when thread caching is enabled.
+  // Returns nullptr (resp. false) if the request must take the regular path.
+  void* AllocateFromThreadCache(size_t num_bytes);
+  bool DeallocateToThreadCache(void* ptr);
+
+  // Returns the cache of the calling thread, creating it on first use.
+  ThreadCache* GetThreadCache();
+
+  // Drops the cache of a thread that is exiting and returns its idle chunks
+  // to the bins.
+  void ReleaseThreadCache(ThreadCache* cache) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Moves up to "n" free chunks of "rounded_bytes" bytes from the bins into
+  // "out", marking them in use.  Returns the number of chunks moved.
+  int RefillThreadCacheChunks(size_t rounded_bytes, int n,
+                              std::vector<CachedChunk>* out)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns cached chunks to the bins.
+  void ReleaseThreadCacheChunks(absl::Span<const CachedChunk> chunks)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the idle chunks held by all thread caches to the bins.  Returns
+  // true if any chunk was released.
+  bool FlushThreadCaches() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Keeps the user-visible stats, which exclude idle cached chunks, when
+  // thread caching is enabled.
+  void RecordUserAllocation(size_t bytes);
+  void RecordUserDeallocation(size_t bytes);
 
   void* AllocateRawInternal(size_t alignment, size_t num_bytes,
                             bool dump_log_on_failure,
@@ -125,6 +179,10 @@ class BFCAllocator : public Allocator {
 
   void DeallocateRawInternal(void* ptr);
 
+  // Frees the chunk holding "ptr".
+  void DeallocateRawInternalLocked(void* ptr)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -595,6 +653,10 @@ class BFCAllocator : public Allocator {
   // Stats.
   AllocatorStats stats_ ABSL_GUARDED_BY(mutex_);
 
+  // Only set if Options::thread_cache_capacity > 0.  Shared with the threads
+  // that have a cache, which release it when they exit.
+  std::shared_ptr<ThreadCacheState> thread_cache_;
+
 #ifdef TENSORFLOW_MEM_DEBUG
   int64 action_counter_ ABSL_GUARDED_BY(mutex_);
 #define MEM_DEBUG_SIZE_HISTORY_SIZE 4096
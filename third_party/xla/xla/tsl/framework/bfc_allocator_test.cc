@@ -0,0 +1,203 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/tsl/framework/bfc_allocator.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "xla/tsl/framework/allocator.h"
+#include "xla/tsl/protobuf/bfc_memory_map.pb.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/logging.h"
+#include "tsl/platform/mem.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+#include "tsl/platform/threadpool.h"
+
+namespace tsl {
+namespace {
+
+class MallocSubAllocator : public SubAllocator {
+ public:
+  MallocSubAllocator() : SubAllocator({}, {}) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    *bytes_received = num_bytes;
+    return port::AlignedMalloc(num_bytes, static_cast<int>(alignment));
+  }
+
+  void Free(void* ptr, size_t num_bytes) override { port::AlignedFree(ptr); }
+
+  bool SupportsCoalescing() const override { return false; }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+};
+
+std::unique_ptr<BFCAllocator> NewAllocator(size_t total_memory,
+                                           int thread_cache_capacity) {
+  BFCAllocator::Options opts;
+  opts.thread_cache_capacity = thread_cache_capacity;
+  return std::make_unique<BFCAllocator>(std::make_unique<MallocSubAllocator>(),
+                                        total_memory, "bfc_test", opts);
+}
+
+TEST(BFCAllocatorThreadCacheTest, ReusesFreedChunks) {
+  auto a = NewAllocator(1 << 20, /*thread_cache_capacity=*/8);
+  void* p1 = a->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  ASSERT_NE(p1, nullptr);
+  EXPECT_EQ(a->AllocatedSize(p1), 1024);
+  EXPECT_EQ(a->GetStats()->bytes_in_use, 1024);
+  a->DeallocateRaw(p1);
+  EXPECT_EQ(a->GetStats()->bytes_in_use, 0);
+
+  // Any request rounding to the same size class gets the chunk back.
+  void* p2 = a->AllocateRaw(Allocator::kAllocatorAlignment, 900);
+  EXPECT_EQ(p1, p2);
+  EXPECT_EQ(a->RequestedSize(p2), 1024);
+  a->DeallocateRaw(p2);
+
+  std::optional<AllocatorStats> stats = a->GetStats();
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->peak_bytes_in_use, 1024);
+  EXPECT_EQ(stats->num_allocs, 2);
+  EXPECT_EQ(stats->largest_alloc_size, 1024);
+}
+
+TEST(BFCAllocatorThreadCacheTest, LargeAllocationsBypassCache) {
+  auto a = NewAllocator(1 << 20, /*thread_cache_capacity=*/8);
+  const size_t num_bytes = BFCAllocator::kMaxThreadCachedBytes + 1;
+  void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(a->RequestedSize(p), num_bytes);
+  a->DeallocateRaw(p);
+
+  std::optional<AllocatorStats> stats = a->GetStats();
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->num_allocs, 1);
+}
+
+TEST(BFCAllocatorThreadCacheTest, FlushesCachesWhenOutOfMemory) {
+  const size_t total_memory = 1 << 20;
+  auto a = NewAllocator(total_memory, /*thread_cache_capacity=*/64);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 32; ++i) {
+    ptrs.push_back(a->AllocateRaw(Allocator::kAllocatorAlignment, 4096));
+    ASSERT_NE(ptrs.back(), nullptr);
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+
+  // Only fits once the idle cached chunks are coalesced back into the pool.
+  void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, total_memory);
+  ASSERT_NE(p, nullptr);
+  a->DeallocateRaw(p);
+  EXPECT_EQ(a->GetStats()->bytes_in_use, 0);
+}
+
+TEST(BFCAllocatorThreadCacheTest, StatsAreExactAcrossThreads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumIters = 1000;
+  auto a = NewAllocator(64 << 20, /*thread_cache_capacity=*/16);
+  {
+    thread::ThreadPool pool(Env::Default(), "bfc_test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&a, t]() {
+        std::vector<void*> ptrs;
+        for (int i = 0; i < kNumIters; ++i) {
+          const size_t num_bytes = 256 * (1 + (i + t) % 16);
+          void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+          CHECK(p != nullptr);
+          memset(p, t, num_bytes);
+          ptrs.push_back(p);
+          if (ptrs.size() > 32) {
+            a->DeallocateRaw(ptrs.front());
+            ptrs.erase(ptrs.begin());
+          }
+        }
+        for (void* p : ptrs) {
+          a->DeallocateRaw(p);
+        }
+      });
+    }
+  }
+
+  std::optional<AllocatorStats> stats = a->GetStats();
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->num_allocs, kNumThreads * kNumIters);
+  EXPECT_EQ(stats->largest_alloc_size, 4096);
+  EXPECT_GT(stats->peak_bytes_in_use, 0);
+}
+
+TEST(BFCAllocatorThreadCacheTest, ReleasesCachesOfExitedThreads) {
+  constexpr int kNumThreads = 16;
+  auto a = NewAllocator(1 << 20, /*thread_cache_capacity=*/16);
+  for (int t = 0; t < kNumThreads; ++t) {
+    // Each thread leaves idle chunks in its cache when it exits.
+    std::unique_ptr<Thread> thread(
+        Env::Default()->StartThread(ThreadOptions(), "bfc_test", [&a]() {
+          std::vector<void*> ptrs;
+          for (int i = 0; i < 8; ++i) {
+            ptrs.push_back(a->AllocateRaw(Allocator::kAllocatorAlignment, 512));
+            CHECK(ptrs.back() != nullptr);
+          }
+          for (void* p : ptrs) {
+            a->DeallocateRaw(p);
+          }
+        }));
+  }
+  EXPECT_EQ(a->GetStats()->bytes_in_use, 0);
+
+  // No chunk is held out of the bins by the caches of the exited threads.
+  MemoryDump md = a->RecordMemoryMap();
+  for (const auto& chunk : md.chunk()) {
+    EXPECT_FALSE(chunk.in_use());
+  }
+}
+
+// Args: thread cache capacity (0 disables the caches).
+void BM_AllocateSmall(::testing::benchmark::State& state) {
+  static BFCAllocator* allocator = nullptr;
+  if (state.thread_index() == 0) {
+    allocator = NewAllocator(size_t{1} << 30, state.range(0)).release();
+  }
+  constexpr int kBatchSize = 16;
+  void* ptrs[kBatchSize];
+  for (auto s : state) {
+    for (int i = 0; i < kBatchSize; ++i) {
+      ptrs[i] = allocator->AllocateRaw(Allocator::kAllocatorAlignment,
+                                       64 << (i % 8));
+    }
+    for (int i = 0; i < kBatchSize; ++i) {
+      allocator->DeallocateRaw(ptrs[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+  if (state.thread_index() == 0) {
+    delete allocator;
+    allocator = nullptr;
+  }
+}
+BENCHMARK(BM_AllocateSmall)->Arg(0)->Arg(64)->ThreadRange(1, 64);
+
+}  // namespace
+}  // namespace tsl